@@ -2,7 +2,9 @@
 #ifndef ARCH_IO_CONCURRENCY_HPP_
 #define ARCH_IO_CONCURRENCY_HPP_
 
+#include <errno.h>
 #include <pthread.h>
+#include <time.h>
 
 #include "errors.hpp"
 
@@ -55,6 +57,16 @@ public:
         int res = pthread_cond_wait(&c, &mutex->m);
         guarantee_xerr(res == 0, res, "Could not wait on pthread cond.");
     }
+    // Like `wait()`, but gives up at `deadline` (measured against `CLOCK_REALTIME`).
+    // Returns false if the deadline passed.
+    bool timed_wait(system_mutex_t *mutex, const struct timespec &deadline) {
+        int res = pthread_cond_timedwait(&c, &mutex->m, &deadline);
+        if (res == ETIMEDOUT) {
+            return false;
+        }
+        guarantee_xerr(res == 0, res, "Could not wait on pthread cond.");
+        return true;
+    }
     void signal() {
         int res = pthread_cond_signal(&c);
         guarantee_xerr(res == 0, res, "Could not signal pthread cond.");
@@ -28,6 +28,7 @@
 #include "arch/io/disk/conflict_resolving.hpp"
 #include "arch/io/disk/stats.hpp"
 #include "arch/io/disk/accounting.hpp"
+#include "arch/io/disk/scheduler.hpp"
 #include "backtrace.hpp"
 #include "config/args.hpp"
 #include "do_on_thread.hpp"
@@ -53,12 +54,15 @@ public:
     linux_disk_manager_t(linux_event_queue_t *queue,
                          int batch_factor,
                          int max_concurrent_io_requests,
+                         int64_t group_commit_delay_usec,
                          perfmon_collection_t *stats) :
         stack_stats(stats, "stack"),
         conflict_resolver(stats),
         accounter(batch_factor),
-        backend_stats(stats, "backend", accounter.producer),
-        backend(queue, backend_stats.producer, max_concurrent_io_requests),
+        scheduler(accounter.producer, max_concurrent_io_requests),
+        backend_stats(stats, "backend", scheduler.producer),
+        backend(queue, backend_stats.producer, max_concurrent_io_requests,
+                group_commit_delay_usec),
         outstanding_txn(0)
     {
         /* Hook up the `submit_fun`s of the parts of the IO stack that are above the
@@ -71,7 +75,8 @@ public:
 
         /* Hook up everything's `done_fun`. */
         backend.done_fun = std::bind(&stats_diskmgr_2_t::done, &backend_stats, ph::_1);
-        backend_stats.done_fun = std::bind(&accounting_diskmgr_t::done, &accounter, ph::_1);
+        backend_stats.done_fun = std::bind(&scheduler_diskmgr_t::done, &scheduler, ph::_1);
+        scheduler.done_fun = std::bind(&accounting_diskmgr_t::done, &accounter, ph::_1);
         accounter.done_fun = std::bind(&conflict_resolving_diskmgr_t::done,
                                        &conflict_resolver, ph::_1);
         conflict_resolver.done_fun = std::bind(&stats_diskmgr_t::done, &stack_stats, ph::_1);
@@ -84,8 +89,9 @@ public:
                 outstanding_txn);
     }
 
-    void *create_account(int pri, int outstanding_requests_limit) {
-        return new accounting_diskmgr_t::account_t(&accounter, pri, outstanding_requests_limit);
+    void *create_account(int pri, int outstanding_requests_limit, io_class_t io_class) {
+        return new accounting_diskmgr_t::account_t(&accounter, pri, outstanding_requests_limit,
+                                                   io_class);
     }
 
     void destroy_account(void *account) {
@@ -195,6 +201,7 @@ private:
     stats_diskmgr_t stack_stats;
     conflict_resolving_diskmgr_t conflict_resolver;
     accounting_diskmgr_t accounter;
+    scheduler_diskmgr_t scheduler;
     stats_diskmgr_2_t backend_stats;
     pool_diskmgr_t backend;
 
@@ -205,11 +212,13 @@ private:
 };
 
 io_backender_t::io_backender_t(file_direct_io_mode_t _direct_io_mode,
-                               int max_concurrent_io_requests)
+                               int max_concurrent_io_requests,
+                               int64_t group_commit_delay_usec)
     : direct_io_mode(_direct_io_mode),
       diskmgr(new linux_disk_manager_t(&linux_thread_pool_t::get_thread()->queue,
                                        DEFAULT_IO_BATCH_FACTOR,
                                        max_concurrent_io_requests,
+                                       group_commit_delay_usec,
                                        &stats)) { }
 
 io_backender_t::~io_backender_t() { }
@@ -370,9 +379,10 @@ bool linux_file_t::coop_lock_and_check() {
 #endif
 }
 
-void *linux_file_t::create_account(int priority, int outstanding_requests_limit) {
+void *linux_file_t::create_account(int priority, int outstanding_requests_limit,
+                                   io_class_t io_class) {
     assert_thread();
-    return diskmgr->create_account(priority, outstanding_requests_limit);
+    return diskmgr->create_account(priority, outstanding_requests_limit, io_class);
 }
 
 void linux_file_t::destroy_account(void *account) {
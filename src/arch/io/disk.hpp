@@ -17,6 +17,12 @@ const int DEFAULT_MAX_CONCURRENT_IO_REQUESTS = 64;
 // queue.  (A million is a ridiculously high value, but also safely nowhere near INT_MAX.)
 const int MAXIMUM_MAX_CONCURRENT_IO_REQUESTS = MILLION;
 
+// How long (in microseconds) the first datasync of a group commit batch waits for more
+// datasyncs on the same device to join it.  0 means that datasyncs only get merged
+// while waiting for an earlier flush of the device to finish.
+const int64_t DEFAULT_IO_GROUP_COMMIT_DELAY_USEC = 0;
+const int64_t MAXIMUM_IO_GROUP_COMMIT_DELAY_USEC = MILLION;
+
 struct iovec;
 
 class linux_iocallback_t;
@@ -29,7 +35,8 @@ public:
     // stops us from specifying this on a file-by-file basis, but right now there's no desire for
     // that.  See https://github.com/rethinkdb/rethinkdb/issues/97#issuecomment-19778177 .
     io_backender_t(file_direct_io_mode_t direct_io_mode,
-                   int max_concurrent_io_requests = DEFAULT_MAX_CONCURRENT_IO_REQUESTS);
+                   int max_concurrent_io_requests = DEFAULT_MAX_CONCURRENT_IO_REQUESTS,
+                   int64_t group_commit_delay_usec = DEFAULT_IO_GROUP_COMMIT_DELAY_USEC);
     ~io_backender_t();
     linux_disk_manager_t *get_diskmgr_ptr() { return diskmgr.get(); }
     file_direct_io_mode_t get_direct_io_mode() const;
@@ -83,7 +90,8 @@ public:
 
     bool coop_lock_and_check();
 
-    void *create_account(int priority, int outstanding_requests_limit);
+    void *create_account(int priority, int outstanding_requests_limit,
+                         io_class_t io_class);
     void destroy_account(void *account);
 
     ~linux_file_t();
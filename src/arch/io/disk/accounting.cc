@@ -49,9 +49,11 @@ private:
 
 accounting_diskmgr_account_t::accounting_diskmgr_account_t(accounting_diskmgr_t *_par,
                                                            int _pri,
-                                                           int _outstanding_requests_limit)
+                                                           int _outstanding_requests_limit,
+                                                           io_class_t _io_class)
         : par(_par), pri(_pri),
-          outstanding_requests_limit(_outstanding_requests_limit) { }
+          outstanding_requests_limit(_outstanding_requests_limit),
+          io_class(_io_class) { }
 
 accounting_diskmgr_account_t::~accounting_diskmgr_account_t() {
     par->assert_thread();
@@ -104,6 +106,7 @@ accounting_diskmgr_t::~accounting_diskmgr_t() {
 }
 
 void accounting_diskmgr_t::submit(action_t *a) {
+    a->io_class = a->account->get_io_class();
     a->account->push(a);
 }
 
@@ -11,7 +11,7 @@
 #include "concurrency/queue/unlimited_fifo.hpp"
 #include "concurrency/semaphore.hpp"
 #include "arch/io/disk.hpp"
-#include "arch/io/disk/stats_2.hpp"
+#include "arch/io/disk/scheduler.hpp"
 
 /* `casting_passive_producer_t` is useful when you have a
 `passive_producer_t<X>` but you need a `passive_producer_t<Y>`, where `X` can
@@ -34,7 +34,7 @@ private:
 /* `accounting_diskmgr_t` shares disk throughput proportionally between a
 number of different "accounts". */
 
-typedef stats_diskmgr_2_t::action_t accounting_payload_t;
+typedef scheduler_diskmgr_t::action_t accounting_payload_t;
 
 class accounting_diskmgr_t;
 
@@ -47,10 +47,13 @@ struct accounting_diskmgr_account_t {
 
     accounting_diskmgr_account_t(accounting_diskmgr_t *_par,
                                  int _pri,
-                                 int _outstanding_requests_limit);
+                                 int _outstanding_requests_limit,
+                                 io_class_t _io_class);
 
     ~accounting_diskmgr_account_t();
 
+    io_class_t get_io_class() const { return io_class; }
+
     void push(action_t *action);
     void on_semaphore_available();
     co_semaphore_t *get_outstanding_requests_limiter();
@@ -63,6 +66,7 @@ private:
     accounting_diskmgr_t *par;
     int pri;
     int outstanding_requests_limit;
+    io_class_t io_class;
     scoped_ptr_t<eager_account_t> eager_account;
     // A scoped pointer because we create the drainer lazily on first use.
     scoped_ptr_t<auto_drainer_t> requests_drainer;
@@ -0,0 +1,97 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "arch/io/disk/group_datasync.hpp"
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#include "arch/io/disk.hpp"
+#include "config/args.hpp"
+#include "time.hpp"
+
+group_datasync_t::group_datasync_t(int64_t _max_delay_usec,
+                                   const std::function<int(fd_t)> &_datasync_fn)
+    : max_delay_usec(_max_delay_usec), datasync_fn(_datasync_fn) {
+    guarantee(max_delay_usec >= 0
+              && max_delay_usec <= MAXIMUM_IO_GROUP_COMMIT_DELAY_USEC);
+}
+
+#ifdef _WIN32
+
+int group_datasync_t::datasync(fd_t fd, size_t *batch_size_out) {
+    // TODO WINDOWS: group datasyncs per volume.
+    *batch_size_out = 1;
+    return datasync_fn(fd);
+}
+
+#else
+
+int group_datasync_t::datasync(fd_t fd, size_t *batch_size_out) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        *batch_size_out = 1;
+        return datasync_fn(fd);
+    }
+
+    system_mutex_t::lock_t lock(&mutex);
+    device_t *device = &devices[st.st_dev];
+
+    std::shared_ptr<batch_t> batch = device->open_batch;
+    const bool is_leader = !batch;
+    if (is_leader) {
+        batch = std::make_shared<batch_t>();
+        device->open_batch = batch;
+    }
+    size_t file_index = 0;
+    while (file_index < batch->files.size() && batch->files[file_index].fd != fd) {
+        ++file_index;
+    }
+    if (file_index == batch->files.size()) {
+        batch->files.push_back(file_t(fd));
+    }
+    ++batch->size;
+
+    if (is_leader) {
+        bool delay_elapsed = max_delay_usec == 0;
+        struct timespec deadline = clock_realtime();
+        add_to_timespec(&deadline, max_delay_usec * THOUSAND);
+        while (!delay_elapsed && batch->size < MAX_GROUP_DATASYNC_BATCH_SIZE) {
+            delay_elapsed = !device->cond.timed_wait(&mutex, deadline);
+        }
+        // Close the batch.  Datasyncs that arrive from now on start a new one, which
+        // doesn't wait for our flushes.
+        device->open_batch.reset();
+        batch->closed = true;
+        device->cond.broadcast();
+    } else {
+        if (batch->size >= MAX_GROUP_DATASYNC_BATCH_SIZE) {
+            // Wake up the leader, it doesn't have to wait any longer.
+            device->cond.broadcast();
+        }
+        while (!batch->closed) {
+            device->cond.wait(&mutex);
+        }
+    }
+
+    // Every file gets its own datasync, whose result goes to the datasyncs of that
+    // file only.  A single `syncfs()` would be cheaper, but it also writes back the
+    // dirty pages of every other file on the file system, and kernels before 5.8
+    // don't report writeback errors from it.
+    if (!batch->files[file_index].claimed) {
+        batch->files[file_index].claimed = true;
+        lock.unlock();
+        const int result = datasync_fn(fd);
+        system_mutex_t::lock_t relock(&mutex);
+        batch->files[file_index].result = result;
+        batch->files[file_index].done = true;
+        device->cond.broadcast();
+    } else {
+        while (!batch->files[file_index].done) {
+            device->cond.wait(&mutex);
+        }
+    }
+    *batch_size_out = batch->size;
+    return batch->files[file_index].result;
+}
+
+#endif  // _WIN32
@@ -0,0 +1,78 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef ARCH_IO_DISK_GROUP_DATASYNC_HPP_
+#define ARCH_IO_DISK_GROUP_DATASYNC_HPP_
+
+#include <sys/types.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "arch/io/concurrency.hpp"
+#include "arch/io/disk.hpp"
+#include "arch/types.hpp"
+#include "errors.hpp"
+
+/* `group_datasync_t` merges the datasyncs that the blocker pool threads of a
+`pool_diskmgr_t` perform for hard durability writes (metablock writes and their
+surrounding datasyncs), so that concurrent writers of the same file share a single
+flush of it instead of each paying for its own.
+
+Datasyncs are grouped per device: the first datasync of a batch becomes its leader,
+and waits until either the group commit delay has elapsed or the batch is full.  Then
+the batch is closed, and every distinct file of the batch is datasynced once, by the
+first of its datasyncs, on that one's blocker pool thread.  So the files of a batch are
+flushed in parallel, and so are the batches of a device, which don't wait for each
+other.  The other datasyncs of a file wait for that flush and get its result.
+
+A datasync only joins a batch that hasn't been closed yet, so it is still covered by
+the flush of everything that was written before it was called. */
+
+class group_datasync_t {
+public:
+    // `datasync_fn` flushes a single file; the tests replace `perform_datasync()`.
+    explicit group_datasync_t(
+        int64_t max_delay_usec,
+        const std::function<int(fd_t)> &datasync_fn = &perform_datasync);
+
+    // Blocks until everything that has been written to `fd` is on disk.  Must be
+    // called from a blocker pool thread.  Returns 0 or an errno value, like
+    // `perform_datasync()`.  `*batch_size_out` is set to the number of datasyncs
+    // in its batch.
+    int datasync(fd_t fd, size_t *batch_size_out);
+
+private:
+#ifndef _WIN32
+    struct file_t {
+        explicit file_t(fd_t _fd) : fd(_fd), claimed(false), done(false), result(0) { }
+        fd_t fd;
+        // Whether a datasync of the file has taken on its flush, and finished it.
+        bool claimed;
+        bool done;
+        int result;
+    };
+
+    struct batch_t {
+        batch_t() : size(0), closed(false) { }
+        std::vector<file_t> files;   // distinct
+        size_t size;
+        bool closed;
+    };
+
+    struct device_t {
+        std::shared_ptr<batch_t> open_batch;
+        system_cond_t cond;
+    };
+
+    system_mutex_t mutex;
+    std::map<dev_t, device_t> devices;
+#endif
+
+    const int64_t max_delay_usec;
+    const std::function<int(fd_t)> datasync_fn;
+
+    DISABLE_COPYING(group_datasync_t);
+};
+
+#endif  // ARCH_IO_DISK_GROUP_DATASYNC_HPP_
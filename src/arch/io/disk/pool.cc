@@ -37,10 +37,12 @@ void debug_print(printf_buffer_t *buf,
 
 pool_diskmgr_t::pool_diskmgr_t(linux_event_queue_t *queue,
                                passive_producer_t<action_t *> *_source,
-                               int max_concurrent_io_requests)
+                               int max_concurrent_io_requests,
+                               int64_t group_commit_delay_usec)
     : queue_depth(blocker_pool_queue_depth(max_concurrent_io_requests)),
       source(_source),
       blocker_pool(max_concurrent_io_requests, queue),
+      group_datasync(group_commit_delay_usec),
       n_pending(0) {
     if (source->available->get()) { pump(); }
     source->available->set_callback(this);
@@ -152,9 +154,19 @@ int64_t pool_diskmgr_t::action_t::perform_read_write(iovec *vecs,
     return total_bytes;
 }
 
+int pool_diskmgr_t::action_t::perform_group_datasync() {
+    rassert(num_datasyncs < 2);
+    ticks_t start = get_ticks();
+    int errcode = parent->group_datasync.datasync(fd, &datasync_batch_sizes[num_datasyncs]);
+    datasync_ticks[num_datasyncs] = get_ticks() - start;
+    ++num_datasyncs;
+    return errcode;
+}
+
 void pool_diskmgr_t::action_t::run() {
+    num_datasyncs = 0;
     if (wrap_in_datasyncs) {
-        int errcode = perform_datasync(fd);
+        int errcode = perform_group_datasync();
         if (errcode != 0) {
             io_result = -errcode;
             return;
@@ -199,7 +211,7 @@ void pool_diskmgr_t::action_t::run() {
     }
 
     if (wrap_in_datasyncs) {
-        int errcode = perform_datasync(fd);
+        int errcode = perform_group_datasync();
         if (errcode != 0) {
             io_result = -errcode;
             return;
@@ -9,8 +9,10 @@
 
 #include "arch/runtime/event_queue.hpp"
 #include "arch/io/blocker_pool.hpp"
+#include "arch/io/disk/group_datasync.hpp"
 #include "concurrency/queue/passive_producer.hpp"
 #include "containers/scoped.hpp"
+#include "time.hpp"
 
 #ifndef __linux__
 #define USE_WRITEV 0
@@ -93,6 +95,18 @@ struct pool_diskmgr_action_t
     int64_t get_offset() const { return offset; }
     int64_t get_size_change() const { return size_change; }
 
+    // For actions that were wrapped in datasyncs: how many datasyncs were merged into
+    // the flush that ended each of them, and how long the action spent in them.
+    int get_num_datasyncs() const { return num_datasyncs; }
+    size_t get_datasync_batch_size(int i) const {
+        rassert(i >= 0 && i < num_datasyncs);
+        return datasync_batch_sizes[i];
+    }
+    ticks_t get_datasync_ticks(int i) const {
+        rassert(i >= 0 && i < num_datasyncs);
+        return datasync_ticks[i];
+    }
+
     void set_successful_due_to_conflict() { io_result = get_count(); }
     bool get_succeeded() const { return io_result == static_cast<int64_t>(get_count()); }
     int get_io_errno() const {
@@ -128,6 +142,11 @@ private:
 
     int64_t io_result;
 
+    int perform_group_datasync();
+    int num_datasyncs;
+    size_t datasync_batch_sizes[2];
+    ticks_t datasync_ticks[2];
+
     void run();
     void done();
 
@@ -145,7 +164,7 @@ public:
     /* The `pool_diskmgr_t` will draw actions to run from `source`. It will call `done_fun`
     on each one when it's done. */
     pool_diskmgr_t(linux_event_queue_t *queue, passive_producer_t<action_t *> *source,
-                   int max_concurrent_io_requests);
+                   int max_concurrent_io_requests, int64_t group_commit_delay_usec);
     std::function<void(action_t *)> done_fun;
     ~pool_diskmgr_t();
 
@@ -153,6 +172,7 @@ private:
     const int queue_depth;
     passive_producer_t<action_t *> *source;
     blocker_pool_t blocker_pool;
+    group_datasync_t group_datasync;
 
     void on_source_availability_changed();
     int n_pending;
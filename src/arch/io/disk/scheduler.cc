@@ -0,0 +1,194 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "arch/io/disk/scheduler.hpp"
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <initializer_list>
+
+#include "config/args.hpp"
+#include "containers/printf_buffer.hpp"
+
+void debug_print(printf_buffer_t *buf,
+                 const scheduler_diskmgr_action_t &action) {
+    buf->appendf("scheduler_diskmgr_action{io_class=%d, deadline=%" PRIu64 "}<",
+                 static_cast<int>(action.io_class), action.deadline);
+    const stats_diskmgr_2_t::action_t &parent_action = action;
+    debug_print(buf, parent_action);
+}
+
+scheduler_diskmgr_t::scheduler_diskmgr_t(passive_producer_t<action_t *> *_source,
+                                         int max_concurrent_io_requests)
+    : passive_producer_t<stats_diskmgr_2_t::action_t *>(&availability),
+      producer(this),
+      source(_source),
+      filling(false),
+      total_in_flight(0),
+      queued_foreground(0),
+      window(IO_SCHEDULER_WINDOW_FACTOR * max_concurrent_io_requests),
+      max_background_depth(max_concurrent_io_requests),
+      background_depth(max_concurrent_io_requests),
+      interactive_latency(0),
+      interactive_samples(0) {
+    guarantee(max_concurrent_io_requests > 0);
+    for (int i = 0; i < num_io_classes; ++i) {
+        buckets[i].tokens = IO_SCHEDULER_THROTTLED_BURST;
+        in_flight[i] = 0;
+    }
+    source->available->set_callback(this);
+    fill();
+    update_availability();
+}
+
+scheduler_diskmgr_t::~scheduler_diskmgr_t() {
+    assert_thread();
+    source->available->unset_callback();
+    for (int i = 0; i < num_io_classes; ++i) {
+        rassert(queues[i].empty());
+        rassert(in_flight[i] == 0);
+    }
+}
+
+ticks_t scheduler_diskmgr_t::deadline_of(io_class_t io_class) {
+    int64_t ms;
+    switch (io_class) {
+    case io_class_t::interactive: ms = IO_SCHEDULER_INTERACTIVE_TARGET_MS; break;
+    case io_class_t::flush: ms = IO_SCHEDULER_FLUSH_DEADLINE_MS; break;
+    case io_class_t::gc: ms = IO_SCHEDULER_GC_DEADLINE_MS; break;
+    case io_class_t::background: ms = IO_SCHEDULER_BACKGROUND_DEADLINE_MS; break;
+    default: unreachable();
+    }
+    return ms * MILLION;
+}
+
+void scheduler_diskmgr_t::on_source_availability_changed() {
+    assert_thread();
+    /* `fill()` itself makes the source unavailable when it takes its last request,
+    in which case there is nothing to do. */
+    if (filling) {
+        return;
+    }
+    fill();
+    update_availability();
+}
+
+void scheduler_diskmgr_t::fill() {
+    if (filling) {
+        return;
+    }
+    filling = true;
+    const ticks_t now = get_ticks();
+    while (source->available->get() && queued_foreground < window) {
+        action_t *a = source->pop();
+        a->deadline = now + deadline_of(a->io_class);
+        queues[static_cast<int>(a->io_class)].push_back(a);
+        if (is_foreground(a->io_class)) {
+            ++queued_foreground;
+        }
+    }
+    filling = false;
+}
+
+bool scheduler_diskmgr_t::has_token(io_class_t io_class, ticks_t now) {
+    token_bucket_t *bucket = &buckets[static_cast<int>(io_class)];
+    if (now > bucket->last_refill) {
+        bucket->tokens = std::min<double>(
+            IO_SCHEDULER_THROTTLED_BURST,
+            bucket->tokens
+            + ticks_to_secs(now - bucket->last_refill) * IO_SCHEDULER_THROTTLED_RATE);
+        bucket->last_refill = now;
+    }
+    return bucket->tokens >= 1;
+}
+
+bool scheduler_diskmgr_t::choose(ticks_t now, io_class_t *io_class_out) {
+    // 1. Requests that have missed their deadline, earliest deadline first.
+    const action_t *earliest = nullptr;
+    for (int i = 0; i < num_io_classes; ++i) {
+        const action_t *head = queues[i].head();
+        if (head != nullptr && head->deadline <= now
+            && (earliest == nullptr || head->deadline < earliest->deadline)) {
+            earliest = head;
+        }
+    }
+    if (earliest != nullptr) {
+        *io_class_out = earliest->io_class;
+        return true;
+    }
+
+    // 2. Foreground requests.
+    for (io_class_t c : { io_class_t::interactive, io_class_t::flush }) {
+        if (!queues[static_cast<int>(c)].empty()) {
+            *io_class_out = c;
+            return true;
+        }
+    }
+
+    // 3. Whatever is left of the disk goes to GC and background requests.
+    for (io_class_t c : { io_class_t::gc, io_class_t::background }) {
+        if (!queues[static_cast<int>(c)].empty()
+            && (!foreground_in_flight()
+                || (total_in_flight < background_depth && has_token(c, now)))) {
+            *io_class_out = c;
+            return true;
+        }
+    }
+    return false;
+}
+
+void scheduler_diskmgr_t::update_availability() {
+    io_class_t io_class;
+    availability.set_available(choose(get_ticks(), &io_class));
+}
+
+stats_diskmgr_2_t::action_t *scheduler_diskmgr_t::produce_next_value() {
+    assert_thread();
+    const ticks_t now = get_ticks();
+    io_class_t io_class;
+    DEBUG_VAR bool chosen = choose(now, &io_class);
+    rassert(chosen);
+
+    const int i = static_cast<int>(io_class);
+    action_t *a = queues[i].head();
+    queues[i].pop_front();
+    if (is_foreground(io_class)) {
+        --queued_foreground;
+    } else if (foreground_in_flight() && has_token(io_class, now)) {
+        buckets[i].tokens -= 1;
+    }
+    ++in_flight[i];
+    ++total_in_flight;
+    a->dispatch_time = now;
+
+    fill();
+    update_availability();
+    return a;
+}
+
+void scheduler_diskmgr_t::done(stats_diskmgr_2_t::action_t *p) {
+    assert_thread();
+    action_t *a = static_cast<action_t *>(p);
+    --in_flight[static_cast<int>(a->io_class)];
+    --total_in_flight;
+    if (a->io_class == io_class_t::interactive) {
+        record_interactive_latency(get_ticks() - a->dispatch_time);
+    }
+    update_availability();
+    done_fun(a);
+}
+
+void scheduler_diskmgr_t::record_interactive_latency(ticks_t latency) {
+    // An exponentially weighted moving average with a weight of 1/8 for the newest
+    // sample.  The depth is adapted once every 16 samples, additively up and
+    // multiplicatively down.
+    interactive_latency += (static_cast<double>(latency) - interactive_latency) / 8;
+    if (++interactive_samples < 16) {
+        return;
+    }
+    interactive_samples = 0;
+    if (interactive_latency > IO_SCHEDULER_INTERACTIVE_TARGET_MS * MILLION) {
+        background_depth = std::max(1, background_depth / 2);
+    } else {
+        background_depth = std::min(max_background_depth, background_depth + 1);
+    }
+}
@@ -0,0 +1,117 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef ARCH_IO_DISK_SCHEDULER_HPP_
+#define ARCH_IO_DISK_SCHEDULER_HPP_
+
+#include <functional>
+
+#include "arch/io/disk/stats_2.hpp"
+#include "arch/types.hpp"
+#include "concurrency/queue/passive_producer.hpp"
+#include "containers/intrusive_list.hpp"
+#include "time.hpp"
+
+struct scheduler_diskmgr_action_t
+    : public intrusive_list_node_t<scheduler_diskmgr_action_t>,
+      public stats_diskmgr_2_t::action_t {
+    io_class_t io_class;
+    // When the request should have been dispatched by.
+    ticks_t deadline;
+    ticks_t dispatch_time;
+};
+
+void debug_print(printf_buffer_t *buf,
+                 const scheduler_diskmgr_action_t &action);
+
+/* `scheduler_diskmgr_t` sits between the `accounting_diskmgr_t` and the
+`pool_diskmgr_t`, and decides which request goes to the disk next based on the latency
+class of its account (see `io_class_t`).
+
+It takes requests from the accounting queue into one FIFO queue per class, as long as
+fewer than `IO_SCHEDULER_WINDOW_FACTOR` times the maximum number of concurrent requests
+of interactive and flush requests are waiting.  Every request gets a deadline by which
+it should be dispatched.  The next request is:
+ 1. the one with the earliest deadline among the requests whose deadline has passed,
+ 2. otherwise the oldest interactive request, then the oldest flush request,
+ 3. otherwise the oldest GC request, then the oldest background request.  If
+    interactive or flush requests are in flight, these are only dispatched while
+    fewer than `background_depth` requests are in flight and the token bucket of
+    their class has a token.
+
+`background_depth` adapts to the disk: the scheduler measures how long interactive
+requests take once they have been dispatched, and halves the depth when that is above
+`IO_SCHEDULER_INTERACTIVE_TARGET_MS` and raises it by one otherwise.
+
+The scheduler only throttles while foreground requests are in flight, so the
+completion of one of them is always a chance to dispatch again, and it doesn't need a
+timer.  Like the rest of the disk stack, it runs on the disk manager's home thread. */
+
+class scheduler_diskmgr_t
+    : public home_thread_mixin_debug_only_t,
+      private availability_callback_t,
+      private passive_producer_t<stats_diskmgr_2_t::action_t *> {
+public:
+    typedef scheduler_diskmgr_action_t action_t;
+
+    scheduler_diskmgr_t(passive_producer_t<action_t *> *_source,
+                        int max_concurrent_io_requests);
+    ~scheduler_diskmgr_t();
+
+    std::function<void (action_t *)> done_fun;
+
+    passive_producer_t<stats_diskmgr_2_t::action_t *> *const producer;
+    void done(stats_diskmgr_2_t::action_t *p);
+
+    int get_background_depth() const { return background_depth; }
+
+private:
+    static const int num_io_classes = 4;
+
+    struct token_bucket_t {
+        token_bucket_t() : tokens(0), last_refill(0) { }
+        double tokens;
+        ticks_t last_refill;
+    };
+
+    static ticks_t deadline_of(io_class_t io_class);
+    static bool is_foreground(io_class_t io_class) {
+        return io_class == io_class_t::interactive || io_class == io_class_t::flush;
+    }
+
+    bool foreground_in_flight() const {
+        return in_flight[static_cast<int>(io_class_t::interactive)] > 0
+            || in_flight[static_cast<int>(io_class_t::flush)] > 0;
+    }
+
+    void on_source_availability_changed();
+    stats_diskmgr_2_t::action_t *produce_next_value();
+
+    // Takes requests from `source` until the window is full.
+    void fill();
+    // Picks the class of the next request to dispatch.  Returns false if no request
+    // can be dispatched right now.
+    bool choose(ticks_t now, io_class_t *io_class_out);
+    bool has_token(io_class_t io_class, ticks_t now);
+    void update_availability();
+    void record_interactive_latency(ticks_t latency);
+
+    passive_producer_t<action_t *> *const source;
+    availability_control_t availability;
+    bool filling;
+
+    intrusive_list_t<action_t> queues[num_io_classes];
+    token_bucket_t buckets[num_io_classes];
+    int in_flight[num_io_classes];
+    int total_in_flight;
+    int queued_foreground;
+
+    const int window;
+    const int max_background_depth;
+    int background_depth;
+    // Exponentially weighted moving average of the interactive latency, in ticks.
+    double interactive_latency;
+    int interactive_samples;
+
+    DISABLE_COPYING(scheduler_diskmgr_t);
+};
+
+#endif  // ARCH_IO_DISK_SCHEDULER_HPP_
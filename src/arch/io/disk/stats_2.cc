@@ -23,9 +23,13 @@ stats_diskmgr_2_t::stats_diskmgr_2_t(
     source(_source),
     read_sampler(secs_to_ticks(1), false, get_num_threads()),
     write_sampler(secs_to_ticks(1), false, get_num_threads()),
+    datasync_batch_size(get_num_threads()),
+    datasync_latency(get_num_threads()),
     stats_membership(stats,
                      &read_sampler, (name + "_read").c_str(),
-                     &write_sampler, (name + "_write").c_str()) { }
+                     &write_sampler, (name + "_write").c_str(),
+                     &datasync_batch_size, (name + "_datasync_batch_size").c_str(),
+                     &datasync_latency, (name + "_datasync_latency_us").c_str()) { }
 
 
 void stats_diskmgr_2_t::done(pool_diskmgr_t::action_t *p) {
@@ -35,6 +39,11 @@ void stats_diskmgr_2_t::done(pool_diskmgr_t::action_t *p) {
     } else {
         write_sampler.end(&a->start_time);
     }
+    // The datasyncs ran on a blocker pool thread, so we record them here instead.
+    for (int i = 0; i < a->get_num_datasyncs(); ++i) {
+        datasync_batch_size.record(a->get_datasync_batch_size(i));
+        datasync_latency.record(a->get_datasync_ticks(i) / static_cast<double>(THOUSAND));
+    }
     done_fun(a);
 }
 
@@ -33,6 +33,9 @@ private:
 
     passive_producer_t<action_t *> *source;
     perfmon_duration_sampler_t read_sampler, write_sampler;
+    // How many datasyncs shared each flush, and how long (in microseconds) the
+    // datasyncs took, group commit delay included.
+    perfmon_histogram_t datasync_batch_size, datasync_latency;
     perfmon_multi_membership_t stats_membership;
 };
 
@@ -35,9 +35,7 @@
 #include "perfmon/perfmon.hpp"
 #include "utils.hpp"
 
-#ifdef _WIN32
 #include "concurrency/pmap.hpp"
-#endif
 
 #ifdef TRACE_WINSOCK
 #define winsock_debugf(...) debugf("winsock: " __VA_ARGS__)
@@ -1261,10 +1259,12 @@ void linux_tcp_conn_descriptor_t::make_server_connection(
 /* Network listener object */
 linux_nonthrowing_tcp_listener_t::linux_nonthrowing_tcp_listener_t(
          const std::set<ip_address_t> &bind_addresses, int _port,
-         const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &cb) :
+         const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &cb,
+         bool _reuse_port) :
     callback(cb),
     local_addresses(bind_addresses),
     port(_port),
+    reuse_port(_reuse_port),
     bound(false),
     socks(),
     last_used_socket_index(0),
@@ -1370,6 +1370,13 @@ int linux_nonthrowing_tcp_listener_t::init_sockets() {
         // to be re-bound quickly (e.g. if you restart the server).
         int res = setsockopt(sock_fd, SOL_SOCKET, SO_REUSEADDR, &sockoptval, sizeof(sockoptval)); 
         guarantee_err(res != -1, "Could not set REUSEADDR option");
+#ifdef SO_REUSEPORT
+        if (reuse_port) {
+            res = setsockopt(sock_fd, SOL_SOCKET, SO_REUSEPORT,
+                             &sockoptval, sizeof(sockoptval));
+            guarantee_err(res != -1, "Could not set REUSEPORT option");
+        }
+#endif
 #endif
         /* XXX Making our socket NODELAY prevents the problem where responses to
          * pipelined requests are delayed, since the TCP Nagle algorithm will
@@ -1703,6 +1710,81 @@ int linux_tcp_listener_t::get_port() const {
     return listener->get_port();
 }
 
+linux_sharded_tcp_listener_t::linux_sharded_tcp_listener_t(
+    const std::set<ip_address_t> &bind_addresses,
+    int _port,
+    int num_threads,
+    const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback) :
+        port(_port) {
+#ifndef SO_REUSEPORT
+    num_threads = 1;
+#endif
+    guarantee(num_threads > 0);
+    listeners.init(num_threads);
+
+    bool listening = true;
+    {
+        on_thread_t thread_switcher((threadnum_t(0)));
+        if (num_threads > 1) {
+            // A socket bound with `SO_REUSEPORT` may share its port with any other
+            // socket of the same user that was bound with it, such as the listener of
+            // another server on the same port.  So we first bind a socket without it,
+            // which fails if anybody else is on the port and which picks the port if we
+            // were given `ANY_PORT`.  Only a server that binds the port in the moment
+            // between closing that socket and binding the listeners can still share it.
+            try {
+                linux_tcp_bound_socket_t probe(bind_addresses, port);
+                port = probe.get_port();
+            } catch (const tcp_socket_exc_t &) {
+                listening = false;
+            }
+        }
+        if (listening) {
+            // The first listener picks the port if we were given `ANY_PORT` and there
+            // is no sharding, and the others bind to the same one.
+            listeners[0].init(new linux_nonthrowing_tcp_listener_t(
+                bind_addresses, port, callback, num_threads > 1));
+            listening = listeners[0]->begin_listening();
+            port = listeners[0]->get_port();
+        }
+    }
+    if (listening) {
+        // Every thread writes only its own result, so that they don't race.
+        scoped_array_t<bool> thread_listening(num_threads);
+        thread_listening[0] = true;
+        pmap(static_cast<int64_t>(1), static_cast<int64_t>(num_threads),
+             [&](int64_t i) {
+                on_thread_t thread_switcher((threadnum_t(i)));
+                listeners[i].init(new linux_nonthrowing_tcp_listener_t(
+                    bind_addresses, port, callback, true));
+                thread_listening[i] = listeners[i]->begin_listening();
+            });
+        for (size_t i = 0; i < thread_listening.size(); ++i) {
+            listening = listening && thread_listening[i];
+        }
+    }
+
+    if (!listening) {
+        reset_listeners();
+        throw address_in_use_exc_t("localhost", port);
+    }
+}
+
+linux_sharded_tcp_listener_t::~linux_sharded_tcp_listener_t() {
+    reset_listeners();
+}
+
+int linux_sharded_tcp_listener_t::get_port() const {
+    return port;
+}
+
+void linux_sharded_tcp_listener_t::reset_listeners() {
+    pmap(listeners.size(), [&](int64_t i) {
+        on_thread_t thread_switcher((threadnum_t(i)));
+        listeners[i].reset();
+    });
+}
+
 linux_repeated_nonthrowing_tcp_listener_t::linux_repeated_nonthrowing_tcp_listener_t(
     const std::set<ip_address_t> &bind_addresses,
     int port,
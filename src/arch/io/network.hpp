@@ -454,8 +454,11 @@ the provided callback will be called in a new coroutine every time something con
 
 class linux_nonthrowing_tcp_listener_t : private linux_event_callback_t {
 public:
+    // If `_reuse_port` is true, the sockets are bound with `SO_REUSEPORT`, so that
+    // other listeners can bind to the same port and share its connections.
     linux_nonthrowing_tcp_listener_t(const std::set<ip_address_t> &bind_addresses, int _port,
-        const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback);
+        const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback,
+        bool _reuse_port = false);
 
     ~linux_nonthrowing_tcp_listener_t();
 
@@ -501,6 +504,9 @@ private:
     // The port we're asked to bind to
     int port;
 
+    // Whether the sockets are bound with `SO_REUSEPORT`
+    bool reuse_port;
+
     // Inidicates successful binding to a port
     bool bound;
 
@@ -541,6 +547,31 @@ private:
     scoped_ptr_t<linux_nonthrowing_tcp_listener_t> listener;
 };
 
+/* Listens on a port with one socket per thread for the first `num_threads` threads,
+bound with `SO_REUSEPORT`, so that the kernel spreads the incoming connections over the
+threads instead of one thread accepting all of them.  The callback is called on the
+thread that accepted the connection.  Where `SO_REUSEPORT` isn't available, there is a
+single socket on the first thread.  Like `linux_tcp_listener_t`, it throws
+`address_in_use_exc_t` if the port is taken, even by other `SO_REUSEPORT` sockets. */
+class linux_sharded_tcp_listener_t {
+public:
+    linux_sharded_tcp_listener_t(const std::set<ip_address_t> &bind_addresses, int port,
+        int num_threads,
+        const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback);
+    ~linux_sharded_tcp_listener_t();
+
+    int get_port() const;
+
+private:
+    // Destroys the listeners on their threads.
+    void reset_listeners();
+
+    int port;
+    scoped_array_t<scoped_ptr_t<linux_nonthrowing_tcp_listener_t> > listeners;
+
+    DISABLE_COPYING(linux_sharded_tcp_listener_t);
+};
+
 /* Like a linux tcp listener but repeatedly tries to bind to its port until successful */
 class linux_repeated_nonthrowing_tcp_listener_t {
 public:
@@ -88,6 +88,9 @@ typedef linux_nonthrowing_tcp_listener_t non_throwing_tcp_listener_t;
 class linux_tcp_listener_t;
 typedef linux_tcp_listener_t tcp_listener_t;
 
+class linux_sharded_tcp_listener_t;
+typedef linux_sharded_tcp_listener_t sharded_tcp_listener_t;
+
 class linux_repeated_nonthrowing_tcp_listener_t;
 typedef linux_repeated_nonthrowing_tcp_listener_t repeated_nonthrowing_tcp_listener_t;
 
@@ -105,6 +108,16 @@ enum class file_direct_io_mode_t {
     buffered_desired
 };
 
+// The latency class of the I/O requests of a `file_account_t`.  The disk scheduler
+// (arch/io/disk/scheduler.hpp) serves `interactive` and `flush` requests first and
+// lets `gc` and `background` requests use the bandwidth that is left.
+enum class io_class_t {
+    interactive,    // reads that a query is waiting for
+    flush,          // writes of the cache and the serializer's index
+    gc,             // garbage collection of the serializer
+    background      // backfills, secondary index construction, cache warm-up
+};
+
 // A linux file.  It expects reads and writes and buffers to have an
 // alignment of DEVICE_BLOCK_SIZE.
 class file_t {
@@ -127,7 +140,8 @@ public:
     virtual void writev_async(int64_t offset, size_t length, scoped_array_t<iovec> &&bufs,
                               file_account_t *account, linux_iocallback_t *cb) = 0;
 
-    virtual void *create_account(int priority, int outstanding_requests_limit) = 0;
+    virtual void *create_account(int priority, int outstanding_requests_limit,
+                                 io_class_t io_class) = 0;
     virtual void destroy_account(void *account) = 0;
 
     virtual bool coop_lock_and_check() = 0;
@@ -138,7 +152,9 @@ private:
 
 class file_account_t {
 public:
-    file_account_t(file_t *f, int p, int outstanding_requests_limit = UNLIMITED_OUTSTANDING_REQUESTS);
+    file_account_t(file_t *f, int p,
+                   int outstanding_requests_limit = UNLIMITED_OUTSTANDING_REQUESTS,
+                   io_class_t io_class = io_class_t::flush);
     ~file_account_t();
     void *get_account() { return account; }
 
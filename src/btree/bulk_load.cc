@@ -0,0 +1,168 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "btree/bulk_load.hpp"
+
+#include <stddef.h>
+
+#include <algorithm>
+
+#include "btree/internal_node.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
+#include "btree/operations.hpp"
+#include "config/args.hpp"
+
+btree_bulk_loader_t::btree_bulk_loader_t(value_sizer_t *sizer,
+                                         superblock_t *superblock,
+                                         repli_timestamp_t timestamp)
+    : sizer_(sizer),
+      superblock_(superblock),
+      timestamp_(timestamp),
+      leaf_target_size_(
+          (sizer->block_size().value() - offsetof(leaf_node_t, pair_offsets))
+          * BTREE_BULK_LOAD_FILL_FACTOR),
+      // An internal node always has to take one more child than the target size
+      // allows (see `add_child()`), which must not make it full.
+      internal_target_size_(std::min<int>(
+          (sizer->block_size().value() - sizeof(internal_node_t))
+          * BTREE_BULK_LOAD_FILL_FACTOR,
+          sizer->block_size().value() - sizeof(internal_node_t)
+          - 2 * (INTERNAL_EPSILON + sizeof(uint16_t)))),
+      leaf_(nullptr),
+      num_pairs_(0),
+      finished_(false) {
+    guarantee(superblock->get_root_block_id() == NULL_BLOCK_ID,
+              "Bulk loading into a B-tree that isn't empty.");
+}
+
+btree_bulk_loader_t::~btree_bulk_loader_t() { }
+
+int btree_bulk_loader_t::child_size(const store_key_t &last_key) {
+    return sizeof(uint16_t) + sizeof(block_id_t) + 1 + last_key.size();
+}
+
+void btree_bulk_loader_t::add(const btree_key_t *key, const void *value) {
+    rassert(!finished_);
+    rassert(num_pairs_ == 0 || btree_key_cmp(last_key_.btree_key(), key) < 0);
+
+    if (leaf_ == nullptr) {
+        start_leaf();
+    } else {
+        // The size of the entry and its offset, as `leaf_node_t::live_size` counts it.
+        const int entry_size = sizeof(uint16_t) + 1 + key->size + sizer_->size(value);
+        if (leaf_->live_size + entry_size > leaf_target_size_
+            || leaf::is_full(sizer_, leaf_, key, value)) {
+            finish_leaf(false);
+            start_leaf();
+        }
+    }
+    rassert(!leaf::is_full(sizer_, leaf_, key, value));
+    leaf::insert(sizer_, leaf_, key, value, timestamp_, leaf_buf_.get_recency());
+    last_key_.assign(key);
+    ++num_pairs_;
+}
+
+void btree_bulk_loader_t::finish() {
+    rassert(!finished_);
+    finished_ = true;
+    if (num_pairs_ == 0) {
+        return;
+    }
+    finish_leaf(true);
+
+    // Write what is left of every level.  Only the top level can end up with a single
+    // child, which then is the root.
+    size_t level = 0;
+    while (level + 1 < levels_.size() || levels_[level].children.size() > 1) {
+        rassert(levels_[level].children.size() >= 2);
+        write_internal_node(level, levels_[level].children.size());
+        ++level;
+    }
+    superblock_->set_root_block_id(levels_[level].children[0].block_id);
+
+    // The stat block is detached from the rest of the btree (see
+    // `apply_keyvalue_change()`).
+    const block_id_t stat_block_id = superblock_->get_stat_block_id();
+    if (stat_block_id != NULL_BLOCK_ID) {
+        buf_lock_t stat_block(buf_parent_t(superblock_->expose_buf().txn()),
+                              stat_block_id, access_t::write);
+        buf_write_t stat_block_write(&stat_block);
+        auto stat_block_buf = static_cast<btree_statblock_t *>(
+                stat_block_write.get_data_write(BTREE_STATBLOCK_SIZE));
+        stat_block_buf->population += num_pairs_;
+    }
+}
+
+void btree_bulk_loader_t::start_leaf() {
+    rassert(leaf_ == nullptr);
+    leaf_buf_ = buf_lock_t(superblock_->expose_buf(), alt_create_t::create);
+    leaf_buf_.set_recency(superceding_recency(timestamp_, leaf_buf_.get_recency()));
+    leaf_write_.init(new buf_write_t(&leaf_buf_));
+    leaf_ = static_cast<leaf_node_t *>(leaf_write_->get_data_write());
+    leaf::init(sizer_, leaf_);
+}
+
+void btree_bulk_loader_t::finish_leaf(bool is_last) {
+    rassert(leaf_ != nullptr);
+    // The keys of the leaf are now known to be in (`previous_leaf_last_key_`,
+    // `last_key_`], except for the last leaf, which has no upper bound.
+    if (!is_last && previous_leaf_last_key_.has()) {
+        leaf::extend_prefix(sizer_, leaf_, previous_leaf_last_key_->btree_key(),
+                            last_key_.btree_key());
+    }
+    const block_id_t block_id = leaf_buf_.block_id();
+    leaf_ = nullptr;
+    leaf_write_.reset();
+    leaf_buf_.reset_buf_lock();
+
+    previous_leaf_last_key_ = make_scoped<store_key_t>(last_key_);
+    add_child(0, last_key_, block_id);
+}
+
+void btree_bulk_loader_t::add_child(size_t level,
+                                    const store_key_t &last_key,
+                                    block_id_t block_id) {
+    rassert(level <= levels_.size());
+    if (level == levels_.size()) {
+        levels_.emplace_back();
+    }
+    level_t *l = &levels_[level];
+    l->children.push_back(child_t{last_key, block_id});
+    l->size += child_size(last_key);
+    if (l->size > internal_target_size_ && l->children.size() >= 4) {
+        // The node gets all children but the last two, which makes sure that the
+        // last node of the level gets at least two children.  The children that it
+        // gets took no more than the target size before the last one came.
+        write_internal_node(level, l->children.size() - 2);
+    }
+}
+
+void btree_bulk_loader_t::write_internal_node(size_t level, size_t n) {
+    std::vector<child_t> *children = &levels_[level].children;
+    rassert(n >= 2 && n <= children->size());
+
+    buf_lock_t buf(superblock_->expose_buf(), alt_create_t::create);
+    // All children were created in this transaction with the same recency.
+    buf.set_recency(superceding_recency(timestamp_, buf.get_recency()));
+    {
+        buf_write_t write(&buf);
+        auto node = static_cast<internal_node_t *>(write.get_data_write());
+        internal_node::init(sizer_->block_size(), node);
+        for (size_t i = 0; i + 1 < n; ++i) {
+            DEBUG_VAR const bool inserted = internal_node::insert(
+                node, (*children)[i].last_key.btree_key(),
+                (*children)[i].block_id, (*children)[i + 1].block_id);
+            rassert(inserted);
+        }
+#ifndef NDEBUG
+        internal_node::validate(sizer_->block_size(), node);
+#endif
+    }
+
+    const store_key_t last_key = (*children)[n - 1].last_key;
+    children->erase(children->begin(), children->begin() + n);
+    levels_[level].size = 0;
+    for (const child_t &child : *children) {
+        levels_[level].size += child_size(child.last_key);
+    }
+    add_child(level + 1, last_key, buf.block_id());
+}
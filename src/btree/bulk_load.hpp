@@ -0,0 +1,88 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef BTREE_BULK_LOAD_HPP_
+#define BTREE_BULK_LOAD_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "btree/keys.hpp"
+#include "buffer_cache/alt.hpp"
+#include "containers/scoped.hpp"
+#include "repli_timestamp.hpp"
+
+struct leaf_node_t;
+class superblock_t;
+class value_sizer_t;
+
+/* `btree_bulk_loader_t` builds a B-tree bottom up out of key/value pairs that come in
+ascending key order, instead of inserting them one at a time.  It fills every leaf up to
+`BTREE_BULK_LOAD_FILL_FACTOR` of its capacity before it starts the next one, and builds
+every level of internal nodes out of the nodes of the level below in the same way.  So
+the nodes are created (and get their block ids) in key order, and they come out about
+as full as the fill factor says, rather than half full as the splits of one insert at
+a time leave them.
+
+The tree must be empty.  The loader keeps the superblock, which must be acquired for
+write, while it builds the tree, and `finish()` makes the new tree the one of the
+superblock.  Only the leaf that is being filled is kept acquired; the internal nodes are
+only written once all of their children are known. */
+class btree_bulk_loader_t {
+public:
+    btree_bulk_loader_t(value_sizer_t *sizer,
+                        superblock_t *superblock,
+                        repli_timestamp_t timestamp);
+    ~btree_bulk_loader_t();
+
+    // `key` must be greater than the key of the previous call.  `value` is copied.
+    void add(const btree_key_t *key, const void *value);
+
+    // Must be called once all pairs have been added.
+    void finish();
+
+    int64_t num_pairs() const { return num_pairs_; }
+
+private:
+    // A node of the tree that has been written, and the greatest key of its subtree.
+    struct child_t {
+        store_key_t last_key;
+        block_id_t block_id;
+    };
+    struct level_t {
+        level_t() : size(0) { }
+        std::vector<child_t> children;
+        // An estimate of how much space `children` take in an internal node.
+        int size;
+    };
+
+    static int child_size(const store_key_t &last_key);
+
+    void start_leaf();
+    void finish_leaf(bool is_last);
+    void add_child(size_t level, const store_key_t &last_key, block_id_t block_id);
+    // Writes an internal node out of the first `n` children of `levels_[level]`.
+    void write_internal_node(size_t level, size_t n);
+
+    value_sizer_t *const sizer_;
+    superblock_t *const superblock_;
+    const repli_timestamp_t timestamp_;
+    const int leaf_target_size_;
+    const int internal_target_size_;
+
+    buf_lock_t leaf_buf_;
+    scoped_ptr_t<buf_write_t> leaf_write_;
+    leaf_node_t *leaf_;
+    store_key_t last_key_;
+    // The last key of the previous leaf, which bounds the keys of the current one.
+    scoped_ptr_t<store_key_t> previous_leaf_last_key_;
+
+    // The children of the internal nodes that are yet to be written, from the lowest
+    // level up.
+    std::vector<level_t> levels_;
+    int64_t num_pairs_;
+    bool finished_;
+
+    DISABLE_COPYING(btree_bulk_loader_t);
+};
+
+#endif  // BTREE_BULK_LOAD_HPP_
@@ -0,0 +1,112 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "btree/count.hpp"
+
+#include "btree/depth_first_traversal.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
+#include "btree/operations.hpp"
+
+namespace {
+
+class leaf_counter_t : public depth_first_traversal_callback_t {
+public:
+    explicit leaf_counter_t(const key_range_t &range) : range_(range), count_(0) { }
+
+    continue_bool_t handle_pre_leaf(
+            const counted_t<counted_buf_lock_and_read_t> &buf,
+            const btree_key_t *left_excl_or_null,
+            const btree_key_t *right_incl,
+            UNUSED signal_t *interruptor,
+            bool *skip_out) {
+        // The keys of the leaf are in (`left_excl_or_null`, `right_incl`], so if that
+        // is in the range, they don't have to be checked one by one.
+        const bool whole_leaf =
+            left_excl_or_null != nullptr
+            && btree_key_cmp(left_excl_or_null, range_.left.btree_key()) >= 0
+            && (range_.right.unbounded
+                || btree_key_cmp(right_incl, range_.right.key().btree_key()) < 0);
+        auto node = static_cast<const leaf_node_t *>(buf->read->get_data_read());
+        for (auto it = leaf::begin(*node); it != leaf::end(*node); ++it) {
+            if (whole_leaf || range_.contains_key((*it).first)) {
+                ++count_;
+            }
+        }
+        *skip_out = true;
+        return continue_bool_t::CONTINUE;
+    }
+
+    continue_bool_t handle_pair(scoped_key_value_t &&, signal_t *) {
+        unreachable();
+    }
+
+    int64_t count() const { return count_; }
+
+private:
+    const key_range_t &range_;
+    int64_t count_;
+};
+
+class pair_finder_t : public depth_first_traversal_callback_t {
+public:
+    pair_finder_t() : found_(false) { }
+
+    continue_bool_t handle_pair(scoped_key_value_t &&, signal_t *) {
+        found_ = true;
+        return continue_bool_t::ABORT;
+    }
+
+    bool found() const { return found_; }
+
+private:
+    bool found_;
+};
+
+bool has_pairs_in(superblock_t *superblock, const key_range_t &range,
+                  signal_t *interruptor) {
+    pair_finder_t finder;
+    btree_depth_first_traversal(superblock, range, &finder, access_t::read, FORWARD,
+                                release_superblock_t::KEEP, interruptor);
+    return finder.found();
+}
+
+}  // namespace
+
+int64_t btree_count_in_range(
+        superblock_t *superblock,
+        const key_range_t &range,
+        release_superblock_t release_superblock,
+        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    const block_id_t stat_block_id = superblock->get_stat_block_id();
+    if (stat_block_id != NULL_BLOCK_ID
+        && (range.left == store_key_t::min()
+            || !has_pairs_in(superblock,
+                             key_range_t(key_range_t::none, store_key_t(),
+                                         key_range_t::open, range.left),
+                             interruptor))
+        && (range.right.unbounded
+            || !has_pairs_in(superblock,
+                             key_range_t(key_range_t::closed, range.right.key(),
+                                         key_range_t::none, store_key_t()),
+                             interruptor))) {
+        // The stat block is detached from the rest of the btree (see
+        // `apply_keyvalue_change()`).
+        buf_lock_t stat_block(buf_parent_t(superblock->expose_buf().txn()),
+                              stat_block_id, access_t::read);
+        int64_t population;
+        {
+            buf_read_t read(&stat_block);
+            population = static_cast<const btree_statblock_t *>(
+                read.get_data_read())->population;
+        }
+        if (release_superblock == release_superblock_t::RELEASE) {
+            superblock->release();
+        }
+        return population;
+    }
+
+    leaf_counter_t counter(range);
+    btree_depth_first_traversal(superblock, range, &counter, access_t::read, FORWARD,
+                                release_superblock, interruptor);
+    return counter.count();
+}
@@ -0,0 +1,30 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef BTREE_COUNT_HPP_
+#define BTREE_COUNT_HPP_
+
+#include <stdint.h>
+
+#include "btree/keys.hpp"
+#include "btree/types.hpp"
+#include "concurrency/interruptor.hpp"
+
+class superblock_t;
+
+/* Counts the pairs with keys in `range` in the tree of `superblock`, which must be
+acquired for read.  If the tree has a stat block and no keys outside of `range`, which
+is the case for a shard that is read as a whole, this is the population in the stat
+block, and it only takes the descents to the two ends of `range` to make sure of that.
+Otherwise the leaves in `range` are counted a leaf at a time, without handling the
+pairs one by one.
+
+Like the stat block, the population doesn't have a consistent view of concurrent
+writes, so a count that takes it may or may not include the writes that are in flight
+while it runs. */
+int64_t btree_count_in_range(
+        superblock_t *superblock,
+        const key_range_t &range,
+        release_superblock_t release_superblock,
+        signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t);
+
+#endif  // BTREE_COUNT_HPP_
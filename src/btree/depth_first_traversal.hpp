@@ -25,7 +25,8 @@ public:
 };
 
 // A btree leaf key/value pair that also owns a reference to the buf_lock_t that
-// contains said key/value pair.
+// contains said key/value pair.  The key is a copy, because the leaf node may store
+// it without the prefix of the node.
 class scoped_key_value_t {
 public:
     scoped_key_value_t(const btree_key_t *key,
@@ -37,7 +38,7 @@ public:
 
     const btree_key_t *key() const {
         guarantee(buf_.has());
-        return key_;
+        return key_.btree_key();
     }
     const void *value() const {
         guarantee(buf_.has());
@@ -50,7 +51,7 @@ public:
     void reset();
 
 private:
-    const btree_key_t *key_;
+    store_key_t key_;
     const void *value_;
     movable_t<counted_buf_lock_and_read_t> buf_;
 
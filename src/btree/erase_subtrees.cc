@@ -0,0 +1,263 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "btree/erase_subtrees.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "btree/internal_node.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
+#include "btree/operations.hpp"
+#include "buffer_cache/alt.hpp"
+
+namespace {
+
+class subtree_eraser_t {
+public:
+    subtree_eraser_t(value_sizer_t *sizer, const key_range_t &range, int max_leaves,
+                     const value_deleter_t *deleter)
+        : sizer_(sizer), range_(range), deleter_(deleter), leaves_left_(max_leaves),
+          pairs_erased_(0), stopped_(false), has_done_(false), done_unbounded_(false) { }
+
+    // Erases the pairs in the range from the subtree of `buf`, whose keys are in
+    // (`left_excl`, `right_incl`], where null stands for no bound.  Returns true if
+    // the subtree is empty afterwards.
+    bool erase(buf_lock_t *buf,
+               const store_key_t *left_excl, const store_key_t *right_incl) {
+        bool is_leaf;
+        {
+            buf_read_t read(buf);
+            is_leaf = node::is_leaf(static_cast<const node_t *>(read.get_data_read()));
+        }
+        return is_leaf
+            ? erase_in_leaf(buf, left_excl, right_incl)
+            : erase_in_internal(buf, left_excl, right_incl);
+    }
+
+    int64_t pairs_erased() const { return pairs_erased_; }
+    bool stopped() const { return stopped_; }
+
+    // Whether there are no pairs left in the range.
+    bool finished() const {
+        return !stopped_ || done_unbounded_
+            || (has_done_ && !range_.right.unbounded
+                && done_up_to_ >= range_.right.key());
+    }
+
+    // The part of the range that is free of pairs now.
+    key_range_t erased_range() const {
+        if (finished()) {
+            return range_;
+        } else if (!has_done_) {
+            return key_range_t::empty();
+        } else {
+            return key_range_t(key_range_t::closed, range_.left,
+                               key_range_t::closed, done_up_to_);
+        }
+    }
+
+private:
+    bool covers(const store_key_t *left_excl, const store_key_t *right_incl) const {
+        return (left_excl == nullptr
+                ? range_.left == store_key_t::min()
+                : *left_excl >= range_.left)
+            && (right_incl == nullptr
+                ? range_.right.unbounded
+                : *right_incl < range_.right.key());
+    }
+
+    bool erase_in_leaf(buf_lock_t *buf,
+                       const store_key_t *left_excl, const store_key_t *right_incl) {
+        if (leaves_left_ == 0) {
+            stopped_ = true;
+            return false;
+        }
+        --leaves_left_;
+
+        // A leaf that is entirely in the range is emptied as a whole, tombstones
+        // included.  The others lose the pairs in the range one by one.
+        const bool covered = covers(left_excl, right_incl);
+        bool is_empty;
+        {
+            buf_write_t write(buf);
+            auto node = static_cast<leaf_node_t *>(write.get_data_write());
+            std::vector<store_key_t> keys;
+            for (auto it = leaf::begin(*node); it != leaf::end(*node); ++it) {
+                const btree_key_t *key = (*it).first;
+                if (covered || range_.contains_key(key)) {
+                    deleter_->delete_value(buf_parent_t(buf), (*it).second);
+                    if (!covered) {
+                        keys.push_back(store_key_t(key));
+                    }
+                    ++pairs_erased_;
+                }
+            }
+            for (const store_key_t &key : keys) {
+                leaf::erase_presence(sizer_, node, key.btree_key());
+            }
+            // An empty leaf gives up its prefix too, so that it can take over the key
+            // ranges of its neighbors.
+            if (covered || node->num_pairs == 0) {
+                leaf::init(sizer_, node);
+            }
+            is_empty = node->num_pairs == 0;
+        }
+
+        has_done_ = true;
+        if (right_incl == nullptr) {
+            done_unbounded_ = true;
+        } else {
+            done_up_to_ = *right_incl;
+        }
+        return is_empty;
+    }
+
+    bool erase_in_internal(buf_lock_t *buf,
+                           const store_key_t *left_excl, const store_key_t *right_incl) {
+        // `keys[i]` is the greatest key of the subtree of `children[i]`, except for the
+        // last child.
+        std::vector<block_id_t> children;
+        std::vector<store_key_t> keys;
+        {
+            buf_read_t read(buf);
+            auto node = static_cast<const internal_node_t *>(read.get_data_read());
+            for (int i = 0; i < node->npairs; ++i) {
+                const btree_internal_pair *pair = internal_node::get_pair_by_index(node, i);
+                children.push_back(pair->lnode);
+                if (i + 1 < node->npairs) {
+                    keys.push_back(store_key_t(&pair->key));
+                }
+            }
+        }
+
+        const size_t n = children.size();
+        std::vector<bool> empty(n, false);
+        for (size_t i = 0; i < n && !stopped_; ++i) {
+            const store_key_t *child_left = i == 0 ? left_excl : &keys[i - 1];
+            const store_key_t *child_right = i + 1 == n ? right_incl : &keys[i];
+            if (child_right != nullptr && *child_right < range_.left) {
+                continue;
+            }
+            if (child_left != nullptr && !range_.right.unbounded
+                && *child_left >= range_.right.key()) {
+                break;
+            }
+            buf_lock_t child(buf, children[i], access_t::write);
+            empty[i] = erase(&child, child_left, child_right);
+        }
+
+        // Of every run of empty children, the last one takes over the key ranges of
+        // the others.  We go from right to left so that the indices stay valid.
+        for (size_t i = n - 1; i-- > 0;) {
+            if (empty[i] && empty[i + 1]) {
+                delete_empty_subtree(buf, children[i]);
+                buf_write_t write(buf);
+                internal_node::remove(
+                    sizer_->block_size(),
+                    static_cast<internal_node_t *>(write.get_data_write()),
+                    keys[i].btree_key());
+            }
+        }
+        return std::all_of(empty.begin(), empty.end(), [](bool e) { return e; });
+    }
+
+    // Deletes an empty subtree, which is an empty leaf or a chain of internal nodes
+    // with a single child that ends in one.
+    static void delete_empty_subtree(buf_lock_t *parent, block_id_t block_id) {
+        parent->detach_child(block_id);
+        buf_lock_t buf(parent, block_id, access_t::write);
+        block_id_t only_child = NULL_BLOCK_ID;
+        {
+            buf_read_t read(&buf);
+            auto node = static_cast<const node_t *>(read.get_data_read());
+            if (node::is_internal(node)) {
+                auto internal = reinterpret_cast<const internal_node_t *>(node);
+                rassert(internal->npairs == 1);
+                only_child = internal_node::get_pair_by_index(internal, 0)->lnode;
+            } else {
+                rassert(reinterpret_cast<const leaf_node_t *>(node)->num_pairs == 0);
+            }
+        }
+        if (only_child != NULL_BLOCK_ID) {
+            delete_empty_subtree(&buf, only_child);
+        }
+        buf.write_acq_signal()->wait_lazily_unordered();
+        buf.mark_deleted();
+    }
+
+    value_sizer_t *const sizer_;
+    const key_range_t range_;
+    const value_deleter_t *const deleter_;
+    int leaves_left_;
+    int64_t pairs_erased_;
+    bool stopped_;
+
+    // The greatest key of the last leaf that was visited.
+    bool has_done_;
+    bool done_unbounded_;
+    store_key_t done_up_to_;
+
+    DISABLE_COPYING(subtree_eraser_t);
+};
+
+// Replaces a root that has only one child by that child, as often as it takes.
+void collapse_root(superblock_t *superblock, buf_lock_t *root) {
+    for (;;) {
+        block_id_t only_child;
+        {
+            buf_read_t read(root);
+            auto node = static_cast<const node_t *>(read.get_data_read());
+            if (node::is_leaf(node)) {
+                return;
+            }
+            auto internal = reinterpret_cast<const internal_node_t *>(node);
+            if (internal->npairs > 1) {
+                return;
+            }
+            only_child = internal_node::get_pair_by_index(internal, 0)->lnode;
+        }
+        superblock->expose_buf().detach_child(root->block_id());
+        root->detach_child(only_child);
+        buf_lock_t child(root, only_child, access_t::write);
+        root->write_acq_signal()->wait_lazily_unordered();
+        root->mark_deleted();
+        superblock->set_root_block_id(only_child);
+        *root = std::move(child);
+    }
+}
+
+}  // namespace
+
+continue_bool_t erase_subtrees_in_range(
+        value_sizer_t *sizer,
+        superblock_t *superblock,
+        const key_range_t &range,
+        int max_leaves,
+        const value_deleter_t *deleter,
+        key_range_t *erased_out,
+        int64_t *pairs_erased_out) {
+    rassert(max_leaves > 0);
+    subtree_eraser_t eraser(sizer, range, max_leaves, deleter);
+    const block_id_t root_id = superblock->get_root_block_id();
+    if (root_id != NULL_BLOCK_ID) {
+        buf_lock_t root(superblock->expose_buf(), root_id, access_t::write);
+        eraser.erase(&root, nullptr, nullptr);
+        collapse_root(superblock, &root);
+    }
+
+    // The stat block is detached from the rest of the btree (see
+    // `apply_keyvalue_change()`).
+    const block_id_t stat_block_id = superblock->get_stat_block_id();
+    if (stat_block_id != NULL_BLOCK_ID && eraser.pairs_erased() != 0) {
+        buf_lock_t stat_block(buf_parent_t(superblock->expose_buf().txn()),
+                              stat_block_id, access_t::write);
+        buf_write_t stat_block_write(&stat_block);
+        auto stat_block_buf = static_cast<btree_statblock_t *>(
+                stat_block_write.get_data_write(BTREE_STATBLOCK_SIZE));
+        stat_block_buf->population -= eraser.pairs_erased();
+    }
+
+    *erased_out = eraser.erased_range();
+    *pairs_erased_out = eraser.pairs_erased();
+    return eraser.finished() ? continue_bool_t::ABORT : continue_bool_t::CONTINUE;
+}
@@ -0,0 +1,44 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef BTREE_ERASE_SUBTREES_HPP_
+#define BTREE_ERASE_SUBTREES_HPP_
+
+#include <stdint.h>
+
+#include "btree/keys.hpp"
+#include "btree/types.hpp"
+
+class superblock_t;
+class value_sizer_t;
+
+/* Erases all pairs with keys in `range` from the tree of `superblock`, which must be
+acquired for write, a subtree rather than a key at a time.  Leaves whose key ranges
+are in `range` are emptied in one go, and only the two leaves at the edges of the
+range have their pairs erased one by one.  Of every run of neighboring children that
+end up empty, all but the last one are deleted with their blocks and removed from
+their parent, so that the last one takes over their key ranges.  The children that are
+kept this way are empty leaves, or internal nodes that are left with a single empty
+child.  The nodes that lose pairs or children this way are underfull, and get merged
+by later writes like any other (see `check_and_handle_underfull()`).  A node with a
+single child has no key of its own, so the merging takes the key that separates it
+from its sibling from their parent, by position.
+
+`deleter` is called on every erased value, with the leaf that holds it as the parent.
+Like `delete_mode_t::ERASE`, it leaves no tombstones behind, and the emptied leaves
+lose the ones they had, so this is only for data that doesn't get backfilled.
+
+The nodes are visited from left to right, and no more than `max_leaves` leaves are
+visited.  Returns `continue_bool_t::CONTINUE` if that stopped it before it got to the
+end of the range, and `continue_bool_t::ABORT` otherwise.  `*erased_out` is set to the
+part of `range` that is now free of pairs, which starts at `range.left`.
+`*pairs_erased_out` is set to the number of erased pairs, which are also taken off the
+population in the stat block of the tree. */
+continue_bool_t erase_subtrees_in_range(
+        value_sizer_t *sizer,
+        superblock_t *superblock,
+        const key_range_t &range,
+        int max_leaves,
+        const value_deleter_t *deleter,
+        key_range_t *erased_out,
+        int64_t *pairs_erased_out);
+
+#endif  // BTREE_ERASE_SUBTREES_HPP_
@@ -5,6 +5,7 @@
 
 #include <algorithm>
 
+#include "btree/key_prefix_index.hpp"
 #include "btree/node.hpp"
 #include "containers/unaligned.hpp"
 
@@ -59,8 +60,9 @@ void init(block_size_t block_size, internal_node_t *node, const internal_node_t
     rassert(get_pair_by_index(node, node->npairs-1)->key.size == 0);
 }
 
-block_id_t lookup(const internal_node_t *node, const btree_key_t *key) {
-    int index = get_offset_index(node, key);
+block_id_t lookup(const internal_node_t *node, const btree_key_t *key,
+                  const key_prefix_index_t *prefix_index) {
+    int index = get_offset_index(node, key, prefix_index);
     return get_pair_by_index(node, index)->lnode;
 }
 
@@ -129,11 +131,9 @@ void split(block_size_t block_size, internal_node_t *node, internal_node_t *rnod
     validate(block_size, rnode);
 }
 
-void merge(block_size_t block_size, const internal_node_t *node, internal_node_t *rnode, const internal_node_t *parent) {
+void merge(block_size_t block_size, const internal_node_t *node, internal_node_t *rnode, const btree_key_t *key_from_parent) {
     validate(block_size, node);
     validate(block_size, rnode);
-    // get the key in parent which points to node
-    const btree_key_t *key_from_parent = &get_pair_by_index(parent, get_offset_index(parent, &get_pair_by_index(node, 0)->key))->key;
 
     guarantee(sizeof(internal_node_t) + (node->npairs + rnode->npairs)*sizeof(*node->pair_offsets) +
         (block_size.value() - node->frontmost_offset) + (block_size.value() - rnode->frontmost_offset) + key_from_parent->size < block_size.value(),
@@ -154,9 +154,9 @@ void merge(block_size_t block_size, const internal_node_t *node, internal_node_t
     validate(block_size, rnode);
 }
 
-bool level(block_size_t block_size, internal_node_t *node,
+bool level(block_size_t block_size, int nodecmp_node_with_sib, internal_node_t *node,
            internal_node_t *sibling, btree_key_t *replacement_key,
-           const internal_node_t *parent,
+           const btree_key_t *key_from_parent,
            std::vector<block_id_t> *moved_children_out) {
     validate(block_size, node);
     validate(block_size, sibling);
@@ -164,8 +164,7 @@ bool level(block_size_t block_size, internal_node_t *node,
         moved_children_out->reserve(sibling->npairs);
     }
 
-    if (nodecmp(node, sibling) < 0) {
-        const btree_key_t *key_from_parent = &get_pair_by_index(parent, get_offset_index(parent, &get_pair_by_index(node, 0)->key))->key;
+    if (nodecmp_node_with_sib < 0) {
         if (sizeof(internal_node_t) + (node->npairs + 1) * sizeof(*node->pair_offsets) + impl::pair_size_with_key(key_from_parent) >= node->frontmost_offset)
             return false;
         uint16_t special_pair_offset = node->pair_offsets[node->npairs-1];
@@ -214,7 +213,6 @@ bool level(block_size_t block_size, internal_node_t *node,
         impl::delete_offset(sibling, 0);
     } else {
         uint16_t offset;
-        const btree_key_t *key_from_parent = &get_pair_by_index(parent, get_offset_index(parent, &get_pair_by_index(sibling, 0)->key))->key;
         if (sizeof(internal_node_t) + (node->npairs + 1) * sizeof(*node->pair_offsets) + impl::pair_size_with_key(key_from_parent) >= node->frontmost_offset)
             return false;
         block_id_t first_child = get_pair_by_index(sibling, sibling->npairs-1)->lnode;
@@ -271,7 +269,7 @@ int sibling(const internal_node_t *node, const btree_key_t *key, block_id_t *sib
     }
 
     *sib_id = sib_pair->lnode;
-    return cmp; //equivalent to nodecmp(node, sibling)
+    return cmp; // < 0 if the sibling is to the right of the child
 }
 
 
@@ -335,13 +333,7 @@ bool is_underfull(block_size_t block_size, const internal_node_t *node) {
         INTERNAL_EPSILON * 2  < block_size.value() / 2;
 }
 
-bool is_mergable(block_size_t block_size, const internal_node_t *node, const internal_node_t *sibling, const internal_node_t *parent) {
-    const btree_key_t *key_from_parent;
-    if (nodecmp(node, sibling) < 0) {
-        key_from_parent = &get_pair_by_index(parent, get_offset_index(parent, &get_pair_by_index(node, 0)->key))->key;
-    } else {
-        key_from_parent = &get_pair_by_index(parent, get_offset_index(parent, &get_pair_by_index(sibling, 0)->key))->key;
-    }
+bool is_mergable(block_size_t block_size, const internal_node_t *node, const internal_node_t *sibling, const btree_key_t *key_from_parent) {
     return sizeof(internal_node_t) +
         (node->npairs + sibling->npairs + 1)*sizeof(*node->pair_offsets) +
         (block_size.value() - node->frontmost_offset) +
@@ -373,15 +365,15 @@ btree_internal_pair *get_pair_by_index(internal_node_t *node, int index) {
     return get_pair(node, node->pair_offsets[index]);
 }
 
-int get_offset_index(const internal_node_t *node, const btree_key_t *key) {
-    return std::lower_bound(node->pair_offsets, node->pair_offsets+node->npairs-1, (uint16_t) internal_key_comp::faux_offset, internal_key_comp(node, key)) - node->pair_offsets;
-}
-
-int nodecmp(const internal_node_t *node1, const internal_node_t *node2) {
-    const btree_key_t *key1 = &get_pair_by_index(node1, 0)->key;
-    const btree_key_t *key2 = &get_pair_by_index(node2, 0)->key;
-
-    return btree_key_cmp(key1, key2);
+int get_offset_index(const internal_node_t *node, const btree_key_t *key,
+                     const key_prefix_index_t *prefix_index) {
+    int beg = 0;
+    int end = node->npairs - 1;
+    if (prefix_index != nullptr) {
+        rassert(prefix_index->size() == end);
+        prefix_index->narrow(key, &beg, &end);
+    }
+    return std::lower_bound(node->pair_offsets+beg, node->pair_offsets+end, (uint16_t) internal_key_comp::faux_offset, internal_key_comp(node, key)) - node->pair_offsets;
 }
 
 namespace impl {
@@ -9,6 +9,7 @@
 #include "serializer/types.hpp"
 #include "utils.hpp"
 
+class key_prefix_index_t;
 struct internal_node_t;
 
 // See internal_node_t in node.hpp
@@ -30,21 +31,26 @@ namespace internal_node {
 void init(block_size_t block_size, internal_node_t *node);
 void init(block_size_t block_size, internal_node_t *node, const internal_node_t *lnode, const uint16_t *offsets, int numpairs);
 
-block_id_t lookup(const internal_node_t *node, const btree_key_t *key);
+// `prefix_index`, if not null, must be the key prefix index of `node`.
+block_id_t lookup(const internal_node_t *node, const btree_key_t *key,
+                  const key_prefix_index_t *prefix_index = nullptr);
 bool insert(internal_node_t *node, const btree_key_t *key, block_id_t lnode, block_id_t rnode);
 bool remove(block_size_t block_size, internal_node_t *node, const btree_key_t *key);
 void split(block_size_t block_size, internal_node_t *node, internal_node_t *rnode, btree_key_t *median);
-void merge(block_size_t block_size, const internal_node_t *node, internal_node_t *rnode, const internal_node_t *parent);
-bool level(block_size_t block_size, internal_node_t *node, internal_node_t *sibling,
-           btree_key_t *replacement_key, const internal_node_t *parent,
+// `key_from_parent` is the key of the parent that separates the two nodes, as found
+// by `sibling()`.  It can't be looked up by the first key of a node, because a node
+// that `erase_subtrees_in_range()` left with a single pair has only the empty key.
+void merge(block_size_t block_size, const internal_node_t *node, internal_node_t *rnode, const btree_key_t *key_from_parent);
+bool level(block_size_t block_size, int nodecmp_node_with_sib, internal_node_t *node,
+           internal_node_t *sibling, btree_key_t *replacement_key,
+           const btree_key_t *key_from_parent,
            std::vector<block_id_t> *moved_children_out);
 int sibling(const internal_node_t *node, const btree_key_t *key, block_id_t *sib_id, store_key_t *key_in_middle_out);
 void update_key(internal_node_t *node, const btree_key_t *key_to_replace, const btree_key_t *replacement_key);
-int nodecmp(const internal_node_t *node1, const internal_node_t *node2);
 bool is_full(const internal_node_t *node);
 bool is_underfull(block_size_t block_size, const internal_node_t *node);
 bool change_unsafe(const internal_node_t *node);
-bool is_mergable(block_size_t block_size, const internal_node_t *node, const internal_node_t *sibling, const internal_node_t *parent);
+bool is_mergable(block_size_t block_size, const internal_node_t *node, const internal_node_t *sibling, const btree_key_t *key_from_parent);
 bool is_doubleton(const internal_node_t *node);
 
 void validate(block_size_t block_size, const internal_node_t *node);
@@ -56,7 +62,8 @@ btree_internal_pair *get_pair(internal_node_t *node, uint16_t offset);
 const btree_internal_pair *get_pair_by_index(const internal_node_t *node, int index);
 btree_internal_pair *get_pair_by_index(internal_node_t *node, int index);
 
-int get_offset_index(const internal_node_t *node, const btree_key_t *key);
+int get_offset_index(const internal_node_t *node, const btree_key_t *key,
+                     const key_prefix_index_t *prefix_index = nullptr);
 
 }  // namespace internal_node
 
@@ -0,0 +1,138 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "btree/key_prefix_index.hpp"
+
+#include <algorithm>
+
+#include "btree/internal_node.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
+#include "buffer_cache/alt.hpp"
+#include "config/args.hpp"
+
+key_prefix_index_t::key_prefix_index_t(const uint8_t *base, int base_size,
+                                       const btree_key_t *const *keys, int n) {
+    if (n == 0) {
+        return;
+    }
+
+    // The keys are sorted, so the prefix that all of them share is the one that the
+    // first and the last key share.
+    const btree_key_t *first = keys[0];
+    const btree_key_t *last = keys[n - 1];
+    size_t common = 0;
+    while (common < first->size && common < last->size
+           && first->contents[common] == last->contents[common]) {
+        ++common;
+    }
+    common_prefix_.assign(base, base + base_size);
+    common_prefix_.insert(common_prefix_.end(),
+                          first->contents, first->contents + common);
+
+    prefixes_.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        prefixes_.push_back(pack(keys[i]->contents, keys[i]->size, common));
+    }
+}
+
+key_prefix_index_t::prefix_t key_prefix_index_t::pack(const uint8_t *contents,
+                                                      size_t size, size_t skip) {
+    // Missing bytes are packed as zeros, which keeps the packed prefixes in the same
+    // order as the keys (keys that only differ after that tie).
+    prefix_t packed = 0;
+    for (size_t i = 0; i < sizeof(prefix_t); ++i) {
+        packed <<= 8;
+        if (skip + i < size) {
+            packed |= contents[skip + i];
+        }
+    }
+    return packed;
+}
+
+void key_prefix_index_t::narrow(const btree_key_t *key,
+                                int *beg_out, int *end_out) const {
+    const int n = prefixes_.size();
+    const size_t common = common_prefix_.size();
+    const int res = sized_strcmp(key->contents, std::min<size_t>(key->size, common),
+                                 common_prefix_.data(), common);
+    if (res < 0) {
+        *beg_out = *end_out = 0;
+        return;
+    } else if (res > 0) {
+        *beg_out = *end_out = n;
+        return;
+    }
+
+    // A single pass without branches, which the compiler turns into SIMD compares.
+    const prefix_t packed = pack(key->contents, key->size, common);
+    const prefix_t *prefixes = prefixes_.data();
+    int less = 0;
+    int less_or_equal = 0;
+    for (int i = 0; i < n; ++i) {
+        less += prefixes[i] < packed;
+        less_or_equal += prefixes[i] <= packed;
+    }
+    *beg_out = less;
+    *end_out = less_or_equal;
+}
+
+namespace {
+
+scoped_ptr_t<key_prefix_index_t> make_leaf_index(const leaf_node_t *node) {
+    // The entries store their keys without the prefix of the node.
+    std::vector<const btree_key_t *> keys;
+    keys.reserve(node->num_pairs);
+    for (int i = 0; i < node->num_pairs; ++i) {
+        keys.push_back(leaf::iterator(node, i).stored_key());
+    }
+    const int base_size = leaf::prefix_size(node);
+    return make_scoped<key_prefix_index_t>(
+        base_size == 0 ? nullptr : leaf::prefix_contents(node), base_size,
+        keys.data(), keys.size());
+}
+
+scoped_ptr_t<key_prefix_index_t> make_internal_index(const internal_node_t *node) {
+    // The last pair has the empty key, which stands for "everything else".
+    std::vector<const btree_key_t *> keys;
+    keys.reserve(node->npairs);
+    for (int i = 0; i < node->npairs - 1; ++i) {
+        keys.push_back(&internal_node::get_pair_by_index(node, i)->key);
+    }
+    return make_scoped<key_prefix_index_t>(nullptr, 0, keys.data(), keys.size());
+}
+
+}  // namespace
+
+// `read_t` is `buf_read_t` or `buf_peek_t`.
+template <class read_t, class node_type>
+const key_prefix_index_t *get_or_make_key_prefix_index(
+        read_t *read, const node_type *node,
+        scoped_ptr_t<key_prefix_index_t> (*make_index)(const node_type *)) {
+    uint32_t block_size;
+    DEBUG_VAR const void *data = read->get_data_read(&block_size);
+    rassert(data == node);
+    alt::page_accelerator_t *accelerator = read->get_page_accelerator(
+        [&]() -> scoped_ptr_t<alt::page_accelerator_t> {
+            scoped_ptr_t<key_prefix_index_t> index = make_index(node);
+            if (index->memory_usage()
+                > block_size * KEY_PREFIX_INDEX_MAX_SIZE_FRACTION) {
+                return scoped_ptr_t<alt::page_accelerator_t>();
+            }
+            return scoped_ptr_t<alt::page_accelerator_t>(index.release());
+        });
+    return static_cast<const key_prefix_index_t *>(accelerator);
+}
+
+const key_prefix_index_t *get_key_prefix_index(buf_read_t *read,
+                                               const leaf_node_t *node) {
+    return get_or_make_key_prefix_index(read, node, &make_leaf_index);
+}
+
+const key_prefix_index_t *get_key_prefix_index(buf_read_t *read,
+                                               const internal_node_t *node) {
+    return get_or_make_key_prefix_index(read, node, &make_internal_index);
+}
+
+const key_prefix_index_t *get_key_prefix_index(buf_peek_t *peek,
+                                               const internal_node_t *node) {
+    return get_or_make_key_prefix_index(peek, node, &make_internal_index);
+}
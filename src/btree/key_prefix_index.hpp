@@ -0,0 +1,67 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef BTREE_KEY_PREFIX_INDEX_HPP_
+#define BTREE_KEY_PREFIX_INDEX_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "btree/keys.hpp"
+#include "buffer_cache/page.hpp"
+
+class buf_peek_t;
+class buf_read_t;
+struct internal_node_t;
+struct leaf_node_t;
+
+/* A search accelerator for the sorted keys of a B-tree node.  It holds, for every key,
+the four bytes that follow the prefix that all keys of the node share, packed
+big-endian into a `prefix_t`, so that comparing two packed prefixes compares the bytes
+lexicographically.  A lookup counts the packed prefixes that are less than and equal
+to the one of the key, which is a branch-free loop over a small contiguous array that
+the compiler vectorizes, and only the keys whose packed prefix ties with the one of
+the key have to be compared in full.
+
+The index is built on the first lookup in a node that is held for read, and kept with
+the page (see `alt::page_accelerator_t`) until the node is modified or evicted.  Its
+memory counts toward the cache's memory limit. */
+class key_prefix_index_t : public alt::page_accelerator_t {
+public:
+    typedef uint32_t prefix_t;
+
+    // Builds the index of the `n` ascending keys `base + keys[0], ..., base +
+    // keys[n - 1]`, where `base` is a prefix of `base_size` bytes that the node
+    // stores only once.
+    key_prefix_index_t(const uint8_t *base, int base_size,
+                       const btree_key_t *const *keys, int n);
+
+    int size() const { return prefixes_.size(); }
+    virtual size_t memory_usage() const {
+        return sizeof(*this) + prefixes_.capacity() * sizeof(prefix_t)
+            + common_prefix_.capacity();
+    }
+
+    // Narrows down where `key` is among the keys of the index: all keys before
+    // `*beg_out` are less than `key`, and all keys from `*end_out` on are greater.
+    void narrow(const btree_key_t *key, int *beg_out, int *end_out) const;
+
+private:
+    static prefix_t pack(const uint8_t *contents, size_t size, size_t skip);
+
+    std::vector<uint8_t> common_prefix_;
+    std::vector<prefix_t> prefixes_;
+
+    DISABLE_COPYING(key_prefix_index_t);
+};
+
+/* These return the index of the node that `read` holds, building it if necessary, or
+null if the node shouldn't have one (because the lock isn't a read lock, or the index
+would be too large compared to the node). */
+const key_prefix_index_t *get_key_prefix_index(buf_read_t *read,
+                                               const leaf_node_t *node);
+const key_prefix_index_t *get_key_prefix_index(buf_read_t *read,
+                                               const internal_node_t *node);
+const key_prefix_index_t *get_key_prefix_index(buf_peek_t *peek,
+                                               const internal_node_t *node);
+
+#endif  // BTREE_KEY_PREFIX_INDEX_HPP_
@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <set>
 
+#include "btree/key_prefix_index.hpp"
 #include "btree/node.hpp"
 #include "containers/unaligned.hpp"
 #include "repli_timestamp.hpp"
@@ -96,6 +97,19 @@ const int SKIP_ENTRY_RESERVED = 251;
 // itself three bytes, so it can't fit in a slot of size one or two. We don't
 // expect to actually see many entries of size one or two, but it pays to be
 // thorough.
+//
+// A leaf node in the prefix format, whose magic is the leaf magic of its value type
+// with `PREFIX_FORMAT_MAGIC_BIT` set in the last byte, stores the prefix that all
+// keys in its key range share between the header and the pair offsets:
+//
+// [magic][num_pairs][live_size][frontmost][tstamp_cutpoint][prefix size][prefix]...[padding?][off0][off1]...
+//
+// and the keys in its entries lack that prefix.  The padding keeps pair_offsets at
+// uint16_t alignment.  Since the prefix belongs to the key range of the node, every
+// key that gets inserted into the node has it.  `extend_prefix()` lengthens it when a
+// split narrows down the range of the node, and merging or leveling nodes shortens it
+// to the prefix that both nodes have in common (see `set_prefix()`).  Nodes that
+// have never been given a prefix stay in the original format.
 
 
 struct entry_t;
@@ -167,6 +181,101 @@ repli_timestamp_t get_timestamp(const leaf_node_t *node, int offset) {
     return reinterpret_cast<const unaligned<repli_timestamp_t> *>(reinterpret_cast<const char *>(node) + offset)->value;
 }
 
+bool has_prefix_format(const leaf_node_t *node) {
+    return (static_cast<uint8_t>(node->magic.bytes[3]) & PREFIX_FORMAT_MAGIC_BIT) != 0;
+}
+
+int prefix_size(const leaf_node_t *node) {
+    if (!has_prefix_format(node)) {
+        return 0;
+    }
+    return *reinterpret_cast<const uint8_t *>(node + 1);
+}
+
+const uint8_t *prefix_contents(const leaf_node_t *node) {
+    rassert(has_prefix_format(node));
+    return reinterpret_cast<const uint8_t *>(node + 1) + 1;
+}
+
+// The size of the prefix, the prefix, and the padding between the header and
+// pair_offsets.
+int prefix_header_size(bool prefix_format, int size) {
+    return prefix_format ? (size + 2) & ~1 : 0;
+}
+
+int pair_offsets_offset(const leaf_node_t *node) {
+    return offsetof(leaf_node_t, pair_offsets)
+        + prefix_header_size(has_prefix_format(node), prefix_size(node));
+}
+
+uint16_t *pair_offsets(leaf_node_t *node) {
+    return reinterpret_cast<uint16_t *>(
+        reinterpret_cast<char *>(node) + pair_offsets_offset(node));
+}
+
+const uint16_t *pair_offsets(const leaf_node_t *node) {
+    return reinterpret_cast<const uint16_t *>(
+        reinterpret_cast<const char *>(node) + pair_offsets_offset(node));
+}
+
+// Switches an empty node to the prefix format with the given prefix.
+void init_prefix(leaf_node_t *node, const uint8_t *prefix, int size) {
+    rassert(node->num_pairs == 0);
+    rassert(size <= MAX_KEY_SIZE);
+    node->magic.bytes[3] |= PREFIX_FORMAT_MAGIC_BIT;
+    uint8_t *p = reinterpret_cast<uint8_t *>(node + 1);
+    p[0] = size;
+    memmove(p + 1, prefix, size);
+}
+
+bool key_has_prefix(const leaf_node_t *node, const btree_key_t *key) {
+    const int size = prefix_size(node);
+    return size == 0
+        || (key->size >= size && memcmp(key->contents, prefix_contents(node), size) == 0);
+}
+
+// Compares `key` with the key of the entry `p` of `node`.
+int entry_key_cmp(const leaf_node_t *node, const btree_key_t *key, const entry_t *p) {
+    const btree_key_t *ek = entry_key(p);
+    const int size = prefix_size(node);
+    if (size == 0) {
+        return btree_key_cmp(key, ek);
+    }
+    int res = sized_strcmp(key->contents, std::min<int>(key->size, size),
+                           prefix_contents(node), size);
+    if (res != 0) {
+        return res;
+    }
+    return sized_strcmp(key->contents + size, key->size - size, ek->contents, ek->size);
+}
+
+// Writes the whole key of the entry `p` of `node`, including the prefix of the node,
+// to `key_out`, which must have room for `MAX_KEY_SIZE` bytes.
+void entry_full_key(const leaf_node_t *node, const entry_t *p, btree_key_t *key_out) {
+    const btree_key_t *ek = entry_key(p);
+    const int size = prefix_size(node);
+    rassert(size + ek->size <= MAX_KEY_SIZE);
+    if (size != 0) {
+        memcpy(key_out->contents, prefix_contents(node), size);
+    }
+    memmove(key_out->contents + size, ek->contents, ek->size);
+    key_out->size = size + ek->size;
+}
+
+// The size `key` has in an entry of `node`.
+int stored_key_size(const leaf_node_t *node, const btree_key_t *key) {
+    guarantee(key_has_prefix(node, key), "key doesn't belong in this leaf node");
+    return key->full_size() - prefix_size(node);
+}
+
+void write_stored_key(const leaf_node_t *node, char *dest, const btree_key_t *key) {
+    const int size = prefix_size(node);
+    rassert(key_has_prefix(node, key));
+    btree_key_t *k = reinterpret_cast<btree_key_t *>(dest);
+    k->size = key->size - size;
+    memcpy(k->contents, key->contents + size, k->size);
+}
+
 struct entry_iter_t {
     int offset;
 
@@ -211,16 +320,20 @@ std::string strprint_leaf(value_sizer_t *sizer, const leaf_node_t *node) {
     out += strprintf("Leaf(magic='%4.4s', num_pairs=%u, live_size=%u, frontmost=%u, tstamp_cutpoint=%u)\n",
             node->magic.bytes, node->num_pairs, node->live_size, node->frontmost, node->tstamp_cutpoint);
 
+    if (has_prefix_format(node)) {
+        out += strprintf("  Prefix: %.*s\n", prefix_size(node), prefix_contents(node));
+    }
+
     out += strprintf("  Offsets:");
     for (int i = 0; i < node->num_pairs; ++i) {
-        out += strprintf(" %d", node->pair_offsets[i]);
+        out += strprintf(" %d", pair_offsets(node)[i]);
     }
     out += strprintf("\n");
 
     out += strprintf("  By Key:");
     for (int i = 0; i < node->num_pairs; ++i) {
-        out += strprintf(" %d:", node->pair_offsets[i]);
-        strprint_entry(&out, sizer, get_entry(node, node->pair_offsets[i]));
+        out += strprintf(" %d:", pair_offsets(node)[i]);
+        strprint_entry(&out, sizer, get_entry(node, pair_offsets(node)[i]));
     }
     out += strprintf("\n");
 
@@ -264,17 +377,21 @@ void print(FILE *fp, value_sizer_t *sizer, const leaf_node_t *node) {
     fprintf(fp, "Leaf(magic='%4.4s', num_pairs=%u, live_size=%u, frontmost=%u, tstamp_cutpoint=%u)\n",
             node->magic.bytes, node->num_pairs, node->live_size, node->frontmost, node->tstamp_cutpoint);
 
+    if (has_prefix_format(node)) {
+        fprintf(fp, "  Prefix: %.*s\n", prefix_size(node), prefix_contents(node));
+    }
+
     fprintf(fp, "  Offsets:");
     for (int i = 0; i < node->num_pairs; ++i) {
-        fprintf(fp, " %d", node->pair_offsets[i]);
+        fprintf(fp, " %d", pair_offsets(node)[i]);
     }
     fprintf(fp, "\n");
     fflush(fp);
 
     fprintf(fp, "  By Key:");
     for (int i = 0; i < node->num_pairs; ++i) {
-        fprintf(fp, " %d:", node->pair_offsets[i]);
-        print_entry(fp, sizer, get_entry(node, node->pair_offsets[i]));
+        fprintf(fp, " %d:", pair_offsets(node)[i]);
+        print_entry(fp, sizer, get_entry(node, pair_offsets(node)[i]));
     }
     fprintf(fp, "\n");
 
@@ -326,9 +443,11 @@ bool fsck(value_sizer_t *sizer, const btree_key_t *left_exclusive_or_null, const
     // is not before the end of pair_offsets
 
     // Basic sanity checks on fields' values.
-    if (failed(node->magic == sizer->btree_leaf_magic(),
+    if (failed(sizer->is_btree_leaf_magic(node->magic),
                "bad leaf magic")
-        || failed(node->frontmost >= offsetof(leaf_node_t, pair_offsets) + node->num_pairs * sizeof(uint16_t),
+        || failed(prefix_size(node) <= MAX_KEY_SIZE,
+                  "prefix is too long")
+        || failed(node->frontmost >= pair_offsets_offset(node) + node->num_pairs * sizeof(uint16_t),
                   "frontmost offset is before the end of pair_offsets")
         || failed(node->live_size <= (sizer->block_size().value() - node->frontmost) + sizeof(uint16_t) * node->num_pairs,
                   "live_size is impossibly large")
@@ -342,7 +461,7 @@ bool fsck(value_sizer_t *sizer, const btree_key_t *left_exclusive_or_null, const
 
     // sizeof(offs) is guaranteed to be less than the block_size() thanks to assertions above.
     scoped_array_t<uint16_t> offs(node->num_pairs);
-    memcpy(offs.data(), node->pair_offsets, node->num_pairs * sizeof(uint16_t));
+    memcpy(offs.data(), pair_offsets(node), node->num_pairs * sizeof(uint16_t));
 
     std::sort(offs.data(), offs.data() + node->num_pairs);
 
@@ -389,17 +508,24 @@ bool fsck(value_sizer_t *sizer, const btree_key_t *left_exclusive_or_null, const
         }
 
         const entry_t *ent = get_entry(node, offset);
+        if (!entry_is_skip(ent)
+            && failed(prefix_size(node) + entry_key(ent)->size <= MAX_KEY_SIZE,
+                      "key is too long")) {
+            return false;
+        }
         if (entry_is_live(ent)) {
             const void *value = entry_value(ent);
             int space = sizer->block_size().value() - (reinterpret_cast<const char *>(value) - reinterpret_cast<const char *>(node));
+            store_key_t key;
+            entry_full_key(node, ent, key.btree_key());
             if (!sizer->fits(value, space)) {
-                *msg_out = strprintf("problem with key %.*s: value does not fit\n", entry_key(ent)->size, entry_key(ent)->contents);
+                *msg_out = strprintf("problem with key %.*s: value does not fit\n", key.size(), key.contents());
                 return false;
             }
 
             std::string fscker_msg;
-            if (!fscker->fsck(sizer, entry_key(ent), value, &fscker_msg)) {
-                *msg_out = strprintf("Problem with key %.*s: %s\n", entry_key(ent)->size, entry_key(ent)->contents, fscker_msg.c_str());
+            if (!fscker->fsck(sizer, key.btree_key(), value, &fscker_msg)) {
+                *msg_out = strprintf("Problem with key %.*s: %s\n", key.size(), key.contents(), fscker_msg.c_str());
                 return false;
             }
 
@@ -437,8 +563,10 @@ bool fsck(value_sizer_t *sizer, const btree_key_t *left_exclusive_or_null, const
     // Entries look valid, check key ordering.
 
     const btree_key_t *last = left_exclusive_or_null;
+    store_key_t keys[2];
     for (int k = 0; k < node->num_pairs; ++k) {
-        const btree_key_t *key = entry_key(get_entry(node, node->pair_offsets[k]));
+        btree_key_t *key = keys[k % 2].btree_key();
+        entry_full_key(node, get_entry(node, pair_offsets(node)[k]), key);
         if (failed(last == nullptr || btree_key_cmp(last, key) < 0,
                    "keys out of order")) {
             return false;
@@ -477,12 +605,25 @@ int free_space(value_sizer_t *sizer) {
     return sizer->block_size().value() - offsetof(leaf_node_t, pair_offsets);
 }
 
-// Returns the mandatory storage cost of the node, returning a value
-// in the closed interval [0, free_space(sizer)].  Outputs the offset
-// of the first entry for which storing a timestamp is not mandatory.
-int mandatory_cost(value_sizer_t *sizer, const leaf_node_t *node, int required_timestamps, int *tstamp_back_offset_out) {
+// Returns the mandatory storage cost the node would have if it stored its keys
+// without a prefix of `new_prefix_size` bytes (see `set_prefix()`).  Outputs the
+// offset of the first entry for which storing a timestamp is not mandatory.
+int mandatory_cost_with_prefix(value_sizer_t *sizer, const leaf_node_t *node, int new_prefix_size,
+                               int required_timestamps, int *tstamp_back_offset_out) {
     int size = node->live_size;
 
+    // Every key grows by the bytes that are no longer part of the prefix.
+    const int key_growth = prefix_size(node) - new_prefix_size;
+    if (key_growth != 0) {
+        for (int i = 0; i < node->num_pairs; ++i) {
+            if (entry_is_live(get_entry(node, pair_offsets(node)[i]))) {
+                size += key_growth;
+            }
+        }
+    }
+    size += prefix_header_size(has_prefix_format(node) || new_prefix_size > 0,
+                               new_prefix_size);
+
     // node->live_size does not include deletion entries, deletion
     // entries' timestamps, and live entries' timestamps.  We add that
     // to size.
@@ -498,7 +639,7 @@ int mandatory_cost(value_sizer_t *sizer, const leaf_node_t *node, int required_t
                 break;
             }
 
-            int this_entry_cost = sizeof(uint16_t) + sizeof(repli_timestamp_t) + entry_size(sizer, ent);
+            int this_entry_cost = sizeof(uint16_t) + sizeof(repli_timestamp_t) + entry_size(sizer, ent) + key_growth;
             deletions_cost += this_entry_cost;
             size += this_entry_cost;
             ++count;
@@ -515,6 +656,14 @@ int mandatory_cost(value_sizer_t *sizer, const leaf_node_t *node, int required_t
     return size;
 }
 
+// Returns the mandatory storage cost of the node, returning a value
+// in the closed interval [0, free_space(sizer)].  Outputs the offset
+// of the first entry for which storing a timestamp is not mandatory.
+int mandatory_cost(value_sizer_t *sizer, const leaf_node_t *node, int required_timestamps, int *tstamp_back_offset_out) {
+    return mandatory_cost_with_prefix(sizer, node, prefix_size(node),
+                                      required_timestamps, tstamp_back_offset_out);
+}
+
 int mandatory_cost(value_sizer_t *sizer, const leaf_node_t *node, int required_timestamps) {
     int ignored;
     return mandatory_cost(sizer, node, required_timestamps, &ignored);
@@ -557,7 +706,7 @@ bool is_full(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *k
     // insert.  We conservatively assume the key is not already
     // contained in the node.
 
-    size += sizeof(uint16_t) + sizeof(repli_timestamp_t) + key->full_size() + sizer->size(value);
+    size += sizeof(uint16_t) + sizeof(repli_timestamp_t) + stored_key_size(node, key) + sizer->size(value);
 
     // The node is full if we can't fit all that data within the free space.
     return size > free_space(sizer);
@@ -582,6 +731,14 @@ bool is_underfull(value_sizer_t *sizer, const leaf_node_t *node) {
     return mandatory_cost(sizer, node, MANDATORY_TIMESTAMPS) < free_space(sizer) / 2 - leaf_epsilon(sizer);
 }
 
+// Whether the node would be underfull if it stored its keys without a prefix of
+// `new_prefix_size` bytes.
+bool is_underfull_with_prefix(value_sizer_t *sizer, const leaf_node_t *node, int new_prefix_size) {
+    int ignored;
+    return mandatory_cost_with_prefix(sizer, node, new_prefix_size, MANDATORY_TIMESTAMPS, &ignored)
+        < free_space(sizer) / 2 - leaf_epsilon(sizer);
+}
+
 
 // Compares indices by looking at values in another array.
 class indirect_index_comparator_t {
@@ -609,7 +766,7 @@ void garbage_collect(
         indices[i] = i;
     }
 
-    std::sort(indices.data(), indices.data() + node->num_pairs, indirect_index_comparator_t(node->pair_offsets));
+    std::sort(indices.data(), indices.data() + node->num_pairs, indirect_index_comparator_t(pair_offsets(node)));
 
     int mand_offset;
     UNUSED int cost = mandatory_cost(sizer, node, num_tstamped, &mand_offset);
@@ -622,7 +779,7 @@ void garbage_collect(
     int w = sizer->block_size().value();
     int i = node->num_pairs - 1;
     for (; i >= 0; --i) {
-        int offset = node->pair_offsets[indices[i]];
+        int offset = pair_offsets(node)[indices[i]];
 
         if (offset < mand_offset) {
             break;
@@ -633,18 +790,18 @@ void garbage_collect(
             int sz = entry_size(sizer, ent);
             w -= sz;
             memmove(get_at_offset(node, w), ent, sz);
-            node->pair_offsets[indices[i]] = w;
+            pair_offsets(node)[indices[i]] = w;
         } else {
-            node->pair_offsets[indices[i]] = 0;
+            pair_offsets(node)[indices[i]] = 0;
         }
     }
 
-    // Either i < 0 or node->pair_offsets[indices[i]] < mand_offset.
+    // Either i < 0 or pair_offsets(node)[indices[i]] < mand_offset.
 
     node->tstamp_cutpoint = w;
 
     for (; i >= 0; --i) {
-        int offset = node->pair_offsets[indices[i]];
+        int offset = pair_offsets(node)[indices[i]];
         entry_t *ent = get_entry(node, offset);
         rassert(!entry_is_skip(ent));
 
@@ -654,7 +811,7 @@ void garbage_collect(
         w -= sz;
 
         memmove(get_at_offset(node, w), get_at_offset(node, offset), sz);
-        node->pair_offsets[indices[i]] = w;
+        pair_offsets(node)[indices[i]] = w;
     }
 
     node->frontmost = w;
@@ -666,8 +823,8 @@ void garbage_collect(
             *preserved_index = j;
         }
 
-        if (node->pair_offsets[k] != 0) {
-            node->pair_offsets[j] = node->pair_offsets[k];
+        if (pair_offsets(node)[k] != 0) {
+            pair_offsets(node)[j] = pair_offsets(node)[k];
 
             j += 1;
         }
@@ -709,6 +866,160 @@ void clean_entry(void *p, int sz) {
     }
 }
 
+// Writes the entry `ent` of a node whose keys lack the `old_size` bytes of
+// `old_prefix` to `dest`, for a node whose keys lack the `new_size` bytes of
+// `new_prefix`.  Returns the size of the written entry.
+int write_entry_with_prefix(value_sizer_t *sizer, const entry_t *ent,
+                            const uint8_t *old_prefix, int old_size,
+                            const uint8_t *new_prefix, int new_size, char *dest) {
+    rassert(!entry_is_skip(ent));
+    const btree_key_t *key = entry_key(ent);
+    const void *value = entry_value(ent);
+    char *p = dest;
+    if (value == nullptr) {
+        *p = static_cast<char>(DELETE_ENTRY_CODE);
+        ++p;
+    }
+    btree_key_t *new_key = reinterpret_cast<btree_key_t *>(p);
+    new_key->size = key->size + old_size - new_size;
+    if (new_size <= old_size) {
+        memcpy(new_key->contents, old_prefix + new_size, old_size - new_size);
+        memcpy(new_key->contents + old_size - new_size, key->contents, key->size);
+    } else {
+        rassert(memcmp(key->contents, new_prefix + old_size, new_size - old_size) == 0);
+        memcpy(new_key->contents, key->contents + new_size - old_size, new_key->size);
+    }
+    p += new_key->full_size();
+    if (value != nullptr) {
+        int value_size = sizer->size(value);
+        memcpy(p, value, value_size);
+        p += value_size;
+    }
+    return p - dest;
+}
+
+// Rewrites `node` so that it stores its keys without the `size` bytes of `prefix`,
+// which all keys in the key range of the node must have, and garbage collects it on
+// the way.  Returns false without changing the node if it wouldn't fit, which can
+// only happen if the prefix gets shorter.
+bool set_prefix(value_sizer_t *sizer, leaf_node_t *node, const uint8_t *prefix, int size) {
+    rassert(size <= MAX_KEY_SIZE);
+    const int old_size = prefix_size(node);
+    if (size == old_size) {
+        rassert(size == 0 || memcmp(prefix, prefix_contents(node), size) == 0);
+        return true;
+    }
+
+    int mand_offset;
+    if (mandatory_cost_with_prefix(sizer, node, size, MANDATORY_TIMESTAMPS, &mand_offset)
+        > free_space(sizer)) {
+        return false;
+    }
+
+    // `prefix` may point into `node`, which we're about to overwrite.
+    uint8_t new_prefix[MAX_KEY_SIZE];
+    if (size != 0) {
+        memcpy(new_prefix, prefix, size);
+    }
+
+    const int bs = sizer->block_size().value();
+    scoped_malloc_t<leaf_node_t> old_node(bs);
+    memcpy(old_node.get(), node, bs);
+    const leaf_node_t *old = old_node.get();
+    const uint8_t *old_prefix = old_size == 0 ? nullptr : prefix_contents(old);
+
+    scoped_array_t<uint16_t> indices(old->num_pairs);
+    for (int i = 0; i < old->num_pairs; ++i) {
+        indices[i] = i;
+    }
+    std::sort(indices.data(), indices.data() + old->num_pairs,
+              indirect_index_comparator_t(pair_offsets(old)));
+
+    // Like `garbage_collect()`, we write the entries from the back of the node,
+    // without the timestamps and deletions that aren't mandatory.
+    scoped_array_t<uint16_t> new_offsets(old->num_pairs);
+    int live_size = 0;
+    int w = bs;
+    int tstamp_cutpoint = -1;
+    for (int i = old->num_pairs - 1; i >= 0; --i) {
+        const int offset = pair_offsets(old)[indices[i]];
+        const entry_t *ent = get_entry(old, offset);
+        const bool tstamped = offset < mand_offset;
+        if (!tstamped && entry_is_deletion(ent)) {
+            new_offsets[indices[i]] = 0;
+            continue;
+        }
+        if (tstamped && tstamp_cutpoint == -1) {
+            tstamp_cutpoint = w;
+        }
+        const int sz = entry_size(sizer, ent) + old_size - size;
+        w -= sz;
+        write_entry_with_prefix(sizer, ent, old_prefix, old_size, new_prefix, size,
+                                get_at_offset(node, w));
+        if (tstamped) {
+            w -= sizeof(repli_timestamp_t);
+            reinterpret_cast<unaligned<repli_timestamp_t> *>(get_at_offset(node, w))->value
+                = get_timestamp(old, offset);
+        }
+        if (entry_is_live(ent)) {
+            live_size += sizeof(uint16_t) + sz;
+        }
+        new_offsets[indices[i]] = w;
+    }
+
+    node->num_pairs = 0;
+    init_prefix(node, new_prefix, size);
+    int j = 0;
+    for (int k = 0; k < old->num_pairs; ++k) {
+        if (new_offsets[k] != 0) {
+            pair_offsets(node)[j] = new_offsets[k];
+            ++j;
+        }
+    }
+    node->num_pairs = j;
+    node->live_size = live_size;
+    node->frontmost = w;
+    node->tstamp_cutpoint = tstamp_cutpoint == -1 ? w : tstamp_cutpoint;
+
+    validate(sizer, node);
+    return true;
+}
+
+// Shortens the prefix of `node` to its first `size` bytes.
+bool shorten_prefix(value_sizer_t *sizer, leaf_node_t *node, int size) {
+    rassert(size <= prefix_size(node));
+    return set_prefix(sizer, node, size == 0 ? nullptr : prefix_contents(node), size);
+}
+
+// The size of the prefix that the prefixes of both nodes start with.
+int common_prefix_size(const leaf_node_t *left, const leaf_node_t *right) {
+    const int max_size = std::min(prefix_size(left), prefix_size(right));
+    int size = 0;
+    while (size < max_size && prefix_contents(left)[size] == prefix_contents(right)[size]) {
+        ++size;
+    }
+    return size;
+}
+
+void extend_prefix(value_sizer_t *sizer, leaf_node_t *node,
+                   const btree_key_t *left_excl, const btree_key_t *right_incl) {
+    if (left_excl == nullptr || right_incl == nullptr) {
+        return;
+    }
+    // Every key in (left_excl, right_incl] starts with the prefix that both bounds
+    // share.
+    const int max_size = std::min(left_excl->size, right_incl->size);
+    int size = 0;
+    while (size < max_size && left_excl->contents[size] == right_incl->contents[size]) {
+        ++size;
+    }
+    if (size > prefix_size(node)) {
+        // The node keeps its prefix in the unlikely case that the header of the
+        // longer one doesn't fit.
+        set_prefix(sizer, node, right_incl->contents, size);
+    }
+}
+
 // Moves entries with pair_offsets indices in the clopen range [beg,
 // end) from fro to tow.
 void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
@@ -718,6 +1029,11 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
     rassert(is_underfull(sizer, tow));
     rassert(end >= beg);
 
+    // The entries are copied as they are, so both nodes must store their keys
+    // without the same prefix.
+    rassert(prefix_size(fro) == prefix_size(tow)
+            && common_prefix_size(fro, tow) == prefix_size(fro));
+
     // This assertion is a bit loose.
     rassert(fro_copysize + mandatory_cost(sizer, tow, MANDATORY_TIMESTAMPS) <= free_space(sizer));
 
@@ -726,7 +1042,7 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
     garbage_collect(sizer, tow, MANDATORY_TIMESTAMPS, &wpoint);
 
     // Now resize and move tow's pair_offsets.
-    memmove(tow->pair_offsets + wpoint + (end - beg), tow->pair_offsets + wpoint, sizeof(uint16_t) * (tow->num_pairs - wpoint));
+    memmove(pair_offsets(tow) + wpoint + (end - beg), pair_offsets(tow) + wpoint, sizeof(uint16_t) * (tow->num_pairs - wpoint));
 
     tow->num_pairs += end - beg;
 
@@ -735,18 +1051,18 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
     // Now we're going to do something crazy.  Fill the new hole in
     // the pair offsets with the numbers in [0, end - beg).
     for (int i = 0; i < end - beg; ++i) {
-        tow->pair_offsets[wpoint + i] = i;
+        pair_offsets(tow)[wpoint + i] = i;
     }
 
     // We treat these numbers as indices into [beg, end) in fro, and
     // sort them so that we can access [beg, end) in order by
     // increasing offset.
-    std::sort(tow->pair_offsets + wpoint, tow->pair_offsets + wpoint + (end - beg), indirect_index_comparator_t(fro->pair_offsets + beg));
+    std::sort(pair_offsets(tow) + wpoint, pair_offsets(tow) + wpoint + (end - beg), indirect_index_comparator_t(pair_offsets(fro) + beg));
 
     int tow_offset = tow->frontmost;
 
     // The offset we read from (indirectly pointing to fro's [beg,
-    // end)) in tow->pair_offsets, and the offset at which we stop.
+    // end)) in pair_offsets(tow), and the offset at which we stop.
     int fro_index = wpoint;
     int fro_index_end = wpoint + (end - beg);
 
@@ -764,7 +1080,7 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
     int livesize = tow->live_size;
 
     for (int i = 0; i < wpoint; ++i) {
-        if (tow->pair_offsets[i] < tow->tstamp_cutpoint) {
+        if (pair_offsets(tow)[i] < tow->tstamp_cutpoint) {
             rassert(num_adjustable_tow_offsets < MANDATORY_TIMESTAMPS);
             adjustable_tow_offsets[num_adjustable_tow_offsets] = i;
             ++num_adjustable_tow_offsets;
@@ -772,7 +1088,7 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
     }
 
     for (int i = wpoint + (end - beg); i < tow->num_pairs; ++i) {
-        if (tow->pair_offsets[i] < tow->tstamp_cutpoint) {
+        if (pair_offsets(tow)[i] < tow->tstamp_cutpoint) {
             rassert(num_adjustable_tow_offsets < MANDATORY_TIMESTAMPS);
             adjustable_tow_offsets[num_adjustable_tow_offsets] = i;
             ++num_adjustable_tow_offsets;
@@ -788,7 +1104,7 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
             break;
         }
 
-        int fro_offset = fro->pair_offsets[beg + tow->pair_offsets[fro_index]];
+        int fro_offset = pair_offsets(fro)[beg + pair_offsets(tow)[fro_index]];
 
         if (fro_offset >= fro_mand_offset) {
             // We have no more timestamped information to push.
@@ -815,7 +1131,7 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
             // Update the pair offset in fro to be the offset in tow
             // -- we'll never use the old value again and we'll copy
             // the newer values to tow later.
-            fro->pair_offsets[beg + tow->pair_offsets[fro_index]] = wri_offset;
+            pair_offsets(fro)[beg + pair_offsets(tow)[fro_index]] = wri_offset;
 
             wri_offset += sz;
             actually_copied += sz;
@@ -829,8 +1145,8 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
             int i;
             for (i = 0; i < num_adjustable_tow_offsets; ++i) {
                 int j = adjustable_tow_offsets[i];
-                if (tow->pair_offsets[j] == tow_offset) {
-                    tow->pair_offsets[j] = wri_offset;
+                if (pair_offsets(tow)[j] == tow_offset) {
+                    pair_offsets(tow)[j] = wri_offset;
                     break;
                 }
             }
@@ -847,7 +1163,7 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
 
     // Now we have some untimestamped entries to write.
     for (; fro_index < fro_index_end; ++fro_index) {
-        int fro_offset = fro->pair_offsets[beg + tow->pair_offsets[fro_index]];
+        int fro_offset = pair_offsets(fro)[beg + pair_offsets(tow)[fro_index]];
         entry_t *ent = get_entry(fro, fro_offset);
         if (entry_is_live(ent)) {
             int sz = entry_size(sizer, ent);
@@ -855,7 +1171,7 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
             clean_entry(ent, sz);
             fro_live_size_adjustment -= sz + sizeof(uint16_t);
 
-            fro->pair_offsets[beg + tow->pair_offsets[fro_index]] = wri_offset;
+            pair_offsets(fro)[beg + pair_offsets(tow)[fro_index]] = wri_offset;
 
             wri_offset += sz;
             livesize += sz + sizeof(uint16_t);
@@ -865,7 +1181,7 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
             rassert(entry_is_deletion(ent));
 
             // This is a dead entry.  We'll need to squash this dead entry later.
-            fro->pair_offsets[beg + tow->pair_offsets[fro_index]] = 0;
+            pair_offsets(fro)[beg + pair_offsets(tow)[fro_index]] = 0;
 
             int sz = entry_size(sizer, ent);
             clean_entry(ent, sz);
@@ -889,8 +1205,8 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
             int i;
             for (i = 0; i < num_adjustable_tow_offsets; ++i) {
                 int j = adjustable_tow_offsets[i];
-                if (tow->pair_offsets[j] == tow_offset) {
-                    tow->pair_offsets[j] = wri_offset;
+                if (pair_offsets(tow)[j] == tow_offset) {
+                    pair_offsets(tow)[j] = wri_offset;
                     break;
                 }
             }
@@ -906,8 +1222,8 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
             int i;
             for (i = 0; i < num_adjustable_tow_offsets; ++i) {
                 int j = adjustable_tow_offsets[i];
-                if (tow->pair_offsets[j] == tow_offset) {
-                    tow->pair_offsets[j] = 0;
+                if (pair_offsets(tow)[j] == tow_offset) {
+                    pair_offsets(tow)[j] = 0;
                 }
             }
         }
@@ -929,9 +1245,9 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
 
     // Copy the valid tow offsets from [beg, end) to the wpoint point
     // in tow, and move fro entries.
-    memcpy(tow->pair_offsets + wpoint, fro->pair_offsets + beg,
+    memcpy(pair_offsets(tow) + wpoint, pair_offsets(fro) + beg,
            sizeof(uint16_t) * (end - beg));
-    memmove(fro->pair_offsets + beg, fro->pair_offsets + end, sizeof(uint16_t) * (fro->num_pairs - end));
+    memmove(pair_offsets(fro) + beg, pair_offsets(fro) + end, sizeof(uint16_t) * (fro->num_pairs - end));
     fro->num_pairs -= end - beg;
 
     tow->frontmost = new_frontmost;
@@ -947,7 +1263,7 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
         moved_values_out->clear();
         moved_values_out->reserve(end - beg);
         for (int pair_idx = wpoint; pair_idx < wpoint + (end - beg); ++pair_idx) {
-            const int offset = tow->pair_offsets[pair_idx];
+            const int offset = pair_offsets(tow)[pair_idx];
             // Skip dead entries
             if (offset != 0) {
                 const entry_t *entry = get_entry(tow, offset);
@@ -964,8 +1280,8 @@ void move_elements(value_sizer_t *sizer, leaf_node_t *fro, int beg, int end,
         // for, and that we removed from tow, as well.
         int j, k;
         for (j = 0, k = 0; k < tow->num_pairs; ++k) {
-            if (tow->pair_offsets[k] != 0) {
-                tow->pair_offsets[j] = tow->pair_offsets[k];
+            if (pair_offsets(tow)[k] != 0) {
+                pair_offsets(tow)[j] = pair_offsets(tow)[k];
 
                 j += 1;
             }
@@ -990,7 +1306,7 @@ void split(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *rnode, btree_ke
     int prev_rcost = 0;
     int rcost = 0;
     while (i >= 0 && rcost < mandatory / 2) {
-        int offset = node->pair_offsets[i];
+        int offset = pair_offsets(node)[i];
         entry_t *ent = get_entry(node, offset);
 
         // We only take mandatory entries' costs into consideration,
@@ -1045,30 +1361,40 @@ void split(value_sizer_t *sizer, leaf_node_t *node, leaf_node_t *rnode, btree_ke
     // Now we wish to move the elements at indices [s, num_pairs) to rnode.
 
     init(sizer, rnode);
+    if (has_prefix_format(node)) {
+        init_prefix(rnode, prefix_contents(node), prefix_size(node));
+    }
 
     int node_copysize = end_rcost - num_mandatories * sizeof(uint16_t);
     move_elements(sizer, node, s, node->num_pairs, 0, rnode, node_copysize,
                   tstamp_back_offset, nullptr);
 
-    keycpy(median_out, entry_key(get_entry(node, node->pair_offsets[s - 1])));
+    entry_full_key(node, get_entry(node, pair_offsets(node)[s - 1]), median_out);
 }
 
 void merge(value_sizer_t *sizer, leaf_node_t *left, leaf_node_t *right) {
     rassert(left != right);
 
+    // The merged node covers the key ranges of both nodes, so it can only leave out
+    // the prefix that both of them leave out.  `is_mergable()` made sure that the
+    // nodes still fit with it.
+    const int common_size = common_prefix_size(left, right);
+    guarantee(shorten_prefix(sizer, left, common_size));
+    guarantee(shorten_prefix(sizer, right, common_size));
+
     rassert(is_underfull(sizer, left));
     rassert(is_underfull(sizer, right));
 
     int tstamp_back_offset;
     int mandatory = mandatory_cost(sizer, left, MANDATORY_TIMESTAMPS, &tstamp_back_offset);
 
-    int left_copysize = mandatory;
+    int left_copysize = mandatory - prefix_header_size(has_prefix_format(left), common_size);
     // Uncount the uint16_t cost of mandatory entries.  Sigh.
     // This includes deletion entries *before* the `tstamp_back_offset`, as well
     // as all non-deletion entries.
     for (int i = 0; i < left->num_pairs; ++i) {
-        if (left->pair_offsets[i] < tstamp_back_offset
-            || !entry_is_deletion(get_entry(left, left->pair_offsets[i]))) {
+        if (pair_offsets(left)[i] < tstamp_back_offset
+            || !entry_is_deletion(get_entry(left, pair_offsets(left)[i]))) {
             left_copysize -= sizeof(uint16_t);
         }
     }
@@ -1084,9 +1410,20 @@ bool level(value_sizer_t *sizer, int nodecmp_node_with_sib,
            std::vector<const void *> *moved_values_out) {
     rassert(node != sibling);
 
-    // If sibling were underfull, we'd just merge the nodes.
-    rassert(is_underfull(sizer, node));
-    rassert(!is_underfull(sizer, sibling));
+    // The keys we move have to lose the same prefix in both nodes, and the range of
+    // node grows into the one of sibling, so both nodes get the prefix that their
+    // prefixes share.  If that makes either of them too big, we'd rather not level.
+    const int common_size = common_prefix_size(node, sibling);
+    if (!shorten_prefix(sizer, sibling, common_size)
+        || !shorten_prefix(sizer, node, common_size)) {
+        return false;
+    }
+
+    // If sibling were underfull, we'd just merge the nodes, unless they don't fit
+    // together with their common prefix.
+    if (!is_underfull(sizer, node) || is_underfull(sizer, sibling)) {
+        return false;
+    }
 
     // First figure out the inclusive range [beg, end] of elements we want to move
     // from sibling.
@@ -1124,7 +1461,7 @@ bool level(value_sizer_t *sizer, int nodecmp_node_with_sib,
     int num_mandatories = 0;
     int prev_diff = sizer->block_size().value();  // some impossibly large value
     for (;;) {
-        int offset = sibling->pair_offsets[*w];
+        int offset = pair_offsets(sibling)[*w];
         entry_t *ent = get_entry(sibling, offset);
 
         // We only take mandatory entries' costs into consideration.
@@ -1182,24 +1519,44 @@ bool level(value_sizer_t *sizer, int nodecmp_node_with_sib,
     guarantee(sibling->num_pairs > 0);
 
     if (nodecmp_node_with_sib < 0) {
-        keycpy(replacement_key_out, entry_key(get_entry(node, node->pair_offsets[node->num_pairs - 1])));
+        entry_full_key(node, get_entry(node, pair_offsets(node)[node->num_pairs - 1]),
+                       replacement_key_out);
     } else {
-        keycpy(replacement_key_out, entry_key(get_entry(sibling, sibling->pair_offsets[sibling->num_pairs - 1])));
+        entry_full_key(sibling, get_entry(sibling, pair_offsets(sibling)[sibling->num_pairs - 1]),
+                       replacement_key_out);
     }
 
     return true;
 }
 
 bool is_mergable(value_sizer_t *sizer, const leaf_node_t *node, const leaf_node_t *sibling) {
-    return is_underfull(sizer, node) && is_underfull(sizer, sibling);
+    const int common_size = common_prefix_size(node, sibling);
+    return is_underfull_with_prefix(sizer, node, common_size)
+        && is_underfull_with_prefix(sizer, sibling, common_size);
 }
 
 // Sets *index_out to the index for the live entry or deletion entry
 // for the key, or to the index the key would have if it were
 // inserted.  Returns true if the key at said index is actually equal.
-bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out) {
+bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out,
+              const key_prefix_index_t *prefix_index) {
+    // Keys outside of the prefix of the node go before or after all of its entries.
+    const int psize = prefix_size(node);
+    if (psize != 0) {
+        const int res = sized_strcmp(key->contents, std::min<int>(key->size, psize),
+                                     prefix_contents(node), psize);
+        if (res != 0) {
+            *index_out = res < 0 ? 0 : node->num_pairs;
+            return false;
+        }
+    }
+
     int beg = 0;
     int end = node->num_pairs;
+    if (prefix_index != nullptr) {
+        rassert(prefix_index->size() == node->num_pairs);
+        prefix_index->narrow(key, &beg, &end);
+    }
 
     // beg == 0 or key > *(beg - 1).
     // end == num_pairs or key < *end.
@@ -1208,9 +1565,10 @@ bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out) {
         // when (end - beg) > 0, (end - beg) / 2 is always less than (end - beg).  So beg <= test_point < end.
         int test_point = beg + (end - beg) / 2;
 
-        const btree_key_t *ek = entry_key(get_entry(node, node->pair_offsets[test_point]));
+        const btree_key_t *ek = entry_key(get_entry(node, pair_offsets(node)[test_point]));
 
-        int res = btree_key_cmp(key, ek);
+        int res = sized_strcmp(key->contents + psize, key->size - psize,
+                               ek->contents, ek->size);
 
         if (res < 0) {
             // key < *test_point.
@@ -1232,10 +1590,11 @@ bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out) {
     return false;
 }
 
-bool lookup(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *key, void *value_out) {
+bool lookup(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *key, void *value_out,
+            const key_prefix_index_t *prefix_index) {
     int index;
-    if (find_key(node, key, &index)) {
-        const entry_t *ent = get_entry(node, node->pair_offsets[index]);
+    if (find_key(node, key, &index, prefix_index)) {
+        const entry_t *ent = get_entry(node, pair_offsets(node)[index]);
         if (entry_is_live(ent)) {
             const void *val = entry_value(ent);
             memcpy(value_out, val, sizer->size(val));
@@ -1305,7 +1664,7 @@ MUST_USE bool prepare_space_for_new_entry(
     bool found = find_key(node, key, &index);
 
     if (found) {
-        int offset = node->pair_offsets[index];
+        int offset = pair_offsets(node)[index];
         entry_t *ent = get_entry(node, offset);
 
         int sz = entry_size(sizer, ent);
@@ -1336,7 +1695,7 @@ MUST_USE bool prepare_space_for_new_entry(
     We check for this condition further down, and recover from it by dropping
     all existing timestamps and discarding the delete entry by returning `false`. */
 
-    if (offsetof(leaf_node_t, pair_offsets) +
+    if (pair_offsets_offset(node) +
             sizeof(uint16_t) * (node->num_pairs + (found ? 0 : 1)) +
             sizeof(repli_timestamp_t) +
             new_entry_size >
@@ -1346,8 +1705,8 @@ MUST_USE bool prepare_space_for_new_entry(
             /* We can't re-use an existing index if we're garbage collecting. */
             found = false;
             memmove(
-                node->pair_offsets + index,
-                node->pair_offsets + index + 1,
+                pair_offsets(node) + index,
+                pair_offsets(node) + index + 1,
                 sizeof(uint16_t) * (node->num_pairs - index - 1));
             --node->num_pairs;
         }
@@ -1415,7 +1774,7 @@ MUST_USE bool prepare_space_for_new_entry(
     bool drop_timestamps = false;
     if (actually_create_entry
         && !allow_after_tstamp_cutpoint
-        && offsetof(leaf_node_t, pair_offsets)
+        && pair_offsets_offset(node)
            + sizeof(uint16_t) * (node->num_pairs + (found ? 0 : 1))
            + new_entry_size
            + sizeof(repli_timestamp_t)
@@ -1430,8 +1789,8 @@ MUST_USE bool prepare_space_for_new_entry(
             a new one; close the gap in `pair_offsets`. `index` is the location
             of the open slot. */
             memmove(
-                node->pair_offsets + index,
-                node->pair_offsets + index + 1,
+                pair_offsets(node) + index,
+                pair_offsets(node) + index + 1,
                 sizeof(uint16_t) * (node->num_pairs - index - 1));
             --node->num_pairs;
         }
@@ -1450,8 +1809,8 @@ MUST_USE bool prepare_space_for_new_entry(
 
     if (!found) {
         memmove(
-            node->pair_offsets + index + 1,
-            node->pair_offsets + index,
+            pair_offsets(node) + index + 1,
+            pair_offsets(node) + index,
             sizeof(uint16_t) * (node->num_pairs - index));
         ++node->num_pairs;
     }
@@ -1476,14 +1835,14 @@ MUST_USE bool prepare_space_for_new_entry(
         the entries */
         for (int i = 0; i < node->num_pairs; ++i) {
             if (i == index) continue;
-            if (node->pair_offsets[i] < end_of_where_new_entry_should_go) {
-                node->pair_offsets[i] -= total_space_for_new_entry;
+            if (pair_offsets(node)[i] < end_of_where_new_entry_should_go) {
+                pair_offsets(node)[i] -= total_space_for_new_entry;
             }
         }
     }
 
     node->frontmost -= total_space_for_new_entry;
-    guarantee(offsetof(leaf_node_t, pair_offsets)
+    guarantee(pair_offsets_offset(node)
               + sizeof(uint16_t) * node->num_pairs <= node->frontmost);
 
     /* Write the timestamp if we need one, and update `node->tstamp_cutpoint` if
@@ -1499,7 +1858,7 @@ MUST_USE bool prepare_space_for_new_entry(
 
     /* Record the offset in `pair_offsets` */
 
-    node->pair_offsets[index] = start_of_where_new_entry_should_go;
+    pair_offsets(node)[index] = start_of_where_new_entry_should_go;
 
     /* Fill output variable */
 
@@ -1526,20 +1885,21 @@ void insert(
 
     /* Make space for the entry itself */
 
+    const int key_size = stored_key_size(node, key);
     char *location_to_write_data;
     bool should_write = prepare_space_for_new_entry(sizer, node,
-        key, key->full_size() + sizer->size(value), tstamp, maximum_existing_tstamp,
+        key, key_size + sizer->size(value), tstamp, maximum_existing_tstamp,
         true,
         &location_to_write_data);
     guarantee(should_write);
 
     /* Now copy the data into the node itself */
 
-    memcpy(location_to_write_data, key, key->full_size());
-    location_to_write_data += key->full_size();
+    write_stored_key(node, location_to_write_data, key);
+    location_to_write_data += key_size;
     memcpy(location_to_write_data, value, sizer->size(value));
 
-    node->live_size += sizeof(uint16_t) + key->full_size() + sizer->size(value);
+    node->live_size += sizeof(uint16_t) + key_size + sizer->size(value);
 
     validate(sizer, node);
 }
@@ -1558,14 +1918,14 @@ void remove(
     char *location_to_write_data;
     if (prepare_space_for_new_entry(sizer, node,
             key,
-            1 + key->full_size(),   /* 1 for `DELETE_ENTRY_CODE` */
+            1 + stored_key_size(node, key),   /* 1 for `DELETE_ENTRY_CODE` */
             tstamp,
             maximum_existing_tstamp,
             false,
             &location_to_write_data)) {
         *location_to_write_data = static_cast<char>(DELETE_ENTRY_CODE);
         ++location_to_write_data;
-        memcpy(location_to_write_data, key, key->full_size());
+        write_stored_key(node, location_to_write_data, key);
     }
 
     validate(sizer, node);
@@ -1576,7 +1936,7 @@ void erase_presence(value_sizer_t *sizer, leaf_node_t *node, const btree_key_t *
     int index;
     bool found = find_key(node, key, &index);
     if (found) {
-        int offset = node->pair_offsets[index];
+        int offset = pair_offsets(node)[index];
         entry_t *ent = get_entry(node, offset);
 
         int sz = entry_size(sizer, ent);
@@ -1586,7 +1946,7 @@ void erase_presence(value_sizer_t *sizer, leaf_node_t *node, const btree_key_t *
 
         clean_entry(ent, sz);
 
-        memmove(node->pair_offsets + index, node->pair_offsets + index + 1, (node->num_pairs - (index + 1)) * sizeof(uint16_t));
+        memmove(pair_offsets(node) + index, pair_offsets(node) + index + 1, (node->num_pairs - (index + 1)) * sizeof(uint16_t));
         node->num_pairs -= 1;
     }
 
@@ -1668,13 +2028,13 @@ void erase_deletions(
     int src = 0, dst = 0;
     int num_deleted = deletion_offsets.size();
     for (; src < node->num_pairs; ++src) {
-        uint16_t off = node->pair_offsets[src];
+        uint16_t off = pair_offsets(node)[src];
         auto it = deletion_offsets.find(off);
         if (it == deletion_offsets.end()) {
             if (off >= new_tstamp_cutpoint && off < old_tstamp_cutpoint) {
                 off += sizeof(repli_timestamp_t);
             }
-            node->pair_offsets[dst++] = off;
+            pair_offsets(node)[dst++] = off;
         } else {
             guarantee(off >= new_tstamp_cutpoint && off < old_tstamp_cutpoint);
             deletion_offsets.erase(it);
@@ -1689,7 +2049,8 @@ void erase_deletions(
 
 /* Calls `cb` on every entry in the node, whether a real entry or a deletion. The calls
 will be in order from most recent to least recent. For entries with no timestamp, the
-callback will get `min_deletion_timestamp() - 1`. */
+callback will get `min_deletion_timestamp() - 1`. In a node with a prefix, the key that
+`cb` gets is only valid during the call. */
 continue_bool_t visit_entries(
         value_sizer_t *sizer,
         const leaf_node_t *node,
@@ -1699,6 +2060,8 @@ continue_bool_t visit_entries(
             repli_timestamp_t timestamp,
             const void *value   /* null for deletion */
             )> &cb) {
+    const bool with_prefix = prefix_size(node) != 0;
+    store_key_t full_key;
     repli_timestamp_t earliest_so_far = maximum_existing_timestamp;
     for (entry_iter_t iter = entry_iter_t::make(node);
             !iter.done(sizer); iter.step(sizer, node)) {
@@ -1716,7 +2079,12 @@ continue_bool_t visit_entries(
             continue;
         }
 
-        if (continue_bool_t::ABORT == cb(entry_key(ent), tstamp, entry_value(ent))) {
+        const btree_key_t *key = entry_key(ent);
+        if (with_prefix) {
+            entry_full_key(node, ent, full_key.btree_key());
+            key = full_key.btree_key();
+        }
+        if (continue_bool_t::ABORT == cb(key, tstamp, entry_value(ent))) {
             return continue_bool_t::ABORT;
         }
     }
@@ -1732,16 +2100,26 @@ iterator::iterator(const leaf_node_t *node, int index)
 std::pair<const btree_key_t *, const void *> iterator::operator*() const {
     guarantee(index_ < static_cast<int>(node_->num_pairs));
     guarantee(index_ >= 0);
-    const entry_t *entree = get_entry(node_, node_->pair_offsets[index_]);
+    const entry_t *entree = get_entry(node_, pair_offsets(node_)[index_]);
+    if (prefix_size(node_) != 0) {
+        entry_full_key(node_, entree, key_.btree_key());
+        return std::make_pair(key_.btree_key(), entry_value(entree));
+    }
     return std::make_pair(entry_key(entree), entry_value(entree));
 }
 
+const btree_key_t *iterator::stored_key() const {
+    guarantee(index_ < static_cast<int>(node_->num_pairs));
+    guarantee(index_ >= 0);
+    return entry_key(get_entry(node_, pair_offsets(node_)[index_]));
+}
+
 iterator &iterator::operator++() {
     guarantee(index_ < static_cast<int>(node_->num_pairs),
               "Trying to increment past the end of an iterator.");
     do {
         ++index_;
-    } while (index_ < node_->num_pairs && !entry_is_live(get_entry(node_, node_->pair_offsets[index_])));
+    } while (index_ < node_->num_pairs && !entry_is_live(get_entry(node_, pair_offsets(node_)[index_])));
     return *this;
 }
 
@@ -1749,7 +2127,7 @@ iterator &iterator::operator--() {
     guarantee(index_ > -1, "Trying to decrement past the beginning of an iterator.");
     do {
         --index_;
-    } while (index_ >= 0 && !entry_is_live(get_entry(node_, node_->pair_offsets[index_])));
+    } while (index_ >= 0 && !entry_is_live(get_entry(node_, pair_offsets(node_)[index_])));
     return *this;
 }
 
@@ -1812,7 +2190,7 @@ leaf::iterator inclusive_lower_bound(const btree_key_t *key, const leaf_node_t &
     int index;
     leaf::find_key(&leaf_node, key, &index);
     if (index == leaf_node.num_pairs ||
-        entry_is_live(leaf::get_entry(&leaf_node, leaf_node.pair_offsets[index]))) {
+        entry_is_live(leaf::get_entry(&leaf_node, pair_offsets(&leaf_node)[index]))) {
         return leaf_node_t::iterator(&leaf_node, index);
     } else {
         return ++leaf_node_t::iterator(&leaf_node, index);
@@ -1823,10 +2201,9 @@ leaf::reverse_iterator exclusive_upper_bound(const btree_key_t *key, const leaf_
     int index;
     leaf::find_key(&leaf_node, key, &index);
     if (index < leaf_node.num_pairs) {
-        const leaf::entry_t *entry = leaf::get_entry(&leaf_node, leaf_node.pair_offsets[index]);
-        const btree_key_t *ekey = leaf::entry_key(entry);
+        const leaf::entry_t *entry = leaf::get_entry(&leaf_node, pair_offsets(&leaf_node)[index]);
         if (entry_is_live(entry) &&
-            btree_key_cmp(ekey, key) == 0) {
+            entry_key_cmp(&leaf_node, key, entry) == 0) {
             // We have to skip this entry to make the iterator exclusive,
             // hence the ++.
             return ++leaf_node_t::reverse_iterator(&leaf_node, index);
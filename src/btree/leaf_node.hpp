@@ -7,10 +7,12 @@
 #include <vector>
 
 #include "arch/compiler.hpp"
+#include "btree/keys.hpp"
 #include "btree/types.hpp"
 #include "buffer_cache/types.hpp"
 #include "containers/optional.hpp"
 
+class key_prefix_index_t;
 class value_sizer_t;
 struct btree_key_t;
 class repli_timestamp_t;
@@ -76,6 +78,10 @@ leaf_node_t::reverse_iterator exclusive_upper_bound(const btree_key_t *key, cons
 const int MANDATORY_TIMESTAMPS = 5;
 const int DELETION_RESERVE_FRACTION = 10;
 
+// Set in the last byte of the magic of leaf nodes that store their keys without a
+// common prefix (see leaf_node.cc).
+const uint8_t PREFIX_FORMAT_MAGIC_BIT = 0x80;
+
 
 
 
@@ -124,9 +130,22 @@ bool level(value_sizer_t *sizer, int nodecmp_node_with_sib, leaf_node_t *node,
 
 bool is_mergable(value_sizer_t *sizer, const leaf_node_t *node, const leaf_node_t *sibling);
 
-bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out);
+// Lets `node`, whose key range is now (`left_excl`, `right_incl`], store its keys
+// without the prefix that all keys in that range share.  Does nothing if either bound
+// is null.
+void extend_prefix(value_sizer_t *sizer, leaf_node_t *node,
+                   const btree_key_t *left_excl, const btree_key_t *right_incl);
+
+// The prefix that all keys in `node` share and that its entries don't store.
+int prefix_size(const leaf_node_t *node);
+const uint8_t *prefix_contents(const leaf_node_t *node);
+
+// `prefix_index`, if not null, must be the key prefix index of `node`.
+bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out,
+              const key_prefix_index_t *prefix_index = nullptr);
 
-bool lookup(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *key, void *value_out);
+bool lookup(value_sizer_t *sizer, const leaf_node_t *node, const btree_key_t *key, void *value_out,
+            const key_prefix_index_t *prefix_index = nullptr);
 
 void insert(
         value_sizer_t *sizer,
@@ -167,7 +186,8 @@ void erase_deletions(
 
 /* Calls `cb` on every entry in the node, whether a real entry or a deletion. The calls
 will be in order from most recent to least recent. For entries with no timestamp, the
-callback will get `min_deletion_timestamp() - 1`. */
+callback will get `min_deletion_timestamp() - 1`. In a node with a prefix, the key that
+`cb` gets is only valid during the call. */
 continue_bool_t visit_entries(
     value_sizer_t *sizer,
     const leaf_node_t *node,
@@ -179,11 +199,15 @@ continue_bool_t visit_entries(
         const void *value   /* null for deletion */
         )> &cb);
 
+/* In a node with a prefix, the key that `operator*()` returns points into the
+iterator and is only valid until the iterator is dereferenced again or destroyed. */
 class iterator {
 public:
     iterator();
     iterator(const leaf_node_t *node, int index);
     std::pair<const btree_key_t *, const void *> operator*() const;
+    // The key as the entry stores it, without the prefix of the node.
+    const btree_key_t *stored_key() const;
     iterator &operator++();
     iterator &operator--();
     bool operator==(const iterator &other) const;
@@ -197,6 +221,7 @@ private:
     int cmp(const iterator &other) const;
     const leaf_node_t *node_;
     int index_;
+    mutable store_key_t key_;
 };
 
 class reverse_iterator {
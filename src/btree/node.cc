@@ -6,10 +6,15 @@
 
 const block_magic_t internal_node_t::expected_magic = { { 'i', 'n', 't', 'e' } };
 
+bool value_sizer_t::is_btree_leaf_magic(block_magic_t magic) const {
+    magic.bytes[3] &= ~leaf::PREFIX_FORMAT_MAGIC_BIT;
+    return magic == btree_leaf_magic();
+}
+
 namespace node {
 
 bool is_underfull(value_sizer_t *sizer, const node_t *node) {
-    if (node->magic == sizer->btree_leaf_magic()) {
+    if (sizer->is_btree_leaf_magic(node->magic)) {
         return leaf::is_underfull(sizer, reinterpret_cast<const leaf_node_t *>(node));
     } else {
         rassert(is_internal(node));
@@ -17,12 +22,12 @@ bool is_underfull(value_sizer_t *sizer, const node_t *node) {
     }
 }
 
-bool is_mergable(value_sizer_t *sizer, const node_t *node, const node_t *sibling, const internal_node_t *parent) {
-    if (sizer->btree_leaf_magic() == node->magic) {
+bool is_mergable(value_sizer_t *sizer, const node_t *node, const node_t *sibling, const btree_key_t *key_from_parent) {
+    if (sizer->is_btree_leaf_magic(node->magic)) {
         return leaf::is_mergable(sizer, reinterpret_cast<const leaf_node_t *>(node), reinterpret_cast<const leaf_node_t *>(sibling));
     } else {
         rassert(is_internal(node));
-        return internal_node::is_mergable(sizer->block_size(), reinterpret_cast<const internal_node_t *>(node), reinterpret_cast<const internal_node_t *>(sibling), parent);
+        return internal_node::is_mergable(sizer->block_size(), reinterpret_cast<const internal_node_t *>(node), reinterpret_cast<const internal_node_t *>(sibling), key_from_parent);
     }
 }
 
@@ -37,17 +42,17 @@ void split(value_sizer_t *sizer, node_t *node, node_t *rnode, btree_key_t *media
     }
 }
 
-void merge(value_sizer_t *sizer, node_t *node, node_t *rnode, const internal_node_t *parent) {
+void merge(value_sizer_t *sizer, node_t *node, node_t *rnode, const btree_key_t *key_from_parent) {
     if (is_leaf(node)) {
         leaf::merge(sizer, reinterpret_cast<leaf_node_t *>(node), reinterpret_cast<leaf_node_t *>(rnode));
     } else {
-        internal_node::merge(sizer->block_size(), reinterpret_cast<internal_node_t *>(node), reinterpret_cast<internal_node_t *>(rnode), parent);
+        internal_node::merge(sizer->block_size(), reinterpret_cast<internal_node_t *>(node), reinterpret_cast<internal_node_t *>(rnode), key_from_parent);
     }
 }
 
 void validate(DEBUG_VAR value_sizer_t *sizer, DEBUG_VAR const node_t *node) {
 #ifndef NDEBUG
-    if (node->magic == sizer->btree_leaf_magic()) {
+    if (sizer->is_btree_leaf_magic(node->magic)) {
         leaf::validate(sizer, reinterpret_cast<const leaf_node_t *>(node));
     } else if (node->magic == internal_node_t::expected_magic) {
         internal_node::validate(sizer->block_size(), reinterpret_cast<const internal_node_t *>(node));
@@ -27,6 +27,10 @@ public:
     virtual block_magic_t btree_leaf_magic() const = 0;
     virtual max_block_size_t block_size() const = 0;
 
+    // True for `btree_leaf_magic()` and for the magic of leaf nodes in the prefix
+    // format (see leaf_node.cc).
+    bool is_btree_leaf_magic(block_magic_t magic) const;
+
 private:
     DISABLE_COPYING(value_sizer_t);
 };
@@ -73,13 +77,13 @@ inline bool is_leaf(const node_t *node) {
     return !is_internal(node);
 }
 
-bool is_mergable(value_sizer_t *sizer, const node_t *node, const node_t *sibling, const internal_node_t *parent);
+bool is_mergable(value_sizer_t *sizer, const node_t *node, const node_t *sibling, const btree_key_t *key_from_parent);
 
 bool is_underfull(value_sizer_t *sizer, const node_t *node);
 
 void split(value_sizer_t *sizer, node_t *node, node_t *rnode, btree_key_t *median);
 
-void merge(value_sizer_t *sizer, node_t *node, node_t *rnode, const internal_node_t *parent);
+void merge(value_sizer_t *sizer, node_t *node, node_t *rnode, const btree_key_t *key_from_parent);
 
 void validate(value_sizer_t *sizer, const node_t *node);
 
@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 #include "btree/internal_node.hpp"
+#include "btree/key_prefix_index.hpp"
 #include "btree/leaf_node.hpp"
 #include "buffer_cache/alt.hpp"
 #include "buffer_cache/blob.hpp"
@@ -63,6 +64,48 @@ void detach_all_children(const node_t *node, buf_parent_t parent,
     }
 }
 
+// Helper function for `check_and_handle_split()`.  Lets the two halves of a split
+// leaf node leave out the prefix that all keys in their new key ranges share.  We only
+// know both bounds of a range if `parent` has keys on both sides of the child.
+void extend_leaf_prefixes(value_sizer_t *sizer, buf_lock_t *parent,
+                          buf_lock_t *left, buf_lock_t *right,
+                          const btree_key_t *median) {
+    store_key_t left_bound;
+    store_key_t right_bound;
+    bool has_left_bound;
+    bool has_right_bound;
+    {
+        buf_read_t parent_read(parent);
+        const internal_node_t *node
+            = static_cast<const internal_node_t *>(parent_read.get_data_read());
+        const int index = internal_node::get_offset_index(node, median);
+        rassert(btree_key_cmp(&internal_node::get_pair_by_index(node, index)->key,
+                              median) == 0);
+        has_left_bound = index > 0;
+        if (has_left_bound) {
+            left_bound.assign(&internal_node::get_pair_by_index(node, index - 1)->key);
+        }
+        // The last pair has no key.
+        has_right_bound = index + 1 < node->npairs - 1;
+        if (has_right_bound) {
+            right_bound.assign(&internal_node::get_pair_by_index(node, index + 1)->key);
+        }
+    }
+
+    if (has_left_bound) {
+        buf_write_t left_write(left);
+        leaf::extend_prefix(sizer,
+                            static_cast<leaf_node_t *>(left_write.get_data_write()),
+                            left_bound.btree_key(), median);
+    }
+    if (has_right_bound) {
+        buf_write_t right_write(right);
+        leaf::extend_prefix(sizer,
+                            static_cast<leaf_node_t *>(right_write.get_data_write()),
+                            median, right_bound.btree_key());
+    }
+}
+
 // Split the node if necessary. If the node is a leaf_node, provide the new
 // value that will be inserted; if it's an internal node, provide NULL (we
 // split internal nodes proactively).
@@ -153,6 +196,10 @@ void check_and_handle_split(value_sizer_t *sizer,
         rassert(success, "could not insert internal btree node");
     }
 
+    if (new_value != nullptr) {
+        extend_leaf_prefixes(sizer, last_buf, buf, &rbuf, median);
+    }
+
     // We've split the node; now figure out where the key goes and release the other buf (since we're done with it).
     if (0 >= btree_key_cmp(key, median)) {
         // The key goes in the old buf (the left one).
@@ -216,11 +263,9 @@ void check_and_handle_underfull(value_sizer_t *sizer,
             buf_read_t buf_read(buf);
             const node_t *const node
                 = static_cast<const node_t *>(buf_read.get_data_read());
-            buf_read_t last_buf_read(last_buf);
-            const internal_node_t *parent_node
-                = static_cast<const internal_node_t *>(last_buf_read.get_data_read());
 
-            node_is_mergable = node::is_mergable(sizer, node, sib_node, parent_node);
+            node_is_mergable = node::is_mergable(sizer, node, sib_node,
+                                                 key_in_middle.btree_key());
         }
 
         if (node_is_mergable) {
@@ -254,7 +299,6 @@ void check_and_handle_underfull(value_sizer_t *sizer,
             {
                 buf_write_t sib_buf_write(&sib_buf);
                 buf_write_t buf_write(buf);
-                buf_read_t last_buf_read(last_buf);
 
                 // Detach all values / children in `sib_buf`
                 buf_read_t sib_buf_read(&sib_buf);
@@ -262,12 +306,10 @@ void check_and_handle_underfull(value_sizer_t *sizer,
                     static_cast<const node_t *>(sib_buf_read.get_data_read());
                 detach_all_children(node, buf_parent_t(&sib_buf), detacher);
 
-                const internal_node_t *parent_node
-                    = static_cast<const internal_node_t *>(last_buf_read.get_data_read());
                 node::merge(sizer,
                             static_cast<node_t *>(sib_buf_write.get_data_write()),
                             static_cast<node_t *>(buf_write.get_data_write()),
-                            parent_node);
+                            key_in_middle.btree_key());
             }
             sib_buf.mark_deleted();
             sib_buf.reset_buf_lock();
@@ -309,9 +351,6 @@ void check_and_handle_underfull(value_sizer_t *sizer,
                 }
                 buf_write_t buf_write(buf);
                 buf_write_t sib_buf_write(&sib_buf);
-                buf_read_t last_buf_read(last_buf);
-                const internal_node_t *parent_node
-                    = static_cast<const internal_node_t *>(last_buf_read.get_data_read());
                 // We handle internal and leaf nodes separately because of the
                 // different ways their children have to be detached.
                 // (for internal nodes: call detach_child directly vs. for leaf
@@ -320,9 +359,11 @@ void check_and_handle_underfull(value_sizer_t *sizer,
                 if (is_internal) {
                     std::vector<block_id_t> moved_children;
                     leveled = internal_node::level(sizer->block_size(),
+                            nodecmp_node_with_sib,
                             static_cast<internal_node_t *>(buf_write.get_data_write()),
                             static_cast<internal_node_t *>(sib_buf_write.get_data_write()),
-                            replacement_key, parent_node, &moved_children);
+                            replacement_key, key_in_middle.btree_key(),
+                            &moved_children);
                     // Detach children that have been removed from `sib_buf`:
                     for (size_t i = 0; i < moved_children.size(); ++i) {
                         sib_buf.detach_child(moved_children[i]);
@@ -491,11 +532,34 @@ void find_keyvalue_location_for_read(
         return;
     }
 
+    // Internal nodes that nobody is writing to are read without acquiring them, down
+    // to the first node that has to be acquired (see `buf_peek_t`).
+    block_id_t first_id = root_id;
+    for (;;) {
+        buf_peek_t peek(superblock->expose_buf(), first_id);
+        if (!peek.has()) {
+            break;
+        }
+        const void *data = peek.get_data_read();
+        if (!node::is_internal(static_cast<const node_t *>(data))) {
+            break;
+        }
+        auto node = static_cast<const internal_node_t *>(data);
+#ifndef NDEBUG
+        node::validate(sizer, reinterpret_cast<const node_t *>(node));
+#endif  // NDEBUG
+        first_id = internal_node::lookup(node, key, get_key_prefix_index(&peek, node));
+        rassert(first_id != NULL_BLOCK_ID && first_id != SUPERBLOCK_ID);
+    }
+
     buf_lock_t buf;
     {
         PROFILE_STARTER_IF_ENABLED(
                 trace != nullptr, "Acquire a block for read.", trace);;
-        buf_lock_t tmp(superblock->expose_buf(), root_id, access_t::read);
+        buf_lock_t tmp(first_id == root_id
+                           ? superblock->expose_buf()
+                           : buf_parent_t(superblock->expose_buf().txn()),
+                       first_id, access_t::read);
         superblock->release();
         buf = std::move(tmp);
     }
@@ -516,8 +580,9 @@ void find_keyvalue_location_for_read(
                 break;
             }
 
-            node_id = internal_node::lookup(static_cast<const internal_node_t *>(data),
-                                            key);
+            auto node = static_cast<const internal_node_t *>(data);
+            node_id = internal_node::lookup(node, key,
+                                            get_key_prefix_index(&read, node));
         }
         rassert(node_id != NULL_BLOCK_ID && node_id != SUPERBLOCK_ID);
 
@@ -544,7 +609,8 @@ void find_keyvalue_location_for_read(
         buf_read_t read(&buf);
         const leaf_node_t *leaf
             = static_cast<const leaf_node_t *>(read.get_data_read());
-        value_found = leaf::lookup(sizer, leaf, key, value.get());
+        value_found = leaf::lookup(sizer, leaf, key, value.get(),
+                                   get_key_prefix_index(&read, leaf));
     }
     if (value_found) {
         keyvalue_location_out->buf = std::move(buf);
@@ -553,6 +619,140 @@ void find_keyvalue_location_for_read(
     }
 }
 
+// Helper function for `find_keyvalue_locations_for_read()`.  Looks up the keys
+// `keys[order[beg]], ..., keys[order[end - 1]]`, which are in ascending order, in the
+// subtree of `buf`.
+continue_bool_t find_keyvalue_locations_in_subtree(
+        value_sizer_t *sizer,
+        buf_lock_t *buf,
+        const std::vector<const btree_key_t *> &keys,
+        const std::vector<size_t> &order,
+        size_t beg,
+        size_t end,
+        direction_t direction,
+        const std::function<continue_bool_t(
+            size_t, const void *, buf_parent_t)> &cb,
+        btree_stats_t *stats,
+        profile::trace_t *trace) {
+    struct child_t {
+        block_id_t block_id;
+        size_t beg;
+        size_t end;
+    };
+    std::vector<child_t> children;
+    {
+        buf_read_t read(buf);
+        const void *data = read.get_data_read();
+#ifndef NDEBUG
+        node::validate(sizer, static_cast<const node_t *>(data));
+#endif  // NDEBUG
+
+        if (!node::is_internal(static_cast<const node_t *>(data))) {
+            auto leaf = static_cast<const leaf_node_t *>(data);
+            const key_prefix_index_t *prefix_index = get_key_prefix_index(&read, leaf);
+            scoped_malloc_t<void> value(sizer->max_possible_size());
+            // Only the keys that are in the leaf count as read.
+            size_t keys_found = 0;
+            continue_bool_t cont = continue_bool_t::CONTINUE;
+            for (size_t i = 0; i < end - beg && cont == continue_bool_t::CONTINUE;
+                 ++i) {
+                const size_t index = order[direction == FORWARD ? beg + i : end - 1 - i];
+                if (leaf::lookup(sizer, leaf, keys[index], value.get(), prefix_index)) {
+                    ++keys_found;
+                    cont = cb(index, value.get(), buf_parent_t(buf));
+                }
+            }
+            stats->pm_keys_read.record(keys_found);
+            stats->pm_total_keys_read += keys_found;
+            return cont;
+        }
+
+        // Group the keys by the child they go to.  The keys that go to a child are
+        // the ones up to its key; the last child has no key and gets the rest.
+        auto node = static_cast<const internal_node_t *>(data);
+        const key_prefix_index_t *prefix_index = get_key_prefix_index(&read, node);
+        for (size_t i = beg; i < end;) {
+            const int child_index
+                = internal_node::get_offset_index(node, keys[order[i]], prefix_index);
+            const btree_internal_pair *pair
+                = internal_node::get_pair_by_index(node, child_index);
+            size_t j = i + 1;
+            if (child_index == node->npairs - 1) {
+                j = end;
+            } else {
+                while (j < end && btree_key_cmp(keys[order[j]], &pair->key) <= 0) {
+                    ++j;
+                }
+            }
+            rassert(pair->lnode != NULL_BLOCK_ID && pair->lnode != SUPERBLOCK_ID);
+            children.push_back(child_t{pair->lnode, i, j});
+            i = j;
+        }
+    }
+
+    for (size_t i = 0; i < children.size(); ++i) {
+        const child_t &child
+            = children[direction == FORWARD ? i : children.size() - 1 - i];
+        buf_lock_t child_buf;
+        {
+            PROFILE_STARTER_IF_ENABLED(
+                trace != nullptr, "Acquire a block for read.", trace);
+            child_buf = buf_lock_t(buf, child.block_id, access_t::read);
+        }
+        if (continue_bool_t::ABORT == find_keyvalue_locations_in_subtree(
+                sizer, &child_buf, keys, order, child.beg, child.end, direction, cb,
+                stats, trace)) {
+            return continue_bool_t::ABORT;
+        }
+    }
+    return continue_bool_t::CONTINUE;
+}
+
+continue_bool_t find_keyvalue_locations_for_read(
+        value_sizer_t *sizer,
+        superblock_t *superblock,
+        const std::vector<const btree_key_t *> &keys,
+        direction_t direction,
+        release_superblock_t release_superblock,
+        const std::function<continue_bool_t(
+            size_t index, const void *value, buf_parent_t leaf)> &cb,
+        btree_stats_t *stats,
+        profile::trace_t *trace) {
+    const block_id_t root_id = superblock->get_root_block_id();
+    rassert(root_id != SUPERBLOCK_ID);
+
+    if (root_id == NULL_BLOCK_ID || keys.empty()) {
+        // Either the tree is empty (it has no root), or there is nothing to look up.
+        if (release_superblock == release_superblock_t::RELEASE) {
+            superblock->release();
+        }
+        return continue_bool_t::CONTINUE;
+    }
+
+    // Equal keys keep the order they have in `keys`.
+    std::vector<size_t> order(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return btree_key_cmp(keys[a], keys[b]) < 0;
+    });
+
+    buf_lock_t root;
+    {
+        PROFILE_STARTER_IF_ENABLED(
+                trace != nullptr, "Acquire a block for read.", trace);
+        buf_lock_t tmp(superblock->expose_buf(), root_id, access_t::read);
+        if (release_superblock == release_superblock_t::RELEASE) {
+            superblock->release();
+        }
+        root = std::move(tmp);
+    }
+
+    return find_keyvalue_locations_in_subtree(
+        sizer, &root, keys, order, 0, order.size(), direction, cb, stats, trace);
+}
+
 void apply_keyvalue_change(
         value_sizer_t *sizer,
         keyvalue_location_t *kv_loc,
@@ -3,9 +3,11 @@
 #define BTREE_OPERATIONS_HPP_
 
 #include <algorithm>
+#include <functional>
 #include <utility>
 #include <vector>
 
+#include "btree/depth_first_traversal.hpp"
 #include "btree/node.hpp"
 #include "btree/stats.hpp"
 #include "buffer_cache/alt.hpp"
@@ -144,6 +146,25 @@ void find_keyvalue_location_for_read(
         btree_stats_t *stats,
         profile::trace_t *trace);
 
+/* Looks up all of `keys` in a single descent of the tree.  The keys are sorted first,
+and the descent only splits up where they go to different children, so every node on
+the way, and every leaf that holds some of the keys, is acquired once.  `cb` gets
+called for every key that is in the tree, with the index of the key in `keys`, its
+value, and the leaf that holds it, which stays acquired during the call.  The calls go
+in ascending key order, or in descending order for `BACKWARD`; callers that want the
+values in the order of `keys` can use the index.  Returns `ABORT` as soon as `cb`
+does.  The keys that are found count as read in `stats`. */
+continue_bool_t find_keyvalue_locations_for_read(
+        value_sizer_t *sizer,
+        superblock_t *superblock,
+        const std::vector<const btree_key_t *> &keys,
+        direction_t direction,
+        release_superblock_t release_superblock,
+        const std::function<continue_bool_t(
+            size_t index, const void *value, buf_parent_t leaf)> &cb,
+        btree_stats_t *stats,
+        profile::trace_t *trace);
+
 /* `delete_mode_t` controls how `apply_keyvalue_change()` acts when `kv_loc->value` is
 empty. */
 enum class delete_mode_t {
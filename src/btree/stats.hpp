@@ -13,9 +13,11 @@ public:
           pm_keys_set(secs_to_ticks(1), n_threads),
           pm_total_keys_read(n_threads),
           pm_total_keys_set(n_threads),
+          pm_total_keys_covered(n_threads),
           pm_keys_membership(&btree_collection,
               &pm_keys_read, "keys_read",
               &pm_total_keys_read, "total_keys_read",
+              &pm_total_keys_covered, "total_keys_covered",
               &pm_keys_set, "keys_set",
               &pm_total_keys_set, "total_keys_set") {
         if (parent != nullptr) {
@@ -44,6 +46,9 @@ public:
     perfmon_counter_t
         pm_total_keys_read,
         pm_total_keys_set;
+    // The keys of covering secondary indexes that reads answered from the included
+    // fields, without loading the row.
+    perfmon_counter_t pm_total_keys_covered;
     perfmon_multi_membership_t pm_keys_membership;
 };
 
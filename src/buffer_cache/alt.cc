@@ -104,9 +104,10 @@ void alt_txn_throttler_t::inform_memory_limit_change(uint64_t memory_limit,
 
 cache_t::cache_t(serializer_t *serializer,
                  cache_balancer_t *balancer,
-                 perfmon_collection_t *perfmon_collection)
+                 perfmon_collection_t *perfmon_collection,
+                 const optional<std::string> &manifest_path)
     : throttler_(MINIMUM_SOFT_UNWRITTEN_CHANGES_LIMIT),
-      page_cache_(serializer, balancer, &throttler_),
+      page_cache_(serializer, balancer, &throttler_, manifest_path),
       stats_(make_scoped<alt_cache_stats_t>(&page_cache_, perfmon_collection)) { }
 
 cache_t::~cache_t() {
@@ -821,6 +822,59 @@ const void *buf_read_t::get_data_read(uint32_t *block_size_out) {
     return page_acq_.get_buf_read();
 }
 
+alt::page_accelerator_t *buf_read_t::get_page_accelerator(
+        const std::function<scoped_ptr_t<alt::page_accelerator_t>()> &make) {
+    guarantee(page_acq_.has());
+    if (lock_->access() != access_t::read) {
+        return nullptr;
+    }
+    page_t *page = lock_->get_held_page_for_read();
+    if (page->is_rdma_page()) {
+        // The buffer of an RDMA page can be replaced behind our back.
+        return nullptr;
+    }
+    if (page->accelerator() == nullptr) {
+        scoped_ptr_t<alt::page_accelerator_t> accelerator = make();
+        if (!accelerator.has()) {
+            return nullptr;
+        }
+        page->set_accelerator(std::move(accelerator), &lock_->cache()->page_cache_);
+    }
+    return page->accelerator();
+}
+
+buf_peek_t::buf_peek_t(buf_parent_t ancestor, block_id_t block_id)
+    : cache_(ancestor.cache()), page_(nullptr) {
+    cache_->assert_thread();
+    buf_lock_t *lock = ancestor.lock_or_null_;
+    if (lock == nullptr || lock->is_snapshotted() || lock->access() != access_t::read
+        || !lock->read_acq_signal()->is_pulsed()) {
+        return;
+    }
+    page_ = cache_->page_cache_.page_for_optimistic_read(block_id);
+}
+
+const void *buf_peek_t::get_data_read(uint32_t *block_size_out) {
+    ASSERT_NO_CORO_WAITING;
+    guarantee(has());
+    *block_size_out = page_->get_page_buf_size().value();
+    return page_->get_page_buf(&cache_->page_cache_);
+}
+
+alt::page_accelerator_t *buf_peek_t::get_page_accelerator(
+        const std::function<scoped_ptr_t<alt::page_accelerator_t>()> &make) {
+    ASSERT_NO_CORO_WAITING;
+    guarantee(has());
+    if (page_->accelerator() == nullptr) {
+        scoped_ptr_t<alt::page_accelerator_t> accelerator = make();
+        if (!accelerator.has()) {
+            return nullptr;
+        }
+        page_->set_accelerator(std::move(accelerator), &cache_->page_cache_);
+    }
+    return page_->accelerator();
+}
+
 buf_write_t::buf_write_t(buf_lock_t *lock)
     : lock_(lock) {
     guarantee(lock_->access() == access_t::write);
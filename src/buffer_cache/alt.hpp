@@ -2,6 +2,7 @@
 #ifndef BUFFER_CACHE_ALT_HPP_
 #define BUFFER_CACHE_ALT_HPP_
 
+#include <functional>
 #include <map>
 #include <vector>
 #include <utility>
@@ -41,9 +42,11 @@ private:
 
 class cache_t : public home_thread_mixin_t {
 public:
+    // See page_cache_t for what `manifest_path` does.
     explicit cache_t(serializer_t *serializer,
                      cache_balancer_t *balancer,
-                     perfmon_collection_t *perfmon_collection);
+                     perfmon_collection_t *perfmon_collection,
+                     const optional<std::string> &manifest_path = r_nullopt);
     ~cache_t();
 
     max_block_size_t max_block_size() const { return page_cache_.max_block_size(); }
@@ -60,6 +63,7 @@ private:
     friend class buf_read_t;
     friend class buf_write_t;
     friend class buf_lock_t;
+    friend class buf_peek_t;
 
     alt_snapshot_node_t *matching_snapshot_node_or_null(
             block_id_t block_id,
@@ -318,6 +322,7 @@ public:
 
 private:
     friend class buf_lock_t;
+    friend class buf_peek_t;
     txn_t *txn_;
     buf_lock_t *lock_or_null_;
 };
@@ -335,6 +340,13 @@ public:
         return data;
     }
 
+    // Returns the page's accelerator (see `alt::page_accelerator_t`), calling `make`
+    // to create it if the page doesn't have one yet.  Returns null for write locks,
+    // because their holder may modify the page at any time, or if `make` returns an
+    // empty pointer.  Must be called after `get_data_read()`.
+    alt::page_accelerator_t *get_page_accelerator(
+        const std::function<scoped_ptr_t<alt::page_accelerator_t>()> &make);
+
 private:
     buf_lock_t *lock_;
     alt::page_acq_t page_acq_;
@@ -342,6 +354,42 @@ private:
     DISABLE_COPYING(buf_read_t);
 };
 
+/* Reads the current version of a block without acquiring it, which saves getting in
+line for the block and waiting for the turn, for a descent that has acquired
+`ancestor` for read, without a snapshot.  This is only possible if the block is in
+memory and no write acquirer is in line for it, which is also what makes it safe:
+until the coroutine yields, nothing can modify the block, and reading it is the same
+as reading it with a lock that got in line right now.  If `has()` is false, the block
+has to be acquired with a `buf_lock_t`.  A block whose id was read from blocks that
+were read this way without yielding since can be acquired with `buf_parent_t(txn)` as
+the parent, which gets in line for it where the lock through its parent would have.
+
+The data may only be used until the coroutine yields. */
+class buf_peek_t {
+public:
+    buf_peek_t(buf_parent_t ancestor, block_id_t block_id);
+
+    bool has() const { return page_ != nullptr; }
+
+    const void *get_data_read(uint32_t *block_size_out);
+    const void *get_data_read() {
+        uint32_t block_size;
+        const void *data = get_data_read(&block_size);
+        guarantee(block_size == cache_->max_block_size().value());
+        return data;
+    }
+
+    // See `buf_read_t::get_page_accelerator()`.
+    alt::page_accelerator_t *get_page_accelerator(
+        const std::function<scoped_ptr_t<alt::page_accelerator_t>()> &make);
+
+private:
+    cache_t *cache_;
+    alt::page_t *page_;
+
+    DISABLE_COPYING(buf_peek_t);
+};
+
 class buf_write_t {
 public:
     explicit buf_write_t(buf_lock_t *lock);
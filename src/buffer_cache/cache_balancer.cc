@@ -5,6 +5,7 @@
 
 #include "buffer_cache/evicter.hpp"
 #include "arch/runtime/runtime.hpp"
+#include "config/args.hpp"
 #include "concurrency/pmap.hpp"
 
 const uint64_t alt_cache_balancer_t::rebalance_check_interval_ms = 20;
@@ -16,9 +17,33 @@ const double alt_cache_balancer_t::read_ahead_proportion = 0.9;
 alt_cache_balancer_t::cache_data_t::cache_data_t(alt::evicter_t *_evicter) :
     evicter(_evicter),
     new_size(0),
+    new_compressed_tier_size(0),
     old_size(evicter->memory_limit()),
     bytes_loaded(evicter->get_bytes_loaded()),
-    access_count(evicter->access_count()) { }
+    access_count(evicter->access_count()),
+    compression_measured_bytes(0),
+    compression_saved_bytes(0) { }
+
+uint64_t compressed_page_tier_cache_size(uint64_t total_cache_size,
+                                         uint64_t measured_bytes,
+                                         uint64_t saved_bytes) {
+    if (measured_bytes == 0) {
+        return 0;
+    }
+    const double saved_fraction =
+        std::min(1.0, static_cast<double>(saved_bytes) / measured_bytes);
+    return total_cache_size * COMPRESSED_PAGE_TIER_CACHE_FRACTION * saved_fraction;
+}
+
+uint64_t compressed_page_tier_share(uint64_t total_tier_size,
+                                    uint64_t cache_size,
+                                    uint64_t total_cache_size) {
+    if (total_cache_size == 0) {
+        return 0;
+    }
+    return total_tier_size
+        * (static_cast<double>(cache_size) / static_cast<double>(total_cache_size));
+}
 
 alt_cache_balancer_t::alt_cache_balancer_t(
         clone_ptr_t<watchable_t<uint64_t> > _total_cache_size_watchable) :
@@ -28,6 +53,8 @@ alt_cache_balancer_t::alt_cache_balancer_t(
     last_rebalance_time(0),
     read_ahead_ok(true),
     bytes_toward_read_ahead_limit(0),
+    compression_measured_bytes(0),
+    compression_saved_bytes(0),
     per_thread_data(get_num_threads()),
     rebalance_pumper([this](signal_t *interruptor) { rebalance_blocking(interruptor); }),
     cache_size_change_subscription(
@@ -124,9 +151,20 @@ void alt_cache_balancer_t::rebalance_blocking(UNUSED signal_t *interruptor) {
         for (size_t j = 0; j < cache_data[i].size(); ++j) {
             total_bytes_loaded += std::max<int64_t>(0, cache_data[i][j].bytes_loaded);
             total_access_count += cache_data[i][j].access_count;
+            compression_measured_bytes += cache_data[i][j].compression_measured_bytes;
+            compression_saved_bytes += cache_data[i][j].compression_saved_bytes;
         }
     }
 
+    // The compressed page tiers get a share of the cache that depends on how much
+    // compressing the evicted blocks saves, which is split between them in proportion
+    // to the caches' regular sizes.
+    const uint64_t total_compressed_tier_size =
+        compressed_page_tier_cache_size(total_cache_size,
+                                        compression_measured_bytes,
+                                        compression_saved_bytes);
+    total_cache_size -= total_compressed_tier_size;
+
     // Reevaluate if read-ahead should be running
     if (read_ahead_ok) {
         bytes_toward_read_ahead_limit += total_bytes_loaded;
@@ -146,6 +184,8 @@ void alt_cache_balancer_t::rebalance_blocking(UNUSED signal_t *interruptor) {
     }
 
     last_rebalance_time = now;
+    compression_measured_bytes /= 2;
+    compression_saved_bytes /= 2;
 
     // Calculate new cache sizes
     if (total_evicters > 0) {
@@ -196,6 +236,16 @@ void alt_cache_balancer_t::rebalance_blocking(UNUSED signal_t *interruptor) {
             }
         }
 
+        for (size_t i = 0; i < cache_data.size(); ++i) {
+            for (size_t j = 0; j < cache_data[i].size(); ++j) {
+                cache_data_t *data = &cache_data[i][j];
+                data->new_compressed_tier_size =
+                    compressed_page_tier_share(total_compressed_tier_size,
+                                               data->new_size,
+                                               total_cache_size);
+            }
+        }
+
         // Send new cache sizes to each thread
         pmap(num_threads,
              std::bind(&alt_cache_balancer_t::apply_rebalance_to_thread,
@@ -229,6 +279,8 @@ void alt_cache_balancer_t::collect_stats_from_thread(
     per_evicter_data->reserve(evicters->size());
     for (auto j = evicters->begin(); j != evicters->end(); ++j) {
         cache_data_t data(*j);
+        (*j)->compressed_tier().take_compression_stats(&data.compression_measured_bytes,
+                                                       &data.compression_saved_bytes);
         all_access_counts_zero &= (data.access_count == 0);
         per_evicter_data->push_back(data);
     }
@@ -250,6 +302,7 @@ void alt_cache_balancer_t::apply_rebalance_to_thread(int index,
         // Make sure the evicter still exists
         if (evicters->find(it->evicter) != evicters->end()) {
             it->evicter->update_memory_limit(it->new_size,
+                                             it->new_compressed_tier_size,
                                              it->bytes_loaded,
                                              it->access_count,
                                              new_read_ahead_ok);
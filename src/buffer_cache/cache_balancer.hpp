@@ -85,6 +85,19 @@ private:
     DISABLE_COPYING(dummy_cache_balancer_t);
 };
 
+// How much of a total cache size of `total_cache_size` the compressed page tiers get
+// (see `COMPRESSED_PAGE_TIER_CACHE_FRACTION`), given that compressing `measured_bytes`
+// of evicted blocks saved `saved_bytes`.
+uint64_t compressed_page_tier_cache_size(uint64_t total_cache_size,
+                                         uint64_t measured_bytes,
+                                         uint64_t saved_bytes);
+
+// The part of the compressed page tiers' `total_tier_size` that goes to a cache with
+// `cache_size` out of the caches' `total_cache_size`.
+uint64_t compressed_page_tier_share(uint64_t total_tier_size,
+                                    uint64_t cache_size,
+                                    uint64_t total_cache_size);
+
 class alt_cache_balancer_t final :
     public cache_balancer_t,
     public repeating_timer_callback_t {
@@ -139,9 +152,12 @@ private:
 
         alt::evicter_t *evicter;
         uint64_t new_size;
+        uint64_t new_compressed_tier_size;
         uint64_t old_size;
         int64_t bytes_loaded;
         uint64_t access_count;
+        uint64_t compression_measured_bytes;
+        uint64_t compression_saved_bytes;
     };
 
     // Helper function to collect stats from each thread so we don't need
@@ -174,6 +190,12 @@ private:
     bool read_ahead_ok;
     uint64_t bytes_toward_read_ahead_limit;
 
+    // How many bytes of evicted blocks the compressed page tiers compressed, and how
+    // many that saved.  Both are halved at every rebalance, so that recent evictions
+    // weigh more.
+    uint64_t compression_measured_bytes;
+    uint64_t compression_saved_bytes;
+
     struct per_thread_data_t {
         per_thread_data_t() : wake_up_balancer(false) { }
         std::set<alt::evicter_t *> evicters;
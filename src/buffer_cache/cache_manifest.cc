@@ -0,0 +1,123 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "buffer_cache/cache_manifest.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arch/compiler.hpp"
+#include "arch/io/disk.hpp"
+#include "arch/io/io_utils.hpp"
+#include "paths.hpp"
+
+// Bump the last character when changing the layout below.
+static const char CACHE_MANIFEST_MAGIC[8] = { 'r', 'd', 'b', 'c', 'm', 'a', 'n', '1' };
+
+ATTR_PACKED(struct cache_manifest_header_t {
+    char magic[sizeof(CACHE_MANIFEST_MAGIC)];
+    uint64_t num_block_ids;
+});
+
+static std::string temporary_manifest_path(const std::string &path) {
+    return path + ".tmp";
+}
+
+#ifdef _WIN32
+
+int write_cache_manifest(UNUSED const std::string &path,
+                         UNUSED const std::vector<block_id_t> &block_ids) {
+    // TODO WINDOWS
+    return ENOTSUP;
+}
+
+#else
+
+int write_cache_manifest(const std::string &path,
+                         const std::vector<block_id_t> &block_ids) {
+    cache_manifest_header_t header;
+    memcpy(header.magic, CACHE_MANIFEST_MAGIC, sizeof(CACHE_MANIFEST_MAGIC));
+    header.num_block_ids = block_ids.size();
+
+    std::string contents(reinterpret_cast<const char *>(&header), sizeof(header));
+    contents.append(reinterpret_cast<const char *>(block_ids.data()),
+                    block_ids.size() * sizeof(block_id_t));
+
+    const std::string tmp_path = temporary_manifest_path(path);
+    scoped_fd_t fd;
+    {
+        int res;
+        do {
+            res = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        } while (res == -1 && get_errno() == EINTR);
+        if (res == -1) {
+            return get_errno();
+        }
+        fd.reset(res);
+    }
+
+    size_t written = 0;
+    while (written < contents.size()) {
+        ssize_t res;
+        do {
+            res = write(fd.get(), contents.data() + written, contents.size() - written);
+        } while (res == -1 && get_errno() == EINTR);
+        if (res == -1) {
+            return get_errno();
+        }
+        written += res;
+    }
+
+    // The manifest must be complete on disk before it replaces the old one, or a
+    // crash could leave us with a truncated file under the permanent name.
+    int sync_res = perform_datasync(fd.get());
+    if (sync_res != 0) {
+        return sync_res;
+    }
+    fd.reset();
+
+    if (::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        return get_errno();
+    }
+    return fsync_parent_directory(path.c_str());
+}
+
+#endif  // _WIN32
+
+int read_cache_manifest(const std::string &path,
+                        std::vector<block_id_t> *block_ids_out) {
+    block_ids_out->clear();
+
+    std::string contents;
+    if (!blocking_read_file(path.c_str(), &contents)) {
+        return get_errno();
+    }
+
+    cache_manifest_header_t header;
+    if (contents.size() < sizeof(header)) {
+        return EINVAL;
+    }
+    memcpy(&header, contents.data(), sizeof(header));
+    if (memcmp(header.magic, CACHE_MANIFEST_MAGIC, sizeof(CACHE_MANIFEST_MAGIC)) != 0
+        || header.num_block_ids
+           != (contents.size() - sizeof(header)) / sizeof(block_id_t)
+        || (contents.size() - sizeof(header)) % sizeof(block_id_t) != 0) {
+        return EINVAL;
+    }
+
+    block_ids_out->resize(header.num_block_ids);
+    memcpy(block_ids_out->data(), contents.data() + sizeof(header),
+           header.num_block_ids * sizeof(block_id_t));
+    return 0;
+}
+
+int remove_cache_manifest(const std::string &path) {
+    int ret = 0;
+    for (const std::string &p : { path, temporary_manifest_path(path) }) {
+        if (::unlink(p.c_str()) != 0 && get_errno() != ENOENT) {
+            ret = get_errno();
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,35 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef BUFFER_CACHE_CACHE_MANIFEST_HPP_
+#define BUFFER_CACHE_CACHE_MANIFEST_HPP_
+
+#include <string>
+#include <vector>
+
+#include "serializer/types.hpp"
+
+/* A cache manifest is a small sidecar file that lists the block ids which were the
+hottest in a `page_cache_t`, hottest first.  The page cache writes it periodically and
+on shutdown, and reads it back on startup to preload those blocks before clients
+start missing on them.
+
+The manifest is only a hint.  Block ids in it may have been deleted or rewritten in
+the meantime, so the page cache re-validates every entry against the serializer's
+index before loading it.  A missing or malformed manifest is treated like an empty
+one. */
+
+/* These functions do blocking file I/O.  Call them through
+`thread_pool_t::run_in_blocker_pool`.  They return 0 on success and an errno value on
+failure; `read_cache_manifest` returns `EINVAL` if the file is malformed. */
+
+// Atomically replaces the manifest at `path` (write to a temporary file, then rename).
+int write_cache_manifest(const std::string &path,
+                         const std::vector<block_id_t> &block_ids);
+
+int read_cache_manifest(const std::string &path,
+                        std::vector<block_id_t> *block_ids_out);
+
+// Removes the manifest and any leftover temporary file.  A missing file is not an
+// error.
+int remove_cache_manifest(const std::string &path);
+
+#endif  // BUFFER_CACHE_CACHE_MANIFEST_HPP_
@@ -0,0 +1,128 @@
+#include "buffer_cache/compressed_page_tier.hpp"
+
+#include <string.h>
+#include <zlib.h>
+
+#include "config/args.hpp"
+
+namespace alt
+{
+
+    buf_ptr_t compressed_page_t::decompress() const
+    {
+        buf_ptr_t buf = buf_ptr_t::alloc_uninitialized(block_size);
+        uLongf length = buf.aligned_block_size();
+        int res = uncompress(reinterpret_cast<Bytef *>(buf.ser_buffer()), &length,
+                             reinterpret_cast<const Bytef *>(data.data()), data.size());
+        guarantee(res == Z_OK && length == buf.aligned_block_size(),
+                  "Corrupted page in the compressed page tier (zlib error %d).", res);
+        return buf;
+    }
+
+    compressed_page_tier_t::compressed_page_tier_t()
+        : memory_limit_(0), memory_usage_(0), measured_bytes_(0), saved_bytes_(0),
+          unsampled_blocks_(0) {}
+
+    compressed_page_tier_t::~compressed_page_tier_t()
+    {
+        assert_thread();
+        set_memory_limit(0);
+        rassert(pages_.empty());
+    }
+
+    uint64_t compressed_page_tier_t::memory_usage_of(const compressed_page_t *page)
+    {
+        // The second term approximates the hash table node.
+        return sizeof(compressed_page_t) + 4 * sizeof(void *) + page->data.size();
+    }
+
+    void compressed_page_tier_t::set_memory_limit(uint64_t memory_limit)
+    {
+        assert_thread();
+        memory_limit_ = memory_limit;
+        evict_if_necessary();
+    }
+
+    void compressed_page_tier_t::insert(block_id_t block_id, int64_t offset,
+                                        const buf_ptr_t &buf)
+    {
+        assert_thread();
+        erase(block_id);
+
+        const uint32_t size = buf.aligned_block_size();
+        const uLong max_size = size * COMPRESSED_PAGE_TIER_MAX_COMPRESSION_RATIO;
+        const bool keep = memory_limit_ >= size;
+        if (!keep && ++unsampled_blocks_ < COMPRESSED_PAGE_TIER_SAMPLE_INTERVAL)
+        {
+            return;
+        }
+        unsampled_blocks_ = 0;
+
+        if (scratch_.size() < compressBound(size))
+        {
+            scratch_.reset();
+            scratch_.init(compressBound(size));
+        }
+        uLongf length = scratch_.size();
+        int res = compress2(reinterpret_cast<Bytef *>(scratch_.data()), &length,
+                            reinterpret_cast<const Bytef *>(buf.ser_buffer()), size,
+                            Z_BEST_SPEED);
+        guarantee(res == Z_OK, "compress2 failed (zlib error %d).", res);
+        measured_bytes_ += size;
+        if (length > max_size)
+        {
+            return;
+        }
+        saved_bytes_ += size - length;
+        if (!keep)
+        {
+            return;
+        }
+
+        scoped_array_t<char> data(length);
+        memcpy(data.data(), scratch_.data(), length);
+        compressed_page_t *page = new compressed_page_t(block_id, offset,
+                                                        buf.block_size(),
+                                                        std::move(data));
+        pages_.insert(std::make_pair(block_id, page));
+        lru_.push_back(page);
+        memory_usage_ += memory_usage_of(page);
+        evict_if_necessary();
+    }
+
+    void compressed_page_tier_t::take_compression_stats(uint64_t *measured_bytes_out,
+                                                        uint64_t *saved_bytes_out)
+    {
+        assert_thread();
+        *measured_bytes_out = measured_bytes_;
+        *saved_bytes_out = saved_bytes_;
+        measured_bytes_ = 0;
+        saved_bytes_ = 0;
+    }
+
+    scoped_ptr_t<compressed_page_t> compressed_page_tier_t::extract(block_id_t block_id)
+    {
+        assert_thread();
+        auto it = pages_.find(block_id);
+        if (it == pages_.end())
+        {
+            return scoped_ptr_t<compressed_page_t>();
+        }
+        scoped_ptr_t<compressed_page_t> page(it->second);
+        pages_.erase(it);
+        lru_.remove(page.get());
+        memory_usage_ -= memory_usage_of(page.get());
+        return page;
+    }
+
+    void compressed_page_tier_t::evict_if_necessary()
+    {
+        while (memory_usage_ > memory_limit_)
+        {
+            compressed_page_t *page = lru_.head();
+            rassert(page != nullptr);
+            erase(page->block_id);
+        }
+    }
+
+} // namespace alt
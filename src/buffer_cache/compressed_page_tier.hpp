@@ -0,0 +1,107 @@
+#ifndef BUFFER_CACHE_COMPRESSED_PAGE_TIER_HPP_
+#define BUFFER_CACHE_COMPRESSED_PAGE_TIER_HPP_
+
+#include <stdint.h>
+
+#include <unordered_map>
+
+#include "containers/intrusive_list.hpp"
+#include "containers/scoped.hpp"
+#include "serializer/buf_ptr.hpp"
+#include "serializer/types.hpp"
+#include "threading.hpp"
+
+namespace alt
+{
+
+    // A compressed copy of the on-disk version of a block, as it was when its page got
+    // evicted.
+    class compressed_page_t : public intrusive_list_node_t<compressed_page_t>
+    {
+    public:
+        compressed_page_t(block_id_t _block_id, int64_t _offset,
+                          block_size_t _block_size, scoped_array_t<char> &&_data)
+            : block_id(_block_id), offset(_offset), block_size(_block_size),
+              data(std::move(_data)) {}
+
+        // Inflates the copy back into a buffer that is identical to the one that
+        // `serializer_t::block_read()` would return for the block token.
+        buf_ptr_t decompress() const;
+
+        const block_id_t block_id;
+        // The offset of the block token, which identifies the version of the block.
+        const int64_t offset;
+        const block_size_t block_size;
+        const scoped_array_t<char> data;
+
+    private:
+        DISABLE_COPYING(compressed_page_t);
+    };
+
+    /* The compressed page tier is a second chance for clean pages that the evicter
+    drops.  Instead of just freeing the buffer, the evicter deflates it into this tier,
+    and the next load of the block inflates it from here instead of reading it from
+    disk.  Blocks that don't compress to at most
+    `COMPRESSED_PAGE_TIER_MAX_COMPRESSION_RATIO` of their size aren't kept.
+
+    The tier is bounded by its own memory limit, which `alt_cache_balancer_t` hands out
+    alongside the page cache's memory limit, based on how much memory compressing the
+    evicted blocks saves.  The tier measures that even without room to keep them.  When it's full, the least recently
+    inserted copies go first.  Every copy is taken out of the tier when it's used, so
+    a block is never both in memory and in the tier for long.
+
+    A copy is only used if its offset matches the block token that the page is being
+    loaded for, so a copy of an outdated version of a block is never used. */
+    class compressed_page_tier_t : public home_thread_mixin_debug_only_t
+    {
+    public:
+        compressed_page_tier_t();
+        ~compressed_page_tier_t();
+
+        void set_memory_limit(uint64_t memory_limit);
+        uint64_t memory_limit() const { return memory_limit_; }
+        uint64_t memory_usage() const { return memory_usage_; }
+        size_t size() const { return pages_.size(); }
+
+        // Stores a compressed copy of `buf`, the contents of `block_id` at `offset`,
+        // replacing any earlier copy.
+        void insert(block_id_t block_id, int64_t offset, const buf_ptr_t &buf);
+
+        // Removes the copy of `block_id` from the tier and returns it (or an empty
+        // pointer).
+        scoped_ptr_t<compressed_page_t> extract(block_id_t block_id);
+
+        void erase(block_id_t block_id) { extract(block_id); }
+
+        // Returns how many bytes of evicted blocks were compressed since the last call,
+        // and how many bytes compressing them saved (counting the blocks that didn't
+        // compress well enough to be kept as saving nothing).
+        void take_compression_stats(uint64_t *measured_bytes_out,
+                                    uint64_t *saved_bytes_out);
+
+    private:
+        static uint64_t memory_usage_of(const compressed_page_t *page);
+        void evict_if_necessary();
+
+        uint64_t memory_limit_;
+        uint64_t memory_usage_;
+
+        uint64_t measured_bytes_;
+        uint64_t saved_bytes_;
+        // How many blocks weren't compressed since the last one that was, while the
+        // tier had no room for them.
+        int unsampled_blocks_;
+
+        std::unordered_map<block_id_t, compressed_page_t *> pages_;
+        // Least recently inserted first.
+        intrusive_list_t<compressed_page_t> lru_;
+
+        // Reused as the output buffer of `compress2()`.
+        scoped_array_t<char> scratch_;
+
+        DISABLE_COPYING(compressed_page_tier_t);
+    };
+
+} // namespace alt
+
+#endif // BUFFER_CACHE_COMPRESSED_PAGE_TIER_HPP_
@@ -5,6 +5,7 @@
 #include "buffer_cache/page.hpp"
 #include "buffer_cache/page_cache.hpp"
 #include "buffer_cache/cache_balancer.hpp"
+#include "config/args.hpp"
 
 namespace alt
 {
@@ -18,7 +19,8 @@ namespace alt
           bytes_loaded_counter_(0),
           access_count_counter_(0),
           access_time_counter_(INITIAL_ACCESS_TIME),
-          evict_if_necessary_active_(false) {}
+          evict_if_necessary_active_(false),
+          accelerator_usage_(0) {}
 
     evicter_t::~evicter_t()
     {
@@ -50,6 +52,7 @@ namespace alt
     }
 
     void evicter_t::update_memory_limit(uint64_t new_memory_limit,
+                                        uint64_t new_compressed_tier_memory_limit,
                                         int64_t bytes_loaded_accounted_for,
                                         uint64_t access_count_accounted_for,
                                         bool read_ahead_ok)
@@ -66,6 +69,7 @@ namespace alt
         access_count_counter_ -= access_count_accounted_for;
         memory_limit_ = new_memory_limit;
         evict_if_necessary();
+        compressed_tier_.set_memory_limit(new_compressed_tier_memory_limit);
 
         throttler_->inform_memory_limit_change(memory_limit_,
                                                page_cache_->max_block_size());
@@ -182,11 +186,20 @@ namespace alt
     {
         assert_thread();
         guarantee(initialized_);
-        evictable_disk_backed_.add(page, page->hypothetical_memory_usage(page_cache_));
+        evictable_disk_backed_category(page)->add(
+            page, page->hypothetical_memory_usage(page_cache_));
         evict_if_necessary();
         notify_bytes_loading(page->hypothetical_memory_usage(page_cache_));
     }
 
+    eviction_bag_t *evicter_t::evictable_disk_backed_category(page_t *page)
+    {
+        // Write pages stay with the rest, where `evict_writes()` looks for them.
+        return is_aux_block_id(page->block_id()) && !page->is_write
+            ? &evictable_large_values_
+            : &evictable_disk_backed_;
+    }
+
     void evicter_t::move_unevictable_to_evictable(page_t *page)
     {
         assert_thread();
@@ -194,7 +207,8 @@ namespace alt
         rassert(unevictable_.has_page(page));
         unevictable_.remove(page, page->hypothetical_memory_usage(page_cache_));
         eviction_bag_t *new_bag = correct_eviction_category(page);
-        rassert(new_bag == &evictable_disk_backed_ || new_bag == &evictable_unbacked_);
+        rassert(new_bag == &evictable_disk_backed_ || new_bag == &evictable_large_values_
+                || new_bag == &evictable_unbacked_);
         new_bag->add(page, page->hypothetical_memory_usage(page_cache_));
         evict_if_necessary();
     }
@@ -237,7 +251,7 @@ namespace alt
         {
             if (page_cache_->check_if_in_current_pages(page->block_id()))
             {
-                return &evictable_disk_backed_;
+                return evictable_disk_backed_category(page);
             }
             return &rdma_bag_;
         }
@@ -260,7 +274,17 @@ namespace alt
     {
         assert_thread();
         guarantee(initialized_);
-        return unevictable_.size() + evictable_disk_backed_.size() + evictable_unbacked_.size();
+        return unevictable_.size() + evictable_disk_backed_.size()
+            + evictable_large_values_.size() + evictable_unbacked_.size()
+            + accelerator_usage_;
+    }
+
+    void evicter_t::change_accelerator_usage(int64_t change)
+    {
+        assert_thread();
+        guarantee(initialized_);
+        guarantee(change >= 0 || accelerator_usage_ >= static_cast<uint64_t>(-change));
+        accelerator_usage_ += change;
     }
 
     void evicter_t::evict_if_necessary() THROWS_NOTHING
@@ -282,16 +306,25 @@ namespace alt
 
         evict_if_necessary_active_ = true;
         page_t *page;
-        while (in_memory_size() > memory_limit_ && evictable_disk_backed_.remove_oldish(&page, access_time_counter_,
-                                                                                        page_cache_))
+        const uint64_t large_value_memory_limit =
+            memory_limit_ * LARGE_VALUE_CACHE_FRACTION;
+        while (in_memory_size() > memory_limit_)
         {
-            if (page->is_rdma_page())
+            // Large values over their share of the limit go first, so that they
+            // don't push out the B-tree.  Below the limit nothing is evicted.
+            const bool large_values_first =
+                evictable_large_values_.size() > large_value_memory_limit;
+            if (!((large_values_first
+                   && evictable_large_values_.remove_oldish(&page, access_time_counter_,
+                                                            page_cache_))
+                  || evictable_disk_backed_.remove_oldish(&page, access_time_counter_,
+                                                          page_cache_)
+                  || evictable_large_values_.remove_oldish(&page, access_time_counter_,
+                                                           page_cache_)))
             {
-                continue;
+                break;
             }
-            evicted_.add(page, page->hypothetical_memory_usage(page_cache_));
-            page->evict_self(page_cache_);
-            page_cache_->consider_evicting_current_page(page->block_id());
+            evict_page(page);
         }
         if (WRITES_ENABLED)
         {
@@ -301,6 +334,17 @@ namespace alt
         evict_if_necessary_active_ = false;
     }
 
+    void evicter_t::evict_page(page_t *page)
+    {
+        if (page->is_rdma_page())
+        {
+            return;
+        }
+        evicted_.add(page, page->hypothetical_memory_usage(page_cache_));
+        page->evict_self(page_cache_);
+        page_cache_->consider_evicting_current_page(page->block_id());
+    }
+
     void evicter_t::evict_writes() THROWS_NOTHING
     {
         guarantee(initialized_);
@@ -426,6 +470,7 @@ namespace alt
         std::cout << "RDMA bags: " << rdma_bag_.size() / 4096 << " Unevictable bags: "
                   << unevictable_.size() / 4096 << " Evicted bags: " << evicted_.size() / 4096
                   << " Evictable disk backed bags: " << evictable_disk_backed_.size() / 4096
+                  << " Evictable large value bags: " << evictable_large_values_.size() / 4096
                   << " Evictable unbacked bags: " << evictable_unbacked_.size() / 4096 << std::endl;
     }
 
@@ -5,6 +5,7 @@
 
 #include <functional>
 
+#include "buffer_cache/compressed_page_tier.hpp"
 #include "buffer_cache/eviction_bag.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/cache_line_padded.hpp"
@@ -49,6 +50,7 @@ namespace alt
                         cache_balancer_t *balancer,
                         alt_txn_throttler_t *throttler);
         void update_memory_limit(uint64_t new_memory_limit,
+                                 uint64_t new_compressed_tier_memory_limit,
                                  int64_t bytes_loaded_accounted_for,
                                  uint64_t access_count_accounted_for,
                                  bool read_ahead_ok);
@@ -59,12 +61,30 @@ namespace alt
             return ++access_time_counter_;
         }
 
+        // The access time that the most recently accessed page got.
+        uint64_t current_access_time() const
+        {
+            guarantee(initialized_);
+            return access_time_counter_;
+        }
+
         uint64_t memory_limit() const;
         uint64_t access_count() const;
         int64_t get_bytes_loaded() const;
 
         uint64_t in_memory_size() const;
 
+        // Charges (or, with a negative `change`, releases) the memory of a page's
+        // accelerator (see `page_accelerator_t`).  It counts toward the memory limit,
+        // and is freed by evicting the page.  This never evicts anything itself, so
+        // that the page it's called for stays loaded even if nobody holds it.
+        void change_accelerator_usage(int64_t change);
+        uint64_t accelerator_usage() const { return accelerator_usage_; }
+
+        // Evicted clean pages get a second chance here.  Its memory limit is separate
+        // from `memory_limit()`.
+        compressed_page_tier_t &compressed_tier() { return compressed_tier_; }
+
         void print_all_bag_sizes();
 
         // This is decremented past UINT64_MAX to force code to be aware of access time
@@ -77,8 +97,12 @@ namespace alt
         // Tells the cache balancer about a page being loaded
         void notify_bytes_loading(int64_t ser_buf_change);
 
+        // The bag of a loaded, disk backed page that nobody waits for.
+        eviction_bag_t *evictable_disk_backed_category(page_t *page);
+
         // Evicts any evictable pages until under the memory limit
         void evict_if_necessary() THROWS_NOTHING;
+        void evict_page(page_t *page);
         void evict_writes();
 
         bool initialized_;
@@ -106,10 +130,21 @@ namespace alt
         // These track every page's eviction status.
         eviction_bag_t unevictable_;
         eviction_bag_t evictable_disk_backed_;
+        // The blocks of large values are kept apart from the B-tree.  When the cache
+        // is over its memory limit, they are evicted first if they take more than
+        // `LARGE_VALUE_CACHE_FRACTION` of it.
+        // Scans that read large values then only evict each other's blocks.
+        eviction_bag_t evictable_large_values_;
         eviction_bag_t evictable_unbacked_;
         eviction_bag_t evicted_;
         eviction_bag_t rdma_bag_;
 
+        // The memory of the accelerators of the loaded pages, which is not in the size
+        // of any eviction bag.
+        uint64_t accelerator_usage_;
+
+        compressed_page_tier_t compressed_tier_;
+
         auto_drainer_t drainer_;
 
         DISABLE_COPYING(evicter_t);
@@ -98,6 +98,7 @@ namespace alt
     {
         rassert(buf_.has());
         is_RDMA_ = false;
+        page_cache->evicter().compressed_tier().erase(block_id_);
         page_cache->evicter().add_to_evictable_unbacked(this);
     }
 
@@ -127,6 +128,7 @@ namespace alt
     {
         rassert(buf_.has());
         is_RDMA_ = false;
+        page_cache->evicter().compressed_tier().erase(block_id_);
         page_cache->evicter().add_to_evictable_disk_backed(this);
     }
 
@@ -415,13 +417,24 @@ namespace alt
         buf_ptr_t buf;
         counted_t<standard_block_token_t> block_token;
 
+        // We only find out on the serializer thread whether the compressed copy is
+        // still the current version of the block.
+        scoped_ptr_t<compressed_page_t> compressed =
+            page_cache->evicter().compressed_tier().extract(block_id);
+        bool use_compressed = false;
+
         {
             serializer_t *const serializer = page_cache->serializer();
             on_thread_t th(serializer->home_thread());
             block_token = serializer->index_read(block_id);
             rassert(block_token.has());
-            buf = serializer->block_read(block_token,
-                                         account->get());
+            use_compressed = compressed.has()
+                && compressed->offset == block_token->offset();
+            if (!use_compressed)
+            {
+                buf = serializer->block_read(block_token,
+                                             account->get());
+            }
         }
 
         ASSERT_FINITE_CORO_WAITING;
@@ -430,6 +443,11 @@ namespace alt
             return;
         }
 
+        if (use_compressed)
+        {
+            buf = compressed->decompress();
+        }
+
         page_t::finish_load_with_block_id(page, page_cache,
                                           std::move(block_token),
                                           std::move(buf));
@@ -454,6 +472,7 @@ namespace alt
             // load_from_copyee.
             rassert(waiters_.empty());
 
+            reset_accelerator(page_cache);
             page_cache->evicter().remove_page(this);
             delete this;
         }
@@ -531,7 +550,14 @@ namespace alt
         counted_t<standard_block_token_t> block_token = page->block_token_;
         rassert(block_token.has());
 
+        scoped_ptr_t<compressed_page_t> compressed =
+            page_cache->evicter().compressed_tier().extract(page->block_id_);
         buf_ptr_t buf;
+        if (compressed.has() && compressed->offset == block_token->offset())
+        {
+            buf = compressed->decompress();
+        }
+        else
         {
             serializer_t *const serializer = page_cache->serializer();
 
@@ -648,7 +674,7 @@ namespace alt
         rassert(snapshot_refcount_ > 0);
     }
 
-    void page_t::evict_self(DEBUG_VAR page_cache_t *page_cache)
+    void page_t::evict_self(page_cache_t *page_cache)
     {
         // A page_t can only self-evict if it has a block token (for now).
         rassert(waiters_.empty());
@@ -658,12 +684,41 @@ namespace alt
 #ifndef NDEBUG
         const uint32_t usage_before = hypothetical_memory_usage(page_cache);
 #endif
+        // The buffer is clean (that's what the block token says), so the compressed
+        // page tier can give it back if the block gets loaded again.
+        page_cache->evicter().compressed_tier().insert(block_id_, block_token_->offset(),
+                                                      buf_);
         buf_.reset();
+        reset_accelerator(page_cache);
         // Hypothetical memory usage shouldn't have changed -- the block token has the
         // same block size.
         rassert(usage_before == hypothetical_memory_usage(page_cache));
     }
 
+    void page_t::set_accelerator(scoped_ptr_t<page_accelerator_t> &&accelerator,
+                                 page_cache_t *page_cache)
+    {
+        rassert(buf_.has());
+        rassert(!is_RDMA_);
+        reset_accelerator(page_cache);
+        accelerator_ = std::move(accelerator);
+        if (accelerator_.has())
+        {
+            page_cache->evicter().change_accelerator_usage(
+                accelerator_->memory_usage());
+        }
+    }
+
+    void page_t::reset_accelerator(page_cache_t *page_cache)
+    {
+        if (accelerator_.has())
+        {
+            page_cache->evicter().change_accelerator_usage(
+                -static_cast<int64_t>(accelerator_->memory_usage()));
+            accelerator_.reset();
+        }
+    }
+
     ser_buffer_t *page_t::get_loaded_ser_buffer()
     {
         rassert(buf_.has());
@@ -734,6 +789,8 @@ namespace alt
     void *page_acq_t::get_buf_write(block_size_t block_size)
     {
         buf_ready_signal_.wait();
+        // The caller is going to modify the buffer.
+        page_->reset_accelerator(page_cache_);
         page_->reset_block_token(page_cache_);
         page_->set_page_buf_size(block_size, page_cache_);
         return page_->get_page_buf(page_cache_);
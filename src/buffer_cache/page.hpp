@@ -4,6 +4,7 @@
 #include "concurrency/cond_var.hpp"
 #include "containers/backindex_bag.hpp"
 #include "containers/half_intrusive_list.hpp"
+#include "containers/scoped.hpp"
 #include "repli_timestamp.hpp"
 #include "serializer/buf_ptr.hpp"
 #include "serializer/types.hpp"
@@ -20,6 +21,19 @@ namespace alt
     class deferred_page_loader_t;
     class deferred_block_token_t;
 
+    // An in-memory structure derived from the contents of a page, such as a search
+    // index over a B-tree node.  The page keeps it until the page is modified or its
+    // buffer is evicted.
+    class page_accelerator_t
+    {
+    public:
+        virtual ~page_accelerator_t() {}
+
+        // The memory it uses, which counts toward the cache's memory limit.  It must
+        // not change.
+        virtual size_t memory_usage() const = 0;
+    };
+
     // A page_t represents a page (a byte buffer of a specific size), having a definite
     // value known at the construction of the page_t (and possibly later modified
     // in-place, but still a definite known value).
@@ -79,6 +93,11 @@ namespace alt
 
         void evict_self(page_cache_t *page_cache);
 
+        page_accelerator_t *accelerator() const { return accelerator_.get(); }
+        void set_accelerator(scoped_ptr_t<page_accelerator_t> &&accelerator,
+                             page_cache_t *page_cache);
+        void reset_accelerator(page_cache_t *page_cache);
+
         block_id_t block_id() const { return block_id_; }
 
         bool page_ptr_count() const { return snapshot_refcount_; }
@@ -143,6 +162,11 @@ namespace alt
 
         uint64_t access_time_;
 
+        // Derived from buf_, and reset whenever buf_ is modified or evicted.  Its
+        // memory is charged to the evicter apart from the page's, because the
+        // hypothetical memory usage of a page must not change when it's evicted.
+        scoped_ptr_t<page_accelerator_t> accelerator_;
+
         // How many page_ptr_t's point at this page, expecting nothing to modify it,
         // other than themselves.
         size_t snapshot_refcount_;
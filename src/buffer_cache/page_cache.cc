@@ -12,10 +12,15 @@
 #include "arch/runtime/coroutines.hpp"
 #include "arch/runtime/runtime.hpp"
 #include "arch/runtime/runtime_utils.hpp"
+#include "arch/runtime/thread_pool.hpp"
+#include "arch/timing.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/new_mutex.hpp"
+#include "concurrency/pmap.hpp"
 #include "buffer_cache/cache_balancer.hpp"
+#include "buffer_cache/cache_manifest.hpp"
 #include "do_on_thread.hpp"
+#include "logger.hpp"
 #include "serializer/serializer.hpp"
 #include "stl_utils.hpp"
 
@@ -116,8 +121,8 @@ namespace alt
         ASSERT_NO_CORO_WAITING;
         // We can't do anything until read-ahead is done, because it uses the existence
         // of a current_page_t entry to figure out whether the read-ahead page could be
-        // out of date.
-        if (read_ahead_cb_ != nullptr)
+        // out of date.  The manifest warm-up relies on the same thing.
+        if (read_ahead_cb_ != nullptr || manifest_warm_up_active_)
         {
             return;
         }
@@ -241,6 +246,216 @@ namespace alt
         read_ahead_cb_existence_.reset();
     }
 
+    std::vector<block_id_t> page_cache_t::hottest_block_ids(size_t max_count) const
+    {
+        assert_thread();
+        // Ages are measured against the current access time, so that this is correct
+        // even after the access time counter has wrapped around.
+        const uint64_t now = evicter_.current_access_time();
+        std::vector<std::pair<uint64_t, block_id_t>> candidates;
+        candidates.reserve(current_pages_.size());
+        for (const auto &pair : current_pages_)
+        {
+            const page_t *page = pair.second->page_.get_page_for_read();
+            // Only pages that are on disk can be reloaded after a restart.  RDMA pages
+            // belong to other nodes.
+            if (page == nullptr || !page->is_loaded() || !page->is_disk_backed() ||
+                page->is_rdma_page() || is_aux_block_id(pair.first))
+            {
+                continue;
+            }
+            candidates.push_back(std::make_pair(now - page->access_time(), pair.first));
+        }
+
+        const size_t count = std::min(max_count, candidates.size());
+        std::partial_sort(candidates.begin(), candidates.begin() + count,
+                          candidates.end());
+
+        std::vector<block_id_t> ret;
+        ret.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            ret.push_back(candidates[i].second);
+        }
+        return ret;
+    }
+
+    size_t page_cache_t::manifest_block_budget() const
+    {
+        const uint64_t blocks_in_memory_limit =
+            evicter_.memory_limit() / max_block_size_.ser_value();
+        return std::min<uint64_t>(blocks_in_memory_limit, CACHE_MANIFEST_MAX_BLOCKS);
+    }
+
+    void page_cache_t::save_manifest()
+    {
+        assert_thread();
+        guarantee(manifest_path_.has_value());
+        guarantee(!manifest_save_active_);
+        manifest_save_active_ = true;
+
+        const std::vector<block_id_t> block_ids =
+            hottest_block_ids(manifest_block_budget());
+        int res;
+        thread_pool_t::run_in_blocker_pool([&]()
+        {
+            res = write_cache_manifest(*manifest_path_, block_ids);
+        });
+        if (res != 0)
+        {
+            logWRN("Failed to write cache manifest \"%s\": %s",
+                   manifest_path_->c_str(), errno_string(res).c_str());
+        }
+
+        manifest_save_active_ = false;
+    }
+
+    void page_cache_t::save_manifest_periodically(page_cache_t *page_cache,
+                                                  auto_drainer_t::lock_t lock)
+    {
+        if (lock.get_drain_signal()->is_pulsed() || page_cache->manifest_save_active_)
+        {
+            return;
+        }
+        page_cache->save_manifest();
+    }
+
+    void page_cache_t::warm_up_from_manifest(page_cache_t *page_cache,
+                                             auto_drainer_t::lock_t lock)
+    {
+        page_cache->assert_thread();
+
+        std::vector<block_id_t> block_ids;
+        int res;
+        thread_pool_t::run_in_blocker_pool([&]()
+        {
+            res = read_cache_manifest(*page_cache->manifest_path_, &block_ids);
+        });
+        if (res != 0)
+        {
+            // ENOENT just means that this cache has never written a manifest.
+            if (res != ENOENT)
+            {
+                logWRN("Ignoring unreadable cache manifest \"%s\": %s",
+                       page_cache->manifest_path_->c_str(), errno_string(res).c_str());
+            }
+            page_cache->manifest_warm_up_done_.pulse();
+            return;
+        }
+        // The manifest is sorted hottest first, so truncating it keeps what matters.
+        block_ids.resize(std::min(block_ids.size(), page_cache->manifest_block_budget()));
+        if (block_ids.empty() || lock.get_drain_signal()->is_pulsed())
+        {
+            page_cache->manifest_warm_up_done_.pulse();
+            return;
+        }
+
+        // From here on, any current_page_t that comes into existence stays until we're
+        // done.  So if there's no entry for a block once its buf got read, nobody
+        // touched the block after we looked up its block token below.
+        page_cache->manifest_warm_up_active_ = true;
+
+        struct warm_up_block_t
+        {
+            block_id_t block_id;
+            counted_t<standard_block_token_t> token;
+        };
+        std::vector<warm_up_block_t> blocks;
+        {
+            on_thread_t th(page_cache->serializer_->home_thread());
+            const block_id_t end_block_id = page_cache->serializer_->end_block_id();
+            blocks.reserve(block_ids.size());
+            for (block_id_t block_id : block_ids)
+            {
+                if (is_aux_block_id(block_id) || block_id >= end_block_id)
+                {
+                    continue;
+                }
+                counted_t<standard_block_token_t> token =
+                    page_cache->serializer_->index_read(block_id);
+                // Skip blocks that have been deleted since the manifest was written.
+                if (token.has())
+                {
+                    blocks.push_back(warm_up_block_t{block_id, std::move(token)});
+                }
+            }
+        }
+
+        // Reading in on-disk order turns the warm-up into mostly sequential I/O.
+        std::sort(blocks.begin(), blocks.end(),
+                  [](const warm_up_block_t &a, const warm_up_block_t &b)
+                  { return a.token->offset() < b.token->offset(); });
+
+        scoped_ptr_t<file_account_t> io_account;
+        for (size_t begin = 0; begin < blocks.size();
+             begin += CACHE_MANIFEST_WARM_UP_BATCH_SIZE)
+        {
+            const size_t end = std::min<size_t>(begin + CACHE_MANIFEST_WARM_UP_BATCH_SIZE,
+                                                blocks.size());
+            std::vector<buf_ptr_t> bufs(end - begin);
+            {
+                on_thread_t th(page_cache->serializer_->home_thread());
+                if (!io_account.has())
+                {
+                    io_account.init(page_cache->serializer_->make_io_account(
+                        CACHE_MANIFEST_WARM_UP_IO_PRIORITY, io_class_t::background));
+                }
+                pmap(static_cast<int64_t>(begin), static_cast<int64_t>(end),
+                     [&](int64_t i)
+                     {
+                         bufs[i - begin] = page_cache->serializer_->block_read(
+                             blocks[i].token, io_account.get());
+                     });
+            }
+
+            if (lock.get_drain_signal()->is_pulsed())
+            {
+                break;
+            }
+            for (size_t i = begin; i < end; ++i)
+            {
+                page_cache->add_warm_up_buf(blocks[i].block_id,
+                                            std::move(bufs[i - begin]),
+                                            blocks[i].token);
+            }
+        }
+
+        if (io_account.has())
+        {
+            on_thread_t th(page_cache->serializer_->home_thread());
+            io_account.reset();
+        }
+
+        page_cache->manifest_warm_up_active_ = false;
+        page_cache->manifest_warm_up_done_.pulse();
+        if (!lock.get_drain_signal()->is_pulsed())
+        {
+            // Let go of the current_page_t's we have been holding on to.
+            consider_evicting_all_current_pages(page_cache, std::move(lock));
+        }
+    }
+
+    void page_cache_t::add_warm_up_buf(block_id_t block_id,
+                                       buf_ptr_t buf,
+                                       const counted_t<standard_block_token_t> &token)
+    {
+        assert_thread();
+        guarantee(manifest_warm_up_active_);
+
+        // If the block has an entry anywhere, it has been accessed since we read its
+        // token and what we read might be out of date (or it is loaded already).
+        if (current_pages_.count(block_id) > 0 ||
+            write_current_pages_.count(block_id) > 0 ||
+            RDMA_current_pages_.count(block_id) > 0)
+        {
+            return;
+        }
+
+        current_page_t *page = new current_page_t(block_id, std::move(buf), token, this);
+        current_pages_[block_id] = page;
+        update_cache_page(page->page_.get_page_for_read(), block_id);
+    }
+
     int page_cache_t::get_node_id()
     {
         std::string tmp = PageAllocator::memory_pool->configs->my_ip;
@@ -321,12 +536,16 @@ namespace alt
     }
     page_cache_t::page_cache_t(serializer_t *_serializer,
                                cache_balancer_t *balancer,
-                               alt_txn_throttler_t *throttler)
+                               alt_txn_throttler_t *throttler,
+                               const optional<std::string> &manifest_path)
         : max_block_size_(_serializer->max_block_size()),
           serializer_(_serializer),
           free_list_(_serializer),
           evicter_(),
           read_ahead_cb_(nullptr),
+          manifest_path_(manifest_path),
+          manifest_warm_up_active_(false),
+          manifest_save_active_(false),
           drainer_(make_scoped<auto_drainer_t>())
     {
         std::cout << "Page cache created \n max_block_size_ = " << max_block_size_.value() << std::endl;
@@ -367,7 +586,8 @@ namespace alt
                 local_read_ahead_cb = new page_read_ahead_cb_t(_serializer, this);
             }
             default_reads_account_.init(_serializer->home_thread(),
-                                        _serializer->make_io_account(CACHE_READS_IO_PRIORITY));
+                                        _serializer->make_io_account(CACHE_READS_IO_PRIORITY,
+                                                                     io_class_t::interactive));
             index_write_sink_.init(new page_cache_index_write_sink_t);
             recencies_ = _serializer->get_all_recencies();
         }
@@ -383,6 +603,25 @@ namespace alt
         read_ahead_cb_ = local_read_ahead_cb;
         operation_count = 0;
         file_number = 0;
+
+        if (manifest_path_.has_value())
+        {
+            // The warm-up runs while we already serve requests.  Blocks that requests
+            // load on their own in the meantime are simply skipped.
+            coro_t::spawn_sometime(std::bind(&page_cache_t::warm_up_from_manifest,
+                                             this, drainer_->lock()));
+            manifest_timer_.init(new repeating_timer_t(
+                CACHE_MANIFEST_WRITE_INTERVAL_MS,
+                [this]()
+                {
+                    if (!manifest_save_active_)
+                    {
+                        coro_t::spawn_sometime(
+                            std::bind(&page_cache_t::save_manifest_periodically,
+                                      this, drainer_->lock()));
+                    }
+                }));
+        }
         if (page_map.port_number == 6001)
         {
             std::cout << "Initializing RDMA server on port " << page_map.port_number << std::endl;
@@ -427,6 +666,17 @@ namespace alt
 
         have_read_ahead_cb_destroyed();
 
+        if (manifest_path_.has_value())
+        {
+            // Record what is hot right now, so that a restart (e.g. during a rolling
+            // upgrade) can pick up where we left off.
+            manifest_timer_.reset();
+            if (!manifest_save_active_)
+            {
+                save_manifest();
+            }
+        }
+
         drainer_.reset();
         size_t i = 0;
         for (auto &&page : current_pages_)
@@ -780,6 +1030,20 @@ namespace alt
         file.close();
     }
 
+    void page_cache_t::record_hit(block_id_t block_id, page_t *page_instance)
+    {
+        update_perf_map(block_id);
+        if (page_instance->is_loaded())
+        {
+            if (check_if_internal_page(page_instance))
+            {
+                update_leaf_map(block_id, true);
+                update_block_info_map(block_id, true, false, false, false);
+            }
+        }
+        update_block_info_map(block_id, false, true, false, false);
+    }
+
     current_page_t *page_cache_t::page_for_block_id(block_id_t block_id, bool isRead)
     {
         assert_thread();
@@ -791,17 +1055,7 @@ namespace alt
         {
             write_key_found = true;
             writes_hit++;
-            update_perf_map(block_id);
-            page_t *page_instance = write_page_it->second->page_.get_page_for_read();
-            if (page_instance->is_loaded())
-            {
-                if (check_if_internal_page(page_instance))
-                {
-                    update_leaf_map(block_id, true);
-                    update_block_info_map(block_id, true, false, false, false);
-                }
-            }
-            update_block_info_map(block_id, false, true, false, false);
+            record_hit(block_id, write_page_it->second->page_.get_page_for_read());
             rassert(!write_page_it->second->is_deleted());
         }
 
@@ -1055,17 +1309,7 @@ namespace alt
             }
             else
             {
-                update_perf_map(block_id);
-                page_t *page_instance = page_it->second->page_.get_page_for_read();
-                if (page_instance->is_loaded())
-                {
-                    if (check_if_internal_page(page_instance))
-                    {
-                        update_leaf_map(block_id, true);
-                        update_block_info_map(block_id, true, false, false, false);
-                    }
-                }
-                update_block_info_map(block_id, false, true, false, false);
+                record_hit(block_id, page_it->second->page_.get_page_for_read());
                 rassert(!page_it->second->is_deleted());
             }
         }
@@ -1183,6 +1427,34 @@ namespace alt
         return internal_page_for_new_chosen(block_id);
     }
 
+    page_t *page_cache_t::page_for_optimistic_read(block_id_t block_id)
+    {
+        assert_thread();
+        // The same lookup as the one of `page_for_block_id()` when the block is in the
+        // cache.
+        current_page_t *current_page;
+        auto write_page_it = write_current_pages_.find(block_id);
+        if (write_page_it != write_current_pages_.end())
+        {
+            current_page = write_page_it->second;
+        }
+        else
+        {
+            auto page_it = current_pages_.find(block_id);
+            if (page_it == current_pages_.end())
+            {
+                return nullptr;
+            }
+            current_page = page_it->second;
+        }
+        page_t *page = current_page->the_page_for_optimistic_read();
+        if (page != nullptr)
+        {
+            record_hit(block_id, page);
+        }
+        return page;
+    }
+
     current_page_t *page_cache_t::internal_page_for_new_chosen(block_id_t block_id)
     {
         assert_thread();
@@ -1245,6 +1517,11 @@ namespace alt
     }
     void page_cache_t::erase_write_page_for_block_id(block_id_t block_id)
     {
+        // See consider_evicting_current_page.
+        if (manifest_warm_up_active_)
+        {
+            return;
+        }
         auto page_it = write_current_pages_.find(block_id);
         if (page_it == write_current_pages_.end())
         {
@@ -1298,7 +1575,8 @@ namespace alt
             // what the file account API is right now, deep in the I/O layer.
             on_thread_t thread_switcher(serializer_->home_thread());
             io_account = serializer_->make_io_account(io_priority,
-                                                      outstanding_requests_limit);
+                                                      outstanding_requests_limit,
+                                                      io_class_t::background);
         }
 
         return cache_account_t(serializer_->home_thread(), io_account);
@@ -1435,6 +1713,10 @@ namespace alt
     void current_page_acq_t::declare_readonly()
     {
         assert_thread();
+        if (access_ == access_t::write && in_a_list())
+        {
+            --current_page_->num_write_acquirers_;
+        }
         access_ = access_t::read;
         if (current_page_ != nullptr)
         {
@@ -1589,6 +1871,7 @@ namespace alt
         : block_id_(block_id),
           is_deleted_(false),
           last_write_acquirer_(nullptr),
+          num_write_acquirers_(0),
           num_keepalives_(0)
     {
         // Increment the block version so that we can distinguish between unassigned
@@ -1604,6 +1887,7 @@ namespace alt
           page_(new page_t(block_id, std::move(buf), page_cache)),
           is_deleted_(false),
           last_write_acquirer_(nullptr),
+          num_write_acquirers_(0),
           num_keepalives_(0)
     {
         // Increment the block version so that we can distinguish between unassigned
@@ -1620,6 +1904,7 @@ namespace alt
           page_(new page_t(block_id, std::move(buf), page_cache, isRDMA)),
           is_deleted_(false),
           last_write_acquirer_(nullptr),
+          num_write_acquirers_(0),
           num_keepalives_(0)
     {
         // Increment the block version so that we can distinguish between unassigned
@@ -1636,6 +1921,7 @@ namespace alt
           page_(new page_t(block_id, std::move(buf), token, page_cache)),
           is_deleted_(false),
           last_write_acquirer_(nullptr),
+          num_write_acquirers_(0),
           num_keepalives_(0)
     {
         // Increment the block version so that we can distinguish between unassigned
@@ -1759,6 +2045,10 @@ namespace alt
             acq->block_version_ = prev_version;
         }
 
+        if (acq->access_ == access_t::write)
+        {
+            ++num_write_acquirers_;
+        }
         acquirers_.push_back(acq);
         pulse_pulsables(acq);
     }
@@ -1767,6 +2057,10 @@ namespace alt
     {
         current_page_acq_t *next = acquirers_.next(acq);
         acquirers_.remove(acq);
+        if (acq->access_ == access_t::write)
+        {
+            --num_write_acquirers_;
+        }
         if (next != nullptr)
         {
             pulse_pulsables(next);
@@ -1845,6 +2139,22 @@ namespace alt
         }
     }
 
+    page_t *current_page_t::the_page_for_optimistic_read()
+    {
+        if (is_deleted_ || num_write_acquirers_ != 0 || !page_.has())
+        {
+            return nullptr;
+        }
+        page_t *page = page_.get_page_for_read();
+        // The buffer of an RDMA page can be replaced behind our back.
+        if (!page->is_loaded() || page->is_loading() || page->is_deferred_loading()
+            || page->is_rdma_page())
+        {
+            return nullptr;
+        }
+        return page;
+    }
+
     void current_page_t::add_keepalive()
     {
         ++num_keepalives_;
@@ -44,6 +44,7 @@
 #include "concurrency/new_semaphore.hpp"
 #include "containers/backindex_bag.hpp"
 #include "containers/intrusive_list.hpp"
+#include "containers/optional.hpp"
 #include "containers/segmented_vector.hpp"
 #include "containers/page_metadata.hpp"
 #include "repli_timestamp.hpp"
@@ -56,6 +57,11 @@ class cache_balancer_t;
 class auto_drainer_t;
 class cache_t;
 class file_account_t;
+class repeating_timer_t;
+
+namespace unittest {
+class manifest_warm_up_tester_t;
+}  // namespace unittest
 
 namespace alt
 {
@@ -166,6 +172,10 @@ namespace alt
         // Returns NULL if the page was deleted.
         page_t *the_page_for_read_or_deleted(current_page_help_t help);
 
+        // Returns the page if it can be read without getting in line for it, because
+        // it's in memory and no write acquirer is in line for it, or NULL otherwise.
+        page_t *the_page_for_optimistic_read();
+
         // Has access to our fields.
         friend class page_cache_t;
 
@@ -199,6 +209,8 @@ namespace alt
 
         // All list elements have current_page_ != NULL, snapshotted_page_ == NULL.
         intrusive_list_t<current_page_acq_t> acquirers_;
+        // How many of the acquirers_ have write access.
+        intptr_t num_write_acquirers_;
 
         // Avoids eviction if > 0. This is used by snapshotted current_page_acq_t's
         // that have a snapshotted version of this block. If the current_page_t
@@ -390,9 +402,13 @@ namespace alt
     class page_cache_t : public home_thread_mixin_t
     {
     public:
+        // If `manifest_path` is given, the page cache periodically records its hottest
+        // block ids there and preloads them when it gets constructed again.  (See
+        // buffer_cache/cache_manifest.hpp.)
         page_cache_t(serializer_t *serializer,
                      cache_balancer_t *balancer,
-                     alt_txn_throttler_t *throttler);
+                     alt_txn_throttler_t *throttler,
+                     const optional<std::string> &manifest_path);
         ~page_cache_t();
 
         int get_node_id();
@@ -415,6 +431,8 @@ namespace alt
         std::unordered_map<block_id_t, size_t> perf_map;
         bool should_admit_block(block_id_t block_id);
         void update_perf_map(block_id_t block_id);
+        // Notes an access to a page that is in the cache in the maps above.
+        void record_hit(block_id_t block_id, page_t *page_instance);
         void clear_perf_map();
         void print_perf_map(size_t file_number);
 
@@ -563,6 +581,10 @@ namespace alt
             block_id_t *block_id_out);
         current_page_t *page_for_new_chosen_block_id(block_id_t block_id);
 
+        // Returns the page of the current version of the block if it can be read without
+        // acquiring the block (see `buf_peek_t`), or NULL.
+        page_t *page_for_optimistic_read(block_id_t block_id);
+
         // Returns how much memory is being used by all the pages in the cache at this
         // moment in time.
         size_t total_page_memory() const;
@@ -600,12 +622,28 @@ namespace alt
 
     private:
         friend class page_read_ahead_cb_t;
+        friend class ::unittest::manifest_warm_up_tester_t;
         void add_read_ahead_buf(block_id_t block_id,
                                 scoped_device_block_aligned_ptr_t<ser_buffer_t> ptr,
                                 const counted_t<standard_block_token_t> &token);
 
         void read_ahead_cb_is_destroyed();
 
+        // Returns up to `max_count` block ids of disk-backed pages that are currently
+        // loaded, most recently accessed first.
+        std::vector<block_id_t> hottest_block_ids(size_t max_count) const;
+        // How many blocks the manifest records, and how many we preload from it.
+        size_t manifest_block_budget() const;
+
+        void save_manifest();
+        static void save_manifest_periodically(page_cache_t *page_cache,
+                                               auto_drainer_t::lock_t lock);
+        static void warm_up_from_manifest(page_cache_t *page_cache,
+                                          auto_drainer_t::lock_t lock);
+        void add_warm_up_buf(block_id_t block_id,
+                             buf_ptr_t buf,
+                             const counted_t<standard_block_token_t> &token);
+
         std::atomic_uint64_t operation_count;
 
         current_page_t *internal_page_for_new_chosen(block_id_t block_id);
@@ -715,6 +753,23 @@ namespace alt
         // destroyed and all possible read-ahead operations have completed.
         auto_drainer_t::lock_t read_ahead_cb_existence_;
 
+        // Where we persist the cache manifest, if anywhere.
+        const optional<std::string> manifest_path_;
+
+        // True while we are preloading blocks from the manifest.  Like the read-ahead
+        // logic, the warm-up relies on the existence of a current_page_t entry to tell
+        // whether the block could have been modified since we read its block token, so
+        // no current_page_t's get evicted while this is set.
+        bool manifest_warm_up_active_;
+
+        // Pulsed once the warm-up has loaded its blocks, or found nothing to load.
+        cond_t manifest_warm_up_done_;
+
+        // True while a manifest is being written, so that we never write two at once.
+        bool manifest_save_active_;
+
+        scoped_ptr_t<repeating_timer_t> manifest_timer_;
+
         scoped_ptr_t<auto_drainer_t> drainer_;
 
         PageMap page_map;
@@ -0,0 +1,110 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "client_protocol/datum.hpp"
+
+#include "arch/io/network.hpp"
+#include "client_protocol/protocols.hpp"
+#include "containers/archive/archive.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/query_params.hpp"
+#include "rdb_protocol/rdb_backtrace.hpp"
+#include "rdb_protocol/response.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
+#include "rdb_protocol/term_storage.hpp"
+#include "utils.hpp"
+
+scoped_ptr_t<ql::query_params_t> datum_protocol_t::parse_query(
+        tcp_conn_t *conn,
+        signal_t *interruptor,
+        ql::query_cache_t *query_cache) {
+    return json_protocol_t::parse_query(conn, interruptor, query_cache, &send_response);
+}
+
+ql::datum_t response_to_datum(ql::response_t *response) {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("t", ql::datum_t(static_cast<double>(response->type())));
+    if (response->type() == Response::RUNTIME_ERROR &&
+        response->error_type()) {
+        builder.overwrite("e",
+                          ql::datum_t(static_cast<double>(*response->error_type())));
+    }
+
+    // The elements are shared with the response, not copied.
+    std::vector<ql::datum_t> data(response->data());
+    builder.overwrite("r", ql::datum_t(std::move(data),
+                                       ql::datum_t::no_array_size_limit_check_t()));
+    if (response->backtrace()) {
+        builder.overwrite("b", *response->backtrace());
+    }
+    if (response->profile()) {
+        builder.overwrite("p", *response->profile());
+    }
+    if (response->type() == Response::SUCCESS_PARTIAL ||
+        response->type() == Response::SUCCESS_SEQUENCE) {
+        std::vector<ql::datum_t> notes;
+        notes.reserve(response->notes().size());
+        for (const auto &note : response->notes()) {
+            notes.push_back(ql::datum_t(static_cast<double>(note)));
+        }
+        builder.overwrite("n", ql::datum_t(std::move(notes),
+                                           ql::datum_t::no_array_size_limit_check_t()));
+    }
+    return std::move(builder).to_datum();
+}
+
+void datum_protocol_t::write_response_to_message(ql::response_t *response,
+                                                 write_message_t *wm) {
+    // We don't check for errors, so that the buffer backed datums are copied as they
+    // are.  A response can have more elements than we would store on disk, but it
+    // must not have `r.minval` or `r.maxval`, which the JSON protocol refuses too.
+    write_message_t response_wm;
+    ql::serialization_result_t res = ql::datum_serialize(
+        &response_wm, response_to_datum(response),
+        ql::check_datum_serialization_errors_t::NO);
+    if (res & ql::serialization_result_t::EXTREMA_PRESENT) {
+        response->fill_error(Response::RUNTIME_ERROR, Response::QUERY_LOGIC,
+                             "Cannot send `r.minval` or `r.maxval` in a response.",
+                             ql::backtrace_registry_t::EMPTY_BACKTRACE);
+        write_response_to_message(response, wm);
+        return;
+    }
+    wm->append_and_clear(&response_wm);
+}
+
+void datum_protocol_t::send_response(ql::response_t *response,
+                                     int64_t token,
+                                     tcp_conn_t *conn,
+                                     signal_t *interruptor) {
+    write_response(response, token, conn, interruptor);
+    conn->flush_buffer(interruptor);
+}
+
+void datum_protocol_t::write_response(ql::response_t *response,
+                                      int64_t token,
+                                      tcp_conn_t *conn,
+                                      signal_t *interruptor) {
+    write_message_t wm;
+    write_response_to_message(response, &wm);
+    const size_t payload_size = wm.size();
+    guarantee(payload_size > 0);
+
+    if (payload_size >= wire_protocol_t::TOO_LARGE_RESPONSE_SIZE) {
+        response->fill_error(Response::RUNTIME_ERROR,
+                             Response::RESOURCE_LIMIT,
+                             wire_protocol_t::too_large_response_message(payload_size),
+                             ql::backtrace_registry_t::EMPTY_BACKTRACE);
+        write_response(response, token, conn, interruptor);
+        return;
+    }
+
+    uint32_t data_size = static_cast<uint32_t>(payload_size);
+#ifdef __s390x__
+    token = __builtin_bswap64(token);
+    data_size = __builtin_bswap32(data_size);
+#endif
+    conn->write_buffered(&token, sizeof(token), interruptor);
+    conn->write_buffered(&data_size, sizeof(data_size), interruptor);
+    intrusive_list_t<write_buffer_t> *buffers = wm.unsafe_expose_buffers();
+    for (write_buffer_t *b = buffers->head(); b != nullptr; b = buffers->next(b)) {
+        conn->write_buffered(b->data, b->size, interruptor);
+    }
+}
@@ -0,0 +1,46 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef CLIENT_PROTOCOL_DATUM_HPP_
+#define CLIENT_PROTOCOL_DATUM_HPP_
+
+#include <stdint.h>
+
+#include "arch/types.hpp"
+#include "containers/scoped.hpp"
+
+class signal_t;
+class write_message_t;
+
+namespace ql {
+class response_t;
+class query_cache_t;
+class query_params_t;
+}
+
+/* Reads queries as JSON, like `json_protocol_t`, but writes each response as a datum in
+the `datum_serialize()` format, which clients ask for with `protocol_version` 1 in the
+handshake.  The response is an object with the same fields as the JSON response.  The
+datums that are backed by a serialized buffer, such as the documents that were read
+from disk, are copied into the response as they are, rather than converted to JSON. */
+class datum_protocol_t {
+public:
+    static scoped_ptr_t<ql::query_params_t> parse_query(tcp_conn_t *conn,
+                                                        signal_t *interruptor,
+                                                        ql::query_cache_t *query_cache);
+
+    // Appends the serialized response to `wm`.
+    static void write_response_to_message(ql::response_t *response,
+                                          write_message_t *wm);
+
+    // Writes the response into the connection's write buffer, without flushing it.
+    static void write_response(ql::response_t *response,
+                               int64_t token,
+                               tcp_conn_t *conn,
+                               signal_t *interruptor);
+
+    static void send_response(ql::response_t *response,
+                              int64_t token,
+                              tcp_conn_t *conn,
+                              signal_t *interruptor);
+};
+
+#endif // CLIENT_PROTOCOL_DATUM_HPP_
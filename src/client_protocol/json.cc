@@ -49,6 +49,14 @@ scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query(
         tcp_conn_t *conn,
         signal_t *interruptor,
         ql::query_cache_t *query_cache) {
+    return parse_query(conn, interruptor, query_cache, &send_response);
+}
+
+scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query(
+        tcp_conn_t *conn,
+        signal_t *interruptor,
+        ql::query_cache_t *query_cache,
+        send_response_t send_error) {
     int64_t token;
     uint32_t size;
     conn->read_buffered(&token, sizeof(token), interruptor);
@@ -75,23 +83,22 @@ scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query(
             conn->pop(size, &pop_interruptor);
         }
 
-        send_response(&error, token, conn, interruptor);
+        send_error(&error, token, conn, interruptor);
         throw tcp_conn_read_closed_exc_t();
     }
 
     scoped_array_t<char> data(size + 1);
-    // It's *usually* more efficient to do an un-buffered read here. The client is
-    // usually not going to group multiple queries into the same network package
-    // (especially not with tcp_nodelay set), and using the non-buffered `read` can
-    // avoid an extra copy.
-    conn->read(data.data(), size, interruptor);
+    // Clients that pipeline their queries send many small queries at once, so we read
+    // small queries through the connection's read buffer, which picks up the queries
+    // after them in the same read.  Large queries are read without the extra copy.
+    conn->read_buffered(data.data(), size, interruptor);
     data[size] = 0; // Null terminate the string, which the json parser requires
 
     scoped_ptr_t<ql::query_params_t> res =
         parse_query_from_buffer(std::move(data), 0, query_cache, token, &error);
 
     if (!res.has()) {
-        send_response(&error, token, conn, interruptor);
+        send_error(&error, token, conn, interruptor);
     }
     return res;
 }
@@ -205,6 +212,14 @@ void json_protocol_t::send_response(ql::response_t *response,
                                     int64_t token,
                                     tcp_conn_t *conn,
                                     signal_t *interruptor) {
+    write_response(response, token, conn, interruptor);
+    conn->flush_buffer(interruptor);
+}
+
+void json_protocol_t::write_response(ql::response_t *response,
+                                     int64_t token,
+                                     tcp_conn_t *conn,
+                                     signal_t *interruptor) {
     uint32_t data_size; // filled in below
     const size_t prefix_size = sizeof(token) + sizeof(data_size);
 
@@ -225,7 +240,7 @@ void json_protocol_t::send_response(ql::response_t *response,
                              Response::RESOURCE_LIMIT,
                              wire_protocol_t::too_large_response_message(payload_size),
                              ql::backtrace_registry_t::EMPTY_BACKTRACE);
-        send_response(response, token, conn, interruptor);
+        write_response(response, token, conn, interruptor);
         return;
     }
 
@@ -247,6 +262,6 @@ void json_protocol_t::send_response(ql::response_t *response,
             reinterpret_cast<const char *>(&data_size)[i];
     }
 
-    conn->write(buffer.GetString(), buffer.GetSize(), interruptor);
+    conn->write_buffered(buffer.GetString(), buffer.GetSize(), interruptor);
 }
 
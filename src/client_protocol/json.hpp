@@ -29,10 +29,27 @@ public:
                                                         signal_t *interruptor,
                                                         ql::query_cache_t *query_cache);
 
+    // Like `parse_query()`, but sends the errors with `send_error`, for the protocols
+    // that read queries as JSON and write their responses some other way.
+    typedef void (*send_response_t)(ql::response_t *response,
+                                    int64_t token,
+                                    tcp_conn_t *conn,
+                                    signal_t *interruptor);
+    static scoped_ptr_t<ql::query_params_t> parse_query(tcp_conn_t *conn,
+                                                        signal_t *interruptor,
+                                                        ql::query_cache_t *query_cache,
+                                                        send_response_t send_error);
+
     // Used by the HTTP ReQL server to write the query response into the HTTP response
     static void write_response_to_buffer(ql::response_t *response,
                                          rapidjson::StringBuffer *buffer_out);
 
+    // Writes the response into the connection's write buffer, without flushing it.
+    static void write_response(ql::response_t *response,
+                               int64_t token,
+                               tcp_conn_t *conn,
+                               signal_t *interruptor);
+
     static void send_response(ql::response_t *response,
                               int64_t token,
                               tcp_conn_t *conn,
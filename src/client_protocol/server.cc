@@ -29,6 +29,7 @@
 #include "clustering/administration/metadata.hpp"
 #include "concurrency/coro_pool.hpp"
 #include "concurrency/cross_thread_signal.hpp"
+#include "concurrency/pump_coro.hpp"
 #include "concurrency/queue/limited_fifo.hpp"
 #include "crypto/error.hpp"
 #include "perfmon/perfmon.hpp"
@@ -193,19 +194,25 @@ size_t http_conn_cache_t::sha_hasher_t::operator()(const conn_key_t &x) const {
 query_server_t::query_server_t(rdb_context_t *_rdb_ctx,
                                const std::set<ip_address_t> &local_addresses,
                                int port,
+                               int num_listener_threads,
                                query_handler_t *_handler,
                                uint32_t http_timeout_sec,
                                tls_ctx_t *_tls_ctx) :
         tls_ctx(_tls_ctx),
         rdb_ctx(_rdb_ctx),
         handler(_handler),
-        http_conn_cache(http_timeout_sec),
-        next_thread(0) {
+        connections_per_thread(get_num_db_threads()),
+        http_conn_cache(http_timeout_sec) {
     rassert(rdb_ctx != nullptr);
+    for (size_t i = 0; i < connections_per_thread.size(); ++i) {
+        connections_per_thread[i].value = 0;
+    }
     try {
-        tcp_listener.init(new tcp_listener_t(local_addresses, port,
-            std::bind(&query_server_t::handle_conn,
-                      this, ph::_1, auto_drainer_t::lock_t(&drainer))));
+        tcp_listener.init(new sharded_tcp_listener_t(local_addresses, port,
+            num_listener_threads,
+            [this](const scoped_ptr_t<tcp_conn_descriptor_t> &nconn) {
+                handle_conn(nconn, auto_drainer_t::lock_t(conn_drainers.get()));
+            }));
     } catch (const address_in_use_exc_t &ex) {
         throw address_in_use_exc_t(
             strprintf("Could not bind to RDB protocol port: %s", ex.what()));
@@ -253,10 +260,43 @@ ql::datum_t read_datum(tcp_conn_t *connection, signal_t *interruptor) {
     }
 }
 
+threadnum_t query_server_t::choose_thread() {
+    const auto &counts = connections_per_thread;
+    const size_t current = get_thread_id().threadnum;
+    size_t least_loaded = 0;
+    for (size_t i = 1; i < counts.size(); ++i) {
+        if (counts[i].value < counts[least_loaded].value) {
+            least_loaded = i;
+        }
+    }
+    if (current < counts.size() &&
+        counts[current].value <=
+            counts[least_loaded].value + CLIENT_CONNECTION_THREAD_SLACK) {
+        return threadnum_t(current);
+    }
+    return threadnum_t(least_loaded);
+}
+
+// Counts a connection in the connections of its thread while it exists.
+class connection_count_sentry_t {
+public:
+    explicit connection_count_sentry_t(std::atomic<int64_t> *_count) : count(_count) {
+        ++*count;
+    }
+    ~connection_count_sentry_t() {
+        --*count;
+    }
+private:
+    std::atomic<int64_t> *const count;
+
+    DISABLE_COPYING(connection_count_sentry_t);
+};
+
 void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn,
                                  auto_drainer_t::lock_t keepalive) {
-    threadnum_t chosen_thread = threadnum_t(next_thread);
-    next_thread = (next_thread + 1) % get_num_db_threads();
+    threadnum_t chosen_thread = choose_thread();
+    connection_count_sentry_t connection_count(
+        &connections_per_thread[chosen_thread.threadnum].value);
 
     cross_thread_signal_t ct_keepalive(keepalive.get_drain_signal(), chosen_thread);
     on_thread_t rethreader(chosen_thread);
@@ -275,6 +315,8 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
     }
 
     uint8_t version = 0;
+    // Only clients of `V1_0` can ask for datum responses, with `protocol_version` 1.
+    bool datum_responses = false;
     std::unique_ptr<auth::base_authenticator_t> authenticator;
     uint32_t error_code = 0;
     std::string error_message;
@@ -370,7 +412,7 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
             {
                 ql::datum_object_builder_t datum_object_builder;
                 datum_object_builder.overwrite("success", ql::datum_t::boolean(true));
-                datum_object_builder.overwrite("max_protocol_version", ql::datum_t(0.0));
+                datum_object_builder.overwrite("max_protocol_version", ql::datum_t(1.0));
                 datum_object_builder.overwrite("min_protocol_version", ql::datum_t(0.0));
                 datum_object_builder.overwrite(
                     "server_version", ql::datum_t(RETHINKDB_VERSION));
@@ -390,10 +432,12 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                     throw client_protocol::client_server_error_t(
                         1, "Expected a number for `protocol_version`.");
                 }
-                if (protocol_version.as_num() != 0.0) {
+                if (protocol_version.as_num() != 0.0 &&
+                    protocol_version.as_num() != 1.0) {
                     throw client_protocol::client_server_error_t(
                         2, "Unsupported `protocol_version`.");
                 }
+                datum_responses = protocol_version.as_num() == 1.0;
 
                 ql::datum_t authentication_method =
                     datum.get_field("authentication_method", ql::NOTHROW);
@@ -462,13 +506,18 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                 : ql::return_empty_normal_batches_t::NO,
             auth::user_context_t(authenticator->get_authenticated_username()));
 
-        connection_loop<json_protocol_t>(
-            conn.get(),
-            (version < 4)
-                ? 1
-                : 1024,
-            &query_cache,
-            &ct_keepalive);
+        if (datum_responses) {
+            connection_loop<datum_protocol_t>(
+                conn.get(), 1024, &query_cache, &ct_keepalive);
+        } else {
+            connection_loop<json_protocol_t>(
+                conn.get(),
+                (version < 4)
+                    ? 1
+                    : 1024,
+                &query_cache,
+                &ct_keepalive);
+        }
     } catch (client_protocol::client_server_error_t const &error) {
         // We can't write the response here due to coroutine switching inside an
         // exception handler
@@ -581,6 +630,30 @@ void query_server_t::connection_loop(tcp_conn_t *conn,
     wait_any_t interruptor(drain_signal, &abort);
 #endif  // __linux
 
+    // The responses are written into the connection's write buffer, which `flusher`
+    // flushes for all of them, so the responses of the queries that finish together
+    // go out in the same writes.
+    pump_coro_t flusher([&](signal_t *flush_interruptor) {
+        new_mutex_acq_t send_lock(&send_mutex, flush_interruptor);
+        try {
+            conn->flush_buffer(flush_interruptor);
+        } catch (const tcp_conn_write_closed_exc_t &) {
+            // `send_response` notices that the connection was closed.
+        }
+    });
+    auto send_response = [&](ql::response_t *response, int64_t token,
+                             signal_t *lock_interruptor, signal_t *send_interruptor) {
+        {
+            new_mutex_acq_t send_lock(&send_mutex, lock_interruptor);
+            protocol_t::write_response(response, token, conn, send_interruptor);
+        }
+        flusher.notify();
+        flusher.flush(send_interruptor);
+        if (!conn->is_write_open()) {
+            throw tcp_conn_write_closed_exc_t();
+        }
+    };
+
     new_semaphore_t sem(max_concurrent_queries);
     auto_drainer_t coro_drainer;
     while (!err) {
@@ -603,9 +676,8 @@ void query_server_t::connection_loop(tcp_conn_t *conn,
                 save_exception(&err, &err_str, &abort, [&]() {
                     handler->run_query(query.get(), &response, &cb_interruptor);
                     if (!query->noreply) {
-                        new_mutex_acq_t send_lock(&send_mutex, &cb_interruptor);
-                        protocol_t::send_response(&response, query->token,
-                                                  conn, &cb_interruptor);
+                        send_response(&response, query->token,
+                                      &cb_interruptor, &cb_interruptor);
                         replied = true;
                     }
                 });
@@ -613,9 +685,8 @@ void query_server_t::connection_loop(tcp_conn_t *conn,
                     if (!replied && !query->noreply) {
                         make_error_response(drain_signal->is_pulsed(), *conn,
                                             err_str, &response);
-                        new_mutex_acq_t send_lock(&send_mutex, drain_signal);
-                        protocol_t::send_response(&response, query->token,
-                                                  conn, &cb_interruptor);
+                        send_response(&response, query->token,
+                                      drain_signal, &cb_interruptor);
                     }
                 });
             });
@@ -2,6 +2,7 @@
 #ifndef CLIENT_PROTOCOL_SERVER_HPP_
 #define CLIENT_PROTOCOL_SERVER_HPP_
 
+#include <atomic>
 #include <set>
 #include <map>
 #include <memory>
@@ -15,7 +16,9 @@
 #include "arch/runtime/runtime.hpp"
 #include "arch/timing.hpp"
 #include "concurrency/auto_drainer.hpp"
+#include "concurrency/cache_line_padded.hpp"
 #include "concurrency/cross_thread_signal.hpp"
+#include "concurrency/one_per_thread.hpp"
 #include "containers/archive/archive.hpp"
 #include "containers/counted.hpp"
 #include "http/http.hpp"
@@ -97,10 +100,13 @@ public:
 
 class query_server_t : public http_app_t {
 public:
+    // The first `num_listener_threads` threads accept connections on the port (see
+    // `sharded_tcp_listener_t`).
     query_server_t(
         rdb_context_t *rdb_ctx,
         const std::set<ip_address_t> &local_addresses,
         int port,
+        int num_listener_threads,
         query_handler_t *_handler,
         uint32_t http_timeout_sec,
         tls_ctx_t* tls_ctx);
@@ -118,6 +124,10 @@ private:
     void handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn,
                      auto_drainer_t::lock_t);
 
+    // Picks the thread for a new connection: the current thread, unless it has more
+    // than its share of the connections.
+    threadnum_t choose_thread();
+
     // This is templatized based on the wire protocol requested by the client
     template<class protocol_t>
     void connection_loop(tcp_conn_t *conn,
@@ -134,12 +144,17 @@ private:
     rdb_context_t *const rdb_ctx;
     query_handler_t *const handler;
 
+    // The number of client connections on every thread.  They are read from other
+    // threads, when choosing the thread of a new connection.
+    scoped_array_t<cache_line_padded_t<std::atomic<int64_t> > > connections_per_thread;
+
     /* WARNING: The order here is fragile. */
     auto_drainer_t drainer;
     http_conn_cache_t http_conn_cache;
-    scoped_ptr_t<tcp_listener_t> tcp_listener;
-
-    int next_thread;
+    // The client connections are accepted on every thread, so they keep a drainer of
+    // the thread that accepted them.
+    one_per_thread_t<auto_drainer_t> conn_drainers;
+    scoped_ptr_t<sharded_tcp_listener_t> tcp_listener;
 };
 
 #endif /* CLIENT_PROTOCOL_SERVER_HPP_ */
@@ -961,6 +961,7 @@ service_address_ports_t get_service_address_ports(const std::map<std::string, op
         exists_option(opts, "--no-http-admin"),
         offseted_port(get_single_int(opts, "--http-port"), port_offset),
         offseted_port(get_single_int(opts, "--driver-port"), port_offset),
+        !exists_option(opts, "--no-driver-port-sharding"),
         port_offset);
 }
 
@@ -1368,6 +1369,7 @@ void run_rethinkdb_serve(const base_path_t &base_path,
                          const std::string &initial_password,
                          const file_direct_io_mode_t direct_io_mode,
                          const int max_concurrent_io_requests,
+                         const int64_t io_group_commit_delay_usec,
                          const optional<optional<uint64_t>>
                              &total_cache_size,
                          const server_id_t *our_server_id,
@@ -1386,7 +1388,8 @@ void run_rethinkdb_serve(const base_path_t &base_path,
 
     logNTC("Loading data from directory %s\n", base_path.path().c_str());
 
-    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests);
+    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests,
+                                io_group_commit_delay_usec);
 
     perfmon_collection_t metadata_perfmon_collection;
     perfmon_membership_t metadata_perfmon_membership(&get_global_perfmon_collection(), &metadata_perfmon_collection, "metadata");
@@ -1528,6 +1531,7 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
                              const std::string &initial_password,
                              const file_direct_io_mode_t direct_io_mode,
                              const int max_concurrent_io_requests,
+                             const int64_t io_group_commit_delay_usec,
                              const optional<optional<uint64_t>>
                                  &total_cache_size,
                              const bool new_directory,
@@ -1543,7 +1547,8 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
     if (!new_directory)
     {
         run_rethinkdb_serve(base_path, serve_info, initial_password, direct_io_mode,
-                            max_concurrent_io_requests, total_cache_size,
+                            max_concurrent_io_requests, io_group_commit_delay_usec,
+                            total_cache_size,
                             nullptr, nullptr, nullptr, data_directory_lock,
                             result_out);
     }
@@ -1582,7 +1587,7 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
         server_config.version = 1;
 
         run_rethinkdb_serve(base_path, serve_info, initial_password, direct_io_mode,
-                            max_concurrent_io_requests,
+                            max_concurrent_io_requests, io_group_commit_delay_usec,
                             optional<optional<uint64_t>>(),
                             &our_server_id, &server_config, &cluster_metadata,
                             data_directory_lock, result_out);
@@ -1670,6 +1675,12 @@ options::help_section_t get_file_options(std::vector<options::option_t> *options
                                              strprintf("%d", DEFAULT_MAX_CONCURRENT_IO_REQUESTS)));
     help.add("--io-threads n",
              "how many simultaneous I/O operations can happen at the same time");
+    options_out->push_back(options::option_t(options::names_t("--io-group-commit-delay"),
+                                             options::OPTIONAL,
+                                             strprintf("%" PRIi64,
+                                                       DEFAULT_IO_GROUP_COMMIT_DELAY_USEC)));
+    help.add("--io-group-commit-delay usecs",
+             "how long a hard durability disk flush waits for others to share it with");
 #ifndef _WIN32
     // TODO WINDOWS: accept this option, but error out if it is passed
     options_out->push_back(options::option_t(options::names_t("--direct-io"),
@@ -1881,6 +1892,10 @@ options::help_section_t get_network_options(const bool join_required, std::vecto
                                              options::OPTIONAL,
                                              strprintf("%d", port_defaults::reql_port)));
     help.add("--driver-port port", "port for rethinkdb protocol client drivers");
+    options_out->push_back(options::option_t(options::names_t("--no-driver-port-sharding"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--no-driver-port-sharding", "accept client driver connections on a single "
+                                          "thread instead of on every thread");
 
     options_out->push_back(options::option_t(options::names_t("--port-offset", "-o"),
                                              options::OPTIONAL,
@@ -2197,6 +2212,22 @@ MUST_USE bool parse_io_threads_option(const std::map<std::string, options::value
     return true;
 }
 
+MUST_USE bool parse_io_group_commit_delay_option(
+        const std::map<std::string, options::values_t> &opts,
+        int64_t *io_group_commit_delay_usec_out)
+{
+    int io_group_commit_delay_usec = get_single_int(opts, "--io-group-commit-delay");
+    if (io_group_commit_delay_usec < 0
+        || io_group_commit_delay_usec > MAXIMUM_IO_GROUP_COMMIT_DELAY_USEC)
+    {
+        fprintf(stderr, "ERROR: io-group-commit-delay must be between 0 and %" PRIi64 "\n",
+                MAXIMUM_IO_GROUP_COMMIT_DELAY_USEC);
+        return false;
+    }
+    *io_group_commit_delay_usec_out = io_group_commit_delay_usec;
+    return true;
+}
+
 file_direct_io_mode_t parse_direct_io_mode_option(const std::map<std::string, options::values_t> &opts)
 {
     return exists_option(opts, "--direct-io") ? file_direct_io_mode_t::direct_desired : file_direct_io_mode_t::buffered_desired;
@@ -2387,6 +2418,12 @@ int main_rethinkdb_serve(int argc, char *argv[])
             return EXIT_FAILURE;
         }
 
+        int64_t io_group_commit_delay_usec;
+        if (!parse_io_group_commit_delay_option(opts, &io_group_commit_delay_usec))
+        {
+            return EXIT_FAILURE;
+        }
+
         optional<optional<uint64_t>> total_cache_size =
             parse_total_cache_size_option(opts);
 
@@ -2449,6 +2486,7 @@ int main_rethinkdb_serve(int argc, char *argv[])
                                      initial_password,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     io_group_commit_delay_usec,
                                      total_cache_size,
                                      static_cast<server_id_t *>(nullptr),
                                      static_cast<server_config_versioned_t *>(nullptr),
@@ -2694,6 +2732,12 @@ int main_rethinkdb_porcelain(int argc, char *argv[])
             return EXIT_FAILURE;
         }
 
+        int64_t io_group_commit_delay_usec;
+        if (!parse_io_group_commit_delay_option(opts, &io_group_commit_delay_usec))
+        {
+            return EXIT_FAILURE;
+        }
+
         optional<int> join_delay_secs = parse_join_delay_secs_option(opts);
         optional<int> node_reconnect_timeout_secs =
             parse_node_reconnect_timeout_secs_option(opts);
@@ -2786,6 +2830,7 @@ int main_rethinkdb_porcelain(int argc, char *argv[])
                                      initial_password,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     io_group_commit_delay_usec,
                                      total_cache_size,
                                      is_new_directory,
                                      &serve_info,
@@ -282,7 +282,9 @@ bool do_serve(io_backender_t *io_backender,
                               nullptr,   /* we'll fill this in later */
                               semilattice_manager_auth.get_root_view(),
                               &get_global_perfmon_collection(),
-                              serve_info.reql_http_proxy);
+                              serve_info.reql_http_proxy,
+                              io_backender,
+                              base_path);
         {
             /* Extract a subview of the directory with all the table meta manager
             business cards. */
@@ -539,6 +541,7 @@ bool do_serve(io_backender_t *io_backender,
                 rdb_query_server_t rdb_query_server(
                     serve_info.ports.local_addresses_driver,
                     serve_info.ports.reql_port,
+                    serve_info.ports.driver_port_sharding ? get_num_db_threads() : 1,
                     &rdb_ctx,
                     &server_config_client,
                     server_id,
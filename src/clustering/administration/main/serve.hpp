@@ -47,6 +47,7 @@ struct service_address_ports_t {
         client_port(0),
         http_port(0),
         reql_port(0),
+        driver_port_sharding(false),
         port_offset(0) { }
 
     service_address_ports_t(const std::set<ip_address_t> &_local_addresses,
@@ -59,6 +60,7 @@ struct service_address_ports_t {
                             bool _http_admin_is_disabled,
                             int _http_port,
                             int _reql_port,
+                            bool _driver_port_sharding,
                             int _port_offset) :
         local_addresses(_local_addresses),
         local_addresses_cluster(_local_addresses_cluster),
@@ -70,6 +72,7 @@ struct service_address_ports_t {
         http_admin_is_disabled(_http_admin_is_disabled),
         http_port(_http_port),
         reql_port(_reql_port),
+        driver_port_sharding(_driver_port_sharding),
         port_offset(_port_offset)
     {
             sanitize_port(port, "port", port_offset);
@@ -93,6 +96,8 @@ struct service_address_ports_t {
     bool http_admin_is_disabled;
     int http_port;
     int reql_port;
+    // Whether every thread gets a socket listening on the driver port.
+    bool driver_port_sharding;
     int port_offset;
 };
 
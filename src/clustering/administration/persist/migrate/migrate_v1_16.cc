@@ -441,7 +441,8 @@ void check_for_obsolete_sindexes(io_backender_t *io_backender,
                                       base_path,
                                       info.first,
                                       /* Important: Don't update indexes yet. */
-                                      update_sindexes_t::LEAVE_ALONE);
+                                      update_sindexes_t::LEAVE_ALONE,
+                                      r_nullopt);
 
                         store.sindex_list(interruptor);
                     });
@@ -489,7 +490,8 @@ void migrate_tables(io_backender_t *io_backender,
                                       io_backender,
                                       base_path,
                                       info.first,
-                                      update_sindexes_t::UPDATE);
+                                      update_sindexes_t::UPDATE,
+                                      r_nullopt);
 
                         if (index == 0) {
                             sindex_list = store.sindex_list(interruptor);
@@ -570,7 +572,8 @@ void migrate_cluster_metadata_to_v2_1(io_backender_t *io_backender,
                       case cluster_version_t::v2_1:
                       case cluster_version_t::v2_2:
                       case cluster_version_t::v2_3:
-                      case cluster_version_t::v2_4_is_latest:
+                      case cluster_version_t::v2_4:
+                      case cluster_version_t::v2_5_is_latest:
                       default:
                         unreachable();
                       }
@@ -590,7 +593,8 @@ void migrate_cluster_metadata_to_v2_1(io_backender_t *io_backender,
                       case cluster_version_t::v2_1:
                       case cluster_version_t::v2_2:
                       case cluster_version_t::v2_3:
-                      case cluster_version_t::v2_4_is_latest:
+                      case cluster_version_t::v2_4:
+                      case cluster_version_t::v2_5_is_latest:
                       default:
                         unreachable();
                       }
@@ -665,7 +669,8 @@ void migrate_auth_metadata_to_v2_1(io_backender_t *io_backender,
                       case cluster_version_t::v2_1:
                       case cluster_version_t::v2_2:
                       case cluster_version_t::v2_3:
-                      case cluster_version_t::v2_4_is_latest:
+                      case cluster_version_t::v2_4:
+                      case cluster_version_t::v2_5_is_latest:
                       default:
                           unreachable();
                       }
@@ -686,7 +691,8 @@ void migrate_auth_metadata_to_v2_1(io_backender_t *io_backender,
                       case cluster_version_t::v2_1:
                       case cluster_version_t::v2_2:
                       case cluster_version_t::v2_3:
-                      case cluster_version_t::v2_4_is_latest:
+                      case cluster_version_t::v2_4:
+                      case cluster_version_t::v2_5_is_latest:
                       default:
                           unreachable();
                       }
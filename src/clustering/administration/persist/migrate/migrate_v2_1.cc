@@ -86,9 +86,12 @@ void migrate_metadata_v2_1_to_v2_3(cluster_version_t serialization_version,
     case cluster_version_t::v2_3:
         migrate_metadata_v2_1_to_v2_3<cluster_version_t::v2_3>(txn, interruptor);
         break;
-    case cluster_version_t::v2_4_is_latest:
+    case cluster_version_t::v2_4:
         migrate_metadata_v2_1_to_v2_3<cluster_version_t::v2_4>(txn, interruptor);
         break;
+    case cluster_version_t::v2_5_is_latest:
+        migrate_metadata_v2_1_to_v2_3<cluster_version_t::v2_5>(txn, interruptor);
+        break;
     case cluster_version_t::v1_14:
     case cluster_version_t::v1_15:
     case cluster_version_t::v1_16:
@@ -30,7 +30,7 @@ void migrate_metadata_v2_3_to_v2_4(cluster_version_t serialization_version,
     case cluster_version_t::v2_3:
         migrate_metadata_v2_3_to_v2_4<cluster_version_t::v2_3>(txn, interruptor);
         break;
-    case cluster_version_t::v2_4_is_latest:
+    case cluster_version_t::v2_5_is_latest:
         break;
     case cluster_version_t::v1_14:
     case cluster_version_t::v1_15:
@@ -38,6 +38,7 @@ void migrate_metadata_v2_3_to_v2_4(cluster_version_t serialization_version,
     case cluster_version_t::v2_0:
     case cluster_version_t::v2_1:
     case cluster_version_t::v2_2:
+    case cluster_version_t::v2_4:
     default:
         unreachable();
     }
@@ -14,12 +14,21 @@
 #include "clustering/administration/persist/file_keys.hpp"
 #include "clustering/administration/persist/raft_storage_interface.hpp"
 #include "clustering/administration/perfmon_collection_repo.hpp"
+#include "buffer_cache/cache_manifest.hpp"
 #include "logger.hpp"
 #include "rdb_protocol/store.hpp"
 #include "serializer/log/log_serializer.hpp"
 #include "serializer/merger.hpp"
 #include "serializer/translator.hpp"
 
+/* Each CPU shard's cache keeps a manifest of its hottest blocks next to the table's
+data file, so that it can warm up quickly after a restart. */
+static std::string cache_manifest_path_for(const serializer_filepath_t &path,
+                                           size_t shard) {
+    return strprintf("%s.shard_%zu.cache_manifest",
+                     path.permanent_path().c_str(), shard);
+}
+
 class real_multistore_ptr_t :
     public multistore_ptr_t {
 public:
@@ -100,7 +109,8 @@ public:
                 io_backender,
                 base_path,
                 table_id,
-                update_sindexes_t::UPDATE));
+                update_sindexes_t::UPDATE,
+                make_optional(cache_manifest_path_for(path, ix))));
 
             /* Initialize the metainfo if necessary */
             if (create) {
@@ -331,6 +341,16 @@ void real_table_persistence_interface_t::destroy_multistore(
     const int res = ::unlink(filepath.c_str());
     guarantee_err(res == 0 || get_errno() == ENOENT,
                   "unlink failed for file %s", filepath.c_str());
+
+    for (size_t ix = 0; ix < CPU_SHARDING_FACTOR; ++ix) {
+        const std::string manifest_path =
+            cache_manifest_path_for(file_name_for(table_id), ix);
+        const int manifest_res = remove_cache_manifest(manifest_path);
+        if (manifest_res != 0) {
+            logWRN("Failed to remove cache manifest %s: %s", manifest_path.c_str(),
+                   errno_string(manifest_res).c_str());
+        }
+    }
 }
 
 serializer_filepath_t real_table_persistence_interface_t::file_name_for(
@@ -44,6 +44,50 @@
 // useful.
 #define DEFAULT_IO_BATCH_FACTOR                   1
 
+// The largest number of datasyncs that `group_datasync_t` merges into a single flush
+// of a device.  A batch that reaches this size is flushed right away instead of
+// waiting out the rest of the group commit delay.
+#define MAX_GROUP_DATASYNC_BATCH_SIZE             64
+
+// Latency targets of the I/O classes (see `io_class_t`) in the disk scheduler.  A
+// request that has waited for longer than its class's deadline is dispatched before
+// any request whose deadline hasn't passed yet.  The interactive target is also what
+// the scheduler compares the measured read latency against when it adapts the number
+// of requests that it lets GC and background I/O keep in flight.
+#define IO_SCHEDULER_INTERACTIVE_TARGET_MS        10
+#define IO_SCHEDULER_FLUSH_DEADLINE_MS            50
+#define IO_SCHEDULER_GC_DEADLINE_MS               500
+#define IO_SCHEDULER_BACKGROUND_DEADLINE_MS       1000
+
+// While interactive or flush requests are in flight, GC and background requests are
+// each limited to this many requests per second (with bursts of up to
+// IO_SCHEDULER_THROTTLED_BURST requests).
+#define IO_SCHEDULER_THROTTLED_RATE               200
+#define IO_SCHEDULER_THROTTLED_BURST              16
+
+// How many requests the disk scheduler takes from the accounting queue ahead of
+// dispatching them, per allowed concurrent I/O request.  A larger window lets it
+// reorder more, at the cost of the accounting queue's proportional sharing.
+#define IO_SCHEDULER_WINDOW_FACTOR                2
+
+// A B-tree node doesn't get a key prefix index (see btree/key_prefix_index.hpp) if the
+// index would use more memory than this fraction of the node's block size.  The
+// indexes count toward the cache's memory limit.
+#define KEY_PREFIX_INDEX_MAX_SIZE_FRACTION        0.25
+
+// How full `btree_bulk_loader_t` (see btree/bulk_load.hpp) makes the nodes that it
+// builds.  Leaving some room lets later writes to the loaded keys go in without
+// splitting the nodes right away.
+#define BTREE_BULK_LOAD_FILL_FACTOR               0.9
+
+// Batches of inserts into an empty table with at least this many rows are written by
+// building the B-trees bottom up instead of inserting one row at a time.
+#define BTREE_BULK_LOAD_MIN_BATCH_SIZE            256
+
+// How many leaves one transaction empties when a range of a B-tree is erased by whole
+// subtrees (see btree/erase_subtrees.hpp).
+#define ERASE_SUBTREES_MAX_LEAVES_PER_TXN         32
+
 // I/O priority of index writes in the log serializer
 #define INDEX_WRITE_IO_PRIORITY                   128
 
@@ -61,11 +105,63 @@
 // perspective) if they are soft-durability or noreply writes.
 #define CACHE_READS_IO_PRIORITY                   (512 / CPU_SHARDING_FACTOR)
 
+// I/O priority of the reads that preload a cache from its manifest after a restart.
+// Lower than CACHE_READS_IO_PRIORITY so that the warm-up yields to real queries.
+#define CACHE_MANIFEST_WARM_UP_IO_PRIORITY        (CACHE_READS_IO_PRIORITY / 4)
+
+// How often each cache records its hottest block ids in its manifest, and the
+// maximum number of block ids that a manifest holds.
+#define CACHE_MANIFEST_WRITE_INTERVAL_MS          (60 * THOUSAND)
+#define CACHE_MANIFEST_MAX_BLOCKS                 (1024 * 1024)
+
+// How many blocks the cache warm-up reads from disk concurrently.  The reads are
+// issued in on-disk offset order, so the disk can serve them mostly sequentially.
+#define CACHE_MANIFEST_WARM_UP_BATCH_SIZE         64
+
 // The cache priority to use for secondary index post construction
 // 100 = same priority as all other read operations in the cache together.
 // 0 = minimal priority
 #define SINDEX_POST_CONSTRUCTION_CACHE_PRIORITY   5
 
+// How many rows secondary index post construction puts into the indexes in one write
+// transaction, and how many rows of such a chunk it evaluates on a thread at least.
+#define SINDEX_POST_CONSTRUCTION_CHUNK_SIZE       64
+#define SINDEX_POST_CONSTRUCTION_MIN_ROWS_PER_THREAD 8
+
+// A new client connection stays on the thread that accepted it, unless that thread has
+// more than this many connections more than the thread with the fewest connections.
+#define CLIENT_CONNECTION_THREAD_SLACK            2
+
+// How many query shapes every thread keeps compiled (see
+// rdb_protocol/compiled_query_cache.hpp).
+#define COMPILED_QUERY_CACHE_SIZE                 256
+
+// How many rows a shard buffers for an aggregation like `sum("field")` before it
+// accumulates them in one go (see `terminal_t` in rdb_protocol/shards.cc).
+#define ACCUMULATOR_BATCH_SIZE                    256
+
+// An `orderBy` without an index sorts up to this many bytes of rows in memory.  Bigger
+// sorts are cut into runs of this size, which are sorted on other threads and written
+// to a temporary file in the data directory (see
+// rdb_protocol/datum_stream/external_sort.hpp).
+#define EXTERNAL_SORT_RUN_SIZE                    (16 * MEGABYTE)
+
+// At most this many runs of a sort (and no more than there are threads) are sorted at
+// the same time, each on its own thread.
+#define EXTERNAL_SORT_MAX_SORTING_RUNS            4
+
+// The sorted runs are written and read back in chunks of about this many bytes.
+#define EXTERNAL_SORT_CHUNK_SIZE                  (64 * KILOBYTE)
+
+// At most this many sorted runs are merged at once, with one chunk of each in memory.
+// More runs than that are first merged into fewer, longer runs.
+#define EXTERNAL_SORT_MAX_MERGE_WIDTH             16
+
+// Every store keeps up to this many bytes of the results of the reads that were run
+// with `result_cache: true`, and no result bigger than an eighth of that (see
+// rdb_protocol/read_result_cache.hpp).
+#define READ_RESULT_CACHE_SIZE                    (4 * MEGABYTE)
+
 // Size of the buffer used to perform IO operations (in bytes).
 #define IO_BUFFER_SIZE                            (4 * KILOBYTE)
 
@@ -86,6 +182,26 @@
 // Ratio of free ram to use for the cache by default
 #define DEFAULT_MAX_CACHE_RATIO                   2
 
+// The largest fraction of the total cache size that the cache balancer sets aside for
+// the compressed page tiers of the caches (see buffer_cache/compressed_page_tier.hpp).
+// They get this fraction times the fraction of memory that compressing the evicted
+// blocks saves, so the caches keep all of their memory until blocks get evicted, and
+// if the blocks don't compress.  Set to 0 to disable the tier.
+#define COMPRESSED_PAGE_TIER_CACHE_FRACTION       0.2
+
+// While a compressed page tier has no room for a block, one in this many evicted
+// blocks is still compressed, to measure how well the blocks compress.
+#define COMPRESSED_PAGE_TIER_SAMPLE_INTERVAL      16
+
+// Fraction of the memory limit of a cache that the blocks of large values (the aux
+// blocks of blobs) may take before they are the first to go when the cache is over
+// its limit, so that reading large values doesn't evict the B-tree.
+#define LARGE_VALUE_CACHE_FRACTION                0.25
+
+// Evicted blocks that don't compress to at most this fraction of their size are
+// not kept in the compressed page tier.
+#define COMPRESSED_PAGE_TIER_MAX_COMPRESSION_RATIO 0.75
+
 // The maximum number of concurrently active
 // index writes per merger serializer.
 // The smaller the number, the more effective
@@ -137,6 +253,16 @@
 // How many block ids should the LBA garbage collector rewrite before yielding?
 #define LBA_GC_BATCH_SIZE                         (1024 * 8)
 
+// If the LBA extents of a shard that are not covered by its LBA snapshot exceed
+// LBA_MIN_SIZE_FOR_SNAPSHOT, we write a new snapshot for the shard, as long as the
+// snapshot is at most LBA_MAX_SNAPSHOT_SIZE_FRACTION of the size of the extents
+// that it lets us skip at startup.
+#define LBA_MIN_SIZE_FOR_SNAPSHOT                 (MEGABYTE * 64)
+#define LBA_MAX_SNAPSHOT_SIZE_FRACTION            0.5
+
+// How many block ids should the LBA snapshot writer copy before yielding?
+#define LBA_SNAPSHOT_BATCH_SIZE                   (1024 * 8)
+
 // How many LBA structures to have for each file
 #define LBA_SHARD_FACTOR                          4
 
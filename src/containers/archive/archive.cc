@@ -81,6 +81,10 @@ void write_message_t::append(const void *p, int64_t n) {
     }
 }
 
+void write_message_t::append_and_clear(write_message_t *other) {
+    buffers_.append_and_clear(&other->buffers_);
+}
+
 size_t write_message_t::size() const {
     size_t ret = 0;
     for (write_buffer_t *h = buffers_.head(); h != nullptr; h = buffers_.next(h)) {
@@ -117,6 +117,9 @@ public:
 
     void append(const void *p, int64_t n);
 
+    // Moves the buffers of `other` to the end of this message, without copying them.
+    void append_and_clear(write_message_t *other);
+
     size_t size() const;
 
     intrusive_list_t<write_buffer_t> *unsafe_expose_buffers() { return &buffers_; }
@@ -7,6 +7,8 @@
 #include <optional>
 #include <infinity/infinity.h>
 #include <random>
+#include <unordered_map>
+#include <vector>
 
 #define CLIENT_BUFFER_SIZE (64 * 1024) // 64 KB buffer size
 #define MAX_METADATA_BLOCKS 177700
@@ -265,6 +265,70 @@ void perfmon_stddev_t::record(double value) {
     thread_data[get_thread_id().threadnum].value.add(value);
 }
 
+/* perfmon_histogram_t */
+
+histogram_t::histogram_t() {
+    std::fill(counts, counts + NUM_BUCKETS, 0);
+}
+
+void histogram_t::add(double value) {
+    int bucket = 0;
+    double upper = 1;
+    while (bucket < NUM_BUCKETS - 1 && value > upper) {
+        ++bucket;
+        upper *= 2;
+    }
+    ++counts[bucket];
+}
+
+void histogram_t::merge(const histogram_t &other) {
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        counts[i] += other.counts[i];
+    }
+}
+
+perfmon_histogram_t::perfmon_histogram_t(int n_threads)
+    : perfmon_perthread_t<perfmon_histogram_t>(),
+      thread_data(new cache_line_padded_t<histogram_t>[n_threads]()) { }
+
+void perfmon_histogram_t::get_thread_stat(histogram_t *stat) {
+    rassert(get_thread_id().threadnum >= 0);
+    *stat = thread_data[get_thread_id().threadnum].value;
+}
+
+histogram_t perfmon_histogram_t::combine_stats(const histogram_t *stats) {
+    histogram_t total;
+    for (int i = 0; i < get_num_threads(); ++i) {
+        total.merge(stats[i]);
+    }
+    return total;
+}
+
+ql::datum_t perfmon_histogram_t::output_stat(const histogram_t &stat) {
+    // Only non-empty buckets are reported, keyed by their inclusive upper bound.
+    ql::datum_object_builder_t builder;
+    int64_t total = 0;
+    double upper = 1;
+    for (int i = 0; i < histogram_t::NUM_BUCKETS; ++i) {
+        total += stat.counts[i];
+        if (stat.counts[i] != 0) {
+            std::string key = i == histogram_t::NUM_BUCKETS - 1
+                ? std::string("inf")
+                : strprintf("le_%.0f", upper);
+            builder.overwrite(key.c_str(),
+                              ql::datum_t(static_cast<double>(stat.counts[i])));
+        }
+        upper *= 2;
+    }
+    builder.overwrite(stat_count, ql::datum_t(static_cast<double>(total)));
+    return std::move(builder).to_datum();
+}
+
+void perfmon_histogram_t::record(double value) {
+    rassert(get_thread_id().threadnum >= 0);
+    thread_data[get_thread_id().threadnum].value.add(value);
+}
+
 /* perfmon_rate_monitor_t */
 
 perfmon_rate_monitor_t::perfmon_rate_monitor_t(ticks_t _length, int n_threads)
@@ -185,6 +185,39 @@ private:
     std::unique_ptr<cache_line_padded_t<stddev_t>[]> thread_data;
 };
 
+/* `perfmon_histogram_t` counts recorded values in power-of-two buckets, for
+ * distributions (such as batch sizes or latencies) whose shape matters more than
+ * their mean.  Bucket 0 counts values up to 1, bucket `i` values in
+ * (2^(i-1), 2^i], and the last bucket everything larger.  Counts accumulate since
+ * startup, like `perfmon_counter_t`.
+ */
+struct histogram_t {
+    static const int NUM_BUCKETS = 32;
+
+    histogram_t();
+    void add(double value);
+    void merge(const histogram_t &other);
+
+    int64_t counts[NUM_BUCKETS];
+};
+
+class perfmon_histogram_t : public perfmon_perthread_t<perfmon_histogram_t> {
+public:
+    using thread_stat_type = histogram_t;
+    using combined_stat_type = histogram_t;
+
+    explicit perfmon_histogram_t(int n_threads);
+    void record(double value);
+
+private:
+    friend class perfmon_perthread_t<perfmon_histogram_t>;
+    void get_thread_stat(histogram_t *);
+    histogram_t combine_stats(const histogram_t *);
+    ql::datum_t output_stat(const histogram_t &);
+
+    std::unique_ptr<cache_line_padded_t<histogram_t>[]> thread_data;
+};
+
 /* `perfmon_rate_monitor_t` keeps track of the number of times some event
  * happens per second. It is different from `perfmon_sampler_t` in that it does
  * not associate a number with each event, but you can record many events at
@@ -265,6 +265,15 @@ void serialize(write_message_t *wm, const batchspec_t &batchspec) {
 }
 INSTANTIATE_SERIALIZE_FOR_CLUSTER(batchspec_t);
 
+void batchspec_t::serialize_without_start_time(write_message_t *wm) const {
+    serialize<cluster_version_t::CLUSTER>(wm, batch_type);
+    serialize<cluster_version_t::CLUSTER>(wm, min_els);
+    serialize<cluster_version_t::CLUSTER>(wm, max_els);
+    serialize<cluster_version_t::CLUSTER>(wm, max_size);
+    serialize<cluster_version_t::CLUSTER>(wm, first_scaledown_factor);
+    serialize<cluster_version_t::CLUSTER>(wm, max_dur);
+}
+
 template<cluster_version_t W>
 archive_result_t deserialize(read_stream_t *s, batchspec_t *batchspec) {
     static_assert(
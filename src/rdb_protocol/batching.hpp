@@ -93,6 +93,10 @@ public:
     batchspec_t scale_down(int64_t divisor) const;
     batcher_t to_batcher() const;
 
+    // Serializes the batchspec without its start time, so that the reads that ask for
+    // the same batches serialize the same way.
+    void serialize_without_start_time(write_message_t *wm) const;
+
 private:
     // I made this private and accessible through a static function because it
     // was being accidentally default-initialized.
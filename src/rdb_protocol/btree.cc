@@ -11,7 +11,9 @@
 #include <string>
 #include <vector>
 
+#include "btree/bulk_load.hpp"
 #include "btree/concurrent_traversal.hpp"
+#include "btree/count.hpp"
 #include "btree/get_distribution.hpp"
 #include "btree/operations.hpp"
 #include "btree/reql_specific.hpp"
@@ -19,6 +21,7 @@
 #include "buffer_cache/serialize_onto_blob.hpp"
 #include "concurrency/coro_pool.hpp"
 #include "concurrency/new_mutex.hpp"
+#include "concurrency/pmap.hpp"
 #include "concurrency/queue/unlimited_fifo.hpp"
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/buffer_group_stream.hpp"
@@ -36,6 +39,8 @@
 #include "rdb_protocol/table_common.hpp"
 
 #include "debug.hpp"
+#include "math.hpp"
+#include "threading.hpp"
 
 rdb_value_sizer_t::rdb_value_sizer_t(max_block_size_t bs) : block_size_(bs) { }
 
@@ -67,7 +72,15 @@ block_magic_t rdb_value_sizer_t::btree_leaf_magic() const {
 max_block_size_t rdb_value_sizer_t::block_size() const { return block_size_; }
 
 bool btree_value_fits(max_block_size_t bs, int data_length, const rdb_value_t *value) {
-    return blob::ref_fits(bs, data_length, value->value_ref(), blob::btree_maxreflen);
+    int prefix_size = 0;
+    if (data_length >= 1 && value->has_covered_data()) {
+        if (data_length < COVERED_DATA_HEADER_SIZE) {
+            return false;
+        }
+        prefix_size = value->covered_data_prefix_size();
+    }
+    return blob::ref_fits(bs, data_length - prefix_size, value->value_ref(),
+                          blob::btree_maxreflen);
 }
 
 // Remember that secondary indexes and the main btree both point to the same rdb
@@ -124,7 +137,7 @@ void kv_location_delete(keyvalue_location_t *kv_location,
         mod_info_out->deleted.second.assign(
                 kv_location->value_as<rdb_value_t>()->value_ref(),
                 kv_location->value_as<rdb_value_t>()->value_ref()
-                + kv_location->value_as<rdb_value_t>()->inline_size(block_size));
+                + kv_location->value_as<rdb_value_t>()->value_ref_size(block_size));
     }
 
     // Detach/Delete
@@ -159,7 +172,7 @@ kv_location_set(keyvalue_location_t *kv_location,
     if (mod_info_out) {
         guarantee(mod_info_out->added.second.empty());
         mod_info_out->added.second.assign(new_value->value_ref(),
-            new_value->value_ref() + new_value->inline_size(block_size));
+            new_value->value_ref() + new_value->value_ref_size(block_size));
     }
 
     if (kv_location->value.has()) {
@@ -170,7 +183,7 @@ kv_location_set(keyvalue_location_t *kv_location,
             mod_info_out->deleted.second.assign(
                     kv_location->value_as<rdb_value_t>()->value_ref(),
                     kv_location->value_as<rdb_value_t>()->value_ref()
-                    + kv_location->value_as<rdb_value_t>()->inline_size(block_size));
+                    + kv_location->value_as<rdb_value_t>()->value_ref_size(block_size));
         }
     }
 
@@ -606,13 +619,15 @@ public:
                        key_range_t *_active_region_range_inout,
                        reql_version_t wire_func_reql_version,
                        ql::map_wire_func_t wire_func,
-                       sindex_multi_bool_t _multi)
+                       sindex_multi_bool_t _multi,
+                       bool _covered)
         : pkey_range(std::move(_pkey_range)),
           datumspec(std::move(_datumspec)),
           active_region_range_inout(_active_region_range_inout),
           func_reql_version(wire_func_reql_version),
           func(wire_func.compile_wire_func()),
-          multi(_multi) {
+          multi(_multi),
+          covered(_covered) {
         datumspec.visit<void>(
             [&](const ql::datum_range_t &r) {
                 lbound_trunc_key = r.get_left_bound_trunc_key(func_reql_version);
@@ -628,6 +643,9 @@ private:
     const reql_version_t func_reql_version;
     const counted_t<const ql::func_t> func;
     const sindex_multi_bool_t multi;
+    // Whether the included fields of the entries of a covering index are all that
+    // the query needs of the rows (see `query_is_covered()`).
+    const bool covered;
     // The (truncated) boundary keys for the datum range stored in `datumspec`.
     std::string lbound_trunc_key;
     std::string rbound_trunc_key;
@@ -657,6 +675,13 @@ public:
             transformers.push_back(ql::make_op(_transforms[i]));
         }
         guarantee(transformers.size() == _transforms.size());
+        if (!_transforms.empty()) {
+            const ql::filter_wire_func_t *filter =
+                boost::get<ql::filter_wire_func_t>(&_transforms[0]);
+            if (filter != nullptr) {
+                predicate = ql::serialized_predicate_t::compile(*filter);
+            }
+        }
     }
     job_data_t(job_data_t &&) = default;
 
@@ -668,6 +693,9 @@ private:
     ql::env_t *const env;
     scoped_ptr_t<ql::batcher_t> batcher;
     std::vector<scoped_ptr_t<ql::op_t> > transformers;
+    // The first transform as a predicate on serialized rows, if it's a simple enough
+    // filter.
+    scoped_ptr_t<ql::serialized_predicate_t> predicate;
     sorting_t sorting;
     scoped_ptr_t<ql::accumulator_t> accumulator;
 };
@@ -695,8 +723,32 @@ public:
         const optional<std::string> &skey_left,
         concurrent_traversal_fifo_enforcer_signal_t waiter)
         THROWS_ONLY(interrupted_exc_t);
+    // Handles a row of a primary index read that `find_keyvalue_locations_for_read()`
+    // found, in order.
+    continue_bool_t handle_value(
+        const store_key_t &key,
+        const void *value,
+        buf_parent_t leaf,
+        size_t copies)
+        THROWS_ONLY(interrupted_exc_t);
     void finish(continue_bool_t last_cb) THROWS_ONLY(interrupted_exc_t);
 private:
+    // Doesn't load the rows that fail `job.predicate`, which only primary index reads
+    // run.
+    ql::datum_t load_value(const void *value,
+                           buf_parent_t leaf,
+                           ql::serialized_predicate_t::result_t *predicate_result_out);
+    // `sindex_val` is the value of the secondary index for the pair if it is
+    // already known, and empty otherwise.
+    continue_bool_t handle_loaded_pair(
+        const store_key_t &key,
+        const ql::datum_t &val,
+        const ql::datum_t &sindex_val,
+        ql::serialized_predicate_t::result_t predicate_result,
+        size_t default_copies,
+        const optional<std::string> &skey_left)
+        THROWS_ONLY(interrupted_exc_t);
+
     const rget_io_data_t io; // How do get data in/out.
     job_data_t job; // What to do next (stateful).
     const optional<rget_sindex_data_t> sindex; // Optional sindex information.
@@ -784,22 +836,86 @@ continue_bool_t rget_cb_t::handle_pair(
     if (sindex && !sindex->pkey_range.contains_key(ql::datum_t::extract_primary(key))) {
         return continue_bool_t::CONTINUE;
     }
-    lazy_btree_val_t row(static_cast<const rdb_value_t *>(keyvalue.value()),
-                         keyvalue.expose_buf());
-    ql::datum_t val;
     // Count stats whether or not we deserialize the value
     io.slice->stats.pm_keys_read.record();
     io.slice->stats.pm_total_keys_read += 1;
+    // The entries of covering indexes have the value of the index, and the included
+    // fields stand in for the row if the query needs no others.
+    ql::datum_t val;
+    ql::datum_t sindex_val;
+    ql::serialized_predicate_t::result_t predicate_result =
+        ql::serialized_predicate_t::result_t::UNKNOWN;
+    const rdb_value_t *rdb_value = static_cast<const rdb_value_t *>(keyvalue.value());
+    if (sindex && rdb_value->has_covered_data()) {
+        ql::datum_t included_fields;
+        get_covered_data(rdb_value, &sindex_val, &included_fields);
+        if (sindex->covered) {
+            io.slice->stats.pm_total_keys_covered += 1;
+            val = included_fields;
+        } else {
+            val = load_value(keyvalue.value(), keyvalue.expose_buf(), &predicate_result);
+        }
+    } else {
+        val = load_value(keyvalue.value(), keyvalue.expose_buf(), &predicate_result);
+    }
+    keyvalue.reset();
+    waiter.wait_interruptible(); // This enforces ordering.
+
+    return handle_loaded_pair(
+        key, val, sindex_val, predicate_result, default_copies, skey_left);
+}
+
+continue_bool_t rget_cb_t::handle_value(
+    const store_key_t &key,
+    const void *value,
+    buf_parent_t leaf,
+    size_t copies)
+    THROWS_ONLY(interrupted_exc_t) {
+    rassert(!sindex);
+    sampler->new_sample();
+    if (bad_init || boost::get<ql::exc_t>(&io.response->result) != nullptr) {
+        return continue_bool_t::ABORT;
+    }
+    // `find_keyvalue_locations_for_read()` already counted the key in the stats.
+    ql::serialized_predicate_t::result_t predicate_result;
+    ql::datum_t val = load_value(value, leaf, &predicate_result);
+    return handle_loaded_pair(
+        key, val, ql::datum_t(), predicate_result, copies, r_nullopt);
+}
+
+ql::datum_t rget_cb_t::load_value(
+        const void *value,
+        buf_parent_t leaf,
+        ql::serialized_predicate_t::result_t *predicate_result_out) {
+    typedef ql::serialized_predicate_t::result_t result_t;
+    const rdb_value_t *rdb_value = static_cast<const rdb_value_t *>(value);
+    *predicate_result_out = job.predicate.has() && !sindex
+        ? test_data(rdb_value, leaf, *job.predicate)
+        : result_t::UNKNOWN;
+    // The rows that pass the predicate skip the filter it was compiled from.
+    const size_t num_transforms = job.transformers.size()
+        - (*predicate_result_out == result_t::UNKNOWN ? 0 : 1);
+    lazy_btree_val_t row(rdb_value, leaf);
+    ql::datum_t val;
     // We only load the value if we actually use it (`count` does not).
-    if (job.accumulator->uses_val() || job.transformers.size() != 0 || sindex) {
+    if (*predicate_result_out != result_t::FAIL
+        && (job.accumulator->uses_val() || num_transforms != 0 || sindex)) {
         val = row.get();
     } else {
         row.reset();
     }
     guarantee(!row.references_parent());
-    keyvalue.reset();
-    waiter.wait_interruptible(); // This enforces ordering.
+    return val;
+}
 
+continue_bool_t rget_cb_t::handle_loaded_pair(
+    const store_key_t &key,
+    const ql::datum_t &val,
+    const ql::datum_t &sindex_val,
+    ql::serialized_predicate_t::result_t predicate_result,
+    size_t default_copies,
+    const optional<std::string> &skey_left)
+    THROWS_ONLY(interrupted_exc_t) {
     ///////////////////////////////////////////////////////
     // STUFF THAT HAS TO HAPPEN IN ORDER GOES BELOW HERE //
     ///////////////////////////////////////////////////////
@@ -852,8 +968,8 @@ continue_bool_t rget_cb_t::handle_pair(
         // secondary index value, though many don't. We don't want to compute
         // it if we don't end up needing it, because that would be expensive.
         // So we provide a function that computes the secondary index value
-        // lazily the first time it's called.
-        ql::datum_t sindex_val_cache; // an empty `datum_t` until initialized
+        // lazily the first time it's called, unless the entry already had it.
+        ql::datum_t sindex_val_cache = sindex_val; // empty until initialized
         auto lazy_sindex_val = [&]() -> ql::datum_t {
             if (sindex && !sindex_val_cache.has()) {
                 sindex_val_cache =
@@ -976,9 +1092,18 @@ continue_bool_t rget_cb_t::handle_pair(
             }
         }
 
-        ql::groups_t data = {{ql::datum_t(), ql::datums_t(copies, val)}};
+        // The rows that fail the predicate are left out here, rather than by the
+        // filter, so that the accumulator still sees their keys.
+        typedef ql::serialized_predicate_t::result_t result_t;
+        ql::groups_t data = {{
+            ql::datum_t(),
+            ql::datums_t(predicate_result == result_t::FAIL ? 0 : copies, val)}};
 
-        for (auto it = job.transformers.begin(); it != job.transformers.end(); ++it) {
+        auto first_transformer = job.transformers.begin();
+        if (predicate_result != result_t::UNKNOWN) {
+            ++first_transformer;
+        }
+        for (auto it = first_transformer; it != job.transformers.end(); ++it) {
             (**it)(job.env, &data, lazy_sindex_val);
         }
         // We need lots of extra data for the accumulation because we might be
@@ -1026,6 +1151,19 @@ void rdb_rget_slice(
         "Do range scan on primary index.",
         ql_env->trace);
 
+    // A plain count doesn't need to look at the rows.
+    if (!primary_keys.has_value() && transforms.empty() && terminal.has_value()
+        && boost::get<ql::count_wire_func_t>(&*terminal) != nullptr) {
+        const int64_t count = btree_count_in_range(
+            superblock, range, release_superblock, ql_env->interruptor);
+        ql::grouped_t<uint64_t> result;
+        if (count != 0) {
+            result[ql::datum_t()] = count;
+        }
+        response->result = std::move(result);
+        return;
+    }
+
     rget_cb_t callback(
         rget_io_data_t(response, slice),
         job_data_t(ql_env,
@@ -1043,34 +1181,23 @@ void rdb_rget_slice(
     direction_t direction = reversed(sorting) ? BACKWARD : FORWARD;
     continue_bool_t cont = continue_bool_t::CONTINUE;
     if (primary_keys.has_value()) {
-        auto cb = [&](const std::pair<store_key_t, uint64_t> &pair, bool is_last) {
-            rget_cb_wrapper_t wrapper(&callback, pair.second, r_nullopt);
-            return btree_concurrent_traversal(
-                superblock,
-                key_range_t::one_key(pair.first),
-                &wrapper,
-                direction,
-                is_last ? release_superblock : release_superblock_t::KEEP);
-        };
-        if (!reversed(sorting)) {
-            for (auto it = primary_keys->begin(); it != primary_keys->end();) {
-                auto this_it = it++;
-                if (cb(*this_it, it == primary_keys->end()) == continue_bool_t::ABORT) {
-                    // If required the superblock will get released further up the stack.
-                    cont = continue_bool_t::ABORT;
-                    break;
-                }
-            }
-        } else {
-            for (auto it = primary_keys->rbegin(); it != primary_keys->rend();) {
-                auto this_it = it++;
-                if (cb(*this_it, it == primary_keys->rend()) == continue_bool_t::ABORT) {
-                    // If required the superblock will get released further up the stack.
-                    cont = continue_bool_t::ABORT;
-                    break;
-                }
-            }
+        // Look up all keys in one descent of the tree instead of one per key.
+        std::vector<const btree_key_t *> keys;
+        std::vector<uint64_t> copies;
+        keys.reserve(primary_keys->size());
+        copies.reserve(primary_keys->size());
+        for (const auto &pair : *primary_keys) {
+            keys.push_back(pair.first.btree_key());
+            copies.push_back(pair.second);
         }
+        rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
+        cont = find_keyvalue_locations_for_read(
+            &sizer, superblock, keys, direction, release_superblock,
+            [&](size_t index, const void *value, buf_parent_t leaf) {
+                return callback.handle_value(
+                    store_key_t(keys[index]), value, leaf, copies[index]);
+            },
+            &slice->stats, ql_env->trace);
     } else {
         rget_cb_wrapper_t wrapper(&callback, 1, r_nullopt);
         cont = btree_concurrent_traversal(
@@ -1079,6 +1206,35 @@ void rdb_rget_slice(
     callback.finish(cont);
 }
 
+// Whether a query with the transformations `transforms` and the terminal `terminal`
+// needs nothing of the rows but the fields `include`.  That is the case if it filters
+// them on these fields and then maps them to something made of these fields (which
+// `pluck()` does too), or counts them.
+bool query_is_covered(const std::set<std::string> &include,
+                      const std::vector<transform_variant_t> &transforms,
+                      const optional<terminal_variant_t> &terminal) {
+    if (include.empty()) {
+        return false;
+    }
+    for (const transform_variant_t &transform : transforms) {
+        if (const auto *filter = boost::get<ql::filter_wire_func_t>(&transform)) {
+            // The default value of a filter takes no argument.
+            if (!filter->filter_func.only_gets_fields(include)) {
+                return false;
+            }
+        } else if (const auto *map = boost::get<ql::map_wire_func_t>(&transform)) {
+            return map->only_gets_fields(include);
+        } else if (const auto *concatmap =
+                       boost::get<ql::concatmap_wire_func_t>(&transform)) {
+            return concatmap->only_gets_fields(include);
+        } else {
+            return false;
+        }
+    }
+    return terminal.has_value()
+        && boost::get<ql::count_wire_func_t>(&*terminal) != nullptr;
+}
+
 void rdb_rget_secondary_slice(
         btree_slice_t *slice,
         const region_t &shard,
@@ -1124,7 +1280,8 @@ void rdb_rget_secondary_slice(
             &active_region_range,
             sindex_func_reql_version,
             sindex_info.mapping,
-            sindex_info.multi)));
+            sindex_info.multi,
+            query_is_covered(sindex_info.include, transforms, terminal))));
 
     direction_t direction = reversed(sorting) ? BACKWARD : FORWARD;
     auto cb = [&](const std::pair<ql::datum_range_t, uint64_t> &pair, bool is_last) {
@@ -1394,6 +1551,7 @@ void rdb_modification_report_cb_t::on_mod_report(
     new_mutex_in_line_t *sindex_spot,
     rwlock_in_line_t *cfeed_stamp_spot) {
     if (report.info.deleted.first.has() || report.info.added.first.has()) {
+        store_->read_results.invalidate(report.primary_key);
         // We spawn the sindex update in its own coroutine because we don't want to
         // hold the sindex update for the changefeed update or vice-versa.
         cond_t sindexes_updated_cond, keys_available_cond;
@@ -1610,6 +1768,31 @@ void compute_keys(const store_key_t &primary_key,
     }
 }
 
+ql::datum_t get_included_fields(const sindex_disk_info_t &index_info,
+                                const ql::datum_t &row) {
+    if (index_info.include.empty() || row.get_type() != ql::datum_t::R_OBJECT) {
+        return ql::datum_t();
+    }
+    ql::datum_object_builder_t included;
+    for (const std::string &field : index_info.include) {
+        ql::datum_t value = row.get_field(datum_string_t(field), ql::NOTHROW);
+        if (!value.has()) {
+            return ql::datum_t();
+        }
+        included.overwrite(datum_string_t(field), value);
+    }
+    return std::move(included).to_datum();
+}
+
+std::vector<char> make_sindex_value(const ql::datum_t &included_fields,
+                                    const ql::datum_t &index_value,
+                                    const std::vector<char> &value_ref) {
+    if (!included_fields.has()) {
+        return value_ref;
+    }
+    return make_covering_value(index_value, included_fields, value_ref);
+}
+
 void serialize_sindex_info(write_message_t *wm,
                            const sindex_disk_info_t &info) {
     serialize_cluster_version(wm, cluster_version_t::LATEST_DISK);
@@ -1623,6 +1806,7 @@ void serialize_sindex_info(write_message_t *wm,
     serialize<cluster_version_t::LATEST_DISK>(wm, info.mapping);
     serialize<cluster_version_t::LATEST_DISK>(wm, info.multi);
     serialize<cluster_version_t::LATEST_DISK>(wm, info.geo);
+    serialize<cluster_version_t::LATEST_DISK>(wm, info.include);
 }
 
 void deserialize_sindex_info(
@@ -1662,7 +1846,8 @@ void deserialize_sindex_info(
     case cluster_version_t::v2_1:
     case cluster_version_t::v2_2:
     case cluster_version_t::v2_3:
-    case cluster_version_t::v2_4_is_latest:
+    case cluster_version_t::v2_4:
+    case cluster_version_t::v2_5_is_latest:
         success = deserialize_reql_version(
                 &read_stream,
                 &info_out->mapping_version_info.original_reql_version,
@@ -1699,12 +1884,31 @@ void deserialize_sindex_info(
     case cluster_version_t::v2_1: // fallthru
     case cluster_version_t::v2_2: // fallthru
     case cluster_version_t::v2_3: // fallthru
-    case cluster_version_t::v2_4_is_latest:
+    case cluster_version_t::v2_4: // fallthru
+    case cluster_version_t::v2_5_is_latest:
         success = deserialize_for_version(cluster_version, &read_stream, &info_out->geo);
         throw_if_bad_deserialization(success, "sindex description");
         break;
     default: unreachable();
     }
+    switch (cluster_version) {
+    case cluster_version_t::v1_14: // fallthru
+    case cluster_version_t::v1_15: // fallthru
+    case cluster_version_t::v1_16: // fallthru
+    case cluster_version_t::v2_0: // fallthru
+    case cluster_version_t::v2_1: // fallthru
+    case cluster_version_t::v2_2: // fallthru
+    case cluster_version_t::v2_3: // fallthru
+    case cluster_version_t::v2_4:
+        info_out->include.clear();
+        break;
+    case cluster_version_t::v2_5_is_latest:
+        success = deserialize_for_version(
+            cluster_version, &read_stream, &info_out->include);
+        throw_if_bad_deserialization(success, "sindex description");
+        break;
+    default: unreachable();
+    }
     guarantee(static_cast<size_t>(read_stream.tell()) == data.size(),
               "An sindex description was incompletely deserialized.");
 }
@@ -1840,6 +2044,7 @@ void rdb_update_single_sindex(
         bool decremented_updates_left = false;
         try {
             ql::datum_t added = modification->info.added.first;
+            const ql::datum_t included = get_included_fields(sindex_info, added);
 
             std::vector<std::pair<store_key_t, ql::datum_t> > keys;
 
@@ -1888,7 +2093,10 @@ void rdb_update_single_sindex(
 
                     ql::serialization_result_t res =
                         kv_location_set(&kv_location, it->first,
-                                        modification->info.added.second,
+                                        make_sindex_value(
+                                            included,
+                                            it->second,
+                                            modification->info.added.second),
                                         repli_timestamp_t::distant_past,
                                         deletion_context);
                     // this particular context cannot fail AT THE MOMENT.
@@ -2009,6 +2217,240 @@ void rdb_update_sindexes(
     }
 }
 
+bool rdb_bulk_load_batched_insert(
+    store_t *store,
+    const btree_info_t &info,
+    scoped_ptr_t<real_superblock_t> *superblock,
+    buf_lock_t *sindex_block,
+    const std::vector<store_key_t> &keys,
+    const btree_batched_replacer_t *replacer,
+    ql::configured_limits_t limits,
+    batched_replace_response_t *response_out,
+    profile::sampler_t *sampler,
+    profile::trace_t *trace) {
+    if (keys.size() < BTREE_BULK_LOAD_MIN_BATCH_SIZE
+        || (*superblock)->get_root_block_id() != NULL_BLOCK_ID) {
+        return false;
+    }
+    if (!store->access_changefeed_servers().first->empty()) {
+        return false;
+    }
+    std::map<sindex_name_t, secondary_index_t> sindex_map;
+    get_secondary_indexes(sindex_block, &sindex_map);
+    for (const auto &pair : sindex_map) {
+        if (!pair.second.being_deleted && !pair.second.post_construction_complete()) {
+            // Its post construction would have to hear about the rows.
+            return false;
+        }
+    }
+
+    // The rows go into the tree in key order.
+    std::vector<size_t> order(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return keys[a] < keys[b];
+    });
+    for (size_t i = 1; i < order.size(); ++i) {
+        if (keys[order[i - 1]] == keys[order[i]]) {
+            return false;
+        }
+    }
+
+    sampler->new_sample();
+    PROFILE_STARTER_IF_ENABLED(
+        trace != nullptr,
+        "Bulk load the rows.",
+        trace);
+
+    // Compute, check and serialize every row before writing anything, so that batches
+    // with errors can still be left to `rdb_batched_replace()`, which reports them.
+    const ql::datum_t null = ql::datum_t::null();
+    std::vector<ql::datum_t> rows(keys.size());
+    std::vector<ql::datum_t> row_stats(keys.size());
+    std::vector<write_message_t> serialized_rows(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        try {
+            rows[i] = replacer->replace(null, i);
+            rcheck_row_replacement(info.primary_key, keys[i], null, rows[i]);
+            bool was_changed;
+            row_stats[i] = make_row_replacement_stats(
+                info.primary_key, keys[i], null, rows[i],
+                replacer->should_return_changes(), &was_changed);
+            if (!was_changed) {
+                return false;
+            }
+        } catch (const ql::base_exc_t &) {
+            return false;
+        }
+        if (ql::bad(datum_serialize(&serialized_rows[i], rows[i],
+                                    ql::check_datum_serialization_errors_t::YES))) {
+            return false;
+        }
+    }
+
+    store_t::sindex_access_vector_t sindexes;
+    store->acquire_all_sindex_superblocks_for_write(sindex_block, &sindexes);
+    for (const auto &sindex : sindexes) {
+        if (!sindex->sindex.being_deleted
+            && sindex->superblock->get_root_block_id() != NULL_BLOCK_ID) {
+            return false;
+        }
+    }
+
+    const max_block_size_t block_size = (*superblock)->cache()->max_block_size();
+    rdb_value_sizer_t sizer(block_size);
+    // The secondary indexes store the same values as the primary index (see
+    // `rdb_update_single_sindex()`).
+    std::vector<std::vector<char> > value_refs(keys.size());
+    {
+        btree_bulk_loader_t loader(&sizer, superblock->get(), info.timestamp);
+        scoped_malloc_t<rdb_value_t> value(blob::btree_maxreflen);
+        for (size_t i : order) {
+            memset(value.get(), 0, blob::btree_maxreflen);
+            {
+                blob_t blob(block_size, value->value_ref(), blob::btree_maxreflen);
+                write_onto_blob((*superblock)->expose_buf(), &blob, serialized_rows[i]);
+            }
+            value_refs[i].assign(value->value_ref(),
+                                 value->value_ref() + value->value_ref_size(block_size));
+            loader.add(keys[i].btree_key(), value.get());
+        }
+        loader.finish();
+    }
+    info.slice->stats.pm_keys_set.record(keys.size());
+    info.slice->stats.pm_total_keys_set += keys.size();
+    superblock->reset();
+
+    for (const auto &sindex : sindexes) {
+        // Like `rdb_update_single_sindex()`, we don't add anything to indexes that are
+        // being deleted.
+        if (sindex->sindex.being_deleted) {
+            continue;
+        }
+        sindex_disk_info_t sindex_info;
+        try {
+            deserialize_sindex_info_or_crash(sindex->sindex.opaque_definition,
+                                             &sindex_info);
+        } catch (const archive_exc_t &e) {
+            crash("%s", e.what());
+        }
+
+        struct entry_t {
+            store_key_t key;
+            size_t row;
+            ql::datum_t index_value;
+        };
+        std::vector<entry_t> entries;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            std::vector<std::pair<store_key_t, ql::datum_t> > sindex_keys;
+            try {
+                compute_keys(keys[i], rows[i], sindex_info, &sindex_keys, nullptr);
+            } catch (const ql::base_exc_t &) {
+                // The row isn't in the index.
+                continue;
+            }
+            for (auto &&pair : sindex_keys) {
+                entries.push_back(
+                    entry_t{std::move(pair.first), i, std::move(pair.second)});
+            }
+        }
+        std::stable_sort(entries.begin(), entries.end(),
+            [](const entry_t &a, const entry_t &b) {
+                return a.key < b.key;
+            });
+
+        btree_bulk_loader_t loader(&sizer, sindex->superblock.get(),
+                                   repli_timestamp_t::distant_past);
+        for (size_t j = 0; j < entries.size(); ++j) {
+            // If rows share a (truncated) index key, the last one wins, as it would
+            // if the rows were inserted in order.
+            if (j + 1 < entries.size() && entries[j].key == entries[j + 1].key) {
+                continue;
+            }
+            if (sindex_info.include.empty()) {
+                loader.add(entries[j].key.btree_key(),
+                           value_refs[entries[j].row].data());
+            } else {
+                std::vector<char> value = make_sindex_value(
+                    get_included_fields(sindex_info, rows[entries[j].row]),
+                    entries[j].index_value,
+                    value_refs[entries[j].row]);
+                loader.add(entries[j].key.btree_key(), value.data());
+            }
+        }
+        loader.finish();
+    }
+
+    batched_replace_response_t stats = ql::datum_t::empty_object();
+    std::set<std::string> conditions;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        stats = stats.merge(row_stats[i], ql::stats_merge, limits, &conditions);
+    }
+    ql::datum_object_builder_t out(stats);
+    out.add_warnings(conditions, limits);
+    *response_out = std::move(out).to_datum();
+    return true;
+}
+
+namespace {
+
+// A row of the primary index that is waiting to be put into the secondary indexes.
+// It only holds plain bytes, so that it can be handed to another thread.
+struct post_construction_row_t {
+    store_key_t primary_key;
+    std::vector<char> data;
+    std::vector<char> value_ref;
+};
+
+struct post_construction_entry_t {
+    store_key_t key;
+    std::vector<char> value;
+};
+
+// Computes the entries of the rows in `rows` for the index that `opaque_definition`
+// defines.  This can run on any thread, because it deserializes its own copies of the
+// index function and of the rows.
+void compute_post_construction_entries(
+        const std::vector<char> &opaque_definition,
+        const std::vector<post_construction_row_t> &rows,
+        size_t begin,
+        size_t end,
+        std::vector<post_construction_entry_t> *entries_out) {
+    sindex_disk_info_t sindex_info;
+    try {
+        deserialize_sindex_info_or_crash(opaque_definition, &sindex_info);
+    } catch (const archive_exc_t &e) {
+        crash("%s", e.what());
+    }
+    for (size_t i = begin; i < end; ++i) {
+        ql::datum_t row;
+        buffer_read_stream_t read_stream(rows[i].data.data(), rows[i].data.size());
+        archive_result_t res = datum_deserialize(&read_stream, &row);
+        guarantee_deserialization(res, "rdb value");
+        try {
+            std::vector<std::pair<store_key_t, ql::datum_t> > keys;
+            compute_keys(rows[i].primary_key, row, sindex_info, &keys, nullptr);
+            const ql::datum_t included = get_included_fields(sindex_info, row);
+            for (auto &&pair : keys) {
+                entries_out->push_back(post_construction_entry_t{
+                    std::move(pair.first),
+                    make_sindex_value(included, pair.second, rows[i].value_ref)});
+            }
+        } catch (const ql::base_exc_t &) {
+            // Do nothing (we just drop the row from the index, as
+            // `rdb_update_single_sindex()` does).
+        }
+    }
+}
+
+}  // namespace
+
+/* The rows of the primary index are collected in key order into chunks of
+`SINDEX_POST_CONSTRUCTION_CHUNK_SIZE`.  The index functions of a chunk are evaluated on
+all threads at once, and the entries of every index are sorted before they go into the
+index, so that entries that go to the same leaf are written one after another. */
 class post_construct_traversal_helper_t : public concurrent_traversal_callback_t {
 public:
     post_construct_traversal_helper_t(
@@ -2023,20 +2465,7 @@ public:
           interruptor_(interruptor),
           check_should_abort_(check_should_abort),
           pairs_constructed_(0),
-          stopped_before_completion_(false),
-          current_chunk_size_(0) {
-        // Start an initial write transaction for the first chunk.
-        // (this acquisition should never block)
-        new_mutex_acq_t wtxn_acq(&wtxn_lock_);
-        start_write_transaction(&wtxn_acq);
-    }
-
-    ~post_construct_traversal_helper_t() {
-        sindexes_.clear();
-        if (wtxn_.has()) {
-            wtxn_->commit();
-        }
-    }
+          stopped_before_completion_(false) { }
 
     continue_bool_t handle_pair(
             scoped_key_value_t &&keyvalue,
@@ -2051,63 +2480,24 @@ public:
         store_->btree->stats.pm_keys_read.record();
         store_->btree->stats.pm_total_keys_read += 1;
 
-        // Grab the key and value and construct a modification report for the key/value
-        // pair.
-        const store_key_t primary_key(keyvalue.key());
+        // Load the row.  This is done concurrently for many rows.
         const rdb_value_t *rdb_value =
             static_cast<const rdb_value_t *>(keyvalue.value());
-        rdb_modification_report_t mod_report(primary_key);
         const max_block_size_t block_size =
             keyvalue.expose_buf().cache()->max_block_size();
-        mod_report.info.added
-            = std::make_pair(
-                get_data(rdb_value, buf_parent_t(keyvalue.expose_buf())),
-                std::vector<char>(rdb_value->value_ref(),
-                    rdb_value->value_ref() + rdb_value->inline_size(block_size)));
-
-        // Store the value into the secondary indexes
-        {
-            // We need this mutex because we don't want `wtxn` to be destructed,
-            // but also because only one coroutine can be traversing the indexes
-            // through `rdb_update_sindexes` at a time (or else the btree will get
-            // corrupted!).
-            new_mutex_acq_t wtxn_acq(&wtxn_lock_, interruptor_);
-            guarantee(wtxn_.has());
-            const rdb_post_construction_deletion_context_t deletion_context;
-            rdb_update_sindexes(store_,
-                                sindexes_,
-                                &mod_report,
-                                wtxn_.get(),
-                                &deletion_context,
-                                nullptr,
-                                nullptr,
-                                nullptr);
-        }
-
-        // Account for the sindex writes in the stats
-        store_->btree->stats.pm_keys_set.record(sindexes_.size());
-        store_->btree->stats.pm_total_keys_set += sindexes_.size();
-
-        // Update the traversed range boundary (everything below here will happen in
-        // key order).
-        // This can't be interrupted, because we have already called rdb_update_sindexes,
-        // so now we /must/ update traversed_right_bound.
+        post_construction_row_t row;
+        row.primary_key = store_key_t(keyvalue.key());
+        row.data = get_serialized_data(rdb_value, buf_parent_t(keyvalue.expose_buf()));
+        row.value_ref.assign(
+            rdb_value->value_ref(),
+            rdb_value->value_ref() + rdb_value->value_ref_size(block_size));
+
+        // Everything below here happens in key order, and for one row at a time.
         waiter.wait();
-        traversed_right_bound_ = primary_key;
-
-        // Release the write transaction and secondary index locks once we've reached the
-        // designated chunk size. Then acquire a new transaction once the previous one
-        // has been flushed.
-        {
-            new_mutex_acq_t wtxn_acq(&wtxn_lock_, interruptor_);
-            ++current_chunk_size_;
-            if (current_chunk_size_ >= MAX_CHUNK_SIZE) {
-                current_chunk_size_ = 0;
-                sindexes_.clear();
-                wtxn_->commit();
-                wtxn_.reset();
-                start_write_transaction(&wtxn_acq);
-            }
+        traversed_right_bound_ = row.primary_key;
+        rows_.push_back(std::move(row));
+        if (rows_.size() >= SINDEX_POST_CONSTRUCTION_CHUNK_SIZE) {
+            write_chunk();
         }
 
         ++pairs_constructed_;
@@ -2119,6 +2509,14 @@ public:
         }
     }
 
+    // Writes the rows of the last chunk.  Must be called once the traversal is over
+    // and wasn't interrupted.
+    void finish() THROWS_ONLY(interrupted_exc_t) {
+        if (!rows_.empty()) {
+            write_chunk();
+        }
+    }
+
     store_key_t get_traversed_right_bound() const {
         return traversed_right_bound_;
     }
@@ -2128,16 +2526,10 @@ public:
     }
 
 private:
-    // Number of key/value pairs we process before releasing the write transaction
-    // and waiting for the secondary index data to be flushed to disk.
-    // Also see the comment above `scoped_ptr_t<txn_t> wtxn;` below.
-    static const int MAX_CHUNK_SIZE = 32;
-
-    void start_write_transaction(new_mutex_acq_t *wtxn_acq) {
-        wtxn_acq->guarantee_is_holding(&wtxn_lock_);
-        guarantee(!wtxn_.has());
-
-        // Start a write transaction and acquire the secondary indexes
+    void write_chunk() THROWS_ONLY(interrupted_exc_t) {
+        // Start a write transaction and acquire the secondary indexes.  A transaction
+        // per chunk keeps other writes to the parts of the indexes that are already
+        // live from waiting on us for long, and keeps the cache out of throttling.
         write_token_t token;
         store_->new_write_token(&token);
 
@@ -2147,12 +2539,13 @@ private:
         // dirty page limit and bring down the whole table.
         // Other than that, the hard durability guarantee is not actually
         // needed here.
+        scoped_ptr_t<txn_t> txn;
         scoped_ptr_t<real_superblock_t> superblock;
         store_->acquire_superblock_for_write(
-                2 + MAX_CHUNK_SIZE,
+                2 + rows_.size(),
                 write_durability_t::HARD,
                 &token,
-                &wtxn_,
+                &txn,
                 &superblock,
                 interruptor_);
 
@@ -2169,23 +2562,83 @@ private:
 
         // Filter out indexes that are being deleted. No need to keep post-constructing
         // those.
-        guarantee(sindexes_.empty());
+        store_t::sindex_access_vector_t sindexes;
         for (auto &&access : all_sindexes) {
             if (!access->sindex.being_deleted) {
-                sindexes_.emplace_back(std::move(access));
+                sindexes.emplace_back(std::move(access));
             }
         }
-        if (sindexes_.empty()) {
+        if (sindexes.empty()) {
             // All indexes have been deleted. Interrupt the traversal.
             on_indexes_deleted_->pulse_if_not_already_pulsed();
         }
 
-        // We pretend that the indexes have been fully constructed, so that when we call
-        // `rdb_update_sindexes` above, it actually updates the range we're currently
-        // constructing. This is a bit hacky, but works.
-        for (auto &&access : sindexes_) {
-            access->sindex.needs_post_construction_range = key_range_t::empty();
+        // Split the rows into slices and compute the entries of every slice on a
+        // thread of its own, starting with this one.
+        const size_t num_slices = std::min<size_t>(
+            get_num_threads(),
+            ceil_divide(rows_.size(), SINDEX_POST_CONSTRUCTION_MIN_ROWS_PER_THREAD));
+        std::vector<std::vector<std::vector<post_construction_entry_t> > > entries(
+            sindexes.size(),
+            std::vector<std::vector<post_construction_entry_t> >(num_slices));
+        const int home_thread = get_thread_id().threadnum;
+        pmap(num_slices, [&](size_t slice) {
+            const size_t begin = rows_.size() * slice / num_slices;
+            const size_t end = rows_.size() * (slice + 1) / num_slices;
+            on_thread_t th(threadnum_t((home_thread + slice) % get_num_threads()));
+            for (size_t i = 0; i < sindexes.size(); ++i) {
+                compute_post_construction_entries(
+                    sindexes[i]->sindex.opaque_definition, rows_, begin, end,
+                    &entries[i][slice]);
+            }
+        });
+        rows_.clear();
+
+        // Store the entries into the secondary indexes in key order.  The rows come
+        // from a snapshot of the primary index, so the entries only have to be added.
+        const rdb_post_construction_deletion_context_t deletion_context;
+        for (size_t i = 0; i < sindexes.size(); ++i) {
+            std::vector<post_construction_entry_t> sorted;
+            for (auto &&slice : entries[i]) {
+                std::move(slice.begin(), slice.end(), std::back_inserter(sorted));
+            }
+            std::stable_sort(sorted.begin(), sorted.end(),
+                [](const post_construction_entry_t &a,
+                   const post_construction_entry_t &b) {
+                    return a.key < b.key;
+                });
+            superblock_t *sindex_superblock = sindexes[i]->superblock.get();
+            for (const post_construction_entry_t &entry : sorted) {
+                promise_t<superblock_t *> return_superblock_local;
+                {
+                    keyvalue_location_t kv_location;
+                    rdb_value_sizer_t sizer(
+                        sindex_superblock->cache()->max_block_size());
+                    find_keyvalue_location_for_write(
+                        &sizer,
+                        sindex_superblock,
+                        entry.key.btree_key(),
+                        repli_timestamp_t::distant_past,
+                        deletion_context.balancing_detacher(),
+                        &kv_location,
+                        nullptr,
+                        &return_superblock_local);
+                    ql::serialization_result_t res =
+                        kv_location_set(&kv_location, entry.key, entry.value,
+                                        repli_timestamp_t::distant_past,
+                                        &deletion_context);
+                    guarantee(!bad(res));
+                }
+                sindex_superblock = return_superblock_local.wait();
+            }
+
+            // Account for the sindex writes in the stats
+            store_->btree->stats.pm_keys_set.record(sorted.size());
+            store_->btree->stats.pm_total_keys_set += sorted.size();
         }
+
+        sindexes.clear();
+        txn->commit();
     }
 
     store_t *store_;
@@ -2200,19 +2653,8 @@ private:
     store_key_t traversed_right_bound_;
     bool stopped_before_completion_;
 
-    // We re-use a single write transaction and secondary index acquisition for a chunk
-    // of writes to get better efficiency when flushing the index writes to disk.
-    // We reset the transaction  after each chunk because large write transactions can
-    // cause the cache to go into throttling, and that would interfere with other
-    // transactions on this table.
-    // Another aspect to keep in mind is that if we hold the write lock on the sindexes
-    // for too long, other concurrent writes to parts of the secondary index that
-    // are already live will also be delayed.
-    scoped_ptr_t<txn_t> wtxn_;
-    store_t::sindex_access_vector_t sindexes_;
-    int current_chunk_size_;
-    // Controls access to `sindexes_` and `wtxn_`.
-    new_mutex_t wtxn_lock_;
+    // The rows of the current chunk.
+    std::vector<post_construction_row_t> rows_;
 };
 
 void post_construct_secondary_index_range(
@@ -2245,10 +2687,11 @@ void post_construct_secondary_index_range(
         interruptor,
         true /* USE_SNAPSHOT */);
 
-    // Note: This starts a write transaction, which might get throttled.
-    // It is important that we construct the `traversal_cb` *after* we've started
-    // the snapshotted read transaction, or otherwise we might deadlock in the presence
-    // of additional (unrelated) write transactions..
+    // Note: The `traversal_cb` starts a write transaction, which might get throttled,
+    // for every `SINDEX_POST_CONSTRUCTION_CHUNK_SIZE` rows that the traversal loads,
+    // and one more for the last rows in `finish()`.  They all start after the
+    // snapshotted read transaction, or otherwise we might deadlock in the presence of
+    // additional (unrelated) write transactions.
     post_construct_traversal_helper_t traversal_cb(
         store,
         sindex_ids_to_post_construct,
@@ -2270,6 +2713,7 @@ void post_construct_secondary_index_range(
         && (interruptor->is_pulsed() || on_index_deleted_interruptor.is_pulsed())) {
         throw interrupted_exc_t();
     }
+    traversal_cb.finish();
 
     // Update the left bound of the construction range
     if (!traversal_cb.stopped_before_completion()) {
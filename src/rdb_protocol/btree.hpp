@@ -121,6 +121,26 @@ batched_replace_response_t rdb_batched_replace(
     profile::sampler_t *sampler,
     profile::trace_t *trace);
 
+/* Inserts a batch of rows into an empty table by building its primary and secondary
+index trees bottom up (see btree/bulk_load.hpp) rather than inserting the rows one at a
+time, which is what initial loads of a table spend most of their time on.  Only large
+batches qualify, and only if nothing needs to hear about the rows one at a time: the
+table must have no changefeeds and no secondary indexes under construction, and every
+row must be valid and have a primary key of its own.  Returns false, without having
+written anything, if the batch doesn't qualify; the caller then has to do it with
+`rdb_batched_replace()`. */
+bool rdb_bulk_load_batched_insert(
+    store_t *store,
+    const btree_info_t &info,
+    scoped_ptr_t<real_superblock_t> *superblock,
+    buf_lock_t *sindex_block,
+    const std::vector<store_key_t> &keys,
+    const btree_batched_replacer_t *replacer,
+    ql::configured_limits_t limits,
+    batched_replace_response_t *response_out,
+    profile::sampler_t *sampler,
+    profile::trace_t *trace);
+
 void rdb_set(const store_key_t &key, ql::datum_t data,
              bool overwrite,
              btree_slice_t *slice, repli_timestamp_t timestamp,
@@ -262,15 +282,32 @@ struct sindex_disk_info_t {
     sindex_disk_info_t(const ql::map_wire_func_t &_mapping,
                        const sindex_reql_version_info_t &_mapping_version_info,
                        sindex_multi_bool_t _multi,
-                       sindex_geo_bool_t _geo) :
+                       sindex_geo_bool_t _geo,
+                       const std::set<std::string> &_include) :
         mapping(_mapping), mapping_version_info(_mapping_version_info),
-        multi(_multi), geo(_geo) { }
+        multi(_multi), geo(_geo), include(_include) { }
     ql::map_wire_func_t mapping;
     sindex_reql_version_info_t mapping_version_info;
     sindex_multi_bool_t multi;
     sindex_geo_bool_t geo;
+    // See `sindex_config_t::include`.
+    std::set<std::string> include;
 };
 
+/* Returns the object of the fields of `row` that the covering index `index_info`
+includes, or an empty datum if it isn't a covering index or `row` lacks some of the
+fields.  The entries of rows that lack some don't get any covered data, so that queries
+that get the missing fields load the row and fail as they would without it. */
+ql::datum_t get_included_fields(const sindex_disk_info_t &index_info,
+                                const ql::datum_t &row);
+
+/* Returns the value of the secondary index entry with the value `index_value` for a
+row with the blob reference `value_ref` and the included fields `included_fields`,
+which come from `get_included_fields()`. */
+std::vector<char> make_sindex_value(const ql::datum_t &included_fields,
+                                    const ql::datum_t &index_value,
+                                    const std::vector<char> &value_ref);
+
 void serialize_sindex_info(write_message_t *wm,
                            const sindex_disk_info_t &info);
 
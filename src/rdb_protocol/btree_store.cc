@@ -5,6 +5,7 @@
 
 #include "arch/runtime/coroutines.hpp"
 #include "btree/depth_first_traversal.hpp"
+#include "btree/erase_subtrees.hpp"
 #include "btree/leaf_node.hpp"
 #include "btree/node.hpp"
 #include "btree/operations.hpp"
@@ -14,6 +15,7 @@
 #include "buffer_cache/cache_balancer.hpp"
 #include "clustering/administration/issues/outdated_index.hpp"
 #include "concurrency/wait_any.hpp"
+#include "config/args.hpp"
 #include "containers/archive/buffer_stream.hpp"
 #include "containers/archive/vector_stream.hpp"
 #include "containers/archive/versioned.hpp"
@@ -87,16 +89,19 @@ store_t::store_t(const region_t &_region,
                  io_backender_t *io_backender,
                  const base_path_t &base_path,
                  namespace_id_t _table_id,
-                 update_sindexes_t _update_sindexes)
+                 update_sindexes_t _update_sindexes,
+                 const optional<std::string> &cache_manifest_path)
     : store_view_t(_region),
       perfmon_collection(),
       io_backender_(io_backender), base_path_(base_path),
       perfmon_collection_membership(parent_perfmon_collection, &perfmon_collection, perfmon_name),
+      read_results(&perfmon_collection, READ_RESULT_CACHE_SIZE),
       ctx(_ctx),
       table_id(_table_id),
       write_superblock_acq_semaphore(WRITE_SUPERBLOCK_ACQ_WAITERS_LIMIT)
 {
-    cache.init(new cache_t(serializer, balancer, &perfmon_collection));
+    cache.init(new cache_t(serializer, balancer, &perfmon_collection,
+                           cache_manifest_path));
     general_cache_conn.init(new cache_conn_t(cache.get()));
 
     if (create) {
@@ -194,12 +199,24 @@ void store_t::read(
     scoped_ptr_t<txn_t> txn;
     scoped_ptr_t<real_superblock_t> superblock;
 
+    const optional<std::string> cache_key =
+        read_result_cache_t::make_key(_read, interruptor);
+    // We must get the generation before the superblock, so that we can tell whether
+    // a write changed the rows before we got to read them.
+    const uint64_t cache_generation = read_results.generation();
+
     acquire_superblock_for_read(token, &txn, &superblock,
                                 interruptor,
                                 _read.use_snapshot());
     DEBUG_ONLY_CODE(metainfo->visit(
         superblock.get(), metainfo_checker.region, metainfo_checker.callback));
+    if (cache_key && read_results.lookup(*cache_key, response)) {
+        return;
+    }
     protocol_read(_read, response, superblock.get(), interruptor);
+    if (cache_key) {
+        read_results.insert(*cache_key, _read, cache_generation, *response);
+    }
 }
 
 void store_t::write(
@@ -214,6 +231,9 @@ void store_t::write(
         signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t) {
     assert_thread();
+    // The write's changes go through `read_results.invalidate()` in the
+    // `rdb_modification_report_cb_t`.
+    read_result_cache_t::change_t cache_change(&read_results);
 
     scoped_ptr_t<txn_t> txn;
     scoped_ptr_t<real_superblock_t> real_superblock;
@@ -239,6 +259,22 @@ void store_t::write(
     txn->commit();
 }
 
+/* Deletes the values of rows right away, which the deleters of
+`rdb_live_deletion_context_t` do in two steps when the secondary indexes still need the
+values in between. */
+class rdb_value_detach_and_deleter_t : public value_deleter_t {
+public:
+    explicit rdb_value_detach_and_deleter_t(const deletion_context_t *deletion_context)
+        : deletion_context_(deletion_context) { }
+    void delete_value(buf_parent_t leaf_node, const void *value) const {
+        deletion_context_->in_tree_deleter()->delete_value(leaf_node, value);
+        deletion_context_->post_deleter()->delete_value(
+            buf_parent_t(leaf_node.txn()), value);
+    }
+private:
+    const deletion_context_t *deletion_context_;
+};
+
 void store_t::reset_data(
         const binary_blob_t &zero_metainfo,
         const region_t &subregion,
@@ -248,6 +284,8 @@ void store_t::reset_data(
     guarantee(subregion.beg == get_region().beg && subregion.end == get_region().end);
     assert_thread();
     with_priority_t p(CORO_PRIORITY_RESET_DATA);
+    read_result_cache_t::change_t cache_change(&read_results);
+    read_results.clear();
 
     // Erase the data in small chunks
     always_true_key_tester_t key_tester;
@@ -278,15 +316,32 @@ void store_t::reset_data(
         rdb_live_deletion_context_t deletion_context;
         std::vector<rdb_modification_report_t> mod_reports;
         key_range_t deleted_range;
-        done_erasing = rdb_erase_small_range(btree.get(),
-                                             &key_tester,
-                                             subregion.inner,
-                                             superblock.get(),
-                                             &deletion_context,
-                                             &non_interruptor,
-                                             max_erased_per_pass,
-                                             &mod_reports,
-                                             &deleted_range);
+        std::map<sindex_name_t, secondary_index_t> sindexes;
+        get_secondary_indexes(&sindex_block, &sindexes);
+        if (sindexes.empty()) {
+            /* Without secondary indexes, nothing needs to know which rows go away, so
+            we can drop whole subtrees of the primary index at a time. */
+            rdb_value_sizer_t sizer(cache->max_block_size());
+            rdb_value_detach_and_deleter_t deleter(&deletion_context);
+            int64_t pairs_erased;
+            done_erasing = erase_subtrees_in_range(&sizer,
+                                                   superblock.get(),
+                                                   subregion.inner,
+                                                   ERASE_SUBTREES_MAX_LEAVES_PER_TXN,
+                                                   &deleter,
+                                                   &deleted_range,
+                                                   &pairs_erased);
+        } else {
+            done_erasing = rdb_erase_small_range(btree.get(),
+                                                 &key_tester,
+                                                 subregion.inner,
+                                                 superblock.get(),
+                                                 &deletion_context,
+                                                 &non_interruptor,
+                                                 max_erased_per_pass,
+                                                 &mod_reports,
+                                                 &deleted_range);
+        }
 
         region_t deleted_region(subregion.beg, subregion.end, deleted_range);
         metainfo->update(superblock.get(),
@@ -336,6 +391,7 @@ std::map<std::string, std::pair<sindex_config_t, sindex_status_t> > store_t::sin
         res->first.func_version = disk_info.mapping_version_info.original_reql_version;
         res->first.multi = disk_info.multi;
         res->first.geo = disk_info.geo;
+        res->first.include = disk_info.include;
 
         res->second.outdated =
             (disk_info.mapping_version_info.latest_compatible_reql_version !=
@@ -382,7 +438,8 @@ void store_t::sindex_create(
     version_info.original_reql_version = config.func_version;
     version_info.latest_compatible_reql_version = config.func_version;
     version_info.latest_checked_reql_version = reql_version_t::LATEST;
-    sindex_disk_info_t info(config.func, version_info, config.multi, config.geo);
+    sindex_disk_info_t info(config.func, version_info, config.multi, config.geo,
+                            config.include);
 
     write_message_t wm;
     serialize_sindex_info(&wm, info);
@@ -752,6 +809,22 @@ void store_t::clear_sindex_data(
         scoped_ptr_t<sindex_superblock_t> sindex_superblock
             = make_scoped<sindex_superblock_t>(std::move(sindex_superblock_lock));
 
+        if (pkey_range_to_clear == key_range_t::universe()) {
+            /* All of the index goes, so we can drop whole subtrees of it instead of
+            deleting it one key at a time.  Every pass starts over from the left, so
+            that the empty nodes that the previous ones left behind get merged and the
+            tree ends up as a single empty leaf, which `drop_sindex()` expects. */
+            key_range_t erased_range;
+            int64_t pairs_erased;
+            reached_end = continue_bool_t::ABORT == erase_subtrees_in_range(
+                sizer, sindex_superblock.get(), key_range_t::universe(),
+                ERASE_SUBTREES_MAX_LEAVES_PER_TXN, deletion_context->in_tree_deleter(),
+                &erased_range, &pairs_erased);
+            sindex_superblock.reset();
+            txn->commit();
+            continue;
+        }
+
         /* 1. Collect a bunch of keys to delete */
         clear_sindex_traversal_cb_t traversal_cb(pkey_range_to_clear);
         try {
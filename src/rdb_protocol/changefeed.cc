@@ -11,6 +11,7 @@
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/interruptor.hpp"
 #include "containers/archive/boost_types.hpp"
+#include "containers/archive/vector_stream.hpp"
 #include "rdb_protocol/artificial_table/backend.hpp"
 #include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/datum_stream.hpp"
@@ -506,6 +507,33 @@ struct stamped_msg_t {
 
 RDB_MAKE_SERIALIZABLE_3(stamped_msg_t, server_uuid, stamp, submsg);
 
+// Writes a `stamped_msg_t` whose `submsg` is already serialized, so that `send_all`
+// serializes a change once however many clients it sends it to.
+class stamped_msg_writer_t : public mailbox_write_callback_t {
+public:
+    stamped_msg_writer_t(const uuid_u &_server_uuid,
+                         uint64_t _stamp,
+                         const std::vector<char> *_serialized_submsg)
+        : server_uuid(_server_uuid),
+          stamp(_stamp),
+          serialized_submsg(_serialized_submsg) { }
+    void write(DEBUG_VAR cluster_version_t cluster_version, write_message_t *wm) {
+        rassert(cluster_version == cluster_version_t::CLUSTER);
+        serialize<cluster_version_t::CLUSTER>(wm, server_uuid);
+        serialize<cluster_version_t::CLUSTER>(wm, stamp);
+        wm->append(serialized_submsg->data(), serialized_submsg->size());
+    }
+#ifdef ENABLE_MESSAGE_PROFILER
+    const char *message_profiler_tag() const {
+        return "mailbox<stamped_msg_t>";
+    }
+#endif
+private:
+    uuid_u server_uuid;
+    uint64_t stamp;
+    const std::vector<char> *serialized_submsg;
+};
+
 // This function takes a `lock_t` to make sure you have one.  (We can't just
 // always acquire a drainer lock before sending because we sometimes send a
 // `stop_t` during destruction, and you can't acquire a drain lock on a draining
@@ -548,8 +576,24 @@ void server_t::send_all(
     }
     acq.reset();
     stamp_spot->reset(); // Done stamping, no need to hold onto it while we send.
+    if (stamps.empty()) {
+        return;
+    }
+
+    // Only the stamps differ between the clients, so we serialize the message once.
+    std::vector<char> serialized_msg;
+    {
+        write_message_t wm;
+        serialize<cluster_version_t::CLUSTER>(&wm, msg);
+        vector_stream_t stream;
+        stream.reserve(wm.size());
+        int res = send_write_message(&stream, &wm);
+        guarantee(res == 0);
+        stream.swap(&serialized_msg);
+    }
     for (const auto &pair : stamps) {
-        send(manager, pair.first, stamped_msg_t(uuid, pair.second, msg));
+        stamped_msg_writer_t writer(uuid, pair.second, &serialized_msg);
+        send_write(manager, pair.first, &writer);
     }
 }
 
@@ -2162,6 +2206,31 @@ counted_t<splice_stream_t> make_splice_stream(Args &&...args) {
     return make_counted<splice_stream_t>(std::forward<Args>(args)...);
 }
 
+// Whether a transform might call `r.now()`, whose value depends on the query.  The
+// transforms that `changes` doesn't accept are assumed to.
+class calls_now_visitor_t : public boost::static_visitor<bool> {
+public:
+    bool operator()(const map_wire_func_t &f) const {
+        return calls_now(f);
+    }
+    bool operator()(const filter_wire_func_t &f) const {
+        return calls_now(f.filter_func)
+            || (f.default_filter_val.has_value() && calls_now(*f.default_filter_val));
+    }
+    bool operator()(const concatmap_wire_func_t &f) const {
+        return calls_now(f);
+    }
+    template<class T>
+    bool operator()(const T &) const {
+        return true;
+    }
+private:
+    static bool calls_now(const wire_func_t &f) {
+        return !f.compile_wire_func()->is_deterministic().test(single_server_t::yes,
+                                                               constant_now_t::no);
+    }
+};
+
 class range_sub_t : public flat_sub_t {
 public:
     // Throws QL exceptions.
@@ -2192,6 +2261,9 @@ public:
         for (const auto &transform : spec.transforms) {
             ops.push_back(make_op(transform));
         }
+        if (has_ops()) {
+            ops_key = make_ops_key();
+        }
         store_keys = spec.datumspec.primary_key_map();
         if (!store_keys.has_value()) {
             store_key_range.set(spec.datumspec.covering_range().to_primary_keyrange());
@@ -2229,7 +2301,7 @@ public:
         }
     }
 
-    bool has_ops() { return ops.size() != 0; }
+    bool has_ops() const { return ops.size() != 0; }
 
     optional<datum_t> apply_ops(datum_t val) {
         guarantee(active());
@@ -2249,6 +2321,12 @@ public:
     optional<datum_t> maybe_apply_ops(datum_t val) {
         return has_ops() ? apply_ops(std::move(val)) : make_optional(std::move(val));
     }
+    // The subscriptions with the same `ops_key` transform every value the same way,
+    // so `msg_visitor_t` applies the ops of only one of them to each change.
+    const std::string &get_ops_key() const {
+        guarantee(has_ops());
+        return ops_key;
+    }
 
     bool update_stamp(const uuid_u &uuid, uint64_t new_stamp) final {
         guarantee(active());
@@ -2388,6 +2466,27 @@ public:
     const std::map<uuid_u, uint64_t> &get_next_stamps() { return next_stamps; }
     const std::map<uuid_u, uint64_t> &get_orig_stamps() { return orig_stamps; }
 private:
+    // The serialized transforms, along with the parts of `env` that they can depend
+    // on.  The variable ids in the transforms come from the client, so the same
+    // query from different clients may still get different keys.
+    std::string make_ops_key() {
+        write_message_t wm;
+        serialize<cluster_version_t::CLUSTER>(&wm, spec.transforms);
+        serialize<cluster_version_t::CLUSTER>(&wm, env->limits());
+        bool calls_now = false;
+        for (const auto &transform : spec.transforms) {
+            calls_now |= boost::apply_visitor(calls_now_visitor_t(), transform);
+        }
+        if (calls_now && env->get_deterministic_time().has()) {
+            serialize<cluster_version_t::CLUSTER>(&wm, env->get_deterministic_time());
+        }
+        vector_stream_t stream;
+        stream.reserve(wm.size());
+        int res = send_write_message(&stream, &wm);
+        guarantee(res == 0);
+        return std::string(stream.vector().begin(), stream.vector().end());
+    }
+
     scoped_ptr_t<env_t> make_env(env_t *outer_env) {
         // This is to support fake environments from the unit tests that don't
         // actually have a context.
@@ -2405,6 +2504,7 @@ private:
 
     scoped_ptr_t<env_t> env;
     std::vector<scoped_ptr_t<op_t> > ops;
+    std::string ops_key;
 
     // The stamp (see `stamped_msg_t`) associated with our `changefeed_stamp_t`
     // read.  We use these to make sure we don't see changes from writes before
@@ -2845,23 +2945,37 @@ public:
     void operator()(const msg_t::change_t &change) const {
         datum_t null = datum_t::null();
 
+        // The transformed `<new_val, old_val>` by `range_sub_t::get_ops_key()`, for
+        // each thread, so that the subscriptions with the same transforms share them.
+        std::vector<std::map<std::string, std::pair<datum_t, datum_t> > >
+            transformed(get_num_threads());
         feed->each_range_sub(*lock, [&](range_sub_t *sub) {
             datum_t new_val = null, old_val = null;
             if (!sub->active()) return;
             bool trivial = false;
             if (sub->has_ops()) {
-                if (change.new_val.has()) {
-                    if (optional<datum_t> d = sub->apply_ops(change.new_val)) {
-                        new_val = *d;
+                std::map<std::string, std::pair<datum_t, datum_t> > *vals =
+                    &transformed[get_thread_id().threadnum];
+                auto it = vals->find(sub->get_ops_key());
+                if (it != vals->end()) {
+                    new_val = it->second.first;
+                    old_val = it->second.second;
+                } else {
+                    if (change.new_val.has()) {
+                        if (optional<datum_t> d = sub->apply_ops(change.new_val)) {
+                            new_val = *d;
+                        }
                     }
-                }
-                if (!sub->active()) return;
-                if (change.old_val.has()) {
-                    if (optional<datum_t> d = sub->apply_ops(change.old_val)) {
-                        old_val = *d;
+                    if (!sub->active()) return;
+                    if (change.old_val.has()) {
+                        if (optional<datum_t> d = sub->apply_ops(change.old_val)) {
+                            old_val = *d;
+                        }
                     }
+                    if (!sub->active()) return;
+                    vals->insert(std::make_pair(sub->get_ops_key(),
+                                                std::make_pair(new_val, old_val)));
                 }
-                if (!sub->active()) return;
                 // Duplicate values are caught before being written to disk and
                 // don't generate a `mod_report`, but if we have transforms the
                 // values might have changed.
@@ -0,0 +1,181 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/compiled_query_cache.hpp"
+
+#include "arch/runtime/coroutines.hpp"
+#include "config/args.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/ql2proto.hpp"
+#include "rdb_protocol/term.hpp"
+#include "rdb_protocol/term_storage.hpp"
+
+namespace ql {
+
+// The minimum amount of stack space we require to be available on a coroutine
+// before walking into another term.
+const size_t MIN_SHAPE_STACK_SPACE = 16 * KILOBYTE;
+
+namespace {
+
+// Whether the terms of `type` only evaluate their arguments, and never look at their
+// sources, at compile time or at run time.  Their optional arguments are left alone,
+// except for the fields of `make_obj`.
+bool passes_parameters(Term::TermType type) {
+    switch (type) {
+    case Term::MAKE_ARRAY: // fallthru
+    case Term::MAKE_OBJ:   // fallthru
+    case Term::GET:        // fallthru
+    case Term::GET_ALL:    // fallthru
+    case Term::INSERT:     // fallthru
+    case Term::LIMIT:      // fallthru
+    case Term::NTH:        // fallthru
+    case Term::EQ:         // fallthru
+    case Term::NE:         // fallthru
+    case Term::LT:         // fallthru
+    case Term::LE:         // fallthru
+    case Term::GT:         // fallthru
+    case Term::GE:         // fallthru
+    case Term::ADD:        // fallthru
+    case Term::SUB:        // fallthru
+    case Term::MUL:        // fallthru
+    case Term::DIV:        return true;
+    default:               return false;
+    }
+}
+
+struct query_shape_t {
+    std::string key;
+    std::vector<datum_t> values;
+    std::vector<backtrace_id_t> bts;
+};
+
+void append_string(const std::string &s, std::string *key) {
+    *key += strprintf("%zu:", s.size());
+    *key += s;
+}
+
+// Appends the shape of `term` to `shape->key`, and the parameters in it to the others.
+// Returns false if the query can't be compiled with parameters.
+bool append_shape(const raw_term_t &term, bool parameter_ok, query_shape_t *shape) {
+    shape->key += strprintf("(%d", static_cast<int>(term.type()));
+    if (term.type() == Term::DATUM) {
+        const datum_t datum = term.datum();
+        std::string literal;
+        char type;
+        switch (datum.get_type()) {
+        case datum_t::R_NULL:
+            type = 'n';
+            break;
+        case datum_t::R_BOOL:
+            type = 'b';
+            literal = datum.as_bool() ? "t" : "f";
+            break;
+        case datum_t::R_NUM:
+            type = 'N';
+            literal = strprintf("%a", datum.as_num());
+            break;
+        case datum_t::R_STR:
+            type = 's';
+            append_string(datum.as_str().to_std(), &literal);
+            break;
+        default:
+            return false;
+        }
+        if (parameter_ok) {
+            shape->key += '?';
+            shape->key += type;
+            shape->values.push_back(datum);
+            shape->bts.push_back(term.bt());
+        } else {
+            shape->key += type;
+            shape->key += literal;
+        }
+        shape->key += ')';
+        return true;
+    }
+
+    const bool passes = parameter_ok && passes_parameters(term.type());
+    bool ok = true;
+    shape->key += '[';
+    for (size_t i = 0; i < term.num_args() && ok; ++i) {
+        call_with_enough_stack([&]() {
+                ok = append_shape(term.arg(i), passes, shape);
+            }, MIN_SHAPE_STACK_SPACE);
+    }
+    shape->key += "]{";
+    term.each_optarg([&](const raw_term_t &o, const std::string &name) {
+            if (ok) {
+                append_string(name, &shape->key);
+                call_with_enough_stack([&]() {
+                        ok = append_shape(o, passes && term.type() == Term::MAKE_OBJ,
+                                          shape);
+                    }, MIN_SHAPE_STACK_SPACE);
+            }
+        });
+    shape->key += "})";
+    return ok;
+}
+
+}  // namespace
+
+query_parameters_t::query_parameters_t(const std::vector<backtrace_id_t> &bts)
+    : compiled_(bts.size(), false), num_compiled_(0) {
+    for (size_t i = 0; i < bts.size(); ++i) {
+        DEBUG_VAR auto res = indices_.insert(std::make_pair(bts[i].get(), i));
+        rassert(res.second);
+    }
+}
+
+optional<size_t> query_parameters_t::compile(backtrace_id_t bt) {
+    auto it = indices_.find(bt.get());
+    if (it == indices_.end()) {
+        return r_nullopt;
+    }
+    if (!compiled_[it->second]) {
+        compiled_[it->second] = true;
+        ++num_compiled_;
+    }
+    return make_optional(it->second);
+}
+
+compiled_query_t::compiled_query_t(const rapidjson::Value &root,
+                                   const std::vector<backtrace_id_t> &parameter_bts) {
+    json.CopyFrom(root, json.GetAllocator());
+    query_parameters_t parameters(parameter_bts);
+    compile_env_t compile_env((var_visibility_t()), &parameters);
+    counted_t<const term_t> tree = compile_term(&compile_env, raw_term_t(&json));
+    if (parameters.all_compiled()) {
+        term_tree = std::move(tree);
+    }
+}
+
+compiled_query_t::~compiled_query_t() { }
+
+compiled_query_cache_t::compiled_query_cache_t()
+    : queries_(COMPILED_QUERY_CACHE_SIZE) { }
+
+compiled_query_cache_t::~compiled_query_cache_t() { }
+
+counted_t<const compiled_query_t> compiled_query_cache_t::get(
+        const raw_term_t &root, std::vector<datum_t> *parameters_out) {
+    const term_variant_t src = root.get_src();
+    const rapidjson::Value *const *json = boost::get<const rapidjson::Value *>(&src);
+    query_shape_t shape;
+    if (json == nullptr || !append_shape(root, true, &shape)) {
+        return counted_t<const compiled_query_t>();
+    }
+
+    counted_t<const compiled_query_t> *cached;
+    if (!queries_.lookup(shape.key, &cached)) {
+        // The shapes that can't be compiled with parameters are cached too, so that
+        // they are only tried once.
+        queries_.insert(shape.key, make_counted<compiled_query_t>(**json, shape.bts));
+        queries_.lookup(shape.key, &cached);
+    }
+    if (!(*cached)->term_tree.has()) {
+        return counted_t<const compiled_query_t>();
+    }
+    *parameters_out = std::move(shape.values);
+    return *cached;
+}
+
+}  // namespace ql
@@ -0,0 +1,89 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_COMPILED_QUERY_CACHE_HPP_
+#define RDB_PROTOCOL_COMPILED_QUERY_CACHE_HPP_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "containers/counted.hpp"
+#include "containers/lru_cache.hpp"
+#include "containers/optional.hpp"
+#include "rapidjson/document.h"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/error.hpp"
+
+namespace ql {
+
+class raw_term_t;
+class term_t;
+
+/* The literals of a query that are compiled into parameters, which take their values
+from the `env_t` that evaluates the query, rather than into `datum_term_t`s.  They are
+known by the backtraces of their terms, which are unique within a query. */
+class query_parameters_t {
+public:
+    explicit query_parameters_t(const std::vector<backtrace_id_t> &bts);
+
+    // Returns the index of the parameter of the DATUM term with the backtrace `bt`, if
+    // it is one, and remembers that it was compiled.
+    optional<size_t> compile(backtrace_id_t bt);
+
+    // Whether every parameter was compiled.  A term that compiles a literal some other
+    // way would keep the value of the query that was compiled.
+    bool all_compiled() const { return num_compiled_ == indices_.size(); }
+
+private:
+    std::map<uint32_t, size_t> indices_;
+    std::vector<bool> compiled_;
+    size_t num_compiled_;
+
+    DISABLE_COPYING(query_parameters_t);
+};
+
+/* The term tree of a query that was compiled with parameters.  It keeps a copy of the
+query, which its terms refer to. */
+class compiled_query_t : public single_threaded_countable_t<compiled_query_t> {
+public:
+    // Throws what `compile_term()` throws.
+    compiled_query_t(const rapidjson::Value &root,
+                     const std::vector<backtrace_id_t> &parameter_bts);
+    ~compiled_query_t();
+
+    // Empty if the query can't be compiled with parameters.
+    counted_t<const term_t> term_tree;
+
+private:
+    rapidjson::Document json;
+
+    DISABLE_COPYING(compiled_query_t);
+};
+
+/* The compiled queries of a thread by their shapes.  The shape of a query is the query
+with the literals that can be parameters left out, except for their types, so the
+queries that an application sends over and over with different values get compiled
+only once.  A literal can be a parameter if it's an argument of a chain of terms, up
+from the root, that only evaluate their arguments, such as `get`, `insert`, `eq` and
+`make_obj` (see `passes_parameters()`).  The literals in functions never are, because
+functions are shipped to the shards as their source. */
+class compiled_query_cache_t {
+public:
+    compiled_query_cache_t();
+    ~compiled_query_cache_t();
+
+    // Returns the compiled query for the preprocessed term tree `root`, and sets
+    // `*parameters_out` to its values of the parameters.  Returns an empty pointer if
+    // the query can't be compiled with parameters.  Throws what `compile_term()`
+    // throws.
+    counted_t<const compiled_query_t> get(const raw_term_t &root,
+                                          std::vector<datum_t> *parameters_out);
+
+private:
+    lru_cache_t<std::string, counted_t<const compiled_query_t> > queries_;
+
+    DISABLE_COPYING(compiled_query_cache_t);
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_COMPILED_QUERY_CACHE_HPP_
@@ -3,6 +3,7 @@
 
 #include "clustering/administration/metadata.hpp"
 #include "concurrency/cross_thread_watchable.hpp"
+#include "containers/archive/stl_types.hpp"
 #include "containers/archive/vector_stream.hpp"
 #include "rdb_protocol/query_cache.hpp"
 #include "rdb_protocol/datum.hpp"
@@ -11,7 +12,8 @@
 #include "time.hpp"
 
 bool sindex_config_t::operator==(const sindex_config_t &o) const {
-    if (func_version != o.func_version || multi != o.multi || geo != o.geo) {
+    if (func_version != o.func_version || multi != o.multi || geo != o.geo
+        || include != o.include) {
         return false;
     }
     /* This is kind of a hack--we compare the functions by serializing them and comparing
@@ -27,8 +29,73 @@ bool sindex_config_t::operator==(const sindex_config_t &o) const {
     return stream1.vector() == stream2.vector();
 }
 
-RDB_IMPL_SERIALIZABLE_4_SINCE_v2_1(sindex_config_t,
-    func, func_version, multi, geo);
+template <cluster_version_t W>
+void serialize(write_message_t *wm, const sindex_config_t &config) {
+    serialize<W>(wm, config.func);
+    serialize<W>(wm, config.func_version);
+    serialize<W>(wm, config.multi);
+    serialize<W>(wm, config.geo);
+    serialize<W>(wm, config.include);
+}
+
+INSTANTIATE_SERIALIZE_FOR_CLUSTER_AND_DISK(sindex_config_t);
+
+// Before v2.5, secondary indexes didn't include any fields.
+template <cluster_version_t W>
+archive_result_t deserialize_sindex_config_pre_v2_5(
+        read_stream_t *s, sindex_config_t *config) {
+    archive_result_t res = deserialize<W>(s, &config->func);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &config->func_version);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &config->multi);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &config->geo);
+    if (bad(res)) { return res; }
+    config->include.clear();
+    return res;
+}
+
+template <cluster_version_t W>
+archive_result_t deserialize(read_stream_t *s, sindex_config_t *config) {
+    archive_result_t res = deserialize<W>(s, &config->func);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &config->func_version);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &config->multi);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &config->geo);
+    if (bad(res)) { return res; }
+    res = deserialize<W>(s, &config->include);
+    return res;
+}
+
+template <>
+archive_result_t deserialize<cluster_version_t::v2_1>(
+        read_stream_t *s, sindex_config_t *config) {
+    return deserialize_sindex_config_pre_v2_5<cluster_version_t::v2_1>(s, config);
+}
+
+template <>
+archive_result_t deserialize<cluster_version_t::v2_2>(
+        read_stream_t *s, sindex_config_t *config) {
+    return deserialize_sindex_config_pre_v2_5<cluster_version_t::v2_2>(s, config);
+}
+
+template <>
+archive_result_t deserialize<cluster_version_t::v2_3>(
+        read_stream_t *s, sindex_config_t *config) {
+    return deserialize_sindex_config_pre_v2_5<cluster_version_t::v2_3>(s, config);
+}
+
+template <>
+archive_result_t deserialize<cluster_version_t::v2_4>(
+        read_stream_t *s, sindex_config_t *config) {
+    return deserialize_sindex_config_pre_v2_5<cluster_version_t::v2_4>(s, config);
+}
+
+template archive_result_t deserialize<cluster_version_t::v2_5_is_latest>(
+        read_stream_t *, sindex_config_t *);
 
 bool write_hook_config_t::operator==(const write_hook_config_t &o) const {
     if (func_version != o.func_version) {
@@ -83,6 +150,7 @@ rdb_context_t::rdb_context_t()
       cluster_interface(nullptr),
       manager(nullptr),
       reql_http_proxy(),
+      io_backender(nullptr),
       stats(&get_global_perfmon_collection()) { }
 
 rdb_context_t::rdb_context_t(
@@ -94,6 +162,7 @@ rdb_context_t::rdb_context_t(
       cluster_interface(_cluster_interface),
       manager(nullptr),
       reql_http_proxy(),
+      io_backender(nullptr),
       stats(&get_global_perfmon_collection()) {
     init_auth_watchables(auth_semilattice_view);
 }
@@ -105,11 +174,15 @@ rdb_context_t::rdb_context_t(
         std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t>>
             auth_semilattice_view,
         perfmon_collection_t *global_stats,
-        const std::string &_reql_http_proxy)
+        const std::string &_reql_http_proxy,
+        io_backender_t *_io_backender,
+        const base_path_t &_base_path)
     : extproc_pool(_extproc_pool),
       cluster_interface(_cluster_interface),
       manager(_mailbox_manager),
       reql_http_proxy(_reql_http_proxy),
+      io_backender(_io_backender),
+      base_path(_base_path),
       stats(global_stats) {
     init_auth_watchables(auth_semilattice_view);
 }
@@ -133,6 +206,10 @@ std::set<ql::query_cache_t *> *rdb_context_t::get_query_caches_for_this_thread()
     return query_caches.get();
 }
 
+ql::compiled_query_cache_t *rdb_context_t::get_compiled_query_cache_for_this_thread() {
+    return compiled_query_caches.get();
+}
+
 clone_ptr_t<watchable_t<auth_semilattice_metadata_t>>
         rdb_context_t::get_auth_watchable() const{
     return m_cross_thread_auth_watchables[get_thread_id().threadnum]->get_watchable();
@@ -17,8 +17,10 @@
 #include "containers/optional.hpp"
 #include "containers/scoped.hpp"
 #include "containers/uuid.hpp"
+#include "paths.hpp"
 #include "perfmon/perfmon.hpp"
 #include "protocol_api.hpp"
+#include "rdb_protocol/compiled_query_cache.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/geo/distances.hpp"
 #include "rdb_protocol/geo/lon_lat_types.hpp"
@@ -57,6 +59,7 @@ ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(
 class auth_semilattice_metadata_t;
 class ellipsoid_spec_t;
 class extproc_pool_t;
+class io_backender_t;
 class name_string_t;
 class namespace_interface_t;
 template <class> class cross_thread_watchable_variable_t;
@@ -74,8 +77,10 @@ class sindex_config_t {
 public:
     sindex_config_t() { }
     sindex_config_t(const ql::map_wire_func_t &_func, reql_version_t _func_version,
-            sindex_multi_bool_t _multi, sindex_geo_bool_t _geo) :
-        func(_func), func_version(_func_version), multi(_multi), geo(_geo) { }
+            sindex_multi_bool_t _multi, sindex_geo_bool_t _geo,
+            const std::set<std::string> &_include = std::set<std::string>()) :
+        func(_func), func_version(_func_version), multi(_multi), geo(_geo),
+        include(_include) { }
 
     bool operator==(const sindex_config_t &o) const;
     bool operator!=(const sindex_config_t &o) const {
@@ -86,6 +91,10 @@ public:
     reql_version_t func_version;
     sindex_multi_bool_t multi;
     sindex_geo_bool_t geo;
+    /* The fields of the row that a covering index stores in its entries, along with
+    the value of the index, so that queries that use no other fields don't have to
+    load the row.  Empty for a regular index. */
+    std::set<std::string> include;
 };
 RDB_DECLARE_SERIALIZABLE(sindex_config_t);
 
@@ -477,7 +486,9 @@ public:
         std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t>>
             auth_semilattice_view,
         perfmon_collection_t *global_stats,
-        const std::string &_reql_http_proxy);
+        const std::string &_reql_http_proxy,
+        io_backender_t *_io_backender,
+        const base_path_t &_base_path);
 
     ~rdb_context_t();
 
@@ -488,6 +499,11 @@ public:
 
     const std::string reql_http_proxy;
 
+    // For the temporary files of the sorts that don't fit in memory.  On proxies and
+    // in the unit tests `io_backender` is null, and they sort in memory only.
+    io_backender_t *io_backender;
+    base_path_t base_path;
+
     class stats_t {
     public:
         explicit stats_t(perfmon_collection_t *global_stats);
@@ -507,6 +523,7 @@ public:
     } stats;
 
     std::set<ql::query_cache_t *> *get_query_caches_for_this_thread();
+    ql::compiled_query_cache_t *get_compiled_query_cache_for_this_thread();
 
     clone_ptr_t<watchable_t<auth_semilattice_metadata_t>> get_auth_watchable() const;
 
@@ -519,6 +536,7 @@ private:
         auth_semilattice_metadata_t>>> m_cross_thread_auth_watchables;
 
     one_per_thread_t<std::set<ql::query_cache_t *> > query_caches;
+    one_per_thread_t<ql::compiled_query_cache_t> compiled_query_caches;
 
     DISABLE_COPYING(rdb_context_t);
 };
@@ -2,13 +2,26 @@
 #include "rdb_protocol/datum_stream.hpp"
 
 #include <inttypes.h>
+#include <stdio.h>
 
+#include <algorithm>
+#include <deque>
+#include <functional>
 #include <map>
 
+#include "arch/arch.hpp"
+#include "arch/io/disk.hpp"
+#include "config/args.hpp"
+#include "containers/archive/buffer_stream.hpp"
+#include "containers/archive/vector_stream.hpp"
+#include "containers/uuid.hpp"
 #include "math.hpp"
+#include "paths.hpp"
 #include "rdb_protocol/batching.hpp"
+#include "rdb_protocol/context.hpp"
 #include "rdb_protocol/datum_stream/array.hpp"
 #include "rdb_protocol/datum_stream/eq_join.hpp"
+#include "rdb_protocol/datum_stream/external_sort.hpp"
 #include "rdb_protocol/datum_stream/fold.hpp"
 #include "rdb_protocol/datum_stream/indexed_sort.hpp"
 #include "rdb_protocol/datum_stream/lazy.hpp"
@@ -35,8 +48,10 @@
 #include "rdb_protocol/geo/s2/s2polygon.h"
 #include "rdb_protocol/geo/s2/s2polyline.h"
 #include "rdb_protocol/math_utils.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
 #include "rdb_protocol/term.hpp"
 #include "rdb_protocol/val.hpp"
+#include "threading.hpp"
 #include "utils.hpp"
 
 namespace ql {
@@ -1620,6 +1635,605 @@ indexed_sort_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batch
     return ret;
 }
 
+// EXTERNAL_SORT_DATUM_STREAM_T
+typedef external_sort_datum_stream_t::record_t sort_record_t;
+
+// Each part of a record's key is stored as one of these tags, followed by the value
+// or the error if there is one.
+const uint8_t SORT_KEY_MISSING = 0;
+const uint8_t SORT_KEY_VALUE = 1;
+const uint8_t SORT_KEY_ERROR = 2;
+
+void serialize_sort_record(write_message_t *wm, const sort_record_t &record) {
+    for (const lt_cmp_t::key_part_t &part : record.key) {
+        if (part.error.has_value()) {
+            serialize<cluster_version_t::LATEST_OVERALL>(wm, SORT_KEY_ERROR);
+            serialize<cluster_version_t::LATEST_OVERALL>(wm, *part.error);
+        } else if (part.val.has()) {
+            serialize<cluster_version_t::LATEST_OVERALL>(wm, SORT_KEY_VALUE);
+            datum_serialize(wm, part.val, check_datum_serialization_errors_t::NO);
+        } else {
+            serialize<cluster_version_t::LATEST_OVERALL>(wm, SORT_KEY_MISSING);
+        }
+    }
+    datum_serialize(wm, record.row, check_datum_serialization_errors_t::NO);
+}
+
+void deserialize_sort_record(read_stream_t *s, size_t key_size, sort_record_t *out) {
+    out->key.resize(key_size);
+    for (size_t i = 0; i < key_size; ++i) {
+        uint8_t tag;
+        archive_result_t res = deserialize<cluster_version_t::LATEST_OVERALL>(s, &tag);
+        guarantee_deserialization(res, "external sort key");
+        if (tag == SORT_KEY_ERROR) {
+            exc_t error;
+            res = deserialize<cluster_version_t::LATEST_OVERALL>(s, &error);
+            guarantee_deserialization(res, "external sort key");
+            out->key[i].error.set(std::move(error));
+        } else if (tag == SORT_KEY_VALUE) {
+            res = datum_deserialize(s, &out->key[i].val);
+            guarantee_deserialization(res, "external sort key");
+        } else {
+            guarantee(tag == SORT_KEY_MISSING, "Unexpected external sort key tag.");
+        }
+    }
+    archive_result_t res = datum_deserialize(s, &out->row);
+    guarantee_deserialization(res, "external sort row");
+}
+
+size_t sort_record_size(const sort_record_t &record) {
+    size_t size = datum_serialized_size(record.row, check_datum_serialization_errors_t::NO);
+    for (const lt_cmp_t::key_part_t &part : record.key) {
+        if (part.val.has()) {
+            size += datum_serialized_size(part.val, check_datum_serialization_errors_t::NO);
+        }
+    }
+    return size;
+}
+
+// `std::stable_sort`, except that it yields after every `SORT_YIELD_INTERVAL` rows it
+// places.  The blocks of that many rows are sorted first, and then merged pairwise.
+const size_t SORT_YIELD_INTERVAL = 1024;
+
+template <class T, class lt_t>
+void yielding_stable_sort(std::vector<T> *items, const lt_t &lt) {
+    const size_t n = items->size();
+    for (size_t i = 0; i < n; i += SORT_YIELD_INTERVAL) {
+        std::stable_sort(items->begin() + i,
+                         items->begin() + std::min(i + SORT_YIELD_INTERVAL, n),
+                         lt);
+        coro_t::yield();
+    }
+    std::vector<T> merged;
+    for (size_t width = SORT_YIELD_INTERVAL; width < n; width *= 2) {
+        merged.clear();
+        merged.reserve(n);
+        size_t steps = 0;
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            const size_t mid = std::min(lo + width, n);
+            const size_t hi = std::min(lo + 2 * width, n);
+            size_t l = lo;
+            size_t r = mid;
+            while (l < mid || r < hi) {
+                // Taking from the left on ties keeps the sort stable.
+                if (r == hi || (l < mid && !lt((*items)[r], (*items)[l]))) {
+                    merged.push_back(std::move((*items)[l++]));
+                } else {
+                    merged.push_back(std::move((*items)[r++]));
+                }
+                if (++steps % SORT_YIELD_INTERVAL == 0) {
+                    coro_t::yield();
+                }
+            }
+        }
+        items->swap(merged);
+    }
+}
+
+// The runs are written in chunks of about `EXTERNAL_SORT_CHUNK_SIZE` bytes, which are
+// padded to `DEVICE_BLOCK_SIZE` and start with this header.
+struct sort_chunk_header_t {
+    // The size of the whole chunk, with the header and the padding.
+    uint64_t size;
+    uint64_t num_records;
+};
+
+struct sort_chunk_t {
+    scoped_aligned_ptr_t<char, DEVICE_BLOCK_SIZE> buf;
+    int64_t size;
+};
+
+// Makes a chunk of the `num_records` serialized records in `records`, and clears them.
+sort_chunk_t make_sort_chunk(write_message_t *records, uint64_t num_records) {
+    sort_chunk_header_t header;
+    header.size = ceil_aligned(sizeof(header) + records->size(), DEVICE_BLOCK_SIZE);
+    header.num_records = num_records;
+    sort_chunk_t chunk;
+    chunk.size = header.size;
+    chunk.buf = scoped_aligned_ptr_t<char, DEVICE_BLOCK_SIZE>(header.size);
+    memcpy(chunk.buf.get(), &header, sizeof(header));
+    size_t offset = sizeof(header);
+    intrusive_list_t<write_buffer_t> *buffers = records->unsafe_expose_buffers();
+    for (write_buffer_t *b = buffers->head(); b != nullptr; b = buffers->next(b)) {
+        memcpy(chunk.buf.get() + offset, b->data, b->size);
+        offset += b->size;
+    }
+    memset(chunk.buf.get() + offset, 0, header.size - offset);
+    write_message_t cleared;
+    cleared.append_and_clear(records);
+    return chunk;
+}
+
+// Deserializes the `num_records` records in `unsorted`, sorts them, and serializes them
+// again into the chunks that they're written to the temporary file in.  This runs on
+// another thread than the stream, so that the stream doesn't share any datum with it.
+// Returns the error of a comparison that failed, if any.
+optional<exc_t> sort_serialized_run(const std::vector<order_direction_t> &directions,
+                                    uint64_t num_records,
+                                    write_message_t *unsorted,
+                                    backtrace_id_t bt,
+                                    std::vector<sort_chunk_t> *chunks_out) {
+    std::vector<sort_record_t> records(num_records);
+    {
+        // The buffers of `unsorted` are freed on this thread as soon as they're read.
+        write_message_t wm(std::move(*unsorted));
+        vector_stream_t stream;
+        stream.reserve(wm.size());
+        int res = send_write_message(&stream, &wm);
+        guarantee(res == 0);
+        std::vector<char> data;
+        stream.swap(&data);
+        vector_read_stream_t read_stream(std::move(data));
+        for (auto &&record : records) {
+            deserialize_sort_record(&read_stream, directions.size(), &record);
+        }
+    }
+
+    try {
+        yielding_stable_sort(&records,
+            [&](const sort_record_t &l, const sort_record_t &r) {
+                return lt_cmp_t::key_lt(directions, l.key, r.key);
+            });
+    } catch (const exc_t &e) {
+        return make_optional(e);
+    } catch (const base_exc_t &e) {
+        return make_optional(exc_t(e, bt));
+    }
+
+    write_message_t chunk;
+    uint64_t chunk_records = 0;
+    for (const auto &record : records) {
+        serialize_sort_record(&chunk, record);
+        ++chunk_records;
+        if (chunk.size() >= static_cast<size_t>(EXTERNAL_SORT_CHUNK_SIZE)) {
+            chunks_out->push_back(make_sort_chunk(&chunk, chunk_records));
+            chunk_records = 0;
+        }
+    }
+    if (chunk_records != 0) {
+        chunks_out->push_back(make_sort_chunk(&chunk, chunk_records));
+    }
+    return r_nullopt;
+}
+
+// The temporary file the runs are appended to, which is deleted with it.
+class external_sort_datum_stream_t::spill_file_t {
+public:
+    spill_file_t(io_backender_t *io_backender,
+                 const base_path_t &base_path,
+                 backtrace_id_t bt)
+        : path(serializer_filepath_t(base_path,
+                                     "sort_" + uuid_to_str(generate_uuid()))
+                   .temporary_path()),
+          end(0) {
+        const file_open_result_t res =
+            open_file(path.c_str(),
+                      linux_file_t::mode_read | linux_file_t::mode_write
+                      | linux_file_t::mode_create | linux_file_t::mode_truncate,
+                      io_backender,
+                      &file);
+        rcheck_src(bt, res.outcome != file_open_result_t::ERROR,
+                   base_exc_t::OP_FAILED,
+                   strprintf("Could not create the temporary file `%s` to sort in: %s",
+                             path.c_str(), errno_string(res.errsv).c_str()));
+    }
+
+    ~spill_file_t() {
+        if (file.has()) {
+            file.reset();
+            const int res = ::remove(path.c_str());
+            guarantee_err(res == 0, "remove() failed");
+        }
+    }
+
+    // Appends `chunks` one after the other, and returns where they start.  The space
+    // is taken before anything is written, so that several coroutines can append at
+    // the same time.
+    int64_t append(const std::vector<sort_chunk_t> &chunks) {
+        const int64_t start = end;
+        for (const sort_chunk_t &chunk : chunks) {
+            end += chunk.size;
+        }
+        file->set_file_size_at_least(end, EXTERNAL_SORT_RUN_SIZE);
+        int64_t offset = start;
+        for (const sort_chunk_t &chunk : chunks) {
+            co_write(file.get(), offset, chunk.size, chunk.buf.get(),
+                     DEFAULT_DISK_ACCOUNT, file_t::NO_DATASYNCS);
+            offset += chunk.size;
+        }
+        return start;
+    }
+
+    void read(int64_t offset, int64_t length, char *buf) {
+        co_read(file.get(), offset, length, buf, DEFAULT_DISK_ACCOUNT);
+    }
+
+    int64_t end_offset() const { return end; }
+
+private:
+    const std::string path;
+    scoped_ptr_t<file_t> file;
+    int64_t end;
+
+    DISABLE_COPYING(spill_file_t);
+};
+
+// Appends a run of sorted records to the end of the temporary file, one chunk at a
+// time.  Nothing else may append to the file until the run is finished.
+class external_sort_datum_stream_t::run_writer_t {
+public:
+    explicit run_writer_t(spill_file_t *_file)
+        : file(_file), start(_file->end_offset()), num_records(0) { }
+
+    void push(const sort_record_t &record) {
+        serialize_sort_record(&chunk, record);
+        ++num_records;
+        if (chunk.size() >= static_cast<size_t>(EXTERNAL_SORT_CHUNK_SIZE)) {
+            write_chunk();
+        }
+    }
+
+    run_t finish() {
+        if (num_records != 0) {
+            write_chunk();
+        }
+        run_t run;
+        run.offset = start;
+        run.size = file->end_offset() - start;
+        return run;
+    }
+
+private:
+    void write_chunk() {
+        std::vector<sort_chunk_t> chunks;
+        chunks.push_back(make_sort_chunk(&chunk, num_records));
+        file->append(chunks);
+        num_records = 0;
+    }
+
+    spill_file_t *const file;
+    const int64_t start;
+    write_message_t chunk;
+    uint64_t num_records;
+
+    DISABLE_COPYING(run_writer_t);
+};
+
+// Reads a run back one chunk at a time.
+class external_sort_datum_stream_t::run_reader_t {
+public:
+    run_reader_t(spill_file_t *_file, const run_t &run, size_t _key_size)
+        : file(_file), pos(run.offset), end(run.offset + run.size),
+          key_size(_key_size) { }
+
+    // Returns null if the run is exhausted.
+    const sort_record_t *peek() {
+        if (buffer.empty() && pos < end) {
+            read_chunk();
+        }
+        return buffer.empty() ? nullptr : &buffer.front();
+    }
+
+    sort_record_t pop() {
+        guarantee(!buffer.empty());
+        sort_record_t record = std::move(buffer.front());
+        buffer.pop_front();
+        return record;
+    }
+
+private:
+    void read_chunk() {
+        // The header in the first block tells us how much more there is to read.
+        scoped_aligned_ptr_t<char, DEVICE_BLOCK_SIZE> first(DEVICE_BLOCK_SIZE);
+        file->read(pos, DEVICE_BLOCK_SIZE, first.get());
+        sort_chunk_header_t header;
+        memcpy(&header, first.get(), sizeof(header));
+        guarantee(header.size >= DEVICE_BLOCK_SIZE
+                  && pos + static_cast<int64_t>(header.size) <= end);
+
+        scoped_aligned_ptr_t<char, DEVICE_BLOCK_SIZE> data(header.size);
+        memcpy(data.get(), first.get(), DEVICE_BLOCK_SIZE);
+        if (header.size > DEVICE_BLOCK_SIZE) {
+            file->read(pos + DEVICE_BLOCK_SIZE, header.size - DEVICE_BLOCK_SIZE,
+                       data.get() + DEVICE_BLOCK_SIZE);
+        }
+        pos += header.size;
+
+        buffer_read_stream_t stream(data.get() + sizeof(header),
+                                    header.size - sizeof(header));
+        for (uint64_t i = 0; i < header.num_records; ++i) {
+            buffer.emplace_back();
+            deserialize_sort_record(&stream, key_size, &buffer.back());
+        }
+    }
+
+    spill_file_t *const file;
+    int64_t pos;
+    const int64_t end;
+    const size_t key_size;
+    // The records of the chunk we read last.
+    std::deque<sort_record_t> buffer;
+
+    DISABLE_COPYING(run_reader_t);
+};
+
+// Merges consecutive runs, with the next chunk of each of them in memory.
+class external_sort_datum_stream_t::run_merger_t {
+public:
+    run_merger_t(spill_file_t *file,
+                 std::vector<run_t>::const_iterator begin,
+                 std::vector<run_t>::const_iterator end,
+                 const std::vector<order_direction_t> *_directions)
+        : directions(_directions) {
+        for (auto it = begin; it != end; ++it) {
+            readers.push_back(make_scoped<run_reader_t>(file, *it, directions->size()));
+            if (readers.back()->peek() != nullptr) {
+                heap.push_back(readers.size() - 1);
+            }
+        }
+        std::make_heap(heap.begin(), heap.end(), after_fn());
+    }
+
+    bool empty() const { return heap.empty(); }
+
+    sort_record_t pop() {
+        guarantee(!heap.empty());
+        std::pop_heap(heap.begin(), heap.end(), after_fn());
+        const size_t reader = heap.back();
+        sort_record_t record = readers[reader]->pop();
+        if (readers[reader]->peek() != nullptr) {
+            std::push_heap(heap.begin(), heap.end(), after_fn());
+        } else {
+            heap.pop_back();
+        }
+        return record;
+    }
+
+private:
+    // Every reader in the heap has a record in memory, so this doesn't block.
+    bool after(size_t l, size_t r) {
+        const sort_record_t *l_record = readers[l]->peek();
+        const sort_record_t *r_record = readers[r]->peek();
+        if (lt_cmp_t::key_lt(*directions, r_record->key, l_record->key)) {
+            return true;
+        }
+        if (lt_cmp_t::key_lt(*directions, l_record->key, r_record->key)) {
+            return false;
+        }
+        // The earlier runs have the earlier rows, so this keeps the sort stable.
+        return l > r;
+    }
+
+    std::function<bool(size_t, size_t)> after_fn() {
+        return [this](size_t l, size_t r) { return after(l, r); };
+    }
+
+    const std::vector<order_direction_t> *const directions;
+    std::vector<scoped_ptr_t<run_reader_t> > readers;
+    std::vector<size_t> heap;
+
+    DISABLE_COPYING(run_merger_t);
+};
+
+external_sort_datum_stream_t::external_sort_datum_stream_t(
+        env_t *env,
+        counted_t<datum_stream_t> source,
+        const lt_cmp_t &lt_cmp,
+        backtrace_id_t _bt)
+    : eager_datum_stream_t(_bt),
+      directions(lt_cmp.directions()),
+      index(0),
+      fits_in_array(false),
+      sorting_runs(std::min<int64_t>(get_num_threads(),
+                                     EXTERNAL_SORT_MAX_SORTING_RUNS)),
+      sort_drainer(new auto_drainer_t) {
+    rdb_context_t *rdb_ctx = env->get_rdb_ctx();
+    const bool can_spill = rdb_ctx != nullptr && rdb_ctx->io_backender != nullptr;
+
+    std::vector<sort_record_t> records;
+    size_t records_size = 0;
+    batchspec_t batchspec = batchspec_t::user(batch_type_t::TERMINAL, env);
+    {
+        profile::sampler_t sampler("Evaluating the sort keys.", env->trace);
+        for (;;) {
+            std::vector<datum_t> data = source->next_batch(env, batchspec);
+            if (data.size() == 0) {
+                break;
+            }
+            for (auto &&row : data) {
+                sort_record_t record;
+                record.key = lt_cmp.key(env, row, backtrace());
+                record.row = std::move(row);
+                records_size += sort_record_size(record);
+                records.push_back(std::move(record));
+                sampler.new_sample();
+            }
+            if (!can_spill) {
+                rcheck_array_size(records, env->limits());
+            } else if (records_size >= static_cast<size_t>(EXTERNAL_SORT_RUN_SIZE)) {
+                if (!file.has()) {
+                    file.init(new spill_file_t(rdb_ctx->io_backender,
+                                               rdb_ctx->base_path,
+                                               backtrace()));
+                }
+                start_sorting_run(&records, env->interruptor);
+                records_size = 0;
+            }
+        }
+    }
+
+    if (!file.has()) {
+        profile::sampler_t sampler("Sorting in-memory.", env->trace);
+        yielding_stable_sort(&records,
+            [&](const sort_record_t &l, const sort_record_t &r) {
+                sampler.new_sample();
+                return lt_cmp_t::key_lt(directions, l.key, r.key);
+            });
+        rows.reserve(records.size());
+        for (auto &&record : records) {
+            rows.push_back(std::move(record.row));
+        }
+        fits_in_array = rows.size() <= env->limits().array_size_limit();
+        return;
+    }
+
+    if (!records.empty()) {
+        start_sorting_run(&records, env->interruptor);
+    }
+    finish_sorting_runs();
+    merge_runs();
+    merger.init(new run_merger_t(file.get(), runs.begin(), runs.end(), &directions));
+}
+
+external_sort_datum_stream_t::~external_sort_datum_stream_t() { }
+
+void external_sort_datum_stream_t::start_sorting_run(
+        std::vector<sort_record_t> *records, signal_t *interruptor) {
+    new_semaphore_in_line_t sorting_run(&sorting_runs, 1);
+    wait_interruptible(sorting_run.acquisition_signal(), interruptor);
+    if (sort_error.has_value()) {
+        // There's no point in sorting more rows.
+        finish_sorting_runs();
+    }
+
+    // The records go to the other thread serialized.
+    write_message_t unsorted;
+    for (const auto &record : *records) {
+        serialize_sort_record(&unsorted, record);
+    }
+    const uint64_t num_records = records->size();
+    records->clear();
+
+    // The runs are appended to the file in the order they're done in, but they keep
+    // their place in `runs`, which the merge needs to be stable.
+    const size_t run_index = runs.size();
+    runs.push_back(run_t());
+    const threadnum_t thread(
+        (get_thread_id().threadnum + 1 + run_index) % get_num_threads());
+    auto_drainer_t::lock_t keepalive(sort_drainer.get());
+
+    // `spawn_now_dangerously()` lets the coroutine move the locals out before it
+    // yields for the first time.
+    coro_t::spawn_now_dangerously([&]() {
+        new_semaphore_in_line_t sorting(std::move(sorting_run));
+        write_message_t wm(std::move(unsorted));
+        auto_drainer_t::lock_t lock(keepalive);
+        const size_t index = run_index;
+
+        std::vector<sort_chunk_t> chunks;
+        optional<exc_t> error;
+        {
+            on_thread_t thread_switcher(thread);
+            error = sort_serialized_run(directions, num_records, &wm, backtrace(),
+                                        &chunks);
+        }
+        if (error.has_value()) {
+            if (!sort_error.has_value()) {
+                sort_error = std::move(error);
+            }
+            return;
+        }
+        int64_t size = 0;
+        for (const sort_chunk_t &chunk : chunks) {
+            size += chunk.size;
+        }
+        runs[index].offset = file->append(chunks);
+        runs[index].size = size;
+    });
+}
+
+void external_sort_datum_stream_t::finish_sorting_runs() {
+    sort_drainer.reset();
+    if (sort_error.has_value()) {
+        throw *sort_error;
+    }
+}
+
+void external_sort_datum_stream_t::merge_runs() {
+    const size_t width = EXTERNAL_SORT_MAX_MERGE_WIDTH;
+    while (runs.size() > width) {
+        // The merged runs are appended to the file, and the space of the runs they
+        // were merged from is only freed with the file.
+        std::vector<run_t> merged;
+        for (size_t i = 0; i < runs.size(); i += width) {
+            const size_t end = std::min(i + width, runs.size());
+            if (end - i == 1) {
+                merged.push_back(runs[i]);
+                continue;
+            }
+            run_merger_t group(file.get(), runs.begin() + i, runs.begin() + end,
+                               &directions);
+            run_writer_t writer(file.get());
+            while (!group.empty()) {
+                writer.push(group.pop());
+            }
+            merged.push_back(writer.finish());
+        }
+        runs = std::move(merged);
+    }
+}
+
+datum_t external_sort_datum_stream_t::next_row() {
+    if (!merger.has()) {
+        return index < rows.size() ? std::move(rows[index++]) : datum_t();
+    }
+    if (merger->empty()) {
+        return datum_t();
+    }
+    return merger->pop().row;
+}
+
+std::vector<datum_t>
+external_sort_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batchspec) {
+    std::vector<datum_t> v;
+    batcher_t batcher = batchspec.to_batcher();
+
+    profile::sampler_t sampler("Merging sorted rows.", env->trace);
+    datum_t d;
+    while (d = next_row(), d.has()) {
+        batcher.note_el(d);
+        v.push_back(std::move(d));
+        if (batcher.should_send_batch()) {
+            break;
+        }
+        sampler.new_sample();
+    }
+    return v;
+}
+
+bool external_sort_datum_stream_t::is_exhausted() const {
+    return merger.has() ? merger->empty() : index >= rows.size();
+}
+feed_type_t external_sort_datum_stream_t::cfeed_type() const {
+    return feed_type_t::not_feed;
+}
+bool external_sort_datum_stream_t::is_infinite() const {
+    return false;
+}
+bool external_sort_datum_stream_t::is_array() const {
+    return fits_in_array && !is_grouped();
+}
+
 // ORDERED_DISTINCT_DATUM_STREAM_T
 ordered_distinct_datum_stream_t::ordered_distinct_datum_stream_t(
     counted_t<datum_stream_t> _source) : wrapper_datum_stream_t(_source) { }
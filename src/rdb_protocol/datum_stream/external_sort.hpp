@@ -0,0 +1,95 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_DATUM_STREAM_EXTERNAL_SORT_HPP_
+#define RDB_PROTOCOL_DATUM_STREAM_EXTERNAL_SORT_HPP_
+
+#include <vector>
+
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/new_semaphore.hpp"
+#include "containers/scoped.hpp"
+#include "rdb_protocol/datum_stream.hpp"
+#include "rdb_protocol/order_util.hpp"
+
+namespace ql {
+
+/* Sorts a stream that has no index to sort by, for `orderBy`.  The comparison
+functions are called once for each row, and the rows are sorted by their results.
+
+If the rows fit in `EXTERNAL_SORT_RUN_SIZE` bytes, or the server can't write temporary
+files, they are sorted in memory.  Otherwise the rows are cut into runs of that size.
+While the next run is read, up to `EXTERNAL_SORT_MAX_SORTING_RUNS` runs are sorted at
+once, each on another thread, and appended to a single temporary file; the stream
+merges the runs as it's read.  At most `EXTERNAL_SORT_MAX_MERGE_WIDTH` runs are merged
+at once; if there are more, they are first merged into longer runs, which are appended
+to the same file.  The sorts yield every so often, so that they don't hold up the
+other coroutines of their thread.
+
+The stream is an array, like the other sorted sequences, only if the rows fit in memory
+and within the array size limit; without temporary files, more rows than that are an
+error. */
+class external_sort_datum_stream_t : public eager_datum_stream_t {
+public:
+    external_sort_datum_stream_t(env_t *env,
+                                 counted_t<datum_stream_t> source,
+                                 const lt_cmp_t &lt_cmp,
+                                 backtrace_id_t bt);
+    ~external_sort_datum_stream_t();
+
+    virtual bool is_exhausted() const;
+    virtual feed_type_t cfeed_type() const;
+    virtual bool is_infinite() const;
+
+    struct record_t {
+        std::vector<lt_cmp_t::key_part_t> key;
+        datum_t row;
+    };
+
+    // A sorted run, which takes up `size` bytes of the temporary file from `offset` on.
+    struct run_t {
+        int64_t offset;
+        int64_t size;
+    };
+
+private:
+    class spill_file_t;
+    class run_writer_t;
+    class run_reader_t;
+    class run_merger_t;
+
+    virtual bool is_array() const;
+    virtual std::vector<datum_t>
+    next_raw_batch(env_t *env, const batchspec_t &batchspec);
+
+    // Starts sorting `records` on another thread, to append them to the temporary file
+    // as the next run, and clears them.  Waits while too many runs are being sorted.
+    void start_sorting_run(std::vector<record_t> *records, signal_t *interruptor);
+    // Waits for the runs that are being sorted, and throws the first error that a
+    // comparison of their rows ran into.
+    void finish_sorting_runs();
+    // Merges the runs in groups of `EXTERNAL_SORT_MAX_MERGE_WIDTH` until there are no
+    // more than that.
+    void merge_runs();
+    datum_t next_row();
+
+    const std::vector<order_direction_t> directions;
+
+    // The sorted rows, if they fit in memory, and the index of the next one.
+    std::vector<datum_t> rows;
+    size_t index;
+    bool fits_in_array;
+
+    // The temporary file with the sorted runs otherwise, and the merge of the runs.
+    scoped_ptr_t<spill_file_t> file;
+    std::vector<run_t> runs;
+    scoped_ptr_t<run_merger_t> merger;
+
+    // Limits the runs that are being sorted, which keep the error of the first one that
+    // fails in `sort_error`.
+    new_semaphore_t sorting_runs;
+    optional<exc_t> sort_error;
+    scoped_ptr_t<auto_drainer_t> sort_drainer;
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_DATUM_STREAM_EXTERNAL_SORT_HPP_
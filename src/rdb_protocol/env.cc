@@ -73,6 +73,7 @@ env_t::env_t(rdb_context_t *ctx,
                            serializable_.deterministic_time)),
       reql_version_(reql_version_t::LATEST),
       regex_cache_(LRU_CACHE_SIZE),
+      parameters_(nullptr),
       return_empty_normal_batches(_return_empty_normal_batches),
       interruptor(_interruptor),
       trace(_trace),
@@ -109,6 +110,7 @@ env_t::env_t(signal_t *_interruptor,
         datum_t()},
       reql_version_(_reql_version),
       regex_cache_(LRU_CACHE_SIZE),
+      parameters_(nullptr),
       return_empty_normal_batches(_return_empty_normal_batches),
       interruptor(_interruptor),
       trace(NULL),
@@ -30,6 +30,7 @@ class RE2;
 
 namespace ql {
 class datum_t;
+class query_parameters_t;
 class term_t;
 
 enum class return_empty_normal_batches_t { NO, YES };
@@ -129,6 +130,16 @@ public:
 
     regex_cache_t &regex_cache() { return regex_cache_; }
 
+    // The values of the parameters of a query that was compiled with parameters (see
+    // `compiled_query_cache_t`).
+    void set_parameters(const std::vector<datum_t> *parameters) {
+        parameters_ = parameters;
+    }
+    const datum_t &get_parameter(size_t index) const {
+        r_sanity_check(parameters_ != nullptr && index < parameters_->size());
+        return (*parameters_)[index];
+    }
+
     reql_version_t reql_version() const { return reql_version_; }
 
 private:
@@ -145,6 +156,8 @@ private:
     // query specific cache parameters; for example match regexes.
     regex_cache_t regex_cache_;
 
+    const std::vector<datum_t> *parameters_;
+
 public:
     const return_empty_normal_batches_t return_empty_normal_batches;
 
@@ -175,9 +188,13 @@ private:
 // evaluate anything, it doesn't need an env_t *.
 class compile_env_t {
 public:
-    explicit compile_env_t(var_visibility_t &&_visibility)
-        : visibility(std::move(_visibility)) { }
+    explicit compile_env_t(var_visibility_t &&_visibility,
+                           query_parameters_t *_parameters = nullptr)
+        : visibility(std::move(_visibility)), parameters(_parameters) { }
     var_visibility_t visibility;
+    // The literals that are compiled into parameters, if any (see
+    // `compiled_query_cache_t`).
+    query_parameters_t *parameters;
 };
 
 // This is an environment for evaluating things that use variables in scope.  It
@@ -136,7 +136,7 @@ continue_bool_t rdb_erase_small_range(
                                                      buf_parent_t(&kv_location.buf));
             // Get the inline value
             mod_report.info.deleted.second.assign(rdb_value->value_ref(),
-                rdb_value->value_ref() + rdb_value->inline_size(max_block_size));
+                rdb_value->value_ref() + rdb_value->value_ref_size(max_block_size));
             mod_reports_out->push_back(mod_report);
 
             // Detach the value
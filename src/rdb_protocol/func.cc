@@ -9,6 +9,7 @@
 #include "rdb_protocol/minidriver.hpp"
 #include "rdb_protocol/pseudo_literal.hpp"
 #include "rdb_protocol/ql2proto.hpp"
+#include "rdb_protocol/serialized_predicate.hpp"
 #include "rdb_protocol/term_walker.hpp"
 #include "stl_utils.hpp"
 
@@ -28,6 +29,10 @@ scoped_ptr_t<val_t> func_t::call(env_t *env,
     return call(env, make_vector(arg), eval_flags);
 }
 
+scoped_ptr_t<serialized_predicate_t> func_t::compile_predicate() const {
+    return scoped_ptr_t<serialized_predicate_t>();
+}
+
 scoped_ptr_t<val_t> func_t::call(env_t *env,
                               datum_t arg1,
                               datum_t arg2,
@@ -101,6 +106,102 @@ bool reql_func_t::is_simple_selector() const {
     return body->is_simple_selector();
 }
 
+bool refers_to_var(const raw_term_t &term, sym_t var) {
+    if (term.type() == Term::IMPLICIT_VAR) {
+        return true;
+    }
+    if (term.type() != Term::VAR || term.num_args() != 1
+        || term.arg(0).type() != Term::DATUM) {
+        return false;
+    }
+    datum_t name = term.arg(0).datum();
+    return name.get_type() == datum_t::R_NUM && name.as_int() == var.value;
+}
+
+namespace {
+
+bool is_field_in(const raw_term_t &term, const std::set<std::string> &fields) {
+    if (term.type() != Term::DATUM) {
+        return false;
+    }
+    datum_t field = term.datum();
+    return field.get_type() == datum_t::R_STR
+        && fields.count(field.as_str().to_std()) != 0;
+}
+
+// Whether `term` uses the variable `var` only to get fields in `fields` from it,
+// with `row("field")`, `row.getField("field")` or `row.pluck("field", ...)`.
+bool term_only_gets_fields(const raw_term_t &term,
+                           sym_t var,
+                           const std::set<std::string> &fields) {
+    switch (term.type()) {
+    case Term::VAR: // fallthru
+    case Term::IMPLICIT_VAR:
+        return !refers_to_var(term, var);
+    case Term::GET_FIELD: // fallthru
+    case Term::BRACKET:
+        if (term.num_args() == 2 && refers_to_var(term.arg(0), var)) {
+            return term.num_optargs() == 0 && is_field_in(term.arg(1), fields);
+        }
+        break;
+    case Term::PLUCK:
+        if (term.num_args() >= 1 && refers_to_var(term.arg(0), var)) {
+            for (size_t i = 1; i < term.num_args(); ++i) {
+                if (!is_field_in(term.arg(i), fields)) {
+                    return false;
+                }
+            }
+            bool ok = true;
+            term.each_optarg([&](const raw_term_t &optarg, const std::string &name) {
+                ok = ok && name == "_NO_RECURSE_" && optarg.type() == Term::DATUM;
+            });
+            return ok;
+        }
+        break;
+    default:
+        break;
+    }
+    for (size_t i = 0; i < term.num_args(); ++i) {
+        if (!term_only_gets_fields(term.arg(i), var, fields)) {
+            return false;
+        }
+    }
+    bool ok = true;
+    term.each_optarg([&](const raw_term_t &optarg, const std::string &) {
+        ok = ok && term_only_gets_fields(optarg, var, fields);
+    });
+    return ok;
+}
+
+}  // namespace
+
+bool reql_func_t::only_gets_fields(const std::set<std::string> &fields) const {
+    return arg_names.size() == 1
+        && term_only_gets_fields(body->get_src(), arg_names[0], fields);
+}
+
+optional<datum_string_t> reql_func_t::selected_field() const {
+    if (arg_names.size() != 1) {
+        return r_nullopt;
+    }
+    raw_term_t term = body->get_src();
+    if ((term.type() != Term::GET_FIELD && term.type() != Term::BRACKET)
+        || term.num_args() != 2 || term.num_optargs() != 0
+        || !refers_to_var(term.arg(0), arg_names[0])
+        || term.arg(1).type() != Term::DATUM) {
+        return r_nullopt;
+    }
+    datum_t field = term.arg(1).datum();
+    if (field.get_type() != datum_t::R_STR) {
+        return r_nullopt;
+    }
+    return make_optional(field.as_str());
+}
+
+scoped_ptr_t<serialized_predicate_t> reql_func_t::compile_predicate() const {
+    return serialized_predicate_t::compile(body->get_src(), arg_names);
+}
+
 js_func_t::js_func_t(const std::string &_js_source,
                      uint64_t timeout_ms,
                      backtrace_id_t _backtrace)
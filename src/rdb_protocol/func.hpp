@@ -3,6 +3,7 @@
 #define RDB_PROTOCOL_FUNC_HPP_
 
 #include <map>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -25,6 +26,7 @@ class js_runner_t;
 namespace ql {
 
 class func_visitor_t;
+class serialized_predicate_t;
 
 class func_t : public slow_atomic_countable_t<func_t>, public bt_rcheckable_t {
 public:
@@ -69,6 +71,23 @@ public:
         return false;
     }
 
+    // Whether the function takes one argument and gets nothing but the fields in
+    // `fields` from it, so that calling it with an object of just those fields gives
+    // the same result as calling it with the whole row.
+    virtual bool only_gets_fields(const std::set<std::string> &) const {
+        return false;
+    }
+
+    // If the function takes one argument and returns nothing but `row("field")` or
+    // `row.getField("field")`, the name of that field.
+    virtual optional<datum_string_t> selected_field() const {
+        return r_nullopt;
+    }
+
+    // The function as a predicate on serialized rows (see `serialized_predicate_t`),
+    // or an empty pointer if it's not simple enough.
+    virtual scoped_ptr_t<serialized_predicate_t> compile_predicate() const;
+
 protected:
     explicit func_t(backtrace_id_t bt);
 
@@ -109,6 +128,12 @@ public:
 
     bool is_simple_selector() const final;
 
+    bool only_gets_fields(const std::set<std::string> &fields) const final;
+
+    optional<datum_string_t> selected_field() const final;
+
+    scoped_ptr_t<serialized_predicate_t> compile_predicate() const final;
+
 private:
     template <cluster_version_t> friend class wire_func_serialization_visitor_t;
     bool filter_helper(env_t *env, datum_t arg) const;
@@ -171,6 +196,10 @@ protected:
     DISABLE_COPYING(func_visitor_t);
 };
 
+// Whether `term` refers to the variable `var`.  `r.row` counts as a reference to it
+// too, even in nested functions, where it refers to their own argument instead.
+bool refers_to_var(const raw_term_t &term, sym_t var);
+
 // Some queries, like filter, can take a shortcut object instead of a
 // function as their argument.
 counted_t<const func_t> new_constant_func(datum_t obj, backtrace_id_t bt);
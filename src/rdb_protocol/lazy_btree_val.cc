@@ -2,6 +2,8 @@
 #include "rdb_protocol/lazy_btree_val.hpp"
 
 #include "containers/archive/buffer_group_stream.hpp"
+#include "containers/archive/buffer_stream.hpp"
+#include "containers/archive/vector_stream.hpp"
 #include "containers/archive/versioned.hpp"
 #include "rdb_protocol/blob_wrapper.hpp"
 #include "rdb_protocol/serialize_datum.hpp"
@@ -25,6 +27,86 @@ ql::datum_t get_data(const rdb_value_t *value, buf_parent_t parent) {
     return data;
 }
 
+std::vector<char> get_serialized_data(const rdb_value_t *value, buf_parent_t parent) {
+    rdb_blob_wrapper_t blob(parent.cache()->max_block_size(),
+                            const_cast<rdb_value_t *>(value)->value_ref(),
+                            blob::btree_maxreflen);
+
+    blob_acq_t acq_group;
+    buffer_group_t buffer_group;
+    blob.expose_all(parent, access_t::read, &buffer_group, &acq_group);
+    std::vector<char> data;
+    data.reserve(buffer_group.get_size());
+    for (size_t i = 0; i < buffer_group.num_buffers(); ++i) {
+        const buffer_group_t::buffer_t buffer = buffer_group.get_buffer(i);
+        const char *bytes = static_cast<const char *>(buffer.data);
+        data.insert(data.end(), bytes, bytes + buffer.size);
+    }
+    return data;
+}
+
+ql::serialized_predicate_t::result_t test_data(
+        const rdb_value_t *value,
+        buf_parent_t parent,
+        const ql::serialized_predicate_t &predicate) {
+    rdb_blob_wrapper_t blob(parent.cache()->max_block_size(),
+                            const_cast<rdb_value_t *>(value)->value_ref(),
+                            blob::btree_maxreflen);
+
+    blob_acq_t acq_group;
+    buffer_group_t buffer_group;
+    blob.expose_all(parent, access_t::read, &buffer_group, &acq_group);
+    if (buffer_group.num_buffers() != 1) {
+        return ql::serialized_predicate_t::result_t::UNKNOWN;
+    }
+    const buffer_group_t::buffer_t buffer = buffer_group.get_buffer(0);
+    return predicate.test(static_cast<const char *>(buffer.data),
+                          static_cast<size_t>(buffer.size));
+}
+
+void get_covered_data(const rdb_value_t *value,
+                      ql::datum_t *index_value_out,
+                      ql::datum_t *included_fields_out) {
+    guarantee(value->has_covered_data());
+    buffer_read_stream_t read_stream(value->covered_data(),
+                                     value->covered_data_size());
+    ql::datum_t covered;
+    archive_result_t res = datum_deserialize(&read_stream, &covered);
+    guarantee_deserialization(res, "covered data");
+    guarantee(covered.get_type() == ql::datum_t::R_ARRAY && covered.arr_size() == 2);
+    *index_value_out = covered.get(0);
+    *included_fields_out = covered.get(1);
+}
+
+std::vector<char> make_covering_value(const ql::datum_t &index_value,
+                                      const ql::datum_t &included_fields,
+                                      const std::vector<char> &value_ref) {
+    ql::datum_t covered(std::vector<ql::datum_t>{index_value, included_fields},
+                        ql::configured_limits_t::unlimited);
+    write_message_t wm;
+    if (ql::bad(datum_serialize(&wm, covered,
+                                ql::check_datum_serialization_errors_t::YES))) {
+        return value_ref;
+    }
+    // The whole value has to fit where a blob reference alone would.
+    const size_t covered_size = wm.size();
+    if (COVERED_DATA_HEADER_SIZE + covered_size + value_ref.size()
+        > static_cast<size_t>(blob::btree_maxreflen)) {
+        return value_ref;
+    }
+    std::vector<char> value;
+    value.reserve(COVERED_DATA_HEADER_SIZE + covered_size + value_ref.size());
+    value.push_back(static_cast<char>(COVERED_DATA_MARKER));
+    value.push_back(static_cast<char>(static_cast<uint8_t>(covered_size)));
+    vector_stream_t stream;
+    stream.reserve(covered_size);
+    int write_res = send_write_message(&stream, &wm);
+    guarantee(write_res == 0);
+    value.insert(value.end(), stream.vector().begin(), stream.vector().end());
+    value.insert(value.end(), value_ref.begin(), value_ref.end());
+    return value;
+}
+
 const ql::datum_t &lazy_btree_val_t::get() const {
     guarantee(pointee.has());
     if (!pointee->ptr.has()) {
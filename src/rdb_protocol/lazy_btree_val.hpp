@@ -2,34 +2,92 @@
 #ifndef RDB_PROTOCOL_LAZY_BTREE_VAL_HPP_
 #define RDB_PROTOCOL_LAZY_BTREE_VAL_HPP_
 
+#include <vector>
+
 #include "buffer_cache/alt.hpp"
 #include "buffer_cache/blob.hpp"
 #include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/serialized_predicate.hpp"
+
+/* The entries of covering secondary indexes (see `sindex_config_t::include`) start
+with `COVERED_DATA_MARKER`, which no blob reference starts with, and the size of the
+covered data in one byte.  The covered data is the serialized array of the value of
+the index and the object of the included fields of the row.  The blob reference of the
+row comes after it, so `value_ref()` works for all values alike. */
+const uint8_t COVERED_DATA_MARKER = 252;
+const int COVERED_DATA_HEADER_SIZE = 2;
 
 struct rdb_value_t {
     char contents[1];
 
 public:
+    // The size of the whole value, covered data included.
     int inline_size(max_block_size_t bs) const {
-        return blob::ref_size(bs, contents, blob::btree_maxreflen);
+        return covered_data_prefix_size() + value_ref_size(bs);
+    }
+
+    // The size of the blob reference alone.
+    int value_ref_size(max_block_size_t bs) const {
+        return blob::ref_size(bs, value_ref(), blob::btree_maxreflen);
     }
 
     int64_t value_size() const {
-        return blob::value_size(contents, blob::btree_maxreflen);
+        return blob::value_size(value_ref(), blob::btree_maxreflen);
     }
 
     const char *value_ref() const {
-        return contents;
+        return contents + covered_data_prefix_size();
     }
 
     char *value_ref() {
-        return contents;
+        return contents + covered_data_prefix_size();
+    }
+
+    bool has_covered_data() const {
+        return static_cast<uint8_t>(contents[0]) == COVERED_DATA_MARKER;
+    }
+
+    const char *covered_data() const {
+        return contents + COVERED_DATA_HEADER_SIZE;
+    }
+
+    int covered_data_size() const {
+        return static_cast<uint8_t>(contents[1]);
+    }
+
+    int covered_data_prefix_size() const {
+        return has_covered_data()
+            ? COVERED_DATA_HEADER_SIZE + covered_data_size()
+            : 0;
     }
 };
 
 ql::datum_t get_data(const rdb_value_t *value,
                      buf_parent_t parent);
 
+/* Returns a copy of the serialized row, which unlike a `ql::datum_t` can be handed to
+another thread and deserialized there. */
+std::vector<char> get_serialized_data(const rdb_value_t *value,
+                                      buf_parent_t parent);
+
+/* Runs `predicate` on the serialized row in place.  Rows that span more than one
+buffer would have to be copied first, so they are `UNKNOWN`. */
+ql::serialized_predicate_t::result_t test_data(
+    const rdb_value_t *value,
+    buf_parent_t parent,
+    const ql::serialized_predicate_t &predicate);
+
+/* Reads the covered data of `value`, which must have some. */
+void get_covered_data(const rdb_value_t *value,
+                      ql::datum_t *index_value_out,
+                      ql::datum_t *included_fields_out);
+
+/* Returns the entry of a covering secondary index for a row with the blob reference
+`value_ref`, or `value_ref` itself if the covered data doesn't fit. */
+std::vector<char> make_covering_value(const ql::datum_t &index_value,
+                                      const ql::datum_t &included_fields,
+                                      const std::vector<char> &value_ref);
+
 class lazy_btree_val_pointee_t
         : public single_threaded_countable_t<lazy_btree_val_pointee_t> {
     lazy_btree_val_pointee_t(const rdb_value_t *_rdb_value, buf_parent_t _parent)
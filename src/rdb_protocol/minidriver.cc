@@ -102,6 +102,10 @@ minidriver_t::reql_t minidriver_t::null() {
     return reql_t(this, datum_t::null());
 }
 
+minidriver_t::reql_t minidriver_t::now() {
+    return reql_t(this, Term::NOW);
+}
+
 minidriver_t::reql_t minidriver_t::reql_t::operator !() {
     return std::move(*this).call(Term::NOT);
 }
@@ -167,6 +167,8 @@ public:
 
     reql_t null();
 
+    reql_t now();
+
     template <class T>
     std::pair<std::string, reql_t> optarg(const std::string &key, T &&value) {
         return std::pair<std::string, reql_t>(key, reql_t(this, std::forward<T>(value)));
@@ -91,6 +91,22 @@ build_comparisons_from_optional_terms(const term_t *target,
     return comparisons;
 }
 
+namespace {
+
+// Compares the values of a comparison function for two rows, taking its direction
+// into account.  A value that doesn't exist sorts before all the others.
+int compare_values(order_direction_t direction, const datum_t &l, const datum_t &r) {
+    int cmp_res;
+    if (!l.has() || !r.has()) {
+        cmp_res = static_cast<int>(l.has()) - static_cast<int>(r.has());
+    } else {
+        cmp_res = l.cmp(r);
+    }
+    return direction == DESC ? -cmp_res : cmp_res;
+}
+
+}  // namespace
+
 lt_cmp_t::lt_cmp_t(std::vector<std::pair<order_direction_t, counted_t<const func_t> > > _comparisons)
             : comparisons(std::move(_comparisons)) { }
 
@@ -122,22 +138,62 @@ bool lt_cmp_t::operator()(env_t *env,
             }
         }
 
-        if (!lval.has() && !rval.has()) {
-            continue;
+        int cmp_res = compare_values(it->first, lval, rval);
+        if (cmp_res != 0) {
+            return cmp_res < 0;
         }
-        if (!lval.has()) {
-            return true != (it->first == DESC);
+    }
+
+    return false;
+}
+
+std::vector<lt_cmp_t::key_part_t> lt_cmp_t::key(env_t *env,
+                                                datum_t row,
+                                                backtrace_id_t bt) const {
+    std::vector<key_part_t> ret(comparisons.size());
+    for (size_t i = 0; i < comparisons.size(); ++i) {
+        // The comparator only calls a function if all the previous ones tied, so an
+        // error is kept until a comparison needs this value.
+        try {
+            ret[i].val = comparisons[i].second->call(env, row)->as_datum();
+        } catch (const exc_t &e) {
+            if (e.get_type() != base_exc_t::NON_EXISTENCE) {
+                ret[i].error = make_optional(e);
+            }
+        } catch (const base_exc_t &e) {
+            if (e.get_type() != base_exc_t::NON_EXISTENCE) {
+                ret[i].error = make_optional(exc_t(e, bt));
+            }
+        }
+    }
+    return ret;
+}
+
+std::vector<order_direction_t> lt_cmp_t::directions() const {
+    std::vector<order_direction_t> ret;
+    ret.reserve(comparisons.size());
+    for (auto it = comparisons.begin(); it != comparisons.end(); ++it) {
+        ret.push_back(it->first);
+    }
+    return ret;
+}
+
+bool lt_cmp_t::key_lt(const std::vector<order_direction_t> &directions,
+                      const std::vector<key_part_t> &l,
+                      const std::vector<key_part_t> &r) {
+    r_sanity_check(l.size() == directions.size() && r.size() == directions.size());
+    for (size_t i = 0; i < directions.size(); ++i) {
+        if (l[i].error.has_value()) {
+            throw *l[i].error;
         }
-        if (!rval.has()) {
-            return false != (it->first == DESC);
+        if (r[i].error.has_value()) {
+            throw *r[i].error;
         }
-        int cmp_res = lval.cmp(rval);
-        if (cmp_res == 0) {
-            continue;
+        int cmp_res = compare_values(directions[i], l[i].val, r[i].val);
+        if (cmp_res != 0) {
+            return cmp_res < 0;
         }
-        return (cmp_res < 0) != (it->first == DESC);
     }
-
     return false;
 }
 
@@ -5,12 +5,15 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "errors.hpp"
 
+#include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/profile.hpp"
 #include "containers/counted.hpp"
+#include "containers/optional.hpp"
 
 namespace ql {
 
@@ -54,6 +57,25 @@ public:
                     datum_t l,
                     datum_t r) const;
 
+    // The value of one comparison function for a row.  `val` is empty if the value
+    // doesn't exist.  If the function failed, `error` holds its error, which is only
+    // thrown once a comparison needs the value, like `operator()` would.
+    struct key_part_t {
+        datum_t val;
+        optional<exc_t> error;
+    };
+
+    // The values of the comparison functions for `row`.  Comparing the keys of two
+    // rows with `key_lt` gives the same result as comparing the rows, without calling
+    // the functions again.  Errors that aren't `exc_t`s get the backtrace `bt`.
+    std::vector<key_part_t> key(env_t *env, datum_t row, backtrace_id_t bt) const;
+    std::vector<order_direction_t> directions() const;
+
+    // Doesn't use any `func_t`, so it can be called on any thread.
+    static bool key_lt(const std::vector<order_direction_t> &directions,
+                       const std::vector<key_part_t> &l,
+                       const std::vector<key_part_t> &r);
+
 private:
     const std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
         comparisons;
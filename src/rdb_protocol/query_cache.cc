@@ -51,13 +51,22 @@ scoped_ptr_t<query_cache_t::ref_t> query_cache_t::create(query_params_t *query_p
     }
 
     global_optargs_t global_optargs;
+    counted_t<const compiled_query_t> compiled_query;
+    std::vector<datum_t> parameters;
     counted_t<const term_t> term_tree;
     try {
         query_params->term_storage->preprocess();
         global_optargs = query_params->term_storage->global_optargs();
 
-        compile_env_t compile_env((var_visibility_t()));
-        term_tree = compile_term(&compile_env, query_params->term_storage->root_term());
+        compiled_query = rdb_ctx->get_compiled_query_cache_for_this_thread()->get(
+            query_params->term_storage->root_term(), &parameters);
+        if (compiled_query.has()) {
+            term_tree = compiled_query->term_tree;
+        } else {
+            compile_env_t compile_env((var_visibility_t()));
+            term_tree = compile_term(&compile_env,
+                                     query_params->term_storage->root_term());
+        }
 
     } catch (const exc_t &e) {
         throw bt_exc_t(Response::COMPILE_ERROR,
@@ -73,6 +82,8 @@ scoped_ptr_t<query_cache_t::ref_t> query_cache_t::create(query_params_t *query_p
     scoped_ptr_t<entry_t> entry(new entry_t(query_params,
                                             std::move(global_optargs),
                                             std::move(deterministic_time),
+                                            std::move(compiled_query),
+                                            std::move(parameters),
                                             std::move(term_tree)));
 
     scoped_ptr_t<ref_t> ref(new ref_t(this,
@@ -208,6 +219,7 @@ void query_cache_t::ref_t::fill_response(response_t *res) {
             &combined_interruptor,
             serializable,
             trace.get_or_null());
+        env.set_parameters(&entry->parameters);
 
         if (entry->state == entry_t::state_t::START) {
             run(&env, res);
@@ -362,6 +374,8 @@ void query_cache_t::ref_t::serve(env_t *env, response_t *res) {
 query_cache_t::entry_t::entry_t(query_params_t *query_params,
                                 global_optargs_t &&_global_optargs,
                                 ql::datum_t && _deterministic_time,
+                                counted_t<const compiled_query_t> &&_compiled_query,
+                                std::vector<datum_t> &&_parameters,
                                 counted_t<const term_t> &&_term_tree) :
         state(state_t::START),
         interrupt_reason(interrupt_reason_t::UNKNOWN),
@@ -373,6 +387,8 @@ query_cache_t::entry_t::entry_t(query_params_t *query_params,
         global_optargs(std::move(_global_optargs)),
         deterministic_time(_deterministic_time),
         start_time(current_microtime()),
+        compiled_query(std::move(_compiled_query)),
+        parameters(std::move(_parameters)),
         term_tree(std::move(_term_tree)),
         has_sent_batch(false) { }
 
@@ -8,6 +8,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "arch/address.hpp"
 #include "clustering/administration/auth/user_context.hpp"
@@ -20,6 +21,7 @@
 #include "containers/counted.hpp"
 #include "containers/intrusive_list.hpp"
 #include "containers/object_buffer.hpp"
+#include "rdb_protocol/compiled_query_cache.hpp"
 #include "rdb_protocol/rdb_backtrace.hpp"
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/env.hpp"
@@ -109,6 +111,8 @@ private:
         entry_t(query_params_t *query_params,
                 global_optargs_t &&_global_optargs,
                 ql::datum_t &&_deterministic_time,
+                counted_t<const compiled_query_t> &&_compiled_query,
+                std::vector<datum_t> &&_parameters,
                 counted_t<const term_t> &&_term_tree);
         ~entry_t();
 
@@ -126,6 +130,11 @@ private:
         const ql::datum_t deterministic_time;
         const microtime_t start_time;
 
+        // If the query was compiled with parameters, its compiled query, which
+        // `term_tree` comes from, and the values of its parameters.
+        const counted_t<const compiled_query_t> compiled_query;
+        const std::vector<datum_t> parameters;
+
         cond_t persistent_interruptor;
 
         // This will be empty if the root term has already been run
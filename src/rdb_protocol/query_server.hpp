@@ -22,6 +22,7 @@ class rdb_query_server_t : public query_handler_t {
 public:
     rdb_query_server_t(
       const std::set<ip_address_t> &local_addresses, int port,
+      int num_listener_threads,
       rdb_context_t *_rdb_ctx, server_config_client_t *_server_config_client,
       const server_id_t &_server_id, tls_ctx_t *tls_ctx);
 
@@ -0,0 +1,250 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/read_result_cache.hpp"
+
+#include "containers/archive/boost_types.hpp"
+#include "containers/archive/optional.hpp"
+#include "containers/archive/stl_types.hpp"
+#include "containers/archive/vector_stream.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/func.hpp"
+#include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/val.hpp"
+
+namespace {
+
+// The results of cached reads are never bigger than this fraction of the cache.
+const size_t MAX_RESULT_FRACTION = 8;
+
+// The bytes that an entry takes besides its key and its data.
+const size_t ENTRY_OVERHEAD = 128;
+
+bool is_deterministic(const counted_t<const ql::func_t> &f) {
+    return !f.has() || f->is_deterministic().test(ql::single_server_t::yes,
+                                                  ql::constant_now_t::no);
+}
+
+// Whether the functions of a transform or a terminal always return the same results
+// for the same rows, so that the read can be cached.
+class deterministic_visitor_t : public boost::static_visitor<bool> {
+public:
+    bool operator()(const ql::map_wire_func_t &f) const {
+        return is_deterministic(f.compile_wire_func());
+    }
+    bool operator()(const ql::group_wire_func_t &f) const {
+        for (const auto &func : f.compile_funcs()) {
+            if (!is_deterministic(func)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool operator()(const ql::filter_wire_func_t &f) const {
+        return is_deterministic(f.filter_func.compile_wire_func())
+            && (!f.default_filter_val.has_value()
+                || is_deterministic(f.default_filter_val->compile_wire_func()));
+    }
+    bool operator()(const ql::concatmap_wire_func_t &f) const {
+        return is_deterministic(f.compile_wire_func());
+    }
+    bool operator()(const ql::distinct_wire_func_t &) const {
+        return true;
+    }
+    bool operator()(const ql::zip_wire_func_t &) const {
+        return true;
+    }
+    bool operator()(const ql::count_wire_func_t &) const {
+        return true;
+    }
+    bool operator()(const ql::skip_wire_func_t &f) const {
+        return is_deterministic(f.compile_wire_func_or_null());
+    }
+    bool operator()(const ql::reduce_wire_func_t &f) const {
+        return is_deterministic(f.compile_wire_func());
+    }
+    bool operator()(const ql::limit_read_t &) const {
+        // These are only for changefeeds, and can't be serialized.
+        return false;
+    }
+};
+
+// Whether the read was run with `result_cache: true`.
+bool wants_result_cache(const ql::global_optargs_t &optargs, signal_t *interruptor) {
+    if (!optargs.has_optarg("result_cache")) {
+        return false;
+    }
+    try {
+        ql::env_t env(interruptor,
+                      ql::return_empty_normal_batches_t::NO,
+                      reql_version_t::LATEST);
+        return optargs.get_optarg(&env, "result_cache")->as_bool();
+    } catch (const ql::base_exc_t &) {
+        return false;
+    }
+}
+
+}  // namespace
+
+read_result_cache_t::read_result_cache_t(perfmon_collection_t *parent,
+                                         size_t max_size)
+    : max_size_(max_size),
+      size_(0),
+      generation_(0),
+      changes_in_progress_(0),
+      stats_membership_(parent, &stats_, "read_result_cache"),
+      pm_hits_(get_num_threads()),
+      pm_misses_(get_num_threads()),
+      pm_size_(get_num_threads()),
+      pm_membership_(&stats_,
+                     &pm_hits_, "hits_total",
+                     &pm_misses_, "misses_total",
+                     &pm_size_, "bytes") { }
+
+read_result_cache_t::~read_result_cache_t() {
+    assert_thread();
+}
+
+optional<std::string> read_result_cache_t::make_key(const read_t &read,
+                                                    signal_t *interruptor) {
+    const rget_read_t *rget = boost::get<rget_read_t>(&read.read);
+    if (rget == nullptr
+        || read.profile == profile_bool_t::PROFILE
+        || rget->stamp.has_value()
+        || rget->sindex.has_value()) {
+        return r_nullopt;
+    }
+    deterministic_visitor_t deterministic;
+    for (const auto &transform : rget->transforms) {
+        if (!boost::apply_visitor(deterministic, transform)) {
+            return r_nullopt;
+        }
+    }
+    if (rget->terminal.has_value()
+        && !boost::apply_visitor(deterministic, *rget->terminal)) {
+        return r_nullopt;
+    }
+    if (!wants_result_cache(rget->serializable_env.global_optargs, interruptor)) {
+        return r_nullopt;
+    }
+
+    // We leave out the rest of `serializable_env`: the functions don't read tables,
+    // so they don't depend on the user, and they don't call `r.now()`.
+    write_message_t wm;
+    serialize<cluster_version_t::CLUSTER>(&wm, rget->region);
+    serialize<cluster_version_t::CLUSTER>(&wm, rget->hints);
+    serialize<cluster_version_t::CLUSTER>(&wm, rget->primary_keys);
+    serialize<cluster_version_t::CLUSTER>(
+        &wm, rget->serializable_env.global_optargs);
+    serialize<cluster_version_t::CLUSTER>(&wm, rget->table_name);
+    rget->batchspec.serialize_without_start_time(&wm);
+    serialize<cluster_version_t::CLUSTER>(&wm, rget->transforms);
+    serialize<cluster_version_t::CLUSTER>(&wm, rget->terminal);
+    serialize<cluster_version_t::CLUSTER>(&wm, static_cast<int8_t>(rget->sorting));
+    vector_stream_t stream;
+    stream.reserve(wm.size());
+    int res = send_write_message(&stream, &wm);
+    guarantee(res == 0);
+    return make_optional(std::string(stream.vector().begin(), stream.vector().end()));
+}
+
+bool read_result_cache_t::lookup(const std::string &key,
+                                 read_response_t *response_out) {
+    assert_thread();
+    auto it = changes_in_progress_ == 0 ? entries_.find(key) : entries_.end();
+    if (it == entries_.end()) {
+        ++pm_misses_;
+        return false;
+    }
+    ++pm_hits_;
+    lru_.splice(lru_.end(), lru_, it->second.lru_it);
+
+    rget_read_response_t rget_response;
+    vector_read_stream_t stream(std::vector<char>(it->second.data));
+    archive_result_t res =
+        deserialize<cluster_version_t::CLUSTER>(&stream, &rget_response);
+    guarantee_deserialization(res, "read result cache");
+    response_out->response = std::move(rget_response);
+    response_out->n_shards = 1;
+    // Like `store_t::protocol_read()`, for the end of the parallel task.
+    response_out->event_log.push_back(profile::stop_t());
+    return true;
+}
+
+void read_result_cache_t::insert(const std::string &key,
+                                 const read_t &read,
+                                 uint64_t generation,
+                                 const read_response_t &response) {
+    assert_thread();
+    if (changes_in_progress_ != 0 || generation != generation_) {
+        return;
+    }
+    const rget_read_t *rget = boost::get<rget_read_t>(&read.read);
+    const rget_read_response_t *rget_response =
+        boost::get<rget_read_response_t>(&response.response);
+    guarantee(rget != nullptr && rget_response != nullptr);
+
+    write_message_t wm;
+    serialize<cluster_version_t::CLUSTER>(&wm, *rget_response);
+    const size_t entry_size = key.size() + wm.size() + ENTRY_OVERHEAD;
+    if (entry_size > max_size_ / MAX_RESULT_FRACTION) {
+        return;
+    }
+    auto existing = entries_.find(key);
+    if (existing != entries_.end()) {
+        erase(existing);
+    }
+    while (size_ + entry_size > max_size_) {
+        erase(entries_.find(lru_.front()));
+    }
+
+    entry_t entry;
+    entry.range = rget->region.inner;
+    vector_stream_t stream;
+    stream.reserve(wm.size());
+    int res = send_write_message(&stream, &wm);
+    guarantee(res == 0);
+    stream.swap(&entry.data);
+    entry.lru_it = lru_.insert(lru_.end(), key);
+    entries_.insert(std::make_pair(key, std::move(entry)));
+    size_ += entry_size;
+    pm_size_ += entry_size;
+}
+
+void read_result_cache_t::invalidate(const store_key_t &key) {
+    assert_thread();
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        auto jt = it++;
+        if (jt->second.range.contains_key(key)) {
+            erase(jt);
+        }
+    }
+}
+
+void read_result_cache_t::clear() {
+    assert_thread();
+    while (!entries_.empty()) {
+        erase(entries_.begin());
+    }
+}
+
+void read_result_cache_t::erase(entries_t::iterator it) {
+    guarantee(it != entries_.end());
+    const size_t entry_size = it->first.size() + it->second.data.size()
+        + ENTRY_OVERHEAD;
+    size_ -= entry_size;
+    pm_size_ -= entry_size;
+    lru_.erase(it->second.lru_it);
+    entries_.erase(it);
+}
+
+read_result_cache_t::change_t::change_t(read_result_cache_t *parent)
+    : parent_(parent) {
+    parent_->assert_thread();
+    ++parent_->changes_in_progress_;
+    ++parent_->generation_;
+}
+
+read_result_cache_t::change_t::~change_t() {
+    parent_->assert_thread();
+    --parent_->changes_in_progress_;
+    ++parent_->generation_;
+}
@@ -0,0 +1,96 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_READ_RESULT_CACHE_HPP_
+#define RDB_PROTOCOL_READ_RESULT_CACHE_HPP_
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "btree/keys.hpp"
+#include "containers/optional.hpp"
+#include "perfmon/perfmon.hpp"
+#include "threading.hpp"
+
+class signal_t;
+struct read_t;
+struct read_response_t;
+
+/* The results of the reads of a store that were run with the `result_cache` optarg, so
+that a client that polls the same query over and over only reads the rows again after
+they changed.  The results are kept serialized, by the parts of the read that decide
+them (see `make_key()`), with the primary key range that they were read from.  Only
+the range reads of the primary index whose functions are deterministic, and don't call
+`r.now()`, can be cached.
+
+The store drops the results whose range contains the key of each
+`rdb_modification_report_t`, the same reports that feed the changefeeds, and all of
+them when it changes the rows some other way, like a backfill.  A write releases the
+superblock before it reports its changes, so while a change is going on (see
+`change_t`) no result is used or stored, and a read only stores its result if no change
+started or ended since before it acquired the superblock (see `generation()`). */
+class read_result_cache_t : public home_thread_mixin_t {
+public:
+    read_result_cache_t(perfmon_collection_t *parent, size_t max_size);
+    ~read_result_cache_t();
+
+    // Returns the key of `read`'s result, or nothing if it can't be cached.
+    static optional<std::string> make_key(const read_t &read, signal_t *interruptor);
+
+    // Sets `*response_out` and returns true if the result of `key` is cached.
+    bool lookup(const std::string &key, read_response_t *response_out);
+
+    // Changes whenever a change to the store starts or ends.
+    uint64_t generation() const { return generation_; }
+
+    // Stores the `response` to `read`, whose key is `key`, unless the store changed
+    // since `generation`.
+    void insert(const std::string &key,
+                const read_t &read,
+                uint64_t generation,
+                const read_response_t &response);
+
+    // Drops the results that were read from a range that contains `key`.
+    void invalidate(const store_key_t &key);
+
+    // Drops every result.
+    void clear();
+
+    // Disables the cache while the store changes.
+    class change_t {
+    public:
+        explicit change_t(read_result_cache_t *parent);
+        ~change_t();
+    private:
+        read_result_cache_t *parent_;
+        DISABLE_COPYING(change_t);
+    };
+
+private:
+    struct entry_t {
+        key_range_t range;
+        std::vector<char> data;
+        std::list<std::string>::iterator lru_it;
+    };
+    typedef std::map<std::string, entry_t> entries_t;
+
+    void erase(entries_t::iterator it);
+
+    const size_t max_size_;
+    size_t size_;
+    uint64_t generation_;
+    int changes_in_progress_;
+
+    entries_t entries_;
+    // The keys of `entries_`, from the least recently used.
+    std::list<std::string> lru_;
+
+    perfmon_collection_t stats_;
+    perfmon_membership_t stats_membership_;
+    perfmon_counter_t pm_hits_, pm_misses_, pm_size_;
+    perfmon_multi_membership_t pm_membership_;
+
+    DISABLE_COPYING(read_result_cache_t);
+};
+
+#endif  // RDB_PROTOCOL_READ_RESULT_CACHE_HPP_
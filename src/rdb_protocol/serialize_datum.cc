@@ -871,7 +871,11 @@ std::pair<datum_string_t, datum_t> datum_deserialize_pair_from_buf(
      varint num_elements
      ... */
 size_t datum_get_array_size(const shared_buf_ref_t<char> &array) {
-    buffer_read_stream_t sz_read_stream(array.get(), array.get_safety_boundary());
+    return datum_get_array_size(array.get(), array.get_safety_boundary());
+}
+
+size_t datum_get_array_size(const char *array, size_t size) {
+    buffer_read_stream_t sz_read_stream(array, size);
     uint64_t ser_size;
     guarantee_deserialization(deserialize_varint_uint64(&sz_read_stream, &ser_size),
                               "datum decode array");
@@ -888,7 +892,11 @@ size_t datum_get_array_size(const shared_buf_ref_t<char> &array) {
      uint*_t offsets[num_elements - 1] // counted from `data`, first element omitted
      T data[num_elements] */
 size_t datum_get_element_offset(const shared_buf_ref_t<char> &array, size_t index) {
-    buffer_read_stream_t sz_read_stream(array.get(), array.get_safety_boundary());
+    return datum_get_element_offset(array.get(), array.get_safety_boundary(), index);
+}
+
+size_t datum_get_element_offset(const char *array, size_t size, size_t index) {
+    buffer_read_stream_t sz_read_stream(array, size);
     uint64_t ser_size = 0;
     guarantee_deserialization(deserialize_varint_uint64(&sz_read_stream, &ser_size),
                               "datum decode array");
@@ -927,10 +935,10 @@ size_t datum_get_element_offset(const shared_buf_ref_t<char> &array, size_t inde
             static_cast<size_t>(sz_read_stream.tell())
             + (index - 1) * serialized_offset_size;
 
-        array.guarantee_in_boundary(element_offset_offset);
+        guarantee(size >= element_offset_offset);
         buffer_read_stream_t read_stream(
-            array.get() + element_offset_offset,
-            array.get_safety_boundary() - element_offset_offset);
+            array + element_offset_offset,
+            size - element_offset_offset);
 
         uint64_t element_offset;
         switch (offset_size) {
@@ -966,6 +974,51 @@ size_t datum_get_element_offset(const shared_buf_ref_t<char> &array, size_t inde
     }
 }
 
+/* The elements of objects are pairs of a `datum_string_t` key and a datum, sorted by
+their keys, so this is the binary search of `datum_t::get_field()`. */
+serialized_field_t datum_find_serialized_field(const char *data,
+                                               size_t size,
+                                               const datum_string_t &key,
+                                               size_t *offset_out) {
+    buffer_read_stream_t type_read_stream(data, size);
+    datum_serialized_type_t type = datum_serialized_type_t::R_NULL;
+    guarantee_deserialization(datum_deserialize(&type_read_stream, &type),
+                              "datum type");
+    if (type != datum_serialized_type_t::BUF_R_OBJECT) {
+        return serialized_field_t::NOT_BUF_OBJECT;
+    }
+    const size_t object_offset = static_cast<size_t>(type_read_stream.tell());
+    const char *object = data + object_offset;
+    const size_t object_size = size - object_offset;
+
+    size_t range_beg = 0;
+    size_t range_end = datum_get_array_size(object, object_size);
+    while (range_beg < range_end) {
+        const size_t center = range_beg + ((range_end - range_beg) / 2);
+        const size_t pair_offset = datum_get_element_offset(object, object_size, center);
+        guarantee(object_size >= pair_offset);
+        buffer_read_stream_t key_read_stream(object + pair_offset,
+                                             object_size - pair_offset);
+        uint64_t key_size;
+        guarantee_deserialization(deserialize_varint_uint64(&key_read_stream, &key_size),
+                                  "datum decode object key");
+        const size_t key_offset =
+            pair_offset + static_cast<size_t>(key_read_stream.tell());
+        guarantee(key_size <= object_size - key_offset);
+        const int cmp_res = key.compare(static_cast<size_t>(key_size),
+                                        object + key_offset);
+        if (cmp_res == 0) {
+            *offset_out = object_offset + key_offset + static_cast<size_t>(key_size);
+            return serialized_field_t::FOUND;
+        } else if (cmp_res < 0) {
+            range_end = center;
+        } else {
+            range_beg = center + 1;
+        }
+    }
+    return serialized_field_t::MISSING;
+}
+
 size_t datum_serialized_size(const datum_string_t &s) {
     const size_t s_size = s.size();
     return varint_uint64_serialized_size(s_size) + s_size;
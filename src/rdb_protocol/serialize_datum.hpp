@@ -55,8 +55,21 @@ std::pair<datum_string_t, datum_t> datum_deserialize_pair_from_buf(
 
 // Finds the offset of the given array element in the buffer
 size_t datum_get_element_offset(const shared_buf_ref_t<char> &array, size_t index);
+size_t datum_get_element_offset(const char *array, size_t size, size_t index);
 // Reads the number of elements in the array stored in the buffer
 size_t datum_get_array_size(const shared_buf_ref_t<char> &array);
+size_t datum_get_array_size(const char *array, size_t size);
+
+enum class serialized_field_t { FOUND, MISSING, NOT_BUF_OBJECT };
+
+// Looks for the field `key` of the object serialized in `data` without deserializing
+// it.  If it's there, sets `*offset_out` to the offset of its serialized value in
+// `data`.  Objects in the old format, without an offset table, and datums that
+// aren't objects are `NOT_BUF_OBJECT`.
+serialized_field_t datum_find_serialized_field(const char *data,
+                                               size_t size,
+                                               const datum_string_t &key,
+                                               size_t *offset_out);
 
 size_t datum_serialized_size(const datum_string_t &s);
 serialization_result_t datum_serialize(write_message_t *wm, const datum_string_t &s);
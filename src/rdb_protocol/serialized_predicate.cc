@@ -0,0 +1,322 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/serialized_predicate.hpp"
+
+#include <utility>
+
+#include "containers/archive/buffer_stream.hpp"
+#include "rdb_protocol/func.hpp"
+#include "rdb_protocol/pseudo_literal.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
+#include "rdb_protocol/term_storage.hpp"
+#include "rdb_protocol/wire_func.hpp"
+
+namespace ql {
+
+namespace {
+
+// What a part of the predicate evaluates to.  `missing_field` stands for the
+// non-existence error of the function, which makes `filter` skip the row.
+enum class truth_t { yes, no, missing_field, unknown };
+
+// Whether `d` has an `r.literal`, which `filter_match()` treats differently.
+bool has_literal(const datum_t &d) {
+    if (d.get_type() != datum_t::R_OBJECT) {
+        return false;
+    }
+    if (d.is_ptype(pseudo::literal_string)) {
+        return true;
+    }
+    for (size_t i = 0; i < d.obj_size(); ++i) {
+        if (has_literal(d.get_pair(i).second)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// `filter_match()`, with the missing fields as `missing_field` instead of errors.
+truth_t match_datum(const datum_t &pattern, const datum_t &value) {
+    for (size_t i = 0; i < pattern.obj_size(); ++i) {
+        auto pair = pattern.get_pair(i);
+        datum_t elt = value.get_field(pair.first, NOTHROW);
+        if (!elt.has()) {
+            return truth_t::missing_field;
+        } else if (pair.second.get_type() == datum_t::R_OBJECT
+                   && elt.get_type() == datum_t::R_OBJECT) {
+            truth_t res = match_datum(pair.second, elt);
+            if (res != truth_t::yes) {
+                return res;
+            }
+        } else if (elt != pair.second) {
+            return truth_t::no;
+        }
+    }
+    return truth_t::yes;
+}
+
+datum_t deserialize_field(const char *data, size_t size) {
+    buffer_read_stream_t read_stream(data, size);
+    datum_t res;
+    guarantee_deserialization(datum_deserialize(&read_stream, &res), "datum field");
+    return res;
+}
+
+}  // namespace
+
+struct serialized_predicate_t::node_t {
+    enum class type_t { AND, OR, NOT, COMPARE, MATCH };
+
+    // Returns an empty pointer if `term` isn't simple enough.
+    static scoped_ptr_t<node_t> compile(const raw_term_t &term, sym_t var);
+    // Sets `*path_out` to the fields that `term` gets from `var`, outermost first.
+    static bool compile_path(const raw_term_t &term,
+                             sym_t var,
+                             std::vector<datum_string_t> *path_out);
+
+    truth_t eval(const char *data, size_t size) const;
+    truth_t eval_compare(const char *data, size_t size) const;
+    truth_t eval_match(const char *data, size_t size) const;
+
+    type_t type;
+    // For `AND`, `OR` and `NOT`.
+    std::vector<scoped_ptr_t<node_t> > children;
+    // For `COMPARE`, the field of the row on the left of `comparison`.
+    std::vector<datum_string_t> path;
+    Term::TermType comparison;
+    // For `COMPARE`, the right side of `comparison`, and for `MATCH`, the object.
+    datum_t constant;
+};
+
+scoped_ptr_t<serialized_predicate_t::node_t> serialized_predicate_t::node_t::compile(
+        const raw_term_t &term, sym_t var) {
+    scoped_ptr_t<node_t> node(new node_t());
+    switch (static_cast<int>(term.type())) {
+    case Term::AND: // fallthru
+    case Term::OR: // fallthru
+    case Term::NOT: {
+        if (term.num_args() == 0 || term.num_optargs() != 0
+            || (term.type() == Term::NOT && term.num_args() != 1)) {
+            return scoped_ptr_t<node_t>();
+        }
+        node->type = term.type() == Term::AND ? type_t::AND
+            : term.type() == Term::OR ? type_t::OR
+            : type_t::NOT;
+        for (size_t i = 0; i < term.num_args(); ++i) {
+            scoped_ptr_t<node_t> child = compile(term.arg(i), var);
+            if (!child.has()) {
+                return scoped_ptr_t<node_t>();
+            }
+            node->children.push_back(std::move(child));
+        }
+    } break;
+    case Term::EQ: // fallthru
+    case Term::NE: // fallthru
+    case Term::LT: // fallthru
+    case Term::LE: // fallthru
+    case Term::GT: // fallthru
+    case Term::GE: {
+        if (term.num_args() != 2 || term.num_optargs() != 0) {
+            return scoped_ptr_t<node_t>();
+        }
+        node->type = type_t::COMPARE;
+        node->comparison = term.type();
+        if (term.arg(1).type() == Term::DATUM
+            && compile_path(term.arg(0), var, &node->path)) {
+            node->constant = term.arg(1).datum();
+        } else if (term.arg(0).type() == Term::DATUM
+                   && compile_path(term.arg(1), var, &node->path)) {
+            // `1 < row("x")` is `row("x") > 1`.
+            node->constant = term.arg(0).datum();
+            switch (static_cast<int>(node->comparison)) {
+            case Term::LT: node->comparison = Term::GT; break;
+            case Term::LE: node->comparison = Term::GE; break;
+            case Term::GT: node->comparison = Term::LT; break;
+            case Term::GE: node->comparison = Term::LE; break;
+            default: break;
+            }
+        } else {
+            return scoped_ptr_t<node_t>();
+        }
+    } break;
+    default:
+        return scoped_ptr_t<node_t>();
+    }
+    return node;
+}
+
+bool serialized_predicate_t::node_t::compile_path(
+        const raw_term_t &term,
+        sym_t var,
+        std::vector<datum_string_t> *path_out) {
+    if ((term.type() != Term::GET_FIELD && term.type() != Term::BRACKET)
+        || term.num_args() != 2 || term.num_optargs() != 0
+        || term.arg(1).type() != Term::DATUM) {
+        return false;
+    }
+    datum_t field = term.arg(1).datum();
+    if (field.get_type() != datum_t::R_STR) {
+        return false;
+    }
+    if (!refers_to_var(term.arg(0), var)
+        && !compile_path(term.arg(0), var, path_out)) {
+        return false;
+    }
+    path_out->push_back(field.as_str());
+    return true;
+}
+
+truth_t serialized_predicate_t::node_t::eval(const char *data, size_t size) const {
+    switch (type) {
+    case type_t::AND: {
+        for (const auto &child : children) {
+            truth_t res = child->eval(data, size);
+            if (res != truth_t::yes) {
+                return res;
+            }
+        }
+        return truth_t::yes;
+    }
+    case type_t::OR: {
+        for (const auto &child : children) {
+            truth_t res = child->eval(data, size);
+            if (res != truth_t::no) {
+                return res;
+            }
+        }
+        return truth_t::no;
+    }
+    case type_t::NOT: {
+        truth_t res = children[0]->eval(data, size);
+        return res == truth_t::yes ? truth_t::no
+            : res == truth_t::no ? truth_t::yes
+            : res;
+    }
+    case type_t::COMPARE:
+        return eval_compare(data, size);
+    case type_t::MATCH:
+        return eval_match(data, size);
+    default:
+        unreachable();
+    }
+}
+
+truth_t serialized_predicate_t::node_t::eval_compare(
+        const char *data, size_t size) const {
+    for (const auto &key : path) {
+        size_t offset;
+        switch (datum_find_serialized_field(data, size, key, &offset)) {
+        case serialized_field_t::FOUND:
+            data += offset;
+            size -= offset;
+            break;
+        case serialized_field_t::MISSING:
+            return truth_t::missing_field;
+        case serialized_field_t::NOT_BUF_OBJECT:
+            // Maybe an object of the old format, or an array that `row("x")("y")`
+            // would pluck from.
+            return truth_t::unknown;
+        default:
+            unreachable();
+        }
+    }
+    datum_t value = deserialize_field(data, size);
+    try {
+        bool res;
+        switch (static_cast<int>(comparison)) {
+        case Term::EQ: res = value == constant; break;
+        case Term::NE: res = value != constant; break;
+        case Term::LT: res = value.cmp(constant) < 0; break;
+        case Term::LE: res = value.cmp(constant) <= 0; break;
+        case Term::GT: res = value.cmp(constant) > 0; break;
+        case Term::GE: res = value.cmp(constant) >= 0; break;
+        default: unreachable();
+        }
+        return res ? truth_t::yes : truth_t::no;
+    } catch (const base_exc_t &) {
+        // The function will throw the same error, with its backtrace.
+        return truth_t::unknown;
+    }
+}
+
+truth_t serialized_predicate_t::node_t::eval_match(
+        const char *data, size_t size) const {
+    for (size_t i = 0; i < constant.obj_size(); ++i) {
+        auto pair = constant.get_pair(i);
+        size_t offset;
+        switch (datum_find_serialized_field(data, size, pair.first, &offset)) {
+        case serialized_field_t::FOUND:
+            break;
+        case serialized_field_t::MISSING:
+            return truth_t::missing_field;
+        case serialized_field_t::NOT_BUF_OBJECT:
+            return truth_t::unknown;
+        default:
+            unreachable();
+        }
+        datum_t elt = deserialize_field(data + offset, size - offset);
+        if (pair.second.get_type() == datum_t::R_OBJECT
+            && elt.get_type() == datum_t::R_OBJECT) {
+            truth_t res = match_datum(pair.second, elt);
+            if (res != truth_t::yes) {
+                return res;
+            }
+        } else if (elt != pair.second) {
+            return truth_t::no;
+        }
+    }
+    return truth_t::yes;
+}
+
+serialized_predicate_t::serialized_predicate_t(scoped_ptr_t<node_t> &&_root)
+    : root(std::move(_root)) {
+    guarantee(root.has());
+}
+
+serialized_predicate_t::~serialized_predicate_t() { }
+
+scoped_ptr_t<serialized_predicate_t> serialized_predicate_t::compile(
+        const filter_wire_func_t &filter) {
+    if (filter.default_filter_val.has_value()) {
+        return scoped_ptr_t<serialized_predicate_t>();
+    }
+    return filter.filter_func.compile_wire_func()->compile_predicate();
+}
+
+scoped_ptr_t<serialized_predicate_t> serialized_predicate_t::compile(
+        const raw_term_t &body, const std::vector<sym_t> &arg_names) {
+    scoped_ptr_t<node_t> root;
+    if (body.type() == Term::DATUM) {
+        // `filter({...})` matches the fields of the rows (see `filter_helper()`).
+        datum_t obj = body.datum();
+        if (obj.get_type() == datum_t::R_OBJECT && !has_literal(obj)) {
+            root.init(new node_t());
+            root->type = node_t::type_t::MATCH;
+            root->constant = obj;
+        }
+    } else if (arg_names.size() == 1) {
+        root = node_t::compile(body, arg_names[0]);
+    }
+    if (!root.has()) {
+        return scoped_ptr_t<serialized_predicate_t>();
+    }
+    return scoped_ptr_t<serialized_predicate_t>(
+        new serialized_predicate_t(std::move(root)));
+}
+
+serialized_predicate_t::result_t serialized_predicate_t::test(
+        const char *data, size_t size) const {
+    switch (root->eval(data, size)) {
+    case truth_t::yes:
+        return result_t::PASS;
+    case truth_t::no: // fallthru
+    case truth_t::missing_field:
+        // Without a default, `filter` skips the rows that a field is missing from.
+        return result_t::FAIL;
+    case truth_t::unknown:
+        return result_t::UNKNOWN;
+    default:
+        unreachable();
+    }
+}
+
+}  // namespace ql
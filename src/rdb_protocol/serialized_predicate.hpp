@@ -0,0 +1,53 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_SERIALIZED_PREDICATE_HPP_
+#define RDB_PROTOCOL_SERIALIZED_PREDICATE_HPP_
+
+#include <vector>
+
+#include "containers/scoped.hpp"
+#include "rdb_protocol/sym.hpp"
+
+namespace ql {
+
+class filter_wire_func_t;
+class raw_term_t;
+
+/* A `filter` function that is simple enough to run on the serialized rows in the
+leaves, so that the rows it rejects are never deserialized.  It can be a comparison
+(`eq`, `ne`, `lt`, `le`, `gt` or `ge`) of a field of the row, or a field of a field,
+with a constant, any `and`, `or` and `not` of those, or the constant object of
+`filter({...})`.  Only the compared fields are deserialized.
+
+Whenever the result could differ from that of the function, like when a field that
+is compared to an object isn't one, or the function would throw an error other than
+a missing field, the predicate doesn't decide and the row goes through the function
+as usual. */
+class serialized_predicate_t {
+public:
+    enum class result_t { PASS, FAIL, UNKNOWN };
+
+    // Returns an empty pointer if `filter` is not simple enough, or has a default.
+    static scoped_ptr_t<serialized_predicate_t> compile(
+        const filter_wire_func_t &filter);
+    // Called by `reql_func_t::compile_predicate()`.
+    static scoped_ptr_t<serialized_predicate_t> compile(
+        const raw_term_t &body, const std::vector<sym_t> &arg_names);
+
+    ~serialized_predicate_t();
+
+    // `data` is the serialized row.
+    result_t test(const char *data, size_t size) const;
+
+private:
+    struct node_t;
+
+    explicit serialized_predicate_t(scoped_ptr_t<node_t> &&root);
+
+    scoped_ptr_t<node_t> root;
+
+    DISABLE_COPYING(serialized_predicate_t);
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_SERIALIZED_PREDICATE_HPP_
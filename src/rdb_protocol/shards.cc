@@ -6,6 +6,7 @@
 #include "errors.hpp"
 #include <boost/variant.hpp>
 
+#include "config/args.hpp"
 #include "debug.hpp"
 #include "rdb_protocol/datum_stream.hpp"
 #include "rdb_protocol/func.hpp"
@@ -510,18 +511,32 @@ scoped_ptr_t<eager_acc_t> make_to_array() {
 template<class T>
 class terminal_t : public grouped_acc_t<T>, public eager_acc_t {
 protected:
-    explicit terminal_t(T &&t) : grouped_acc_t<T>(std::move(t)) { }
+    explicit terminal_t(T &&t)
+        : grouped_acc_t<T>(std::move(t)), pending_env(nullptr), num_pending(0) { }
+
+    // Accumulates the rows of a group in one go.  The terminals override this when
+    // they can do better than accumulating the rows one at a time.
+    virtual bool accumulate_batch(env_t *env, const datums_t &els, T *out) {
+        bool keep = false;
+        for (auto el = els.begin(); el != els.end(); ++el) {
+            keep |= accumulate(env, *el, out);
+        }
+        return keep;
+    }
+
+    // Whether the rows that come one at a time from a shard should be buffered, so
+    // that `accumulate_batch` sees them together.
+    virtual bool buffers_rows() { return false; }
+
 private:
-    virtual void operator()(env_t *env, groups_t *groups) {
+    void accumulate_groups(env_t *env, groups_t *groups) {
         grouped_t<T> *_acc = grouped_acc_t<T>::get_acc();
         const T *_default_val = grouped_acc_t<T>::get_default_val();
         for (auto it = groups->begin(); it != groups->end(); ++it) {
             auto pair = _acc->insert(std::make_pair(it->first, *_default_val));
             auto t_it = pair.first;
             bool keep = !pair.second;
-            for (auto el = it->second.begin(); el != it->second.end(); ++el) {
-                keep |= accumulate(env, *el, &t_it->second);
-            }
+            keep |= accumulate_batch(env, it->second, &t_it->second);
             if (!keep) {
                 _acc->erase(t_it);
             }
@@ -529,6 +544,49 @@ private:
         groups->clear();
     }
 
+    virtual void operator()(env_t *env, groups_t *groups) {
+        accumulate_groups(env, groups);
+    }
+
+    virtual continue_bool_t operator()(env_t *env,
+                                       groups_t *groups,
+                                       const store_key_t &,
+                                       const std::function<datum_t()> &) {
+        if (!buffers_rows()) {
+            accumulate_groups(env, groups);
+            return continue_bool_t::CONTINUE;
+        }
+        // The environment outlives the traversal that calls us, and `finish_impl`
+        // accumulates what is left in the buffer before the traversal returns.
+        pending_env = env;
+        for (auto it = groups->begin(); it != groups->end(); ++it) {
+            datums_t *buffer = &pending[it->first];
+            buffer->insert(buffer->end(),
+                           std::make_move_iterator(it->second.begin()),
+                           std::make_move_iterator(it->second.end()));
+            num_pending += it->second.size();
+        }
+        groups->clear();
+        if (num_pending >= ACCUMULATOR_BATCH_SIZE) {
+            accumulate_groups(env, &pending);
+            num_pending = 0;
+        }
+        return continue_bool_t::CONTINUE;
+    }
+
+    virtual void finish_impl(continue_bool_t last_cb, result_t *out) {
+        if (num_pending != 0) {
+            try {
+                accumulate_groups(pending_env, &pending);
+                num_pending = 0;
+            } catch (const exc_t &e) {
+                *out = e;
+                return;
+            }
+        }
+        grouped_acc_t<T>::finish_impl(last_cb, out);
+    }
+
     virtual scoped_ptr_t<val_t> finish_eager(backtrace_id_t bt,
                                              bool is_grouped,
                                              UNUSED const configured_limits_t &limits) {
@@ -597,6 +655,10 @@ private:
     }
     virtual void unshard_impl(env_t *env, T *out, T *el) = 0;
     virtual bool should_send_batch() { return false; }
+
+    env_t *pending_env;
+    groups_t pending;
+    size_t num_pending;
 };
 
 class count_terminal_t : public terminal_t<uint64_t> {
@@ -611,6 +673,10 @@ private:
         *out += 1;
         return true;
     }
+    virtual bool accumulate_batch(env_t *, const datums_t &els, uint64_t *out) {
+        *out += els.size();
+        return !els.empty();
+    }
     virtual datum_t unpack(uint64_t *sz) {
         return datum_t(static_cast<double>(*sz));
     }
@@ -625,6 +691,9 @@ public:
     datum_t operator()(env_t *env, const datum_t &el) const {
         return f.has() ? f->call(env, el)->as_datum() : el;
     }
+    optional<datum_string_t> selected_field() const {
+        return f.has() ? f->selected_field() : r_nullopt;
+    }
 private:
     counted_t<const func_t> f;
 };
@@ -635,7 +704,47 @@ protected:
     skip_terminal_t(const skip_wire_func_t &wf, T &&t)
         : terminal_t<T>(std::move(t)),
           f(wf.compile_wire_func_or_null()),
-          bt(wf.bt) { }
+          bt(wf.bt),
+          field(f.selected_field()) { }
+    virtual bool buffers_rows() { return field.has_value(); }
+    virtual bool accumulate_batch(env_t *env, const datums_t &els, T *out) {
+        if (!field.has_value()) {
+            return terminal_t<T>::accumulate_batch(env, els, out);
+        }
+        // The function just gets a field, so we read the field of each row into
+        // `column` and accumulate the numbers in one go.  A row that isn't an object,
+        // or whose field isn't a number, goes through the function instead.
+        bool keep = false;
+        size_t i = 0;
+        while (i < els.size()) {
+            column.clear();
+            column_rows.clear();
+            for (; i < els.size(); ++i) {
+                if (els[i].get_type() != datum_t::R_OBJECT) {
+                    break;
+                }
+                datum_t val = els[i].get_field(*field, NOTHROW);
+                if (!val.has()) {
+                    // The function would fail with `NON_EXISTENCE`, so we skip it.
+                    continue;
+                }
+                if (val.get_type() != datum_t::R_NUM) {
+                    break;
+                }
+                column.push_back(val.as_num());
+                column_rows.push_back(i);
+            }
+            if (!column.empty()) {
+                acc_column(els, column, column_rows, out);
+                keep = true;
+            }
+            if (i < els.size()) {
+                keep |= accumulate(env, els[i], out);
+                ++i;
+            }
+        }
+        return keep;
+    }
     virtual bool accumulate(env_t *env,
                             const datum_t &el,
                             T *out) {
@@ -658,9 +767,19 @@ private:
                            const datum_t &el,
                            T *out,
                            const acc_func_t &f) = 0;
+    // Accumulates the numbers in `_column`, which come from the rows of `els` at the
+    // indexes in `rows`, in order.
+    virtual void acc_column(const datums_t &els,
+                            const std::vector<double> &_column,
+                            const std::vector<size_t> &rows,
+                            T *out) = 0;
 
     acc_func_t f;
     backtrace_id_t bt;
+    const optional<datum_string_t> field;
+    // Reused by `accumulate_batch`, so that we don't allocate them for every batch.
+    std::vector<double> column;
+    std::vector<size_t> column_rows;
 };
 
 class sum_terminal_t : public skip_terminal_t<double> {
@@ -674,6 +793,16 @@ private:
                            const acc_func_t &_f) {
         *out += _f(env, el).as_num();
     }
+    virtual void acc_column(const datums_t &,
+                            const std::vector<double> &column,
+                            const std::vector<size_t> &,
+                            double *out) {
+        double sum = *out;
+        for (double d : column) {
+            sum += d;
+        }
+        *out = sum;
+    }
     virtual datum_t unpack(double *d) {
         return datum_t(*d);
     }
@@ -695,6 +824,17 @@ private:
         out->first += _f(env, el).as_num();
         out->second += 1;
     }
+    virtual void acc_column(const datums_t &,
+                            const std::vector<double> &column,
+                            const std::vector<size_t> &,
+                            std::pair<double, uint64_t> *out) {
+        double sum = out->first;
+        for (double d : column) {
+            sum += d;
+        }
+        out->first = sum;
+        out->second += column.size();
+    }
     virtual datum_t unpack(
         std::pair<double, uint64_t> *p) {
         rcheck_datum(p->second != 0, base_exc_t::NON_EXISTENCE,
@@ -749,14 +889,19 @@ bool datum_gt(const datum_t &val1, const datum_t &val2) {
     return val1 > val2;
 }
 
+bool num_lt(double val1, double val2) { return val1 < val2; }
+bool num_gt(double val1, double val2) { return val1 > val2; }
+
 class optimizing_terminal_t : public skip_terminal_t<optimizer_t> {
 public:
     optimizing_terminal_t(const skip_wire_func_t &_f,
                           const char *_name,
-                          bool (*_cmp)(const datum_t &val1, const datum_t &val2))
+                          bool (*_cmp)(const datum_t &val1, const datum_t &val2),
+                          bool (*_num_cmp)(double val1, double val2))
         : skip_terminal_t<optimizer_t>(_f, optimizer_t()),
           name(_name),
-          cmp(_cmp) { }
+          cmp(_cmp),
+          num_cmp(_num_cmp) { }
 private:
     virtual void maybe_acc(env_t *env,
                            const datum_t &el,
@@ -765,6 +910,20 @@ private:
         optimizer_t other(el, _f(env, el));
         out->swap_if_other_better(&other, cmp);
     }
+    virtual void acc_column(const datums_t &els,
+                            const std::vector<double> &column,
+                            const std::vector<size_t> &rows,
+                            optimizer_t *out) {
+        // Like `swap_if_other_better`, we keep the first of the rows that tie.
+        size_t best = 0;
+        for (size_t i = 1; i < column.size(); ++i) {
+            if (num_cmp(column[i], column[best])) {
+                best = i;
+            }
+        }
+        optimizer_t other(els[rows[best]], datum_t(column[best]));
+        out->swap_if_other_better(&other, cmp);
+    }
     virtual datum_t unpack(optimizer_t *el) {
         return el->unpack(name);
     }
@@ -773,6 +932,7 @@ private:
     }
     const char *name;
     bool (*cmp)(const datum_t &val1, const datum_t &val2);
+    bool (*num_cmp)(double val1, double val2);
 };
 
 const char *const empty_stream_msg =
@@ -820,10 +980,10 @@ public:
         return new avg_terminal_t(f);
     }
     T *operator()(const min_wire_func_t &f) const {
-        return new optimizing_terminal_t(f, "min", datum_lt);
+        return new optimizing_terminal_t(f, "min", datum_lt, num_lt);
     }
     T *operator()(const max_wire_func_t &f) const {
-        return new optimizing_terminal_t(f, "max", datum_gt);
+        return new optimizing_terminal_t(f, "max", datum_gt, num_gt);
     }
     T *operator()(const reduce_wire_func_t &f) const {
         return new reduce_terminal_t(f);
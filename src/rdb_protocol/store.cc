@@ -838,9 +838,6 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
     }
 
     void operator()(const batched_insert_t &bi) {
-        rdb_modification_report_cb_t sindex_cb(
-            store, &sindex_block,
-            auto_drainer_t::lock_t(&store->drainer));
         ql::env_t ql_env(
             ctx,
             ql::return_empty_normal_batches_t::NO,
@@ -854,6 +851,32 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
         for (auto it = bi.inserts.begin(); it != bi.inserts.end(); ++it) {
             keys.emplace_back(it->get_field(datum_string_t(bi.pkey)).print_primary());
         }
+
+        // Initial loads of a table are built bottom up.  This has to be tried before
+        // `sindex_cb` acquires the secondary index superblocks.
+        batched_replace_response_t bulk_load_response;
+        if (rdb_bulk_load_batched_insert(
+                store,
+                btree_info_t(btree, timestamp, datum_string_t(bi.pkey)),
+                superblock,
+                &sindex_block,
+                keys,
+                &replacer,
+                bi.limits,
+                &bulk_load_response,
+                sampler,
+                trace)) {
+            // The bulk load doesn't make modification reports, which would invalidate
+            // the cached results of the rows one at a time.  The table was empty, so
+            // none of them is worth keeping.
+            store->read_results.clear();
+            response->response = bulk_load_response;
+            return;
+        }
+
+        rdb_modification_report_cb_t sindex_cb(
+            store, &sindex_block,
+            auto_drainer_t::lock_t(&store->drainer));
         response->response =
             rdb_batched_replace(
                 btree_info_t(btree, timestamp, datum_string_t(bi.pkey)),
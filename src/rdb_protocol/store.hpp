@@ -23,6 +23,7 @@
 #include "protocol_api.hpp"
 #include "rdb_protocol/changefeed.hpp"
 #include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/read_result_cache.hpp"
 #include "rdb_protocol/store_metainfo.hpp"
 #include "rpc/mailbox/typed.hpp"
 #include "store_view.hpp"
@@ -87,7 +88,8 @@ public:
             io_backender_t *io_backender,
             const base_path_t &base_path,
             namespace_id_t table_id,
-            update_sindexes_t update_sindexes);
+            update_sindexes_t update_sindexes,
+            const optional<std::string> &cache_manifest_path);
     ~store_t();
 
     void note_reshard(const region_t &shard_region);
@@ -398,6 +400,10 @@ public:
     // `btree.cc`.
     rwlock_t cfeed_stamp_lock;
 
+    // The results of the reads that asked to be cached.  Every change to the rows
+    // must go through `invalidate()`, or `clear()` after the fact.
+    read_result_cache_t read_results;
+
 private:
     rdb_context_t *ctx;
     // We store regions here even though we only really need the key ranges
@@ -390,6 +390,10 @@ continue_bool_t store_t::receive_backfill(
         THROWS_ONLY(interrupted_exc_t) {
     guarantee(_region.beg == get_region().beg && _region.end == get_region().end);
 
+    // The backfill changes the rows without modification reports.
+    read_result_cache_t::change_t cache_change(&read_results);
+    read_results.clear();
+
     unsaved_data_limiter_t unsaved_data_limiter(general_cache_conn.get());
     receive_backfill_info_t info(
         general_cache_conn.get(), btree.get(), &unsaved_data_limiter);
@@ -3,6 +3,7 @@
 
 #include <string>
 
+#include "rdb_protocol/compiled_query_cache.hpp"
 #include "rdb_protocol/op.hpp"
 
 namespace ql {
@@ -34,6 +35,33 @@ private:
     const datum_t datum;
 };
 
+// A literal of a query that was compiled with parameters, which takes its value from
+// the environment (see `compiled_query_cache_t`).  The type of the value is the same
+// for every query that uses the compiled term.
+class parameter_term_t : public term_t {
+public:
+    parameter_term_t(const raw_term_t &term, size_t _index)
+            : term_t(term),
+              index(_index),
+              is_string(term.datum().get_type() == datum_t::type_t::R_STR) { }
+
+    bool is_simple_selector() const {
+        return is_string;
+    }
+
+private:
+    virtual void accumulate_captures(var_captures_t *) const { /* do nothing */ }
+    virtual deterministic_t is_deterministic() const {
+        return deterministic_t::always();
+    }
+    virtual scoped_ptr_t<val_t> term_eval(scope_env_t *env, eval_flags_t) const {
+        return new_val(env->env->get_parameter(index));
+    }
+    virtual const char *name() const { return "datum"; }
+    const size_t index;
+    const bool is_string;
+};
+
 class constant_term_t : public op_term_t {
 public:
     constant_term_t(compile_env_t *env, const raw_term_t &term,
@@ -147,7 +175,13 @@ private:
 };
 
 counted_t<term_t> make_datum_term(
-        const raw_term_t &term) {
+        compile_env_t *env, const raw_term_t &term) {
+    if (env->parameters != nullptr) {
+        optional<size_t> index = env->parameters->compile(term.bt());
+        if (index.has_value()) {
+            return make_counted<parameter_term_t>(term, *index);
+        }
+    }
     return make_counted<datum_term_t>(term);
 }
 counted_t<term_t> make_constant_term(
@@ -28,7 +28,8 @@ datum_string_t sindex_config_to_string(const sindex_config_t &config) {
     version.original_reql_version = config.func_version;
     version.latest_compatible_reql_version = config.func_version;
     version.latest_checked_reql_version = reql_version_t::LATEST;
-    sindex_disk_info_t disk_info(config.func, version, config.multi, config.geo);
+    sindex_disk_info_t disk_info(config.func, version, config.multi, config.geo,
+                                 config.include);
 
     write_message_t wm;
     serialize_sindex_info(&wm, disk_info);
@@ -89,7 +90,8 @@ sindex_config_t sindex_config_from_string(
         sindex_info.mapping,
         sindex_info.mapping_version_info.original_reql_version,
         sindex_info.multi,
-        sindex_info.geo);
+        sindex_info.geo,
+        sindex_info.include);
 }
 
 // Helper for `sindex_status_to_datum()`
@@ -119,6 +121,22 @@ std::string format_index_create_query(
         }
         ret += "geo: true";
     }
+    if (!config.include.empty()) {
+        if (first_optarg) {
+            ret += ", {";
+            first_optarg = false;
+        } else {
+            ret += ", ";
+        }
+        ret += "include: [";
+        for (auto it = config.include.begin(); it != config.include.end(); ++it) {
+            if (it != config.include.begin()) {
+                ret += ", ";
+            }
+            ret += "'" + *it + "'";
+        }
+        ret += "]";
+    }
     if (!first_optarg) {
         ret += "}";
     }
@@ -146,6 +164,13 @@ ql::datum_t sindex_status_to_datum(
         ql::datum_t::boolean(config.multi == sindex_multi_bool_t::MULTI));
     stat.overwrite("geo",
         ql::datum_t::boolean(config.geo == sindex_geo_bool_t::GEO));
+    if (!config.include.empty()) {
+        ql::datum_array_builder_t include(ql::configured_limits_t::unlimited);
+        for (const std::string &field : config.include) {
+            include.add(ql::datum_t(datum_string_t(field)));
+        }
+        stat.overwrite("include", std::move(include).to_datum());
+    }
     stat.overwrite("function",
         ql::datum_t::binary(sindex_config_to_string(config)));
     stat.overwrite("query",
@@ -156,7 +181,8 @@ ql::datum_t sindex_status_to_datum(
 class sindex_create_term_t : public op_term_t {
 public:
     sindex_create_term_t(compile_env_t *env, const raw_term_t &term)
-        : op_term_t(env, term, argspec_t(2, 3), optargspec_t({"multi", "geo"})) { }
+        : op_term_t(env, term, argspec_t(2, 3),
+                    optargspec_t({"multi", "geo", "include"})) { }
 
     virtual scoped_ptr_t<val_t> eval_impl(
         scope_env_t *env, args_t *args, eval_flags_t) const {
@@ -221,6 +247,24 @@ public:
                 ? sindex_geo_bool_t::GEO
                 : sindex_geo_bool_t::REGULAR;
         }
+        /* The fields that a covering index stores with its entries. */
+        if (scoped_ptr_t<val_t> include_val = args->optarg(env, "include")) {
+            datum_t include = include_val->as_datum();
+            rcheck_target(include_val.get(),
+                          include.get_type() == datum_t::R_ARRAY,
+                          base_exc_t::LOGIC,
+                          "The `include` optarg of `index_create` must be an array "
+                          "of field names.");
+            config.include.clear();
+            for (size_t i = 0; i < include.arr_size(); ++i) {
+                config.include.insert(include.get(i).as_str().to_std());
+            }
+            rcheck_target(include_val.get(),
+                          config.geo != sindex_geo_bool_t::GEO
+                          || config.include.empty(),
+                          base_exc_t::LOGIC,
+                          "Geospatial indexes cannot include fields.");
+        }
 
         try {
             admin_err_t error;
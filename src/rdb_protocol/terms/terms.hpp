@@ -85,7 +85,7 @@ counted_t<term_t> make_funcall_term(
 
 // datum_terms.cc
 counted_t<term_t> make_datum_term(
-    const raw_term_t &term);
+    compile_env_t *env, const raw_term_t &term);
 counted_t<term_t> make_constant_term(
     compile_env_t *env, const raw_term_t &term,
     double constant, const char *name);
@@ -237,9 +237,15 @@ archive_result_t deserialize<cluster_version_t::v2_3>(
 }
 
 template <>
-archive_result_t deserialize<cluster_version_t::v2_4_is_latest>(
+archive_result_t deserialize<cluster_version_t::v2_4>(
         read_stream_t *s, wire_func_t *wf) {
-    return deserialize_wire_func<cluster_version_t::v2_4_is_latest>(s, wf);
+    return deserialize_wire_func<cluster_version_t::v2_4>(s, wf);
+}
+
+template <>
+archive_result_t deserialize<cluster_version_t::v2_5_is_latest>(
+        read_stream_t *s, wire_func_t *wf) {
+    return deserialize_wire_func<cluster_version_t::v2_5_is_latest>(s, wf);
 }
 
 template <cluster_version_t W>
@@ -308,6 +314,10 @@ bool wire_func_t::is_simple_selector() const {
     return func->is_simple_selector();
 }
 
+bool wire_func_t::only_gets_fields(const std::set<std::string> &fields) const {
+    return func->only_gets_fields(fields);
+}
+
 RDB_IMPL_SERIALIZABLE_4_SINCE_v1_13(group_wire_func_t, funcs, append_index, multi, bt);
 
 RDB_IMPL_SERIALIZABLE_0_SINCE_v1_13(count_wire_func_t);
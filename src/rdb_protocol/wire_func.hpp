@@ -2,6 +2,8 @@
 #ifndef RDB_PROTOCOL_WIRE_FUNC_HPP_
 #define RDB_PROTOCOL_WIRE_FUNC_HPP_
 
+#include <set>
+#include <string>
 #include <vector>
 
 #include "containers/counted.hpp"
@@ -39,6 +41,7 @@ public:
     friend archive_result_t deserialize_wire_func(read_stream_t *s, wire_func_t *wf);
 
     bool is_simple_selector() const;
+    bool only_gets_fields(const std::set<std::string> &fields) const;
     std::string print_source() const;
 
 private:
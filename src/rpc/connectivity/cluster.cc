@@ -31,11 +31,11 @@
 #define MESSAGE_HANDLER_MAX_BATCH_SIZE           16
 
 // The cluster communication protocol version.
-static_assert(cluster_version_t::CLUSTER == cluster_version_t::v2_4_is_latest,
+static_assert(cluster_version_t::CLUSTER == cluster_version_t::v2_5_is_latest,
               "We need to update CLUSTER_VERSION_STRING when we add a new cluster "
               "version.");
 
-#define CLUSTER_VERSION_STRING "2.4.0"
+#define CLUSTER_VERSION_STRING "2.5.0"
 
 const std::string connectivity_cluster_t::cluster_proto_header("RethinkDB cluster\n");
 const std::string connectivity_cluster_t::cluster_version_string(CLUSTER_VERSION_STRING);
@@ -543,7 +543,7 @@ public:
         }
     }
 
-    void write(write_stream_t *) {
+    void write(write_message_t *) {
         /* Do nothing. The cluster will end up sending just the tag 'H' with no message
         attached, which will trigger `keepalive_read()` on the remote server. */
     }
@@ -1477,16 +1477,15 @@ void connectivity_cluster_t::send_message(connection_t *connection,
         return;
     }
 
-    /* We currently write the message to a vector_stream_t, then
-       serialize that as a string. It's horribly inefficient, of course. */
-    // TODO: If we don't do it this way, we (or the caller) will need
-    // to worry about having the writer run on the connection thread.
-    vector_stream_t buffer;
-    // Reserve some space to reduce overhead (especially for small messages)
-    buffer.reserve(1024);
+    /* The writer runs on the caller's thread, so the message is serialized into a
+    `write_message_t` that we take to the connection's thread. Its buffers are only
+    copied once, into the connection's write buffer, which collects the messages of
+    all the coroutines that send on the connection until the `flusher` runs.
+    Loopback messages are copied once too, into the vector the handler reads. */
+    write_message_t message;
     {
         ASSERT_FINITE_CORO_WAITING;
-        callback->write(&buffer);
+        callback->write(&message);
     }
 
 #ifdef CLUSTER_MESSAGE_DEBUGGING
@@ -1497,7 +1496,10 @@ void connectivity_cluster_t::send_message(connection_t *connection,
         buf.appendf(" to ");
         debug_print(&buf, dest);
         buf.appendf("\n");
-        print_hd(buffer.vector().data(), 0, buffer.vector().size());
+        intrusive_list_t<write_buffer_t> *buffers = message.unsafe_expose_buffers();
+        for (write_buffer_t *b = buffers->head(); b != nullptr; b = buffers->next(b)) {
+            print_hd(b->data, 0, b->size);
+        }
     }
 #endif
 
@@ -1511,7 +1513,7 @@ void connectivity_cluster_t::send_message(connection_t *connection,
     }
 #endif
 
-    size_t bytes_sent = buffer.vector().size();
+    size_t bytes_sent = message.size();
 
 #ifdef ENABLE_MESSAGE_PROFILER
     std::pair<uint64_t, uint64_t> *stats =
@@ -1521,13 +1523,32 @@ void connectivity_cluster_t::send_message(connection_t *connection,
 #endif
 
     if (connection->is_loopback()) {
-        // We could be on any thread here! Oh no!
+        // We could be on any thread here! Oh no!  The message is still deserialized by
+        // the handler, because its values can't be shared with the receiving thread.
+        // The buffers of the message are copied straight into the vector that the
+        // handler reads.
         std::vector<char> buffer_data;
-        buffer.swap(&buffer_data);
+        buffer_data.reserve(bytes_sent);
+        intrusive_list_t<write_buffer_t> *buffers = message.unsafe_expose_buffers();
+        for (write_buffer_t *b = buffers->head(); b != nullptr; b = buffers->next(b)) {
+            buffer_data.insert(buffer_data.end(), b->data, b->data + b->size);
+        }
+        rassert(buffer_data.size() == bytes_sent);
         rassert(message_handlers[tag], "No message handler for tag %" PRIu8, tag);
         message_handlers[tag]->on_local_message(connection, connection_keepalive,
             std::move(buffer_data));
     } else {
+        /* Put the tag in front of the message */
+        write_message_t wm;
+        // All cluster versions use a uint8_t tag here.
+        static_assert(std::is_same<message_tag_t, uint8_t>::value,
+                      "We expect to be serializing a uint8_t -- if this has "
+                      "changed, the cluster communication format has changed and "
+                      "you need to ask yourself whether live cluster upgrades work."
+                      );
+        serialize_universal(&wm, tag);
+        wm.append_and_clear(&message);
+
         on_thread_t threader(connection->conn->home_thread());
 
         /* Acquire the send-mutex so we don't collide with other things trying
@@ -1537,41 +1558,17 @@ void connectivity_cluster_t::send_message(connection_t *connection,
             optimization in this case. */
             mutex_t::acq_t acq(&connection->send_mutex, true);
 
-            /* Write the tag to the network */
-            {
-                // All cluster versions use a uint8_t tag here.
-                write_message_t wm;
-                static_assert(std::is_same<message_tag_t, uint8_t>::value,
-                              "We expect to be serializing a uint8_t -- if this has "
-                              "changed, the cluster communication format has changed and "
-                              "you need to ask yourself whether live cluster upgrades work."
-                              );
-                serialize_universal(&wm, tag);
-                make_buffered_tcp_conn_stream_wrapper_t buffered_conn(connection->conn);
-                int res = send_write_message(&buffered_conn, &wm);
-                if (res == -1) {
-                    /* Close the other half of the connection to make sure that
-                       `connectivity_cluster_t::run_t::handle()` notices that something is
-                       up */
-                    if (connection->conn->is_read_open()) {
-                        connection->conn->shutdown_read();
-                    }
-                    return;
-                }
-            }
-
-            /* Write the message itself to the network */
-            {
-                int64_t res = connection->conn->write_buffered(buffer.vector().data(),
-                                                               buffer.vector().size());
-                if (res == -1) {
-                    if (connection->conn->is_read_open()) {
-                        connection->conn->shutdown_read();
-                    }
-                    return;
-                } else {
-                    guarantee(res == static_cast<int64_t>(buffer.vector().size()));
+            /* Write the tag and the message to the network */
+            make_buffered_tcp_conn_stream_wrapper_t buffered_conn(connection->conn);
+            int res = send_write_message(&buffered_conn, &wm);
+            if (res == -1) {
+                /* Close the other half of the connection to make sure that
+                   `connectivity_cluster_t::run_t::handle()` notices that something is
+                   up */
+                if (connection->conn->is_read_open()) {
+                    connection->conn->shutdown_read();
                 }
+                return;
             }
         } /* Releases the send_mutex */
 
@@ -52,8 +52,9 @@ class cluster_send_message_write_callback_t {
 public:
     virtual ~cluster_send_message_write_callback_t() { }
     // write() doesn't take a version argument because the version is always
-    // cluster_version_t::CLUSTER for cluster messages.
-    virtual void write(write_stream_t *stream) = 0;
+    // cluster_version_t::CLUSTER for cluster messages.  It serializes the message
+    // into `wm`, which is sent without being copied into another buffer first.
+    virtual void write(write_message_t *wm) = 0;
 
 #ifdef ENABLE_MESSAGE_PROFILER
     /* This should return a string that describes the type of message being sent for
@@ -25,30 +25,19 @@ public:
         subwriter(_subwriter) { }
     virtual ~raw_mailbox_writer_t() { }
 
-    void write(write_stream_t *stream) {
-        write_message_t wm;
+    void write(write_message_t *wm) {
+        write_message_t data;
+        subwriter->write(cluster_version_t::CLUSTER, &data);
+
         // Right now, we serialize this length/thread/mailbox information the same
         // way irrespective of version. (Serialization methods for primitive types
         // all behave the same way anyway -- this is just for performance, avoiding
         // unnecessary branching on cluster_version.)  See read_mailbox_header for
         // the deserialization.
-        serialize_universal(&wm, dest_thread);
-        serialize_universal(&wm, dest_mailbox_id);
-        uint64_t prefix_length = static_cast<uint64_t>(wm.size());
-
-        subwriter->write(cluster_version_t::CLUSTER, &wm);
-
-        // Prepend the message length.
-        // TODO: It would be more efficient if we could make this part of `msg`.
-        //  e.g. with a `prepend()` method on write_message_t.
-        write_message_t length_msg;
-        serialize_universal(&length_msg,
-                            static_cast<uint64_t>(wm.size()) - prefix_length);
-
-        int res = send_write_message(stream, &length_msg);
-        if (res) { throw fake_archive_exc_t(); }
-        res = send_write_message(stream, &wm);
-        if (res) { throw fake_archive_exc_t(); }
+        serialize_universal(wm, static_cast<uint64_t>(data.size()));
+        serialize_universal(wm, dest_thread);
+        serialize_universal(wm, dest_mailbox_id);
+        wm->append_and_clear(&data);
     }
 
 #ifdef ENABLE_MESSAGE_PROFILER
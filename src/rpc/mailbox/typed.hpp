@@ -52,6 +52,9 @@ public:
 private:
     template <class... Args2>
     friend void send(mailbox_manager_t *, mailbox_addr_t<Args2...>, const Args2 &... args);
+    template <class... Args2>
+    friend void send_write(mailbox_manager_t *, mailbox_addr_t<Args2...>,
+                           mailbox_write_callback_t *);
 
     raw_mailbox_t::address_t addr;
 };
@@ -131,4 +134,13 @@ void send(mailbox_manager_t *src, mailbox_addr_t<Args...> dest, const Args &...
     send_write(src, dest.addr, &writer);
 }
 
+/* Sends a message that `callback` serializes in the same format as `Args...`, which
+lets the sender of a message to many mailboxes serialize the common parts once. */
+template <class... Args>
+void send_write(mailbox_manager_t *src,
+                mailbox_addr_t<Args...> dest,
+                mailbox_write_callback_t *callback) {
+    send_write(src, dest.addr, callback);
+}
+
 #endif // RPC_MAILBOX_TYPED_HPP_
@@ -105,15 +105,12 @@ public:
     metadata_writer_t(const metadata_t &_md, metadata_version_t _mdv) :
         md(_md), mdv(_mdv) { }
 
-    void write(write_stream_t *stream) {
-        write_message_t wm;
+    void write(write_message_t *wm) {
         // All cluster versions so far use a uint8_t code.
         uint8_t code = message_code_metadata;
-        serialize_universal(&wm, code);
-        serialize<cluster_version_t::CLUSTER>(&wm, md);
-        serialize<cluster_version_t::CLUSTER>(&wm, mdv);
-        int res = send_write_message(stream, &wm);
-        if (res) { throw fake_archive_exc_t(); }
+        serialize_universal(wm, code);
+        serialize<cluster_version_t::CLUSTER>(wm, md);
+        serialize<cluster_version_t::CLUSTER>(wm, mdv);
     }
 
 #ifdef ENABLE_MESSAGE_PROFILER
@@ -137,14 +134,11 @@ public:
     explicit sync_from_query_writer_t(sync_from_query_id_t _query_id) :
         query_id(_query_id) { }
 
-    void write(write_stream_t *stream) {
-        write_message_t wm;
+    void write(write_message_t *wm) {
         // All cluster versions so far use a uint8_t code.
         uint8_t code = message_code_sync_from_query;
-        serialize_universal(&wm, code);
-        serialize<cluster_version_t::CLUSTER>(&wm, query_id);
-        int res = send_write_message(stream, &wm);
-        if (res) { throw fake_archive_exc_t(); }
+        serialize_universal(wm, code);
+        serialize<cluster_version_t::CLUSTER>(wm, query_id);
     }
 
 #ifdef ENABLE_MESSAGE_PROFILER
@@ -167,15 +161,12 @@ public:
     sync_from_reply_writer_t(sync_from_query_id_t _query_id, metadata_version_t _version) :
         query_id(_query_id), version(_version) { }
 
-    void write(write_stream_t *stream) {
-        write_message_t wm;
+    void write(write_message_t *wm) {
         // All cluster versions so far use a uint8_t code.
         uint8_t code = message_code_sync_from_reply;
-        serialize_universal(&wm, code);
-        serialize<cluster_version_t::CLUSTER>(&wm, query_id);
-        serialize<cluster_version_t::CLUSTER>(&wm, version);
-        int res = send_write_message(stream, &wm);
-        if (res) { throw fake_archive_exc_t(); }
+        serialize_universal(wm, code);
+        serialize<cluster_version_t::CLUSTER>(wm, query_id);
+        serialize<cluster_version_t::CLUSTER>(wm, version);
     }
 
 #ifdef ENABLE_MESSAGE_PROFILER
@@ -199,15 +190,12 @@ public:
     sync_to_query_writer_t(sync_to_query_id_t _query_id, metadata_version_t _version) :
         query_id(_query_id), version(_version) { }
 
-    void write(write_stream_t *stream) {
-        write_message_t wm;
+    void write(write_message_t *wm) {
         // All cluster versions so far use a uint8_t code.
         uint8_t code = message_code_sync_to_query;
-        serialize_universal(&wm, code);
-        serialize<cluster_version_t::CLUSTER>(&wm, query_id);
-        serialize<cluster_version_t::CLUSTER>(&wm, version);
-        int res = send_write_message(stream, &wm);
-        if (res) { throw fake_archive_exc_t(); }
+        serialize_universal(wm, code);
+        serialize<cluster_version_t::CLUSTER>(wm, query_id);
+        serialize<cluster_version_t::CLUSTER>(wm, version);
     }
 
 #ifdef ENABLE_MESSAGE_PROFILER
@@ -231,14 +219,11 @@ public:
     explicit sync_to_reply_writer_t(sync_to_query_id_t _query_id) :
         query_id(_query_id) { }
 
-    void write(write_stream_t *stream) {
-        write_message_t wm;
+    void write(write_message_t *wm) {
         // All cluster versions so far use a uint8_t code.
         uint8_t code = message_code_sync_to_reply;
-        serialize_universal(&wm, code);
-        serialize<cluster_version_t::CLUSTER>(&wm, query_id);
-        int res = send_write_message(stream, &wm);
-        if (res) { throw fake_archive_exc_t(); }
+        serialize_universal(wm, code);
+        serialize<cluster_version_t::CLUSTER>(wm, query_id);
     }
 
 #ifdef ENABLE_MESSAGE_PROFILER
@@ -443,8 +443,12 @@ void data_block_manager_t::start_existing(file_t *file,
                                           const data_block_manager::metablock_mixin_t *last_metablock) {
     guarantee(state == state_unstarted);
     dbfile = file;
-    gc_io_account_nice.init(new file_account_t(file, GC_IO_PRIORITY_NICE));
-    gc_io_account_high.init(new file_account_t(file, GC_IO_PRIORITY_HIGH));
+    gc_io_account_nice.init(new file_account_t(file, GC_IO_PRIORITY_NICE,
+                                               UNLIMITED_OUTSTANDING_REQUESTS,
+                                               io_class_t::gc));
+    gc_io_account_high.init(new file_account_t(file, GC_IO_PRIORITY_HIGH,
+                                               UNLIMITED_OUTSTANDING_REQUESTS,
+                                               io_class_t::gc));
 
     /* Reconstruct the active data block extents from the metablock. */
     const int64_t offset = last_metablock->active_extent;
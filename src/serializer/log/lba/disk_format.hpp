@@ -3,6 +3,7 @@
 #define SERIALIZER_LOG_LBA_DISK_FORMAT_HPP_
 
 #include <limits.h>
+#include <stddef.h>
 
 #include "serializer/serializer.hpp"
 #include "config/args.hpp"
@@ -108,12 +109,20 @@ ATTR_PACKED(struct lba_shard_metablock_t {
      * reference to the clean extent. */
     int64_t last_lba_extent_offset;
     int32_t last_lba_extent_entries_count;
-    int32_t padding1;
+
+    /* Reference to the shard's LBA snapshot directory (see `lba_snapshot_directory_t`
+     * below), which always sits at the beginning of its own extent.  Stored as the
+     * index of that extent plus one, so that 0 means "no snapshot".  This and
+     * `lba_snapshot_extents_count` used to be padding that was always written as 0,
+     * so files from before LBA snapshots simply don't have one. */
+    int32_t lba_snapshot_directory_extent;
 
     /* Reference to the LBA superblock and its size */
     int64_t lba_superblock_offset;
     int32_t lba_superblock_entries_count;
-    int32_t padding2;
+
+    /* The number of entries in the LBA snapshot directory. */
+    int32_t lba_snapshot_extents_count;
 });
 
 ATTR_PACKED(struct lba_metablock_mixin_t {
@@ -188,6 +197,56 @@ struct lba_superblock_t {
 };
 
 
+/* An LBA snapshot is a compact copy of the in-memory index for one LBA shard.  It
+ * stands in for a prefix of the extents listed in that shard's LBA superblock, so
+ * that on startup we can load it with a few large reads and then only replay the
+ * LBA extents that were written after it.  The extents that it covers are left in
+ * place (the LBA garbage collector takes care of them as usual, and drops the
+ * snapshot when it does), so versions of RethinkDB that don't know about snapshots
+ * can still read the file.
+ *
+ * The snapshot directory lists the snapshot's data extents. Each data extent holds
+ * the block infos of a run of consecutive block ids of the shard, i.e. `entries[i]`
+ * belongs to block id `first_block_id + i * LBA_SHARD_FACTOR`. */
+
+ATTR_PACKED(struct lba_snapshot_entry_t {
+    flagged_off64_t offset;
+    repli_timestamp_t recency;
+    uint16_t ser_block_size;
+});
+
+#define LBA_SNAPSHOT_MAGIC_SIZE 8
+static const char lba_snapshot_magic[LBA_SNAPSHOT_MAGIC_SIZE] = {'l', 'b', 'a', 's', 'n', 'a', 'p', 'x'};
+static const char lba_snapshot_directory_magic[LBA_SNAPSHOT_MAGIC_SIZE] = {'l', 'b', 'a', 's', 'n', 'a', 'p', 'd'};
+
+ATTR_PACKED(struct lba_snapshot_extent_t {
+    char magic[LBA_SNAPSHOT_MAGIC_SIZE];
+    block_id_t first_block_id;
+    int64_t entries_count;
+    lba_snapshot_entry_t entries[0];
+});
+
+ATTR_PACKED(struct lba_snapshot_directory_entry_t {
+    int64_t offset;
+    int64_t entries_count;
+});
+
+ATTR_PACKED(struct lba_snapshot_directory_t {
+    char magic[LBA_SNAPSHOT_MAGIC_SIZE];
+
+    /* The snapshot replaces the first `covered_extents_count` extents of the LBA
+     * superblock.  We keep the offset of the last one of those around so that we can
+     * tell if the superblock has changed underneath the snapshot. */
+    int64_t covered_extents_count;
+    int64_t last_covered_extent_offset;
+
+    lba_snapshot_directory_entry_t entries[0];
+
+    static size_t size(int64_t extents_count) {
+        return offsetof(lba_snapshot_directory_t, entries[0])
+            + sizeof(lba_snapshot_directory_entry_t) * extents_count;
+    }
+});
 
 #endif  // SERIALIZER_LOG_LBA_DISK_FORMAT_HPP_
 
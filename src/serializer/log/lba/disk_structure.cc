@@ -9,16 +9,21 @@
 #include <vector>
 
 #include "containers/scoped.hpp"
+#include "logger.hpp"
 #include "math.hpp"
+#include "serializer/log/stats.hpp"
 
 lba_disk_structure_t::lba_disk_structure_t(extent_manager_t *_em, file_t *_file)
-    : em(_em), file(_file), superblock_extent(nullptr), last_extent(nullptr)
+    : em(_em), file(_file), superblock_extent(nullptr), last_extent(nullptr),
+      snapshot(nullptr), startup_reads_outstanding(0)
 {
 }
 
 lba_disk_structure_t::lba_disk_structure_t(extent_manager_t *_em, file_t *_file, lba_shard_metablock_t *metablock)
-    : em(_em), file(_file)
+    : em(_em), file(_file), snapshot(nullptr), startup_reads_outstanding(0)
 {
+    snapshot_directory_reader.parent = this;
+
     if (metablock->last_lba_extent_offset != NULL_OFFSET) {
         last_extent = new lba_disk_extent_t(em, file, metablock->last_lba_extent_offset, metablock->last_lba_extent_entries_count);
     } else {
@@ -36,19 +41,49 @@ lba_disk_structure_t::lba_disk_structure_t(extent_manager_t *_em, file_t *_file,
         superblock_extent = new extent_t(em, file, superblock_extent_offset,
             superblock_offset + superblock_size - superblock_extent_offset);
 
+        // A snapshot always covers some of the extents in the superblock, so we only
+        // have to look for one if there is a superblock.
+        size_t snapshot_directory_size = 0;
+        if (metablock->lba_snapshot_directory_extent != 0) {
+            startup_snapshot_directory_offset =
+                (static_cast<int64_t>(metablock->lba_snapshot_directory_extent) - 1)
+                * em->extent_size;
+            startup_snapshot_extents_count = metablock->lba_snapshot_extents_count;
+            guarantee(startup_snapshot_directory_offset >= 0
+                      && startup_snapshot_extents_count >= 0);
+            snapshot_directory_size = ceil_aligned(
+                lba_snapshot_directory_t::size(startup_snapshot_extents_count),
+                DEVICE_BLOCK_SIZE);
+            guarantee(snapshot_directory_size <= em->extent_size);
+        }
+
+        startup_reads_outstanding = snapshot_directory_size != 0 ? 2 : 1;
+
         startup_superblock_buffer = scoped_device_block_aligned_ptr_t<lba_superblock_t>(superblock_size);
         superblock_extent->read(
             superblock_offset - superblock_extent_offset,
             superblock_size,
             startup_superblock_buffer.get(),
             this);
+
+        if (snapshot_directory_size != 0) {
+            // We don't reserve the snapshot's extents until we know that the snapshot
+            // is usable, so we read the directory directly from the file.
+            startup_snapshot_directory_buffer =
+                scoped_device_block_aligned_ptr_t<lba_snapshot_directory_t>(
+                    snapshot_directory_size);
+            file->read_async(startup_snapshot_directory_offset, snapshot_directory_size,
+                             startup_snapshot_directory_buffer.get(),
+                             DEFAULT_DISK_ACCOUNT, &snapshot_directory_reader);
+            em->stats->bytes_read(snapshot_directory_size);
+        }
     } else {
         superblock_extent = nullptr;
     }
 }
 
 void lba_disk_structure_t::set_load_callback(load_callback_t *cb) {
-    if (superblock_extent) {
+    if (startup_reads_outstanding > 0) {
         start_callback = cb;
     } else {
         cb->on_lba_load();
@@ -68,6 +103,53 @@ void lba_disk_structure_t::on_extent_read() {
 
     startup_superblock_buffer.reset();
 
+    rassert(startup_reads_outstanding > 0);
+    if (--startup_reads_outstanding == 0) {
+        finish_loading();
+    }
+}
+
+void lba_disk_structure_t::on_snapshot_directory_read() {
+    rassert(startup_reads_outstanding > 0);
+    if (--startup_reads_outstanding == 0) {
+        finish_loading();
+    }
+}
+
+void lba_disk_structure_t::finish_loading() {
+    if (startup_snapshot_directory_buffer.has()) {
+        const lba_snapshot_directory_t *directory = startup_snapshot_directory_buffer.get();
+
+        // Make sure that the directory is complete, and that the extents the snapshot
+        // stands in for are still the ones at the front of the superblock.
+        lba_disk_extent_t *last_covered_extent = nullptr;
+        if (lba_snapshot_t::directory_is_valid(em, directory,
+                                               startup_snapshot_extents_count,
+                                               file->get_file_size())
+            && directory->covered_extents_count > 0
+            && directory->covered_extents_count
+               <= static_cast<int64_t>(extents_in_superblock.size())) {
+            last_covered_extent = extents_in_superblock.head();
+            for (int64_t i = 1; i < directory->covered_extents_count; ++i) {
+                last_covered_extent = extents_in_superblock.next(last_covered_extent);
+            }
+        }
+
+        if (last_covered_extent != nullptr
+            && last_covered_extent->data->extent_ref.offset()
+               == directory->last_covered_extent_offset) {
+            snapshot = new lba_snapshot_t(em, file, startup_snapshot_directory_offset,
+                                          directory, startup_snapshot_extents_count);
+        } else {
+            // The extents covered by a snapshot are never deleted while the snapshot
+            // is around, so we can always fall back to replaying all of them.
+            logWRN("Ignoring an LBA snapshot that is incomplete or doesn't match the "
+                   "LBA superblock.");
+        }
+
+        startup_snapshot_directory_buffer.reset();
+    }
+
     start_callback->on_lba_load();
 }
 
@@ -110,9 +192,23 @@ void lba_disk_structure_t::destroy_extents(const std::set<lba_disk_extent_t *> &
         extents_in_superblock.remove(*e);
         (*e)->destroy(txn);
     }
+    if (snapshot != nullptr) {
+        snapshot->destroy(txn);
+        snapshot = nullptr;
+    }
     write_superblock(io_account, txn);
 }
 
+void lba_disk_structure_t::replace_snapshot(lba_snapshot_t *new_snapshot,
+                                            extent_transaction_t *txn) {
+    guarantee(new_snapshot->covered_extents_count()
+              <= static_cast<int64_t>(extents_in_superblock.size()));
+    if (snapshot != nullptr) {
+        snapshot->destroy(txn);
+    }
+    snapshot = new_snapshot;
+}
+
 void lba_disk_structure_t::write_superblock(file_account_t *io_account,
                                             extent_transaction_t *txn) {
 
@@ -183,6 +279,7 @@ void lba_disk_structure_t::sync(file_account_t *io_account, sync_callback_t *cb)
     if (last_extent) writer->outstanding_cbs++;
     if (superblock_extent) writer->outstanding_cbs++;
     writer->outstanding_cbs += extents_in_superblock.size();
+    if (snapshot) writer->outstanding_cbs += snapshot->num_extents();
 
     /* Sync the things that need to be synced */
     if (writer->outstanding_cbs == 0) {
@@ -195,6 +292,7 @@ void lba_disk_structure_t::sync(file_account_t *io_account, sync_callback_t *cb)
              e != nullptr; e = extents_in_superblock.next(e)) {
             e->sync(io_account, writer);
         }
+        if (snapshot) snapshot->sync(writer);
     }
 }
 
@@ -210,8 +308,14 @@ struct reader_t
     {
         reader_t *parent;   // Our reader_t that we were created by
         int index;   // parent->readers[index] = this
-        lba_disk_extent_t *extent;   // The extent we are supposed to read
+        lba_disk_extent_t *extent;   // The extent we are supposed to read, or NULL
         lba_disk_extent_t::read_info_t read_info;   // Opaque data used by extent_t::read()
+
+        // If `extent` is NULL, we read the `snapshot_extent`th data extent of
+        // `snapshot` instead.
+        lba_snapshot_t *snapshot;
+        size_t snapshot_extent;
+        lba_snapshot_t::read_info_t snapshot_read_info;
         bool have_read;   // true if our extent has been loaded from disk
 
         /* true if the extent before us called read_step_2(). We keep track of this
@@ -221,8 +325,16 @@ struct reader_t
         bool prev_done;
 
         extent_reader_t(reader_t *p, lba_disk_extent_t *e)
-            : parent(p), extent(e), have_read(false)
+            : parent(p), extent(e), snapshot(nullptr), snapshot_extent(0), have_read(false)
         {
+            init();
+        }
+        extent_reader_t(reader_t *p, lba_snapshot_t *s, size_t i)
+            : parent(p), extent(nullptr), snapshot(s), snapshot_extent(i), have_read(false)
+        {
+            init();
+        }
+        void init() {
             index = parent->readers.size();
             parent->readers.push_back(this);
 
@@ -235,7 +347,11 @@ struct reader_t
         }
         void start_reading() {
             parent->active_readers++;
-            extent->read_step_1(&read_info, this);
+            if (extent != nullptr) {
+                extent->read_step_1(&read_info, this);
+            } else {
+                snapshot->read_step_1(snapshot_extent, &snapshot_read_info, this);
+            }
         }
         void on_extent_read() {   // Called when our extent has been read from disk
             rassert(!have_read);
@@ -248,7 +364,11 @@ struct reader_t
             if (have_read) done();
         }
         void done() {
-            extent->read_step_2(&read_info, parent->index);
+            if (extent != nullptr) {
+                extent->read_step_2(&read_info, parent->index);
+            } else {
+                snapshot->read_step_2(&snapshot_read_info, parent->index);
+            }
             parent->active_readers--;
             parent->start_more_readers();
             if (index == static_cast<int>(parent->readers.size()) - 1) {
@@ -270,8 +390,20 @@ struct reader_t
     reader_t(lba_disk_structure_t *_ds, in_memory_index_t *_index, lba_disk_structure_t::read_callback_t *cb)
         : ds(_ds), index(_index), rcb(cb)
     {
+        // The snapshot goes first, followed by the extents that were written after it.
+        int64_t covered_extents_count = 0;
+        if (ds->snapshot != nullptr) {
+            for (size_t i = 0; i < ds->snapshot->num_data_extents(); ++i) {
+                new extent_reader_t(this, ds->snapshot, i);
+            }
+            covered_extents_count = ds->snapshot->covered_extents_count();
+        }
         for (lba_disk_extent_t *e = ds->extents_in_superblock.head();
              e != nullptr; e = ds->extents_in_superblock.next(e)) {
+            if (covered_extents_count > 0) {
+                --covered_extents_count;
+                continue;
+            }
             new extent_reader_t(this, e);
         }
         if (ds->last_extent) new extent_reader_t(this, ds->last_extent);
@@ -325,6 +457,13 @@ void lba_disk_structure_t::prepare_metablock(lba_shard_metablock_t *mb_out) {
         mb_out->lba_superblock_offset = NULL_OFFSET;
         mb_out->lba_superblock_entries_count = 0;
     }
+
+    if (snapshot) {
+        snapshot->prepare_metablock(mb_out);
+    } else {
+        mb_out->lba_snapshot_directory_extent = 0;
+        mb_out->lba_snapshot_extents_count = 0;
+    }
 }
 
 int lba_disk_structure_t::num_entries_that_can_fit_in_an_extent() const {
@@ -332,6 +471,10 @@ int lba_disk_structure_t::num_entries_that_can_fit_in_an_extent() const {
 }
 
 void lba_disk_structure_t::destroy(extent_transaction_t *txn) {
+    if (snapshot) {
+        snapshot->destroy(txn);
+    }
+
     if (superblock_extent) {
         superblock_extent->destroy(txn);
     }
@@ -349,6 +492,7 @@ void lba_disk_structure_t::destroy(extent_transaction_t *txn) {
 }
 
 void lba_disk_structure_t::shutdown() {
+    if (snapshot) snapshot->shutdown();
     if (superblock_extent) superblock_extent->shutdown();
     while (lba_disk_extent_t *e = extents_in_superblock.head()) {
         extents_in_superblock.remove(e);
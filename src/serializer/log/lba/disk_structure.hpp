@@ -8,6 +8,7 @@
 #include "serializer/log/extent_manager.hpp"
 #include "serializer/log/lba/disk_format.hpp"
 #include "serializer/log/lba/disk_extent.hpp"
+#include "serializer/log/lba/snapshot.hpp"
 
 class lba_load_fsm_t;
 class lba_writer_t;
@@ -49,7 +50,8 @@ public:
     // Destroy the given set of extents. Assumes that the extents pointed to
     // are part of the `extents_in_superblock` list.
     // Once the extents have been destroyed, a new superblock is written to persist
-    // the change.
+    // the change. This also drops the LBA snapshot, if there is one, since it refers
+    // to extents in the superblock.
     void destroy_extents(const std::set<lba_disk_extent_t *> &extents,
                          file_account_t *io_account, extent_transaction_t *txn);
 
@@ -61,6 +63,10 @@ public:
     };
     void read(in_memory_index_t *index, read_callback_t *cb);
 
+    // Takes ownership of `new_snapshot`, which must cover a prefix of
+    // `extents_in_superblock`. The previous snapshot (if any) is destroyed.
+    void replace_snapshot(lba_snapshot_t *new_snapshot, extent_transaction_t *txn);
+
     void prepare_metablock(lba_shard_metablock_t *mb_out);
 
     void destroy(extent_transaction_t *txn);   // Delete both in memory and on disk
@@ -75,6 +81,7 @@ public:
     int64_t superblock_offset;
     intrusive_list_t<lba_disk_extent_t> extents_in_superblock;
     lba_disk_extent_t *last_extent;
+    lba_snapshot_t *snapshot;   // Can be NULL
 
 private:
     /* Prepares and writes a new superblock. */
@@ -82,9 +89,19 @@ private:
 
     /* Used during the startup process */
     void on_extent_read();
+    void on_snapshot_directory_read();
+    void finish_loading();
     load_callback_t *start_callback;
+    int startup_reads_outstanding;
     int startup_superblock_count;
     scoped_device_block_aligned_ptr_t<lba_superblock_t> startup_superblock_buffer;
+    struct snapshot_directory_reader_t : public iocallback_t {
+        lba_disk_structure_t *parent;
+        void on_io_complete() { parent->on_snapshot_directory_read(); }
+    } snapshot_directory_reader;
+    int64_t startup_snapshot_directory_offset;
+    int64_t startup_snapshot_extents_count;
+    scoped_device_block_aligned_ptr_t<lba_snapshot_directory_t> startup_snapshot_directory_buffer;
 
     /* Use destroy() or shutdown() instead */
     ~lba_disk_structure_t() {}
@@ -126,7 +126,8 @@ bool lba_list_t::start_existing(file_t *file, metablock_mixin_t *last_metablock,
     rassert(state == state_unstarted);
 
     dbfile = file;
-    gc_io_account.init(new file_account_t(dbfile, LBA_GC_IO_PRIORITY));
+    gc_io_account.init(new file_account_t(dbfile, LBA_GC_IO_PRIORITY,
+                                             UNLIMITED_OUTSTANDING_REQUESTS, io_class_t::gc));
 
     lba_start_fsm_t *starter = new lba_start_fsm_t(this, last_metablock);
     if (state == state_ready) {
@@ -312,6 +313,13 @@ void lba_list_t::consider_gc() {
             coro_t *gc_coro = coro_t::spawn_sometime(std::bind(&lba_list_t::gc,
                     this, i, auto_drainer_t::lock_t(gc_drainer.get())));
             gc_coro->set_priority(CORO_PRIORITY_LBA_GC);
+        } else if (we_want_to_snapshot(i)) {
+            rassert(!gc_active[i]);
+            gc_active[i] = true;
+            coro_t *snapshot_coro = coro_t::spawn_sometime(
+                std::bind(&lba_list_t::write_snapshot,
+                          this, i, auto_drainer_t::lock_t(gc_drainer.get())));
+            snapshot_coro->set_priority(CORO_PRIORITY_LBA_GC);
         }
     }
 }
@@ -420,6 +428,98 @@ void lba_list_t::gc(int lba_shard, auto_drainer_t::lock_t) {
     gc_active[lba_shard] = false;
 }
 
+void lba_list_t::write_snapshot(int lba_shard, auto_drainer_t::lock_t) {
+    lba_disk_structure_t *ds = disk_structures[lba_shard];
+
+    // The extents in the superblock are full, so they won't change anymore. Every
+    // entry in them has already been applied to `in_memory_index`, so whatever we
+    // copy from there below is at least as recent. Anything that changes while we
+    // are copying ends up in later LBA extents or in the inline LBA, which get
+    // replayed on top of the snapshot.
+    guarantee(ds->extents_in_superblock.size() > 0);
+    lba_snapshot_t *snapshot = new lba_snapshot_t(
+        extent_manager, dbfile,
+        ds->extents_in_superblock.size(),
+        ds->extents_in_superblock.tail()->data->extent_ref.offset());
+
+    int num_written_in_batch = 0;
+    bool aborted = false;
+    const block_id_t end_id = end_block_id();
+    const block_id_t aux_end_id = end_aux_block_id();
+    guarantee(aux_end_id >= end_id);
+    for (block_id_t id = lba_shard; ; id += LBA_SHARD_FACTOR) {
+        // See the corresponding comment in `gc()`.
+        CT_ASSERT(FIRST_AUX_BLOCK_ID % LBA_SHARD_FACTOR == 0);
+        if (!is_aux_block_id(id) && id >= end_id) {
+            id = lba_shard + FIRST_AUX_BLOCK_ID;
+        }
+
+        if (id >= aux_end_id) {
+            break;
+        }
+
+        snapshot->add_entry(id, in_memory_index.get_block_info(id), gc_io_account.get());
+
+        ++num_written_in_batch;
+        if (num_written_in_batch >= LBA_SNAPSHOT_BATCH_SIZE) {
+            num_written_in_batch = 0;
+            coro_t::yield();
+            if (state == lba_list_t::state_gc_shutting_down) {
+                aborted = true;
+                break;
+            }
+        }
+    }
+
+    snapshot->finish(gc_io_account.get());
+
+    if (aborted) {
+        // Wait for our writes to complete before handing the extents back.
+        struct : public cond_t, public extent_t::sync_callback_t {
+            void on_extent_sync() {
+                rassert(outstanding > 0);
+                if (--outstanding == 0) pulse();
+            }
+            size_t outstanding;
+        } on_snapshot_sync;
+        on_snapshot_sync.outstanding = snapshot->num_extents();
+        snapshot->sync(&on_snapshot_sync);
+        on_snapshot_sync.wait();
+
+        // No metablock ever referred to the snapshot, so its extents can be reused
+        // right away.
+        extent_transaction_t txn;
+        extent_manager->begin_transaction(&txn);
+        snapshot->destroy(&txn);
+        extent_manager->end_transaction(&txn);
+        extent_manager->commit_transaction(&txn);
+
+        gc_active[lba_shard] = false;
+        return;
+    }
+
+    // Swap in the new snapshot. The old one's extents are only released once the new
+    // metablock is on disk.
+    extent_transaction_t txn;
+    extent_manager->begin_transaction(&txn);
+    ds->replace_snapshot(snapshot, &txn);
+    extent_manager->end_transaction(&txn);
+
+    // Syncing the disk structure also syncs the snapshot.
+    struct : public cond_t, public lba_disk_structure_t::sync_callback_t {
+        void on_lba_sync() { pulse(); }
+    } on_lba_sync;
+    ds->sync(gc_io_account.get(), &on_lba_sync);
+
+    write_metablock_fun(&on_lba_sync, gc_io_account.get());
+
+    extent_manager->commit_transaction(&txn);
+
+    ++extent_manager->stats->pm_serializer_lba_snapshots;
+
+    gc_active[lba_shard] = false;
+}
+
 bool lba_list_t::is_any_gc_active() const {
     for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
         if (gc_active[i]) {
@@ -468,6 +568,41 @@ bool lba_list_t::we_want_to_gc(int i) {
     return true;
 }
 
+// Decides, based on how much of the LBA we would have to replay at startup.
+bool lba_list_t::we_want_to_snapshot(int i) {
+    // Don't write a snapshot while garbage collecting or writing another snapshot
+    if (gc_active[i]) {
+        return false;
+    }
+
+    if (state == lba_list_t::state_gc_shutting_down) {
+        return false;
+    }
+
+    // Only the extents that aren't covered by the current snapshot would have to be
+    // replayed. If there aren't many of them, a new snapshot won't save us much.
+    const lba_disk_structure_t *ds = disk_structures[i];
+    const int64_t extents_count = ds->extents_in_superblock.size();
+    const int64_t covered_extents_count =
+        ds->snapshot != nullptr ? ds->snapshot->covered_extents_count() : 0;
+    if ((extents_count - covered_extents_count) * extent_manager->extent_size <
+            LBA_MIN_SIZE_FOR_SNAPSHOT / LBA_SHARD_FACTOR) {
+        return false;
+    }
+
+    // Only write a snapshot if it's substantially smaller than the extents it covers.
+    // Right after a GC that is usually not the case.
+    const int64_t snapshot_entries = end_block_id() / LBA_SHARD_FACTOR
+        + make_aux_block_id_relative(end_aux_block_id()) / LBA_SHARD_FACTOR;
+    const int64_t snapshot_size = snapshot_entries * sizeof(lba_snapshot_entry_t);
+    if (snapshot_size > LBA_MAX_SNAPSHOT_SIZE_FRACTION
+                        * extents_count * extent_manager->extent_size) {
+        return false;
+    }
+
+    return true;
+}
+
 void lba_list_t::shutdown_gc() {
     guarantee(state == state_ready);
     guarantee(coro_t::self() != nullptr);
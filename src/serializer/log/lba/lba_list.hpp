@@ -16,10 +16,15 @@
 class lba_start_fsm_t;
 class lba_syncer_t;
 
+namespace unittest {
+class lba_snapshot_tester_t;
+}  // namespace unittest
+
 class lba_list_t
 {
     friend class lba_start_fsm_t;
     friend class lba_syncer_t;
+    friend class unittest::lba_snapshot_tester_t;
 
     typedef std::function<void(const signal_t *, file_account_t *)> write_metablock_fun_t;
 
@@ -87,7 +92,8 @@ public:
     bool is_any_gc_active() const;
 
 private:
-    // Whether we are currently garbage-collecting a shard.
+    // Whether we are currently garbage-collecting a shard or writing a snapshot
+    // of it. We never do both at the same time.
     bool gc_active[LBA_SHARD_FACTOR];
     scoped_ptr_t<auto_drainer_t> gc_drainer;
 
@@ -128,6 +134,13 @@ private:
     // gc. The integer is which shard to GC.
     bool we_want_to_gc(int i);
 
+    // Writes a new LBA snapshot for the given shard
+    void write_snapshot(int lba_shard, auto_drainer_t::lock_t gc_drainer_lock);
+
+    // Returns true if the given shard has accumulated enough LBA extents since its
+    // last snapshot that a new one would noticeably speed up loading it.
+    bool we_want_to_snapshot(int i);
+
     DISABLE_COPYING(lba_list_t);
 };
 
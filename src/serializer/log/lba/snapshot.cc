@@ -0,0 +1,218 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "serializer/log/lba/snapshot.hpp"
+
+#include <stddef.h>
+#include <string.h>
+
+#include <limits>
+
+#include "math.hpp"
+#include "serializer/log/extent_manager.hpp"
+
+lba_snapshot_t::lba_snapshot_t(extent_manager_t *_em, file_t *_file,
+                               int64_t covered_extents_count,
+                               int64_t last_covered_extent_offset)
+    : em(_em), file(_file),
+      covered_extents_count_(covered_extents_count),
+      last_covered_extent_offset_(last_covered_extent_offset),
+      directory_extent(nullptr),
+      next_block_id(NULL_BLOCK_ID) {
+    em->assert_thread();
+    guarantee(covered_extents_count_ > 0);
+    guarantee(entries_per_extent() > 0);
+}
+
+lba_snapshot_t::lba_snapshot_t(extent_manager_t *_em, file_t *_file,
+                               int64_t directory_offset,
+                               const lba_snapshot_directory_t *directory,
+                               int64_t extents_count)
+    : em(_em), file(_file),
+      covered_extents_count_(directory->covered_extents_count),
+      last_covered_extent_offset_(directory->last_covered_extent_offset),
+      next_block_id(NULL_BLOCK_ID) {
+    em->assert_thread();
+    directory_extent = new extent_t(em, file, directory_offset,
+        ceil_aligned(lba_snapshot_directory_t::size(extents_count), DEVICE_BLOCK_SIZE));
+    for (int64_t i = 0; i < extents_count; ++i) {
+        const lba_snapshot_directory_entry_t &e = directory->entries[i];
+        guarantee(e.entries_count > 0 && e.entries_count <= entries_per_extent());
+        data_extent_t data_extent;
+        data_extent.extent = new extent_t(em, file, e.offset,
+            ceil_aligned(offsetof(lba_snapshot_extent_t, entries[0])
+                         + sizeof(lba_snapshot_entry_t) * e.entries_count,
+                         DEVICE_BLOCK_SIZE));
+        data_extent.entries_count = e.entries_count;
+        data_extents.push_back(data_extent);
+    }
+}
+
+lba_snapshot_t::~lba_snapshot_t() { }
+
+bool lba_snapshot_t::directory_is_valid(const extent_manager_t *em,
+                                        const lba_snapshot_directory_t *directory,
+                                        int64_t extents_count, int64_t file_size) {
+    if (memcmp(directory->magic, lba_snapshot_directory_magic,
+               LBA_SNAPSHOT_MAGIC_SIZE) != 0) {
+        return false;
+    }
+    for (int64_t i = 0; i < extents_count; ++i) {
+        const lba_snapshot_directory_entry_t &e = directory->entries[i];
+        if (e.offset < 0 || e.offset % em->extent_size != 0
+            || e.offset + static_cast<int64_t>(em->extent_size) > file_size
+            || e.entries_count <= 0
+            || e.entries_count > entries_per_extent(em->extent_size)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int64_t lba_snapshot_t::entries_per_extent() const {
+    return entries_per_extent(em->extent_size);
+}
+
+int64_t lba_snapshot_t::entries_per_extent(int64_t extent_size) {
+    return (extent_size - offsetof(lba_snapshot_extent_t, entries[0]))
+        / sizeof(lba_snapshot_entry_t);
+}
+
+void lba_snapshot_t::add_entry(block_id_t block_id, const index_block_info_t &info,
+                               file_account_t *io_account) {
+    em->assert_thread();
+    rassert(directory_extent == nullptr);
+
+    // Each data extent holds a run of consecutive block ids of the shard, so we have
+    // to start a new one whenever we skip ahead (i.e. when moving on to aux blocks).
+    if (pending_extent.has()
+        && (block_id != next_block_id
+            || pending_extent->entries_count == entries_per_extent())) {
+        flush_data_extent(io_account);
+    }
+
+    if (!pending_extent.has()) {
+        pending_extent = scoped_device_block_aligned_ptr_t<lba_snapshot_extent_t>(
+            em->extent_size);
+        memcpy(pending_extent->magic, lba_snapshot_magic, LBA_SNAPSHOT_MAGIC_SIZE);
+        pending_extent->first_block_id = block_id;
+        pending_extent->entries_count = 0;
+    }
+
+    lba_snapshot_entry_t *entry = &pending_extent->entries[pending_extent->entries_count];
+    entry->offset = info.offset;
+    entry->recency = info.recency;
+    entry->ser_block_size = info.ser_block_size;
+    ++pending_extent->entries_count;
+    next_block_id = block_id + LBA_SHARD_FACTOR;
+}
+
+void lba_snapshot_t::flush_data_extent(file_account_t *io_account) {
+    rassert(pending_extent.has());
+    const size_t size = offsetof(lba_snapshot_extent_t, entries[0])
+        + sizeof(lba_snapshot_entry_t) * pending_extent->entries_count;
+    const size_t aligned_size = ceil_aligned(size, DEVICE_BLOCK_SIZE);
+    memset(reinterpret_cast<char *>(pending_extent.get()) + size, 0, aligned_size - size);
+
+    data_extent_t data_extent;
+    data_extent.extent = new extent_t(em, file);
+    data_extent.entries_count = pending_extent->entries_count;
+    data_extent.extent->append(pending_extent.get(), aligned_size, io_account);
+    data_extents.push_back(data_extent);
+
+    pending_extent.reset();
+}
+
+void lba_snapshot_t::finish(file_account_t *io_account) {
+    em->assert_thread();
+    rassert(directory_extent == nullptr);
+
+    if (pending_extent.has()) {
+        flush_data_extent(io_account);
+    }
+
+    const size_t size = lba_snapshot_directory_t::size(data_extents.size());
+    guarantee(size <= em->extent_size, "LBA snapshot directory doesn't fit in an extent");
+    const size_t aligned_size = ceil_aligned(size, DEVICE_BLOCK_SIZE);
+
+    scoped_device_block_aligned_ptr_t<lba_snapshot_directory_t> buffer(aligned_size);
+    memset(buffer.get(), 0, aligned_size);
+    memcpy(buffer->magic, lba_snapshot_directory_magic, LBA_SNAPSHOT_MAGIC_SIZE);
+    buffer->covered_extents_count = covered_extents_count_;
+    buffer->last_covered_extent_offset = last_covered_extent_offset_;
+    for (size_t i = 0; i < data_extents.size(); ++i) {
+        buffer->entries[i].offset = data_extents[i].extent->extent_ref.offset();
+        buffer->entries[i].entries_count = data_extents[i].entries_count;
+    }
+
+    directory_extent = new extent_t(em, file);
+    directory_extent->append(buffer.get(), aligned_size, io_account);
+}
+
+size_t lba_snapshot_t::num_extents() const {
+    return data_extents.size() + (directory_extent != nullptr ? 1 : 0);
+}
+
+void lba_snapshot_t::sync(extent_t::sync_callback_t *cb) {
+    em->assert_thread();
+    rassert(!pending_extent.has());
+    for (const data_extent_t &e : data_extents) {
+        e.extent->sync(cb);
+    }
+    if (directory_extent != nullptr) {
+        directory_extent->sync(cb);
+    }
+}
+
+void lba_snapshot_t::prepare_metablock(lba_shard_metablock_t *mb_out) const {
+    guarantee(directory_extent != nullptr);
+    const int64_t directory_extent_index =
+        directory_extent->extent_ref.offset() / em->extent_size;
+    guarantee(directory_extent_index + 1 <= std::numeric_limits<int32_t>::max());
+    mb_out->lba_snapshot_directory_extent = directory_extent_index + 1;
+    mb_out->lba_snapshot_extents_count = data_extents.size();
+}
+
+void lba_snapshot_t::read_step_1(size_t i, read_info_t *info_out,
+                                 extent_t::read_callback_t *cb) {
+    em->assert_thread();
+    guarantee(i < data_extents.size());
+    info_out->buffer =
+        scoped_device_block_aligned_ptr_t<lba_snapshot_extent_t>(em->extent_size);
+    info_out->entries_count = data_extents[i].entries_count;
+    data_extents[i].extent->read(0, data_extents[i].extent->amount_filled,
+                                 info_out->buffer.get(), cb);
+}
+
+void lba_snapshot_t::read_step_2(read_info_t *info, in_memory_index_t *index) {
+    em->assert_thread();
+    const lba_snapshot_extent_t *extent = info->buffer.get();
+    guarantee(memcmp(extent->magic, lba_snapshot_magic, LBA_SNAPSHOT_MAGIC_SIZE) == 0);
+    guarantee(extent->entries_count == info->entries_count);
+
+    for (int64_t i = 0; i < extent->entries_count; ++i) {
+        const lba_snapshot_entry_t &e = extent->entries[i];
+        index->set_block_info(extent->first_block_id + i * LBA_SHARD_FACTOR,
+                              e.recency, e.offset, e.ser_block_size);
+    }
+
+    info->buffer.reset();
+}
+
+void lba_snapshot_t::destroy(extent_transaction_t *txn) {
+    for (const data_extent_t &e : data_extents) {
+        e.extent->destroy(txn);
+    }
+    if (directory_extent != nullptr) {
+        directory_extent->destroy(txn);
+    }
+    delete this;
+}
+
+void lba_snapshot_t::shutdown() {
+    for (const data_extent_t &e : data_extents) {
+        e.extent->shutdown();
+    }
+    if (directory_extent != nullptr) {
+        directory_extent->shutdown();
+    }
+    delete this;
+}
@@ -0,0 +1,110 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef SERIALIZER_LOG_LBA_SNAPSHOT_HPP_
+#define SERIALIZER_LOG_LBA_SNAPSHOT_HPP_
+
+#include <vector>
+
+#include "arch/types.hpp"
+#include "containers/scoped.hpp"
+#include "serializer/log/lba/disk_format.hpp"
+#include "serializer/log/lba/extent.hpp"
+#include "serializer/log/lba/in_memory_index.hpp"
+
+class extent_manager_t;
+class extent_transaction_t;
+
+/* The in-memory side of an LBA snapshot (see `lba_snapshot_directory_t` in
+disk_format.hpp).  An `lba_snapshot_t` is either being written by the LBA snapshot
+writer in `lba_list_t`, or has been loaded during startup and is owned by an
+`lba_disk_structure_t`. */
+
+class lba_snapshot_t {
+public:
+    // Starts a new snapshot that covers the first `covered_extents_count` extents of
+    // an LBA superblock, the last of which is at `last_covered_extent_offset`.
+    lba_snapshot_t(extent_manager_t *em, file_t *file,
+                   int64_t covered_extents_count, int64_t last_covered_extent_offset);
+
+    // Whether `directory`, as read from a file of `file_size` bytes, is a complete
+    // directory of `extents_count` data extents.  A directory that was torn by a crash
+    // while it was being written, or that is garbage, is not.
+    static bool directory_is_valid(const extent_manager_t *em,
+                                   const lba_snapshot_directory_t *directory,
+                                   int64_t extents_count, int64_t file_size);
+
+    // Recreates a snapshot from its directory, which is stored at `directory_offset`
+    // (used during startup).  The directory must be valid.
+    lba_snapshot_t(extent_manager_t *em, file_t *file, int64_t directory_offset,
+                   const lba_snapshot_directory_t *directory, int64_t extents_count);
+
+    // Appends the block info for `block_id`.  Block ids must belong to the same LBA
+    // shard and must be added in increasing order.
+    void add_entry(block_id_t block_id, const index_block_info_t &info,
+                   file_account_t *io_account);
+
+    // Writes out the last data extent and the directory.  Must be called once, after
+    // the last call to `add_entry()`.
+    void finish(file_account_t *io_account);
+
+    // Calls `cb->on_extent_sync()` once for each of the `num_extents()` extents that
+    // make up the snapshot, as soon as that extent is on disk.
+    void sync(extent_t::sync_callback_t *cb);
+    size_t num_extents() const;
+
+    int64_t covered_extents_count() const { return covered_extents_count_; }
+    int64_t last_covered_extent_offset() const { return last_covered_extent_offset_; }
+
+    void prepare_metablock(lba_shard_metablock_t *mb_out) const;
+
+    /* To load a snapshot, call `read_step_1()` for each of its `num_data_extents()`
+    data extents, and `read_step_2()` with the same `read_info_t` once the callback has
+    been called.  As opposed to LBA extents, the data extents of a snapshot can be
+    applied in any order. */
+
+    struct read_info_t {
+        scoped_device_block_aligned_ptr_t<lba_snapshot_extent_t> buffer;
+        int64_t entries_count;
+    };
+
+    size_t num_data_extents() const { return data_extents.size(); }
+    void read_step_1(size_t i, read_info_t *info_out, extent_t::read_callback_t *cb);
+    void read_step_2(read_info_t *info, in_memory_index_t *index);
+
+    /* destroy() deletes the structure in memory and also tells the extent manager that
+    the extents can be safely reused */
+    void destroy(extent_transaction_t *txn);
+
+    /* shutdown() only deletes the structure in memory */
+    void shutdown();
+
+private:
+    struct data_extent_t {
+        extent_t *extent;
+        int64_t entries_count;
+    };
+
+    void flush_data_extent(file_account_t *io_account);
+    int64_t entries_per_extent() const;
+    static int64_t entries_per_extent(int64_t extent_size);
+
+    /* Use destroy() or shutdown() instead */
+    ~lba_snapshot_t();
+
+    extent_manager_t *em;
+    file_t *file;
+
+    const int64_t covered_extents_count_;
+    const int64_t last_covered_extent_offset_;
+
+    std::vector<data_extent_t> data_extents;
+    extent_t *directory_extent;   // NULL until `finish()` has been called
+
+    // The data extent that `add_entry()` is currently filling in.  We only append it
+    // to a new extent once it's complete, because its header has to go first.
+    scoped_device_block_aligned_ptr_t<lba_snapshot_extent_t> pending_extent;
+    block_id_t next_block_id;
+
+    DISABLE_COPYING(lba_snapshot_t);
+};
+
+#endif  // SERIALIZER_LOG_LBA_SNAPSHOT_HPP_
@@ -134,6 +134,7 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
       pm_serializer_old_garbage_block_bytes(get_num_threads()),
       pm_serializer_old_total_block_bytes(get_num_threads()),
       pm_serializer_lba_gcs(get_num_threads()),
+      pm_serializer_lba_snapshots(get_num_threads()),
       parent_collection_membership(parent, &serializer_collection, "serializer"),
       stats_membership(&serializer_collection,
           &pm_serializer_block_reads, "serializer_block_reads",
@@ -153,7 +154,8 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
           &pm_serializer_data_extents_gced, "serializer_data_extents_gced",
           &pm_serializer_old_garbage_block_bytes, "serializer_old_garbage_block_bytes",
           &pm_serializer_old_total_block_bytes, "serializer_old_total_block_bytes",
-          &pm_serializer_lba_gcs, "serializer_lba_gcs")
+          &pm_serializer_lba_gcs, "serializer_lba_gcs",
+          &pm_serializer_lba_snapshots, "serializer_lba_snapshots")
 { }
 
 void log_serializer_stats_t::bytes_read(size_t count) {
@@ -443,10 +445,11 @@ log_serializer_t::~log_serializer_t() {
     rassert(active_write_count == 0);
 }
 
-file_account_t *log_serializer_t::make_io_account(int priority, int outstanding_requests_limit) {
+file_account_t *log_serializer_t::make_io_account(int priority, int outstanding_requests_limit,
+                                                  io_class_t io_class) {
     assert_thread();
     rassert(dbfile);
-    return new file_account_t(dbfile, priority, outstanding_requests_limit);
+    return new file_account_t(dbfile, priority, outstanding_requests_limit, io_class);
 }
 
 buf_ptr_t log_serializer_t::block_read(const counted_t<ls_block_token_pointee_t> &token,
@@ -103,6 +103,10 @@ private:
 // Used internally
 struct ls_start_existing_fsm_t;
 
+namespace unittest {
+class lba_snapshot_tester_t;
+}  // namespace unittest
+
 class log_serializer_t :
 #ifndef SEMANTIC_SERIALIZER_CHECK
     public serializer_t,
@@ -115,6 +119,7 @@ class log_serializer_t :
     friend class data_block_manager_t;
     friend class dbm_read_ahead_t;
     friend class ls_block_token_pointee_t;
+    friend class unittest::lba_snapshot_tester_t;
 
 public:
     /* Serializer configuration. dynamic_config_t is everything that can be changed from run
@@ -136,7 +141,8 @@ public:
 #ifndef SEMANTIC_SERIALIZER_CHECK
     using serializer_t::make_io_account;
 #endif
-    file_account_t *make_io_account(int priority, int outstanding_requests_limit);
+    file_account_t *make_io_account(int priority, int outstanding_requests_limit,
+                                    io_class_t io_class);
 
     void register_read_ahead_cb(serializer_read_ahead_callback_t *cb);
     void unregister_read_ahead_cb(serializer_read_ahead_callback_t *cb);
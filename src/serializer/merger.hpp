@@ -37,8 +37,9 @@ public:
     /* Allocates a new io account for the underlying file.
     Use delete to free it. */
     using serializer_t::make_io_account;
-    file_account_t *make_io_account(int priority, int outstanding_requests_limit) {
-        return inner->make_io_account(priority, outstanding_requests_limit);
+    file_account_t *make_io_account(int priority, int outstanding_requests_limit,
+                                    io_class_t io_class) {
+        return inner->make_io_account(priority, outstanding_requests_limit, io_class);
     }
 
     /* Some serializer implementations support read-ahead to speed up cache warmup.
@@ -0,0 +1,110 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/shards.hpp"
+
+#include "config/args.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/func.hpp"
+#include "rdb_protocol/val.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+ql::datum_t row_with_field(const char *field, ql::datum_t value, double id = 0) {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("id", ql::datum_t(id));
+    builder.overwrite(field, std::move(value));
+    return std::move(builder).to_datum();
+}
+
+counted_t<const ql::func_t> get_field_func(const char *field) {
+    return ql::new_get_field_func(ql::datum_t(field), ql::backtrace_id_t::empty());
+}
+
+// Accumulates `rows` one at a time, the way a shard does, and returns the result.
+ql::result_t shard_aggregate(const ql::terminal_variant_t &terminal,
+                             const std::vector<ql::datum_t> &rows) {
+    cond_t interruptor;
+    ql::env_t env(&interruptor,
+                  ql::return_empty_normal_batches_t::NO,
+                  reql_version_t::LATEST);
+    scoped_ptr_t<ql::accumulator_t> acc = ql::make_terminal(terminal);
+    for (const auto &row : rows) {
+        ql::groups_t groups = {{ql::datum_t(), ql::datums_t{row}}};
+        (*acc)(&env, &groups, store_key_t(), []() { return ql::datum_t(); });
+    }
+    ql::result_t res;
+    acc->finish(continue_bool_t::CONTINUE, &res);
+    return res;
+}
+
+ql::datum_t eager_aggregate(const ql::terminal_variant_t &terminal,
+                            std::vector<ql::datum_t> rows) {
+    cond_t interruptor;
+    ql::env_t env(&interruptor,
+                  ql::return_empty_normal_batches_t::NO,
+                  reql_version_t::LATEST);
+    scoped_ptr_t<ql::eager_acc_t> acc = ql::make_eager_terminal(terminal);
+    ql::groups_t groups = {{ql::datum_t(), std::move(rows)}};
+    (*acc)(&env, &groups);
+    return acc->finish_eager(ql::backtrace_id_t::empty(), false, env.limits())
+        ->as_datum();
+}
+
+TPTEST(Accumulators, SelectedField) {
+    optional<datum_string_t> field = get_field_func("a")->selected_field();
+    ASSERT_TRUE(field.has_value());
+    EXPECT_EQ(datum_string_t("a"), *field);
+    EXPECT_FALSE(ql::new_pluck_func(ql::datum_t("a"), ql::backtrace_id_t::empty())
+                     ->selected_field().has_value());
+}
+
+TPTEST(Accumulators, SumOfField) {
+    // More rows than a shard buffers, some of which don't have the field.
+    std::vector<ql::datum_t> rows;
+    double expected = 0;
+    for (int i = 0; i < ACCUMULATOR_BATCH_SIZE * 2 + 10; ++i) {
+        if (i % 7 == 0) {
+            rows.push_back(row_with_field("b", ql::datum_t(1.0)));
+        } else {
+            rows.push_back(row_with_field("a", ql::datum_t(static_cast<double>(i))));
+            expected += i;
+        }
+    }
+    ql::sum_wire_func_t sum(ql::backtrace_id_t::empty(), get_field_func("a"));
+
+    ql::result_t res = shard_aggregate(sum, rows);
+    ql::grouped_t<double> *grouped = boost::get<ql::grouped_t<double> >(&res);
+    ASSERT_TRUE(grouped != nullptr);
+    ASSERT_EQ(1u, grouped->size());
+    EXPECT_EQ(expected, grouped->begin()->second);
+
+    EXPECT_EQ(ql::datum_t(expected), eager_aggregate(sum, rows));
+}
+
+TPTEST(Accumulators, MinAndMaxOfField) {
+    std::vector<ql::datum_t> rows;
+    rows.push_back(row_with_field("a", ql::datum_t(3.0)));
+    rows.push_back(row_with_field("a", ql::datum_t(1.0)));
+    rows.push_back(row_with_field("b", ql::datum_t(0.0)));
+    // The first of the rows that tie wins.
+    rows.push_back(row_with_field("a", ql::datum_t(5.0), 1));
+    rows.push_back(row_with_field("a", ql::datum_t(5.0), 2));
+
+    ql::min_wire_func_t min(ql::backtrace_id_t::empty(), get_field_func("a"));
+    EXPECT_EQ(row_with_field("a", ql::datum_t(1.0)), eager_aggregate(min, rows));
+    ql::max_wire_func_t max(ql::backtrace_id_t::empty(), get_field_func("a"));
+    EXPECT_EQ(row_with_field("a", ql::datum_t(5.0), 1), eager_aggregate(max, rows));
+}
+
+TPTEST(Accumulators, ErrorFromBufferedRow) {
+    std::vector<ql::datum_t> rows;
+    rows.push_back(row_with_field("a", ql::datum_t(1.0)));
+    rows.push_back(row_with_field("a", ql::datum_t("one")));
+    ql::sum_wire_func_t sum(ql::backtrace_id_t::empty(), get_field_func("a"));
+
+    ql::result_t res = shard_aggregate(sum, rows);
+    EXPECT_TRUE(boost::get<ql::exc_t>(&res) != nullptr);
+}
+
+}  // namespace unittest
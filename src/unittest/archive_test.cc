@@ -34,6 +34,22 @@ TEST(WriteMessageTest, Variant) {
     ASSERT_EQ(15u, s.size());
 }
 
+TEST(WriteMessageTest, AppendAndClear) {
+    write_message_t wm;
+    wm.append("ab", 2);
+
+    write_message_t other;
+    std::string large(write_buffer_t::DATA_SIZE + 1, 'x');
+    other.append(large.data(), large.size());
+
+    wm.append_and_clear(&other);
+    EXPECT_EQ(0u, other.size());
+    wm.append("c", 1);
+
+    std::string s;
+    dump_to_string(&wm, &s);
+    EXPECT_EQ("ab" + large + "c", s);
+}
 
 
 }  // namespace unittest
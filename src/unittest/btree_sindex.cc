@@ -170,7 +170,8 @@ TPTEST(BTreeSindex, BtreeStoreAPI) {
             &io_backender,
             base_path_t("."),
             generate_uuid(),
-            update_sindexes_t::UPDATE);
+            update_sindexes_t::UPDATE,
+            r_nullopt);
 
     cond_t dummy_interruptor;
 
@@ -2,7 +2,12 @@
 
 #include "arch/io/disk.hpp"
 #include "arch/types.hpp"
+#include "btree/bulk_load.hpp"
+#include "btree/count.hpp"
 #include "btree/depth_first_traversal.hpp"
+#include "btree/erase_subtrees.hpp"
+#include "btree/internal_node.hpp"
+#include "btree/node.hpp"
 #include "btree/reql_specific.hpp"
 #include "buffer_cache/cache_balancer.hpp"
 #include "random.hpp"
@@ -135,6 +140,46 @@ public:
         return bt_result;
     }
 
+    void get_many(const std::vector<store_key_t> &keys, direction_t direction) {
+        std::vector<const btree_key_t *> btree_keys;
+        for (const store_key_t &key : keys) {
+            btree_keys.push_back(key.btree_key());
+        }
+        std::vector<std::string> bt_results(keys.size());
+
+        run_txn_fn(false, [&](scoped_ptr_t<real_superblock_t> &&superblock){
+            profile::trace_t trace;
+            btree_stats_t stats(&get_global_perfmon_collection(), "test-get-many", get_num_threads());
+
+            const btree_key_t *last_key = nullptr;
+            find_keyvalue_locations_for_read(
+                sizer.get(),
+                superblock.get(),
+                btree_keys,
+                direction,
+                release_superblock_t::RELEASE,
+                [&](size_t index, const void *value, UNUSED buf_parent_t leaf) {
+                    // The values come in key order.
+                    if (last_key != nullptr) {
+                        int cmp = btree_key_cmp(last_key, btree_keys[index]);
+                        EXPECT_TRUE(direction == direction_t::FORWARD ? cmp <= 0 : cmp >= 0);
+                    }
+                    last_key = btree_keys[index];
+                    bt_results[index] =
+                        static_cast<const short_value_buffer_t *>(value)->as_str();
+                    return continue_bool_t::CONTINUE;
+                },
+                &stats,
+                &trace);
+        });
+
+        for (size_t i = 0; i < keys.size(); ++i) {
+            auto kv_pair = kv.find(keys[i]);
+            EXPECT_EQ(kv_pair == kv.end() ? std::string() : kv_pair->second,
+                      bt_results[i]);
+        }
+    }
+
     void set(const store_key_t &key, const std::string &value, repli_timestamp_t timestamp) {
         run_txn_fn(true, [&](scoped_ptr_t<real_superblock_t> &&superblock){
             profile::trace_t trace;
@@ -173,6 +218,22 @@ public:
         set(key, value, repli_timestamp_t::distant_past);
     }
 
+    void bulk_load(const std::map<store_key_t, std::string> &pairs) {
+        ASSERT_TRUE(kv.empty());
+        run_txn_fn(true, [&](scoped_ptr_t<real_superblock_t> &&superblock){
+            btree_bulk_loader_t loader(
+                sizer.get(), superblock.get(), repli_timestamp_t::distant_past);
+            for (const auto &pair : pairs) {
+                short_value_buffer_t buf(pair.second);
+                loader.add(pair.first.btree_key(), buf.data());
+            }
+            loader.finish();
+            EXPECT_EQ(static_cast<int64_t>(pairs.size()), loader.num_pairs());
+        });
+
+        kv = pairs;
+    }
+
     void remove(const store_key_t &key, repli_timestamp_t timestamp) {
         EXPECT_TRUE(should_have(key));
 
@@ -211,6 +272,34 @@ public:
         remove(key, repli_timestamp_t::distant_past);
     }
 
+    void erase_subtrees(const key_range_t &_range, int max_leaves) {
+        for (continue_bool_t done = continue_bool_t::CONTINUE;
+             done == continue_bool_t::CONTINUE;) {
+            key_range_t erased_range;
+            int64_t pairs_erased;
+            run_txn_fn(true, [&](scoped_ptr_t<real_superblock_t> &&superblock){
+                noop_value_deleter_t deleter;
+                done = erase_subtrees_in_range(
+                    sizer.get(), superblock.get(), _range, max_leaves, &deleter,
+                    &erased_range, &pairs_erased);
+            });
+
+            // Everything up to where it stopped is gone, and nothing else.
+            ASSERT_TRUE(erased_range.is_empty() || erased_range.left == _range.left);
+            int64_t expected_pairs_erased = 0;
+            for (auto it = kv.begin(); it != kv.end();) {
+                if (erased_range.contains_key(it->first)) {
+                    ++expected_pairs_erased;
+                    it = kv.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            EXPECT_EQ(expected_pairs_erased, pairs_erased);
+            verify();
+        }
+    }
+
     void range(const key_range_t &_range) {
         std::map<store_key_t, std::string> bt_map;
 
@@ -240,6 +329,87 @@ public:
         expect_maps_equal(bt_map, kv_map);
     }
 
+    void count(const key_range_t &_range) {
+        int64_t bt_count;
+        run_txn_fn(false, [&](scoped_ptr_t<real_superblock_t> &&superblock){
+            cond_t interruptor;
+            bt_count = btree_count_in_range(
+                superblock.get(), _range, release_superblock_t::RELEASE, &interruptor);
+        });
+
+        int64_t kv_count = 0;
+        for (const auto &pair : kv) {
+            if (_range.contains_key(pair.first)) {
+                ++kv_count;
+            }
+        }
+        EXPECT_EQ(kv_count, bt_count);
+    }
+
+    // Reads the root without acquiring it, while a write transaction has it acquired or
+    // not, which is only possible if it doesn't.
+    void peek_root(bool write_locked) {
+        scoped_ptr_t<txn_t> write_txn;
+        buf_lock_t root_for_write;
+        if (write_locked) {
+            scoped_ptr_t<real_superblock_t> superblock;
+            get_btree_superblock_and_txn_for_writing(
+                cache_conn.get(), nullptr, write_access_t::write, 1,
+                write_durability_t::SOFT, &superblock, &write_txn);
+            root_for_write = buf_lock_t(superblock->expose_buf(),
+                                        superblock->get_root_block_id(),
+                                        access_t::write);
+            root_for_write.write_acq_signal()->wait();
+        }
+
+        {
+            cache_conn_t read_conn(cache.get());
+            scoped_ptr_t<txn_t> txn;
+            scoped_ptr_t<real_superblock_t> superblock;
+            get_btree_superblock_and_txn_for_reading(
+                &read_conn, CACHE_SNAPSHOTTED_NO, &superblock, &txn);
+            const block_id_t root_id = superblock->get_root_block_id();
+            buf_peek_t peek(superblock->expose_buf(), root_id);
+            EXPECT_EQ(!write_locked, peek.has());
+            if (peek.has()) {
+                const void *peeked = peek.get_data_read();
+                buf_lock_t root(superblock->expose_buf(), root_id, access_t::read);
+                buf_read_t read(&root);
+                EXPECT_EQ(peeked, read.get_data_read());
+            }
+        }
+
+        if (write_locked) {
+            root_for_write.reset_buf_lock();
+            write_txn->commit();
+        }
+    }
+
+    // The number of levels of the tree, leaves included.
+    int depth() {
+        int levels = 0;
+        run_txn_fn(false, [&](scoped_ptr_t<real_superblock_t> &&superblock){
+            block_id_t block_id = superblock->get_root_block_id();
+            buf_lock_t buf(superblock->expose_buf(), block_id, access_t::read);
+            superblock->release();
+            for (;;) {
+                ++levels;
+                {
+                    buf_read_t read(&buf);
+                    auto node = static_cast<const node_t *>(read.get_data_read());
+                    if (node::is_leaf(node)) {
+                        break;
+                    }
+                    block_id = internal_node::get_pair_by_index(
+                        reinterpret_cast<const internal_node_t *>(node), 0)->lnode;
+                }
+                buf_lock_t child(&buf, block_id, access_t::read);
+                buf = std::move(child);
+            }
+        });
+        return levels;
+    }
+
     bool should_have(const store_key_t &key) {
         return kv.find(key) != kv.end();
     }
@@ -362,6 +532,7 @@ key_range_t random_key_range(rng_t *rng) {
 
 enum class btree_fuzz_op_t {
     get,
+    get_many,
     set,
     remove,
     range,
@@ -386,6 +557,7 @@ void btree_fuzz_test(bool stay_small, bool random_timestamps, int iterations) {
          btree_fuzz_op_t::remove,
 
          btree_fuzz_op_t::get,
+         btree_fuzz_op_t::get_many,
          btree_fuzz_op_t::range,
          btree_fuzz_op_t::verify,
     };
@@ -429,6 +601,21 @@ void btree_fuzz_test(bool stay_small, bool random_timestamps, int iterations) {
             }
             break;
 
+        case btree_fuzz_op_t::get_many: {
+            // Unsorted, with duplicates and with keys that aren't in the tree.
+            std::vector<store_key_t> keys;
+            for (int n = rng.randint(50); n > 0; --n) {
+                if (rng.randint(10) == 0) {
+                    keys.push_back(store_key_t(random_letter_string(&rng, 1, 250)));
+                } else {
+                    keys.push_back(ctx.pick_random_key(&rng));
+                }
+            }
+            ctx.get_many(keys, rng.randint(2) == 0
+                ? direction_t::FORWARD : direction_t::BACKWARD);
+            break;
+        }
+
         case btree_fuzz_op_t::range: {
             ctx.range(random_key_range(&rng));
             break;
@@ -460,6 +647,162 @@ TPTEST(BTree, WholeLargeFuzzRandomTS) {
     btree_fuzz_test(false, true, 1000);
 }
 
+TPTEST(BTree, BulkLoad) {
+    rng_t rng;
+    for (int size : { 0, 1, 50, 3000 }) {
+        BTreeTestContext ctx;
+        std::map<store_key_t, std::string> pairs;
+        while (pairs.size() < static_cast<size_t>(size)) {
+            pairs[store_key_t(random_letter_string(&rng, 1, 250))] =
+                random_letter_string(&rng, 0, 250);
+        }
+        ctx.bulk_load(pairs);
+        ctx.verify();
+        for (int i = 0; i < 10; ++i) {
+            ctx.range(random_key_range(&rng));
+        }
+
+        // The loaded tree has to take regular writes, which split, merge and level
+        // its nodes.
+        for (int i = 0; i < 200; ++i) {
+            ctx.set(store_key_t(random_letter_string(&rng, 1, 250)),
+                    random_letter_string(&rng, 0, 250));
+        }
+        ctx.verify();
+        while (!ctx.is_empty()) {
+            ctx.remove(ctx.pick_random_key(&rng));
+            if (rng.randint(100) == 0) {
+                ctx.verify();
+            }
+        }
+        ctx.verify();
+    }
+}
+
+TPTEST(BTree, EraseSubtrees) {
+    rng_t rng;
+    BTreeTestContext ctx;
+    std::map<store_key_t, std::string> pairs;
+    while (pairs.size() < 3000) {
+        pairs[store_key_t(random_letter_string(&rng, 1, 250))] =
+            random_letter_string(&rng, 0, 250);
+    }
+    ctx.bulk_load(pairs);
+
+    for (int i = 0; i < 20; ++i) {
+        ctx.erase_subtrees(random_key_range(&rng), 1 + rng.randint(8));
+
+        // The erased ranges leave empty and underfull nodes behind, which later writes
+        // have to deal with.
+        for (int j = 0; j < 100; ++j) {
+            ctx.set(store_key_t(random_letter_string(&rng, 1, 250)),
+                    random_letter_string(&rng, 0, 250));
+        }
+        for (int j = 0; j < 20 && !ctx.is_empty(); ++j) {
+            ctx.remove(ctx.pick_random_key(&rng));
+        }
+        ctx.verify();
+    }
+
+    ctx.erase_subtrees(key_range_t::universe(), 4);
+    EXPECT_TRUE(ctx.is_empty());
+    for (int i = 0; i < 500; ++i) {
+        ctx.set(store_key_t(random_letter_string(&rng, 1, 250)),
+                random_letter_string(&rng, 0, 250));
+    }
+    ctx.verify();
+}
+
+TPTEST(BTree, EraseSubtreesThenWriteAtEdges) {
+    // Long keys make for small internal nodes, and so for a deep tree.
+    const std::string suffix(200, 'x');
+    auto make_key = [&](int i, const std::string &extra) {
+        return store_key_t(strprintf("%06d", i) + extra + suffix);
+    };
+    BTreeTestContext ctx;
+    std::map<store_key_t, std::string> pairs;
+    for (int i = 0; i < 10000; ++i) {
+        pairs[make_key(i, "")] = "v";
+    }
+    ctx.bulk_load(pairs);
+    ASSERT_LE(3, ctx.depth());
+
+    // Whole subtrees of the middle go away.  What is left of them in the internal
+    // nodes must still take writes at either edge of the range, and in between.
+    ctx.erase_subtrees(key_range_t(key_range_t::closed, make_key(2000, ""),
+                                   key_range_t::open, make_key(8000, "")),
+                       ERASE_SUBTREES_MAX_LEAVES_PER_TXN);
+    ctx.verify();
+    for (int i : { 1999, 2000, 5000, 7999, 8000 }) {
+        ctx.set(make_key(i, ""), "w");
+        ctx.set(make_key(i, "a"), "w");
+        ctx.get(make_key(i, ""));
+    }
+    ctx.verify();
+    for (int i = 2000; i < 8000; i += 7) {
+        ctx.set(make_key(i, "b"), "w");
+    }
+    for (int i = 1900; i < 2100; ++i) {
+        if (ctx.should_have(make_key(i, ""))) {
+            ctx.remove(make_key(i, ""));
+        }
+    }
+    ctx.verify();
+    ctx.count(key_range_t::universe());
+}
+
+TPTEST(BTree, Count) {
+    rng_t rng;
+    BTreeTestContext ctx;
+    ctx.count(key_range_t::universe());
+    std::map<store_key_t, std::string> pairs;
+    while (pairs.size() < 3000) {
+        pairs[store_key_t(random_letter_string(&rng, 1, 250))] =
+            random_letter_string(&rng, 0, 250);
+    }
+    ctx.bulk_load(pairs);
+
+    for (int i = 0; i < 5; ++i) {
+        // The whole tree is counted from the stat block, and the rest leaf by leaf.
+        ctx.count(key_range_t::universe());
+        ctx.count(key_range_t(key_range_t::closed, store_key_t::min(),
+                              key_range_t::open, ctx.pick_random_key(&rng)));
+        ctx.count(key_range_t(key_range_t::closed, ctx.pick_random_key(&rng),
+                              key_range_t::none, store_key_t()));
+        for (int j = 0; j < 10; ++j) {
+            ctx.count(random_key_range(&rng));
+        }
+
+        for (int j = 0; j < 100; ++j) {
+            ctx.set(store_key_t(random_letter_string(&rng, 1, 250)),
+                    random_letter_string(&rng, 0, 250));
+        }
+        for (int j = 0; j < 300; ++j) {
+            ctx.remove(ctx.pick_random_key(&rng));
+        }
+    }
+}
+
+TPTEST(BTree, PeekInternalNodes) {
+    rng_t rng;
+    BTreeTestContext ctx;
+    std::map<store_key_t, std::string> pairs;
+    while (pairs.size() < 3000) {
+        pairs[store_key_t(random_letter_string(&rng, 1, 250))] =
+            random_letter_string(&rng, 0, 250);
+    }
+    ctx.bulk_load(pairs);
+
+    ctx.peek_root(false);
+    ctx.peek_root(true);
+    for (int i = 0; i < 100; ++i) {
+        ctx.get(ctx.pick_random_key(&rng));
+        ctx.set(store_key_t(random_letter_string(&rng, 1, 250)),
+                random_letter_string(&rng, 0, 250));
+    }
+    ctx.peek_root(false);
+}
+
 TPTEST(BTree, RemoveInOrder) {
     BTreeTestContext ctx;
     rng_t rng;
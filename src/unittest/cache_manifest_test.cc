@@ -0,0 +1,47 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <errno.h>
+#include <unistd.h>
+
+#include "buffer_cache/cache_manifest.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TEST(CacheManifestTest, RoundTrip) {
+    temp_directory_t dir;
+    const std::string path = dir.path().path() + "/manifest";
+
+    std::vector<block_id_t> block_ids = { 5, 1, 77, 3 };
+    ASSERT_EQ(0, write_cache_manifest(path, block_ids));
+
+    std::vector<block_id_t> read_back;
+    ASSERT_EQ(0, read_cache_manifest(path, &read_back));
+    EXPECT_EQ(block_ids, read_back);
+
+    // Rewriting replaces the old manifest.
+    block_ids.resize(1);
+    ASSERT_EQ(0, write_cache_manifest(path, block_ids));
+    ASSERT_EQ(0, read_cache_manifest(path, &read_back));
+    EXPECT_EQ(block_ids, read_back);
+
+    ASSERT_EQ(0, remove_cache_manifest(path));
+    EXPECT_EQ(ENOENT, read_cache_manifest(path, &read_back));
+    EXPECT_TRUE(read_back.empty());
+    EXPECT_EQ(0, remove_cache_manifest(path));
+}
+
+TEST(CacheManifestTest, Malformed) {
+    temp_directory_t dir;
+    const std::string path = dir.path().path() + "/manifest";
+
+    ASSERT_EQ(0, write_cache_manifest(path, std::vector<block_id_t>{ 1, 2, 3 }));
+    // Chop off half of the last block id.
+    ASSERT_EQ(0, truncate(path.c_str(), 8 + 8 + 2 * sizeof(block_id_t) + 4));
+
+    std::vector<block_id_t> read_back;
+    EXPECT_EQ(EINVAL, read_cache_manifest(path, &read_back));
+    EXPECT_TRUE(read_back.empty());
+}
+
+}  // namespace unittest
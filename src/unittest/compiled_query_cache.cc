@@ -0,0 +1,111 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/compiled_query_cache.hpp"
+
+#include <string.h>
+
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/term.hpp"
+#include "rdb_protocol/term_storage.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+scoped_ptr_t<ql::term_storage_t> parse_query(const std::string &json) {
+    scoped_array_t<char> buffer(json.size() + 1);
+    memcpy(buffer.data(), json.c_str(), json.size() + 1);
+    rapidjson::Document doc;
+    doc.ParseInsitu(buffer.data());
+    guarantee(!doc.HasParseError());
+    scoped_ptr_t<ql::term_storage_t> term_storage(
+        new ql::json_term_storage_t(std::move(buffer), std::move(doc)));
+    term_storage->preprocess();
+    return term_storage;
+}
+
+std::string start_query(const std::string &term) {
+    return strprintf("[%d, %s]", static_cast<int>(Query::START), term.c_str());
+}
+
+std::string add_term(const std::string &left, const std::string &right) {
+    return strprintf("[%d, [%s, %s]]", static_cast<int>(Term::ADD),
+                     left.c_str(), right.c_str());
+}
+
+// Applies `function(x) { return x + addend; }` to `arg`.
+std::string call_term(const std::string &addend, const std::string &arg) {
+    return strprintf("[%d, [[%d, [[%d, [1]], %s]], %s]]",
+                     static_cast<int>(Term::FUNCALL),
+                     static_cast<int>(Term::FUNC),
+                     static_cast<int>(Term::MAKE_ARRAY),
+                     add_term(strprintf("[%d, [1]]", static_cast<int>(Term::VAR)),
+                              addend).c_str(),
+                     arg.c_str());
+}
+
+ql::datum_t evaluate(const ql::compiled_query_t *compiled_query,
+                     const std::vector<ql::datum_t> &parameters) {
+    cond_t interruptor;
+    ql::env_t env(&interruptor,
+                  ql::return_empty_normal_batches_t::NO,
+                  reql_version_t::LATEST);
+    env.set_parameters(&parameters);
+    ql::scope_env_t scope_env(&env, ql::var_scope_t());
+    return compiled_query->term_tree->eval(&scope_env)->as_datum();
+}
+
+TPTEST(CompiledQueryCache, Parameters) {
+    ql::compiled_query_cache_t cache;
+
+    scoped_ptr_t<ql::term_storage_t> first = parse_query(start_query(add_term("1", "2")));
+    std::vector<ql::datum_t> first_parameters;
+    counted_t<const ql::compiled_query_t> first_compiled =
+        cache.get(first->root_term(), &first_parameters);
+    ASSERT_TRUE(first_compiled.has());
+    ASSERT_EQ(2u, first_parameters.size());
+    EXPECT_EQ(ql::datum_t(3.0), evaluate(first_compiled.get(), first_parameters));
+
+    // The same shape with other values is compiled once.
+    scoped_ptr_t<ql::term_storage_t> second =
+        parse_query(start_query(add_term("10", "20")));
+    std::vector<ql::datum_t> second_parameters;
+    counted_t<const ql::compiled_query_t> second_compiled =
+        cache.get(second->root_term(), &second_parameters);
+    EXPECT_EQ(first_compiled.get(), second_compiled.get());
+    EXPECT_EQ(ql::datum_t(30.0), evaluate(second_compiled.get(), second_parameters));
+    EXPECT_EQ(ql::datum_t(3.0), evaluate(first_compiled.get(), first_parameters));
+
+    // The types of the parameters are part of the shape.
+    scoped_ptr_t<ql::term_storage_t> third =
+        parse_query(start_query(add_term("\"a\"", "\"b\"")));
+    std::vector<ql::datum_t> third_parameters;
+    counted_t<const ql::compiled_query_t> third_compiled =
+        cache.get(third->root_term(), &third_parameters);
+    ASSERT_TRUE(third_compiled.has());
+    EXPECT_NE(first_compiled.get(), third_compiled.get());
+    EXPECT_EQ(ql::datum_t("ab"), evaluate(third_compiled.get(), third_parameters));
+}
+
+TPTEST(CompiledQueryCache, LiteralsInFunctions) {
+    ql::compiled_query_cache_t cache;
+
+    // The literals in functions are part of the shape, and so is the argument of the
+    // function call, which doesn't pass parameters.
+    scoped_ptr_t<ql::term_storage_t> first = parse_query(start_query(call_term("5", "2")));
+    std::vector<ql::datum_t> first_parameters;
+    counted_t<const ql::compiled_query_t> first_compiled =
+        cache.get(first->root_term(), &first_parameters);
+    ASSERT_TRUE(first_compiled.has());
+    EXPECT_TRUE(first_parameters.empty());
+    EXPECT_EQ(ql::datum_t(7.0), evaluate(first_compiled.get(), first_parameters));
+
+    scoped_ptr_t<ql::term_storage_t> second =
+        parse_query(start_query(call_term("6", "2")));
+    std::vector<ql::datum_t> second_parameters;
+    counted_t<const ql::compiled_query_t> second_compiled =
+        cache.get(second->root_term(), &second_parameters);
+    EXPECT_NE(first_compiled.get(), second_compiled.get());
+    EXPECT_EQ(ql::datum_t(8.0), evaluate(second_compiled.get(), second_parameters));
+}
+
+}  // namespace unittest
@@ -0,0 +1,122 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include "buffer_cache/cache_balancer.hpp"
+#include "buffer_cache/compressed_page_tier.hpp"
+#include "config/args.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+static buf_ptr_t make_buf(char fill) {
+    buf_ptr_t buf = buf_ptr_t::alloc_zeroed(block_size_t::unsafe_make(4096));
+    memset(buf.cache_data(), fill, 1000);
+    return buf;
+}
+
+TPTEST(CompressedPageTierTest, RoundTrip) {
+    alt::compressed_page_tier_t tier;
+
+    // Without a budget, nothing is kept.
+    tier.insert(1, 4096, make_buf('a'));
+    EXPECT_FALSE(tier.extract(1).has());
+
+    tier.set_memory_limit(MEGABYTE);
+    buf_ptr_t buf = make_buf('a');
+    tier.insert(1, 4096, buf);
+    EXPECT_EQ(1u, tier.size());
+    EXPECT_LT(tier.memory_usage(), buf.aligned_block_size());
+
+    scoped_ptr_t<alt::compressed_page_t> page = tier.extract(1);
+    ASSERT_TRUE(page.has());
+    EXPECT_EQ(4096, page->offset);
+    EXPECT_EQ(0u, tier.size());
+    EXPECT_EQ(0u, tier.memory_usage());
+
+    buf_ptr_t copy = page->decompress();
+    EXPECT_EQ(buf.block_size().ser_value(), copy.block_size().ser_value());
+    EXPECT_EQ(0, memcmp(buf.ser_buffer(), copy.ser_buffer(), buf.aligned_block_size()));
+}
+
+TPTEST(CompressedPageTierTest, Limit) {
+    alt::compressed_page_tier_t tier;
+    tier.set_memory_limit(MEGABYTE);
+    for (block_id_t i = 0; i < 10; ++i) {
+        tier.insert(i, i * 4096, make_buf('a' + i));
+    }
+    EXPECT_EQ(10u, tier.size());
+
+    // Shrinking the tier drops the oldest copies first.
+    tier.set_memory_limit(tier.memory_usage() / 2);
+    EXPECT_LE(tier.memory_usage(), tier.memory_limit());
+    EXPECT_FALSE(tier.extract(0).has());
+    EXPECT_TRUE(tier.extract(9).has());
+
+    tier.set_memory_limit(0);
+    EXPECT_EQ(0u, tier.size());
+}
+
+static buf_ptr_t make_random_buf() {
+    buf_ptr_t buf = buf_ptr_t::alloc_zeroed(block_size_t::unsafe_make(4096));
+    char *data = reinterpret_cast<char *>(buf.ser_buffer());
+    uint32_t x = 12345;
+    for (uint32_t i = 0; i < buf.aligned_block_size(); ++i) {
+        x = x * 1103515245 + 12345;
+        data[i] = x >> 24;
+    }
+    return buf;
+}
+
+TPTEST(CompressedPageTierTest, MeasuresWithoutRoom) {
+    alt::compressed_page_tier_t tier;
+    const uint64_t block_size = make_buf('a').aligned_block_size();
+
+    // Without room, only every `COMPRESSED_PAGE_TIER_SAMPLE_INTERVAL`th block is
+    // compressed, and none is kept.
+    for (int i = 0; i < 2 * COMPRESSED_PAGE_TIER_SAMPLE_INTERVAL; ++i) {
+        tier.insert(i, i * 4096, make_buf('a'));
+    }
+    EXPECT_EQ(0u, tier.size());
+    uint64_t measured, saved;
+    tier.take_compression_stats(&measured, &saved);
+    EXPECT_EQ(2 * block_size, measured);
+    EXPECT_GT(saved, block_size);
+    EXPECT_LT(saved, 2 * block_size);
+
+    // The stats start over, and blocks that don't compress save nothing.
+    tier.set_memory_limit(MEGABYTE);
+    tier.insert(1, 4096, make_random_buf());
+    EXPECT_EQ(0u, tier.size());
+    tier.take_compression_stats(&measured, &saved);
+    EXPECT_EQ(block_size, measured);
+    EXPECT_EQ(0u, saved);
+}
+
+TPTEST(CompressedPageTierTest, BalancerSplit) {
+    const uint64_t total = GIGABYTE;
+    const uint64_t max_tier_size = total * COMPRESSED_PAGE_TIER_CACHE_FRACTION;
+
+    // Nothing is set aside before blocks get evicted, or if they don't compress.
+    EXPECT_EQ(0u, compressed_page_tier_cache_size(total, 0, 0));
+    EXPECT_EQ(0u, compressed_page_tier_cache_size(total, MEGABYTE, 0));
+
+    // Otherwise the tiers get more the better the blocks compress.
+    EXPECT_EQ(max_tier_size / 2,
+              compressed_page_tier_cache_size(total, MEGABYTE, MEGABYTE / 2));
+    EXPECT_EQ(max_tier_size / 4,
+              compressed_page_tier_cache_size(total, MEGABYTE, MEGABYTE / 4));
+    EXPECT_EQ(max_tier_size, compressed_page_tier_cache_size(total, MEGABYTE, MEGABYTE));
+
+    // Each cache gets a share in proportion to its size.
+    const uint64_t tier_size = max_tier_size / 2;
+    const uint64_t small = compressed_page_tier_share(tier_size, total / 4, total);
+    const uint64_t large = compressed_page_tier_share(tier_size, 3 * total / 4, total);
+    EXPECT_EQ(tier_size / 4, small);
+    EXPECT_EQ(3 * tier_size / 4, large);
+    EXPECT_LE(small + large, tier_size);
+    EXPECT_EQ(0u, compressed_page_tier_share(tier_size, 0, total));
+    EXPECT_EQ(0u, compressed_page_tier_share(tier_size, 0, 0));
+}
+
+}  // namespace unittest
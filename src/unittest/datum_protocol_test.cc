@@ -0,0 +1,74 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "client_protocol/datum.hpp"
+
+#include "containers/archive/string_stream.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/response.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+ql::datum_t read_response(ql::response_t *response) {
+    string_stream_t write_stream;
+    write_message_t wm;
+    datum_protocol_t::write_response_to_message(response, &wm);
+    int write_res = send_write_message(&write_stream, &wm);
+    guarantee(write_res == 0);
+
+    string_read_stream_t read_stream(std::move(write_stream.str()), 0);
+    ql::datum_t res;
+    guarantee(ql::datum_deserialize(&read_stream, &res) == archive_result_t::SUCCESS);
+    return res;
+}
+
+TEST(DatumProtocolTest, Response) {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("id", ql::datum_t(1.0));
+    builder.overwrite("name", ql::datum_t("one"));
+    const ql::datum_t document = std::move(builder).to_datum();
+
+    // A document as it comes from disk, backed by its serialization.
+    ql::datum_t stored_document;
+    {
+        string_stream_t write_stream;
+        write_message_t wm;
+        ql::datum_serialize(&wm, document, ql::check_datum_serialization_errors_t::NO);
+        ASSERT_EQ(0, send_write_message(&write_stream, &wm));
+        string_read_stream_t read_stream(std::move(write_stream.str()), 0);
+        ASSERT_EQ(archive_result_t::SUCCESS,
+                  ql::datum_deserialize(&read_stream, &stored_document));
+        ASSERT_TRUE(stored_document.get_buf_ref() != nullptr);
+    }
+
+    ql::response_t response;
+    response.set_type(Response::SUCCESS_PARTIAL);
+    response.set_data(std::vector<ql::datum_t>{stored_document, ql::datum_t(2.0)});
+    response.add_note(Response::SEQUENCE_FEED);
+
+    ql::datum_t res = read_response(&response);
+    EXPECT_EQ(ql::datum_t(static_cast<double>(Response::SUCCESS_PARTIAL)),
+              res.get_field("t"));
+    ql::datum_t data = res.get_field("r");
+    ASSERT_EQ(2u, data.arr_size());
+    EXPECT_EQ(document, data.get(0));
+    EXPECT_EQ(ql::datum_t(2.0), data.get(1));
+    ql::datum_t notes = res.get_field("n");
+    ASSERT_EQ(1u, notes.arr_size());
+    EXPECT_EQ(ql::datum_t(static_cast<double>(Response::SEQUENCE_FEED)), notes.get(0));
+    EXPECT_FALSE(res.get_field("b", ql::NOTHROW).has());
+}
+
+TEST(DatumProtocolTest, Extrema) {
+    ql::response_t response;
+    response.set_type(Response::SUCCESS_ATOM);
+    response.set_data(ql::datum_t::minval());
+
+    ql::datum_t res = read_response(&response);
+    EXPECT_EQ(ql::datum_t(static_cast<double>(Response::RUNTIME_ERROR)),
+              res.get_field("t"));
+    EXPECT_EQ(ql::datum_t(static_cast<double>(Response::QUERY_LOGIC)),
+              res.get_field("e"));
+}
+
+}  // namespace unittest
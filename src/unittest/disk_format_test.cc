@@ -40,11 +40,25 @@ TEST(DiskFormatTest, FlaggedOff64T) {
 TEST(DiskFormatTest, LbaShardMetablockT) {
     EXPECT_EQ(0u, offsetof(lba_shard_metablock_t, last_lba_extent_offset));
     EXPECT_EQ(8u, offsetof(lba_shard_metablock_t, last_lba_extent_entries_count));
+    EXPECT_EQ(12u, offsetof(lba_shard_metablock_t, lba_snapshot_directory_extent));
     EXPECT_EQ(16u, offsetof(lba_shard_metablock_t, lba_superblock_offset));
     EXPECT_EQ(24u, offsetof(lba_shard_metablock_t, lba_superblock_entries_count));
+    EXPECT_EQ(28u, offsetof(lba_shard_metablock_t, lba_snapshot_extents_count));
     EXPECT_EQ(32u, sizeof(lba_shard_metablock_t));
 }
 
+TEST(DiskFormatTest, LbaSnapshotT) {
+    EXPECT_EQ(0u, offsetof(lba_snapshot_entry_t, offset));
+    EXPECT_EQ(8u, offsetof(lba_snapshot_entry_t, recency));
+    EXPECT_EQ(16u, offsetof(lba_snapshot_entry_t, ser_block_size));
+    EXPECT_EQ(18u, sizeof(lba_snapshot_entry_t));
+
+    EXPECT_EQ(24u, offsetof(lba_snapshot_extent_t, entries[0]));
+    EXPECT_EQ(16u, sizeof(lba_snapshot_directory_entry_t));
+    EXPECT_EQ(24u, offsetof(lba_snapshot_directory_t, entries[0]));
+    EXPECT_EQ(24u + 3 * 16u, lba_snapshot_directory_t::size(3));
+}
+
 TEST(DiskFormatTest, LbaMetablockMixinT) {
     // This test will clearly fail if it's not 4.
     EXPECT_EQ(4, LBA_SHARD_FACTOR);
@@ -0,0 +1,87 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <vector>
+
+#include "arch/io/disk/scheduler.hpp"
+#include "arch/runtime/thread_pool.hpp"
+#include "concurrency/queue/unlimited_fifo.hpp"
+#include "containers/scoped.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+struct scheduler_driver_t {
+    typedef scheduler_diskmgr_t::action_t action_t;
+
+    explicit scheduler_driver_t(int max_concurrent_io_requests)
+        : old_thread_id(linux_thread_pool_t::get_thread_id()) {
+        /* Fake thread-context for the scheduler's `assert_thread()`. */
+        linux_thread_pool_t::set_thread_id(0);
+        scheduler.init(new scheduler_diskmgr_t(&queue, max_concurrent_io_requests));
+        scheduler->done_fun = [](action_t *) { };
+    }
+    ~scheduler_driver_t() {
+        scheduler.reset();
+        linux_thread_pool_t::set_thread_id(old_thread_id);
+    }
+
+    action_t *submit(io_class_t io_class) {
+        actions.push_back(make_scoped<action_t>());
+        actions.back()->io_class = io_class;
+        queue.push(actions.back().get());
+        return actions.back().get();
+    }
+
+    bool available() {
+        return scheduler->producer->available->get();
+    }
+
+    action_t *pop() {
+        return static_cast<action_t *>(scheduler->producer->pop());
+    }
+
+    int old_thread_id;
+    std::vector<scoped_ptr_t<action_t> > actions;
+    unlimited_fifo_queue_t<action_t *> queue;
+    scoped_ptr_t<scheduler_diskmgr_t> scheduler;
+};
+
+TEST(DiskSchedulerTest, ForegroundFirst) {
+    scheduler_driver_t driver(4);
+    scheduler_diskmgr_action_t *background = driver.submit(io_class_t::background);
+    scheduler_diskmgr_action_t *gc = driver.submit(io_class_t::gc);
+    scheduler_diskmgr_action_t *flush = driver.submit(io_class_t::flush);
+    scheduler_diskmgr_action_t *interactive = driver.submit(io_class_t::interactive);
+
+    ASSERT_TRUE(driver.available());
+    EXPECT_EQ(interactive, driver.pop());
+    EXPECT_EQ(flush, driver.pop());
+    EXPECT_EQ(gc, driver.pop());
+    EXPECT_EQ(background, driver.pop());
+    EXPECT_FALSE(driver.available());
+
+    for (scheduler_diskmgr_action_t *a : { interactive, flush, gc, background }) {
+        driver.scheduler->done(a);
+    }
+}
+
+TEST(DiskSchedulerTest, BackgroundYieldsToForeground) {
+    scheduler_driver_t driver(2);
+    scheduler_diskmgr_action_t *interactive = driver.submit(io_class_t::interactive);
+    scheduler_diskmgr_action_t *first = driver.submit(io_class_t::background);
+    scheduler_diskmgr_action_t *second = driver.submit(io_class_t::background);
+
+    EXPECT_EQ(interactive, driver.pop());
+    EXPECT_EQ(first, driver.pop());
+    // Two requests are in flight, one of them interactive, so the second background
+    // request has to wait.
+    EXPECT_FALSE(driver.available());
+
+    driver.scheduler->done(interactive);
+    ASSERT_TRUE(driver.available());
+    EXPECT_EQ(second, driver.pop());
+
+    driver.scheduler->done(first);
+    driver.scheduler->done(second);
+}
+
+}  // namespace unittest
@@ -0,0 +1,189 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/datum_stream/external_sort.hpp"
+
+#include <algorithm>
+
+#include "arch/io/disk.hpp"
+#include "config/args.hpp"
+#include "rdb_protocol/context.hpp"
+#include "rdb_protocol/datum_stream/vector.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/func.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+ql::datum_t sort_row(int id, int key, const std::string &payload) {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("id", ql::datum_t(static_cast<double>(id)));
+    if (key >= 0) {
+        builder.overwrite("k", ql::datum_t(static_cast<double>(key)));
+    }
+    builder.overwrite("payload", ql::datum_t(datum_string_t(payload)));
+    return std::move(builder).to_datum();
+}
+
+// Sorts `rows` by their field `k`, and checks that the result is the same as that of
+// `std::stable_sort`, where the rows without `k` come first.
+void check_sort(rdb_context_t *ctx,
+                const std::vector<ql::datum_t> &rows,
+                bool expect_array) {
+    cond_t interruptor;
+    ql::env_t env(ctx,
+                  ql::return_empty_normal_batches_t::NO,
+                  &interruptor,
+                  ql::global_optargs_t(),
+                  auth::user_context_t(),
+                  ql::datum_t(),
+                  nullptr);
+
+    std::vector<std::pair<ql::order_direction_t, counted_t<const ql::func_t> > >
+        comparisons;
+    comparisons.push_back(std::make_pair(
+        ql::ASC,
+        ql::new_get_field_func(ql::datum_t("k"), ql::backtrace_id_t::empty())));
+    counted_t<ql::datum_stream_t> source = make_counted<ql::vector_datum_stream_t>(
+        ql::backtrace_id_t::empty(), std::vector<ql::datum_t>(rows), r_nullopt);
+    counted_t<ql::datum_stream_t> sorted =
+        make_counted<ql::external_sort_datum_stream_t>(
+            &env, source, ql::lt_cmp_t(comparisons), ql::backtrace_id_t::empty());
+    EXPECT_EQ(expect_array, sorted->is_array());
+
+    std::vector<ql::datum_t> expected(rows);
+    std::stable_sort(expected.begin(), expected.end(),
+        [](const ql::datum_t &l, const ql::datum_t &r) {
+            ql::datum_t l_key = l.get_field("k", ql::NOTHROW);
+            ql::datum_t r_key = r.get_field("k", ql::NOTHROW);
+            if (!l_key.has() || !r_key.has()) {
+                return !l_key.has() && r_key.has();
+            }
+            return l_key < r_key;
+        });
+
+    std::vector<ql::datum_t> res;
+    ql::batchspec_t batchspec = ql::batchspec_t::user(ql::batch_type_t::NORMAL, &env);
+    for (;;) {
+        std::vector<ql::datum_t> batch = sorted->next_batch(&env, batchspec);
+        if (batch.empty()) {
+            break;
+        }
+        res.insert(res.end(), batch.begin(), batch.end());
+    }
+    EXPECT_TRUE(sorted->is_exhausted());
+    ASSERT_EQ(expected.size(), res.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(expected[i], res[i]) << "at " << i;
+    }
+}
+
+TPTEST(ExternalSort, InMemory) {
+    rdb_context_t ctx;
+    std::vector<ql::datum_t> rows;
+    for (int i = 0; i < 1000; ++i) {
+        // Many ties, to check that the sort is stable, and some rows without a key.
+        rows.push_back(sort_row(i, i % 13 == 0 ? -1 : (i * 7919) % 50, ""));
+    }
+    check_sort(&ctx, rows, true);
+}
+
+TPTEST(ExternalSort, Spill, 4) {
+    temp_directory_t temp_dir;
+    recreate_temporary_directory(temp_dir.path());
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    rdb_context_t ctx;
+    ctx.io_backender = &io_backender;
+    ctx.base_path = temp_dir.path();
+
+    // Enough rows for a few runs.
+    const std::string payload(KILOBYTE, 'x');
+    const int num_rows = 3 * EXTERNAL_SORT_RUN_SIZE / KILOBYTE;
+    std::vector<ql::datum_t> rows;
+    for (int i = 0; i < num_rows; ++i) {
+        rows.push_back(sort_row(i, i % 101 == 0 ? -1 : (i * 7919) % 1000, payload));
+    }
+    check_sort(&ctx, rows, false);
+}
+
+// Sorts the rows by `id`, and then by `k.x`, which is an error for every row.
+std::vector<ql::datum_t> sort_by_id_then_error(rdb_context_t *ctx,
+                                               const std::vector<ql::datum_t> &rows) {
+    cond_t interruptor;
+    ql::env_t env(ctx,
+                  ql::return_empty_normal_batches_t::NO,
+                  &interruptor,
+                  ql::global_optargs_t(),
+                  auth::user_context_t(),
+                  ql::datum_t(),
+                  nullptr);
+
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+    auto var = ql::minidriver_t::dummy_var_t::FUNC_GETFIELD;
+    ql::compile_env_t empty_compile_env((ql::var_visibility_t()));
+    counted_t<ql::func_term_t> func_term = make_counted<ql::func_term_t>(
+        &empty_compile_env, r.fun(var, r.expr(var)["k"]["x"]).root_term());
+
+    std::vector<std::pair<ql::order_direction_t, counted_t<const ql::func_t> > >
+        comparisons;
+    comparisons.push_back(std::make_pair(
+        ql::ASC,
+        ql::new_get_field_func(ql::datum_t("id"), ql::backtrace_id_t::empty())));
+    comparisons.push_back(std::make_pair(
+        ql::ASC, func_term->eval_to_func(ql::var_scope_t())));
+    counted_t<ql::datum_stream_t> source = make_counted<ql::vector_datum_stream_t>(
+        ql::backtrace_id_t::empty(), std::vector<ql::datum_t>(rows), r_nullopt);
+    counted_t<ql::datum_stream_t> sorted =
+        make_counted<ql::external_sort_datum_stream_t>(
+            &env, source, ql::lt_cmp_t(comparisons), ql::backtrace_id_t::empty());
+    std::vector<ql::datum_t> res;
+    ql::batchspec_t batchspec = ql::batchspec_t::user(ql::batch_type_t::NORMAL, &env);
+    for (;;) {
+        std::vector<ql::datum_t> batch = sorted->next_batch(&env, batchspec);
+        if (batch.empty()) {
+            break;
+        }
+        res.insert(res.end(), batch.begin(), batch.end());
+    }
+    return res;
+}
+
+TPTEST(ExternalSort, KeyErrorsOnlyWhenCompared) {
+    rdb_context_t ctx;
+    std::vector<ql::datum_t> rows;
+    for (int i = 0; i < 100; ++i) {
+        rows.push_back(sort_row(99 - i, i, ""));
+    }
+    // The ids are distinct, so the second key is never needed.
+    std::vector<ql::datum_t> res = sort_by_id_then_error(&ctx, rows);
+    ASSERT_EQ(rows.size(), res.size());
+    for (size_t i = 0; i < res.size(); ++i) {
+        ASSERT_EQ(rows[rows.size() - 1 - i], res[i]);
+    }
+
+    // With a tie, it is, and its error is the sort's.
+    rows.push_back(sort_row(50, 0, ""));
+    ASSERT_THROW(sort_by_id_then_error(&ctx, rows), ql::exc_t);
+}
+
+TPTEST(ExternalSort, KeyErrorsOfSpilledRuns, 4) {
+    temp_directory_t temp_dir;
+    recreate_temporary_directory(temp_dir.path());
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    rdb_context_t ctx;
+    ctx.io_backender = &io_backender;
+    ctx.base_path = temp_dir.path();
+
+    // The runs are sorted on other threads, which have to pass the error of the tie
+    // in the second run on to the sort.
+    const std::string payload(KILOBYTE, 'x');
+    const int num_rows = 2 * EXTERNAL_SORT_RUN_SIZE / KILOBYTE;
+    std::vector<ql::datum_t> rows;
+    for (int i = 0; i < num_rows; ++i) {
+        rows.push_back(sort_row(i, i, payload));
+    }
+    rows.push_back(sort_row(num_rows - 1, 0, payload));
+    ASSERT_THROW(sort_by_id_then_error(&ctx, rows), ql::exc_t);
+}
+
+}  // namespace unittest
@@ -0,0 +1,146 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "arch/io/concurrency.hpp"
+#include "arch/io/disk.hpp"
+#include "arch/io/disk/group_datasync.hpp"
+#include "config/args.hpp"
+#include "time.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+#ifndef _WIN32
+
+struct datasync_arg_t {
+    group_datasync_t *group;
+    fd_t fd;
+    int result;
+    size_t batch_size;
+};
+
+void *run_datasync_thread(void *v_arg) {
+    datasync_arg_t *arg = static_cast<datasync_arg_t *>(v_arg);
+    arg->result = arg->group->datasync(arg->fd, &arg->batch_size);
+    return nullptr;
+}
+
+// Runs one datasync per fd, each on its own thread, all at once.
+std::vector<datasync_arg_t> run_datasyncs(group_datasync_t *group,
+                                          const std::vector<fd_t> &fds) {
+    std::vector<datasync_arg_t> args(fds.size());
+    std::vector<pthread_t> threads(fds.size());
+    for (size_t i = 0; i < fds.size(); ++i) {
+        args[i].group = group;
+        args[i].fd = fds[i];
+        args[i].result = -1;
+        args[i].batch_size = 0;
+        int res = pthread_create(&threads[i], nullptr, &run_datasync_thread, &args[i]);
+        guarantee_xerr(res == 0, res, "pthread_create failed");
+    }
+    for (pthread_t thread : threads) {
+        int res = pthread_join(thread, nullptr);
+        guarantee_xerr(res == 0, res, "pthread_join failed");
+    }
+    return args;
+}
+
+TEST(GroupDatasyncTest, ConcurrentDatasyncsShareABatch) {
+    temp_directory_t dir;
+    std::vector<fd_t> fds;
+    for (size_t i = 0; i < MAX_GROUP_DATASYNC_BATCH_SIZE; ++i) {
+        std::string path = dir.path().path() + "/file" + std::to_string(i);
+        fd_t fd = open(path.c_str(), O_CREAT | O_RDWR, 0644);
+        ASSERT_NE(-1, fd);
+        ASSERT_EQ(1, write(fd, "x", 1));
+        fds.push_back(fd);
+    }
+
+    // The batch fills up long before the delay runs out, so every datasync joins
+    // the first one.
+    group_datasync_t group(MAXIMUM_IO_GROUP_COMMIT_DELAY_USEC);
+    for (const datasync_arg_t &arg : run_datasyncs(&group, fds)) {
+        EXPECT_EQ(0, arg.result);
+        EXPECT_EQ(static_cast<size_t>(MAX_GROUP_DATASYNC_BATCH_SIZE), arg.batch_size);
+    }
+
+    for (fd_t fd : fds) {
+        close(fd);
+    }
+}
+
+TEST(GroupDatasyncTest, FilesOfABatchAreFlushedInParallel) {
+    const size_t num_files = 4;
+    temp_directory_t dir;
+    std::vector<fd_t> fds;
+    for (size_t i = 0; i < num_files; ++i) {
+        std::string path = dir.path().path() + "/file" + std::to_string(i);
+        fd_t fd = open(path.c_str(), O_CREAT | O_RDWR, 0644);
+        ASSERT_NE(-1, fd);
+        fds.push_back(fd);
+    }
+
+    // Each flush waits for the flushes of all the other files to start, which only
+    // happens if they run at the same time.
+    system_mutex_t mutex;
+    system_cond_t cond;
+    size_t flushes_started = 0;
+    size_t flushes_overlapped = 0;
+    auto datasync_fn = [&](fd_t) -> int {
+        system_mutex_t::lock_t lock(&mutex);
+        ++flushes_started;
+        cond.broadcast();
+        struct timespec deadline = clock_realtime();
+        add_to_timespec(&deadline, BILLION);
+        bool timed_out = false;
+        while (flushes_started < num_files && !timed_out) {
+            timed_out = !cond.timed_wait(&mutex, deadline);
+        }
+        if (flushes_started == num_files) {
+            ++flushes_overlapped;
+        }
+        return 0;
+    };
+
+    group_datasync_t group(100 * THOUSAND, datasync_fn);
+    for (const datasync_arg_t &arg : run_datasyncs(&group, fds)) {
+        EXPECT_EQ(0, arg.result);
+        EXPECT_EQ(num_files, arg.batch_size);
+    }
+    EXPECT_EQ(num_files, flushes_started);
+    EXPECT_EQ(num_files, flushes_overlapped);
+
+    for (fd_t fd : fds) {
+        close(fd);
+    }
+}
+
+TEST(GroupDatasyncTest, EveryFileOfABatchIsChecked) {
+    // Pipes share a device but can't be datasynced, so each datasync of the batch
+    // has to report the error of its own pipe.
+    std::vector<fd_t> fds;
+    std::vector<int> pipe_fds(4);
+    for (size_t i = 0; i < pipe_fds.size(); i += 2) {
+        ASSERT_EQ(0, pipe(&pipe_fds[i]));
+        fds.push_back(pipe_fds[i + 1]);
+    }
+
+    group_datasync_t group(100 * THOUSAND);
+    for (const datasync_arg_t &arg : run_datasyncs(&group, fds)) {
+        EXPECT_NE(0, arg.result);
+    }
+
+    for (int fd : pipe_fds) {
+        close(fd);
+    }
+}
+
+#endif  // _WIN32
+
+}  // namespace unittest
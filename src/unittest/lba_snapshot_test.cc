@@ -0,0 +1,256 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "arch/arch.hpp"
+#include "concurrency/new_mutex.hpp"
+#include "serializer/buf_ptr.hpp"
+#include "serializer/log/lba/lba_list.hpp"
+#include "serializer/log/log_serializer.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/mock_file.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+// Lets the tests write LBA snapshots on demand, and look at the ones that got loaded.
+class lba_snapshot_tester_t {
+public:
+    // Writes a snapshot of every LBA shard, like the LBA GC does when the shard's LBA
+    // has grown enough.
+    static void write_snapshots(log_serializer_t *ser) {
+        lba_list_t *lba = ser->lba_index;
+        for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+            ASSERT_FALSE(lba->gc_active[i]);
+            ASSERT_GT(lba->disk_structures[i]->extents_in_superblock.size(), 0u);
+            lba->gc_active[i] = true;
+            lba->write_snapshot(i, auto_drainer_t::lock_t(lba->gc_drainer.get()));
+        }
+    }
+
+    static lba_snapshot_t *snapshot(log_serializer_t *ser, int lba_shard) {
+        return ser->lba_index->disk_structures[lba_shard]->snapshot;
+    }
+
+    // The offset of the snapshot directory of `lba_shard`.
+    static int64_t directory_offset(log_serializer_t *ser, int lba_shard) {
+        lba_shard_metablock_t mb;
+        snapshot(ser, lba_shard)->prepare_metablock(&mb);
+        return (static_cast<int64_t>(mb.lba_snapshot_directory_extent) - 1)
+            * ser->static_config.extent_size();
+    }
+};
+
+// Small extents, so that a few thousand index writes fill up some LBA extents.
+log_serializer_t::static_config_t small_extents_config() {
+    log_serializer_t::static_config_t config;
+    config.extent_size_ = 16 * DEFAULT_BTREE_BLOCK_SIZE;
+    return config;
+}
+
+// The contents of the blocks and the recencies of all block ids that the test
+// expects to read back.
+struct lba_snapshot_expected_t {
+    std::map<block_id_t, char> contents;   // Missing for blocks without data
+    std::map<block_id_t, uint64_t> recencies;
+};
+
+repli_timestamp_t make_recency(uint64_t longtime) {
+    repli_timestamp_t recency;
+    recency.longtime = longtime;
+    return recency;
+}
+
+void write_block(log_serializer_t *ser, file_account_t *account, block_id_t block_id,
+                 char fill, lba_snapshot_expected_t *expected) {
+    buf_ptr_t buf = buf_ptr_t::alloc_zeroed(ser->max_block_size());
+    memset(buf.cache_data(), fill, buf.block_size().value());
+    std::vector<buf_write_info_t> infos;
+    infos.push_back(buf_write_info_t(buf.ser_buffer(), buf.block_size(), block_id));
+    struct : public iocallback_t, public cond_t {
+        void on_io_complete() { pulse(); }
+    } cb;
+    std::vector<counted_t<standard_block_token_t> > tokens
+        = ser->block_writes(infos, account, &cb);
+    cb.wait();
+
+    std::vector<index_write_op_t> ops;
+    ops.push_back(index_write_op_t(block_id, make_optional(tokens[0])));
+    new_mutex_in_line_t dummy_acq;
+    ser->index_write(&dummy_acq, []{ }, ops);
+    expected->contents[block_id] = fill;
+}
+
+void delete_block(log_serializer_t *ser, block_id_t block_id,
+                  lba_snapshot_expected_t *expected) {
+    std::vector<index_write_op_t> ops;
+    ops.push_back(index_write_op_t(block_id,
+                                   make_optional(counted_t<standard_block_token_t>())));
+    new_mutex_in_line_t dummy_acq;
+    ser->index_write(&dummy_acq, []{ }, ops);
+    expected->contents.erase(block_id);
+}
+
+// Sets the recency of every `step`th block id in [begin, end) to `recency_of(id)`,
+// which writes an LBA entry for each of them.
+void set_recencies(log_serializer_t *ser, block_id_t begin, block_id_t end,
+                   block_id_t step, const std::function<uint64_t(block_id_t)> &recency_of,
+                   lba_snapshot_expected_t *expected) {
+    std::vector<index_write_op_t> ops;
+    for (block_id_t id = begin; id < end; id += step) {
+        ops.push_back(index_write_op_t(id, r_nullopt,
+                                       make_optional(make_recency(recency_of(id)))));
+        expected->recencies[id] = recency_of(id);
+        if (ops.size() == 1000 || id + step >= end) {
+            new_mutex_in_line_t dummy_acq;
+            ser->index_write(&dummy_acq, []{ }, ops);
+            ops.clear();
+        }
+    }
+}
+
+void check_contents(log_serializer_t *ser, const lba_snapshot_expected_t &expected) {
+    segmented_vector_t<repli_timestamp_t> recencies = ser->get_all_recencies(0, 1);
+    for (const auto &pair : expected.recencies) {
+        ASSERT_LT(pair.first, static_cast<block_id_t>(recencies.size()));
+        ASSERT_EQ(pair.second, recencies[pair.first].longtime) << "block " << pair.first;
+    }
+
+    scoped_ptr_t<file_account_t> account(ser->make_io_account(1));
+    for (block_id_t id = 0; id < 8; ++id) {
+        counted_t<standard_block_token_t> token = ser->index_read(id);
+        auto it = expected.contents.find(id);
+        if (it == expected.contents.end()) {
+            ASSERT_FALSE(token.has()) << "block " << id;
+            continue;
+        }
+        ASSERT_TRUE(token.has()) << "block " << id;
+        buf_ptr_t buf = ser->block_read(token, account.get());
+        const char *data = static_cast<const char *>(buf.cache_data());
+        for (uint32_t i = 0; i < buf.block_size().value(); ++i) {
+            ASSERT_EQ(it->second, data[i]) << "block " << id << ", byte " << i;
+        }
+    }
+}
+
+// Writes enough LBA entries that every shard has LBA extents in its superblock, takes
+// snapshots, and then writes more entries on top of them.  Returns the offsets of the
+// snapshot directories.
+std::vector<int64_t> write_snapshotted_serializer(mock_file_opener_t *file_opener,
+                                                  lba_snapshot_expected_t *expected) {
+    log_serializer_t::create(file_opener, small_extents_config());
+    log_serializer_t ser(log_serializer_t::dynamic_config_t(),
+                         file_opener,
+                         &get_global_perfmon_collection());
+    scoped_ptr_t<file_account_t> account(ser.make_io_account(1));
+
+    for (block_id_t id = 0; id < 8; ++id) {
+        write_block(&ser, account.get(), id, 'a' + id, expected);
+    }
+    const block_id_t num_ids = 20000;
+    set_recencies(&ser, 0, num_ids, 1, [](block_id_t id) { return id + 1; }, expected);
+
+    lba_snapshot_tester_t::write_snapshots(&ser);
+    std::vector<int64_t> directory_offsets;
+    for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+        EXPECT_TRUE(lba_snapshot_tester_t::snapshot(&ser, i) != nullptr);
+        directory_offsets.push_back(lba_snapshot_tester_t::directory_offset(&ser, i));
+    }
+
+    // These have to be replayed on top of the snapshots.
+    for (block_id_t id = 0; id < 4; ++id) {
+        write_block(&ser, account.get(), id, 'A' + id, expected);
+    }
+    delete_block(&ser, 4, expected);
+    set_recencies(&ser, 0, num_ids, 7, [](block_id_t id) { return 2 * id + 5; },
+                  expected);
+    set_recencies(&ser, num_ids, num_ids + 5000, 1,
+                  [](block_id_t id) { return id + 1; }, expected);
+    return directory_offsets;
+}
+
+// Makes `modify` change the first block of the snapshot directory at `offset`.
+void modify_directory(mock_file_opener_t *file_opener, int64_t offset,
+                      const std::function<void(lba_snapshot_directory_t *)> &modify) {
+    scoped_ptr_t<file_t> file;
+    file_opener->open_serializer_file_existing(&file);
+    scoped_device_block_aligned_ptr_t<lba_snapshot_directory_t> directory(
+        DEVICE_BLOCK_SIZE);
+    co_read(file.get(), offset, DEVICE_BLOCK_SIZE, directory.get(),
+            DEFAULT_DISK_ACCOUNT);
+    modify(directory.get());
+    co_write(file.get(), offset, DEVICE_BLOCK_SIZE, directory.get(),
+             DEFAULT_DISK_ACCOUNT, file_t::NO_DATASYNCS);
+}
+
+TPTEST(LbaSnapshotTest, RoundTrip) {
+    mock_file_opener_t file_opener;
+    lba_snapshot_expected_t expected;
+    write_snapshotted_serializer(&file_opener, &expected);
+
+    log_serializer_t ser(log_serializer_t::dynamic_config_t(),
+                         &file_opener,
+                         &get_global_perfmon_collection());
+    for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+        EXPECT_TRUE(lba_snapshot_tester_t::snapshot(&ser, i) != nullptr);
+    }
+    check_contents(&ser, expected);
+}
+
+TPTEST(LbaSnapshotTest, TornDirectoryIsIgnored) {
+    mock_file_opener_t file_opener;
+    lba_snapshot_expected_t expected;
+    std::vector<int64_t> directory_offsets =
+        write_snapshotted_serializer(&file_opener, &expected);
+
+    // A directory that never made it to disk, and one with garbage entries.
+    modify_directory(&file_opener, directory_offsets[0],
+                     [](lba_snapshot_directory_t *directory) {
+                         memset(directory, 0, DEVICE_BLOCK_SIZE);
+                     });
+    modify_directory(&file_opener, directory_offsets[1],
+                     [](lba_snapshot_directory_t *directory) {
+                         directory->entries[0].entries_count = 0;
+                         directory->entries[0].offset += 1;
+                     });
+
+    log_serializer_t ser(log_serializer_t::dynamic_config_t(),
+                         &file_opener,
+                         &get_global_perfmon_collection());
+    EXPECT_TRUE(lba_snapshot_tester_t::snapshot(&ser, 0) == nullptr);
+    EXPECT_TRUE(lba_snapshot_tester_t::snapshot(&ser, 1) == nullptr);
+    EXPECT_TRUE(lba_snapshot_tester_t::snapshot(&ser, 2) != nullptr);
+    // The shards without a snapshot replay all of their LBA extents.
+    check_contents(&ser, expected);
+}
+
+TPTEST(LbaSnapshotTest, StaleSnapshotIsIgnored) {
+    mock_file_opener_t file_opener;
+    lba_snapshot_expected_t expected;
+    std::vector<int64_t> directory_offsets =
+        write_snapshotted_serializer(&file_opener, &expected);
+
+    // Snapshots that were taken of other LBA superblocks than the current ones.
+    const int64_t extent_size = small_extents_config().extent_size();
+    modify_directory(&file_opener, directory_offsets[2],
+                     [&](lba_snapshot_directory_t *directory) {
+                         directory->last_covered_extent_offset += extent_size;
+                     });
+    modify_directory(&file_opener, directory_offsets[3],
+                     [](lba_snapshot_directory_t *directory) {
+                         directory->covered_extents_count += 1000;
+                     });
+
+    log_serializer_t ser(log_serializer_t::dynamic_config_t(),
+                         &file_opener,
+                         &get_global_perfmon_collection());
+    EXPECT_TRUE(lba_snapshot_tester_t::snapshot(&ser, 0) != nullptr);
+    EXPECT_TRUE(lba_snapshot_tester_t::snapshot(&ser, 2) == nullptr);
+    EXPECT_TRUE(lba_snapshot_tester_t::snapshot(&ser, 3) == nullptr);
+    check_contents(&ser, expected);
+}
+
+}  // namespace unittest
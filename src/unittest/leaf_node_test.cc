@@ -1,6 +1,7 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include <map>
 
+#include "btree/key_prefix_index.hpp"
 #include "btree/leaf_node.hpp"
 #include "btree/node.hpp"
 #include "containers/scoped.hpp"
@@ -165,13 +166,16 @@ public:
         sibling->Verify();
     }
 
-    void Split(LeafNodeTracker *right) {
+    void Split(LeafNodeTracker *right, store_key_t *median_out = nullptr) {
         ASSERT_EQ(bs_.ser_value(), right->bs_.ser_value());
 
         ASSERT_TRUE(leaf::is_empty(right->node()));
 
         store_key_t median;
         leaf::split(&sizer_, node(), right->node(), median.btree_key());
+        if (median_out != nullptr) {
+            *median_out = median;
+        }
 
         std::map<store_key_t, std::string>::iterator p = kv_.end();
         --p;
@@ -184,6 +188,12 @@ public:
         right->Verify();
     }
 
+    void ExtendPrefix(const store_key_t &left_excl, const store_key_t &right_incl) {
+        leaf::extend_prefix(&sizer_, node(), left_excl.btree_key(),
+                            right_incl.btree_key());
+        Verify();
+    }
+
     bool IsFull(const store_key_t& key, const std::string& value) {
         short_value_buffer_t value_buf(value);
         return leaf::is_full(&sizer_, node(), key.btree_key(), value_buf.data());
@@ -401,11 +411,11 @@ void make_node_underfull(LeafNodeTracker *tracker, rng_t *rng) {
     while (!tracker->IsUnderfull() ||
            (node->num_pairs > 0 && rng->randint(2) == 0)) {
         int chosen = rng->randint(node->num_pairs);
-        auto pair = *leaf_node_t::iterator(node, chosen);
+        store_key_t key((*leaf_node_t::iterator(node, chosen)).first);
 
         // We might hit a removal entry; skip those.
-        if (tracker->ShouldHave(store_key_t(pair.first))) {
-            tracker->Remove(store_key_t(pair.first));
+        if (tracker->ShouldHave(key)) {
+            tracker->Remove(key);
         }
     }
 }
@@ -710,4 +720,207 @@ TEST(LeafNodeTest, Fullness) {
     ASSERT_TRUE(node.IsFull(store_key_t(strprintf("a%d", i)), strprintf("A%d", i)));
 }
 
+TEST(LeafNodeTest, KeyPrefixIndex) {
+    LeafNodeTracker node;
+    // The keys share a long prefix and differ in their last few bytes, some of them
+    // only after the four bytes of the packed prefix.
+    for (int i = 0; i < 60; ++i) {
+        node.Insert(store_key_t(strprintf("shared_prefix_%d", i * 7)), "v");
+    }
+    for (int i = 0; i < 60; i += 3) {
+        node.Remove(store_key_t(strprintf("shared_prefix_%d", i * 7)));
+    }
+
+    const leaf_node_t *leaf_node = node.node();
+    std::vector<const btree_key_t *> keys;
+    for (int i = 0; i < leaf_node->num_pairs; ++i) {
+        keys.push_back(leaf::iterator(leaf_node, i).stored_key());
+    }
+    key_prefix_index_t index(nullptr, 0, keys.data(), keys.size());
+    ASSERT_EQ(leaf_node->num_pairs, index.size());
+
+    std::vector<std::string> probes = { "", "a", "shared", "shared_prefix_",
+                                        "shared_prefix_0", "shared_prefix_00", "z" };
+    for (int i = 0; i < 60 * 7; ++i) {
+        probes.push_back(strprintf("shared_prefix_%d", i));
+    }
+    for (const std::string &probe : probes) {
+        store_key_t key(probe);
+        int expected_index, index_with_hint;
+        bool expected_found = leaf::find_key(leaf_node, key.btree_key(), &expected_index);
+        bool found_with_hint = leaf::find_key(leaf_node, key.btree_key(),
+                                              &index_with_hint, &index);
+        EXPECT_EQ(expected_found, found_with_hint) << probe;
+        EXPECT_EQ(expected_index, index_with_hint) << probe;
+    }
+}
+
+TEST(LeafNodeTest, PrefixInsertRemove) {
+    LeafNodeTracker node;
+    for (int i = 0; i < 100; ++i) {
+        node.Insert(store_key_t(strprintf("shared_prefix_%d", i * 3)), "v");
+    }
+    node.ExtendPrefix(store_key_t("shared_prefix_"), store_key_t("shared_prefix_~"));
+    ASSERT_EQ(14, leaf::prefix_size(node.node()));
+
+    for (int i = 0; i < 100; ++i) {
+        node.Insert(store_key_t(strprintf("shared_prefix_%d", i * 3 + 1)), "w");
+        if (i % 2 == 0) {
+            node.Remove(store_key_t(strprintf("shared_prefix_%d", i * 3)));
+        }
+    }
+    ASSERT_EQ(14, leaf::prefix_size(node.node()));
+
+    // Keys outside of the prefix sort before or after all entries.
+    const leaf_node_t *leaf_node = node.node();
+    int index;
+    ASSERT_FALSE(leaf::find_key(leaf_node, store_key_t("shared").btree_key(), &index));
+    ASSERT_EQ(0, index);
+    ASSERT_FALSE(leaf::find_key(leaf_node, store_key_t("z").btree_key(), &index));
+    ASSERT_EQ(leaf_node->num_pairs, index);
+    ASSERT_TRUE(leaf::find_key(leaf_node, store_key_t("shared_prefix_4").btree_key(),
+                               &index));
+    store_key_t found((*leaf::iterator(leaf_node, index)).first);
+    ASSERT_EQ(store_key_t("shared_prefix_4"), found);
+
+    leaf::reverse_iterator it = leaf::exclusive_upper_bound(
+        store_key_t("shared_prefix_4").btree_key(), *leaf_node);
+    ASSERT_EQ(store_key_t("shared_prefix_39"), store_key_t((*it).first));
+
+    // The index of a node with a prefix finds the same keys as the node.
+    std::vector<const btree_key_t *> keys;
+    for (int i = 0; i < leaf_node->num_pairs; ++i) {
+        keys.push_back(leaf::iterator(leaf_node, i).stored_key());
+    }
+    key_prefix_index_t prefix_index(leaf::prefix_contents(leaf_node),
+                                    leaf::prefix_size(leaf_node),
+                                    keys.data(), keys.size());
+    for (int i = 0; i < 300; ++i) {
+        store_key_t key(strprintf("shared_prefix_%d", i));
+        int expected_index, index_with_hint;
+        bool expected_found = leaf::find_key(leaf_node, key.btree_key(), &expected_index);
+        bool found_with_hint = leaf::find_key(leaf_node, key.btree_key(),
+                                              &index_with_hint, &prefix_index);
+        EXPECT_EQ(expected_found, found_with_hint) << i;
+        EXPECT_EQ(expected_index, index_with_hint) << i;
+    }
+}
+
+TEST(LeafNodeTest, PrefixRandomOutOfOrder) {
+    rng_t rng;
+    for (int try_num = 0; try_num < 10; ++try_num) {
+        LeafNodeTracker node;
+        std::vector<store_key_t> key_pool;
+        for (int i = 0; i < 30; ++i) {
+            key_pool.push_back(store_key_t("pre" + random_letter_string(&rng, 0, 100)));
+        }
+        for (int i = 0; i < 2000; ++i) {
+            if (i == 1000) {
+                // Switch to the prefix format halfway, with timestamps and deletions
+                // in the node.
+                node.ExtendPrefix(store_key_t("pre"), store_key_t("pre~"));
+                ASSERT_EQ(3, leaf::prefix_size(node.node()));
+            }
+            const store_key_t &key = key_pool[rng.randint(key_pool.size())];
+            repli_timestamp_t tstamp;
+            tstamp.longtime = rng.randint(2000);
+            if (rng.randint(2) == 0) {
+                if (node.ShouldHave(key)) {
+                    node.Remove(key, tstamp);
+                }
+            } else {
+                node.Insert(key, random_letter_string(&rng, 0, 100), tstamp);
+            }
+        }
+
+        // Merging with a node without a prefix takes the prefix away again.
+        LeafNodeTracker right;
+        right.Insert(store_key_t("q"), "Q");
+        make_node_underfull(&node, &rng);
+        while (!leaf::is_mergable(node.sizer(), node.node(), right.node())) {
+            store_key_t key((*leaf::begin(*node.node())).first);
+            node.Remove(key);
+        }
+        right.Merge(&node);
+        ASSERT_EQ(0, leaf::prefix_size(right.node()));
+    }
+}
+
+TEST(LeafNodeTest, PrefixSavesSpace) {
+    LeafNodeTracker plain;
+    LeafNodeTracker prefixed;
+    prefixed.ExtendPrefix(store_key_t("a_long_shared_prefix_"),
+                          store_key_t("a_long_shared_prefix_~"));
+
+    int plain_count = 0;
+    while (plain.Insert(store_key_t(strprintf("a_long_shared_prefix_%d", plain_count)),
+                        "v")) {
+        ++plain_count;
+    }
+    int prefixed_count = 0;
+    while (prefixed.Insert(
+               store_key_t(strprintf("a_long_shared_prefix_%d", prefixed_count)), "v")) {
+        ++prefixed_count;
+    }
+    ASSERT_GT(prefixed_count, plain_count * 2);
+}
+
+TEST(LeafNodeTest, PrefixSplitting) {
+    LeafNodeTracker left;
+    left.ExtendPrefix(store_key_t("key_"), store_key_t("key_~"));
+    for (int i = 0; left.Insert(store_key_t(strprintf("key_%04d", i)), "v"); ++i) { }
+
+    LeafNodeTracker right;
+    store_key_t median;
+    left.Split(&right, &median);
+    ASSERT_EQ(4, leaf::prefix_size(right.node()));
+
+    // Fewer than a thousand keys fit, so all of them start with key_0, and
+    // narrowing the ranges of the nodes to it lengthens their prefixes.
+    left.ExtendPrefix(store_key_t("key_0"), median);
+    right.ExtendPrefix(median, store_key_t("key_0~"));
+    ASSERT_EQ(5, leaf::prefix_size(left.node()));
+    ASSERT_EQ(5, leaf::prefix_size(right.node()));
+    left.Insert(store_key_t("key_0000a"), "v");
+    right.Insert(store_key_t("key_0999"), "v");
+}
+
+TEST(LeafNodeTest, PrefixMerging) {
+    LeafNodeTracker left;
+    LeafNodeTracker right;
+    left.ExtendPrefix(store_key_t("key_a"), store_key_t("key_a~"));
+    right.ExtendPrefix(store_key_t("key_a~"), store_key_t("key_b~"));
+    ASSERT_EQ(5, leaf::prefix_size(left.node()));
+    ASSERT_EQ(4, leaf::prefix_size(right.node()));
+
+    for (int i = 0; i < 50; ++i) {
+        left.Insert(store_key_t(strprintf("key_a%d", i)), strprintf("A%d", i));
+        right.Insert(store_key_t(strprintf("key_b%d", i)), strprintf("B%d", i));
+    }
+
+    ASSERT_TRUE(leaf::is_mergable(right.sizer(), left.node(), right.node()));
+    right.Merge(&left);
+    ASSERT_EQ(4, leaf::prefix_size(right.node()));
+}
+
+TEST(LeafNodeTest, PrefixLeveling) {
+    LeafNodeTracker left;
+    LeafNodeTracker right;
+    left.ExtendPrefix(store_key_t("key_a"), store_key_t("key_a~"));
+    right.ExtendPrefix(store_key_t("key_a~"), store_key_t("key_b~"));
+
+    // Leave room for the keys of `left` to grow by the byte that the prefixes of the
+    // nodes don't have in common.
+    for (int i = 0; i < 300; ++i) {
+        left.Insert(store_key_t(strprintf("key_a%d", i)), "A");
+    }
+    right.Insert(store_key_t("key_b0"), "B0");
+
+    bool could_level;
+    right.Level(1, &left, &could_level);
+    ASSERT_TRUE(could_level);
+    ASSERT_EQ(4, leaf::prefix_size(left.node()));
+    ASSERT_EQ(4, leaf::prefix_size(right.node()));
+}
+
 }  // namespace unittest
@@ -1,11 +1,18 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include <string>
+#include <vector>
+
 #include "arch/runtime/coroutines.hpp"
 #include "arch/timing.hpp"
 #include "buffer_cache/page_cache.hpp"
 #include "buffer_cache/alt.hpp"
 #include "buffer_cache/cache_balancer.hpp"
+#include "buffer_cache/cache_manifest.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/pmap.hpp"
+#include "config/args.hpp"
 #include "containers/scoped.hpp"
 #include "serializer/log/log_serializer.hpp"
 #include "unittest/gtest.hpp"
@@ -52,8 +59,9 @@ class test_cache_t : public page_cache_t {
 public:
     test_cache_t(serializer_t *_serializer,
                  cache_balancer_t *balancer,
-                 alt_txn_throttler_t *throttler)
-        : page_cache_t(_serializer, balancer, throttler),
+                 alt_txn_throttler_t *throttler,
+                 const optional<std::string> &manifest_path = r_nullopt)
+        : page_cache_t(_serializer, balancer, throttler, manifest_path),
           throttler_(throttler) { }
 
     void flush(scoped_ptr_t<test_txn_t> txn) {
@@ -84,8 +92,9 @@ public:
         : current_page_acq_t(txn, _block_id, _access, create) { }
 
     current_test_acq_t(page_txn_t *txn,
-                       alt_create_t create)
-        : current_page_acq_t(txn, create, block_type_t::normal) { }
+                       alt_create_t create,
+                       block_type_t block_type = block_type_t::normal)
+        : current_page_acq_t(txn, create, block_type) { }
 
     current_test_acq_t(page_cache_t *cache,
                        block_id_t _block_id,
@@ -314,6 +323,268 @@ TPTEST(PageTest, WriteWaitForFlush, 4) {
     pmap(2, std::bind(&WriteWaitForFlush_cases, &s, &page_cache, ph::_1));
 }
 
+TPTEST(PageTest, LargeValuesBelowMemoryLimitStayLoaded, 4) {
+    mock_ser_t mock;
+    const size_t num_blocks = 32;
+    std::vector<block_id_t> block_ids;
+    {
+        dummy_cache_balancer_t balancer(GIGABYTE);
+        test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+        auto txn = make_scoped<test_txn_t>(&page_cache);
+        for (size_t i = 0; i < num_blocks; ++i) {
+            current_test_acq_t acq(txn.get(), alt_create_t::create, block_type_t::aux);
+            block_ids.push_back(acq.block_id());
+            test_acq_t page_acq;
+            page_acq.init(acq.current_page_for_write(), &page_cache);
+            page_acq.get_buf_write();
+        }
+        page_cache.flush(std::move(txn));
+    }
+
+    // The large values take about half of the memory limit, which is more than
+    // `LARGE_VALUE_CACHE_FRACTION` of it but still fits.  Reading them into a fresh
+    // cache must not evict any of them.
+    const uint64_t block_size = DEFAULT_BTREE_BLOCK_SIZE;
+    dummy_cache_balancer_t balancer(2 * num_blocks * block_size);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    alt::evicter_t *evicter = &page_cache.evicter();
+    const uint64_t evicted_before = evicter->evicted_category()->size();
+    auto txn = make_scoped<test_txn_t>(&page_cache);
+    for (block_id_t block_id : block_ids) {
+        current_test_acq_t acq(txn.get(), block_id, access_t::read);
+        test_acq_t page_acq;
+        page_acq.init(acq.current_page_for_read(), &page_cache);
+        page_acq.buf_ready_signal()->wait();
+    }
+    ASSERT_GT(evicter->in_memory_size(),
+              static_cast<uint64_t>(LARGE_VALUE_CACHE_FRACTION
+                                    * evicter->memory_limit()));
+    ASSERT_LE(evicter->in_memory_size(), evicter->memory_limit());
+    ASSERT_GE(evicter->in_memory_size(), num_blocks * block_size);
+    ASSERT_EQ(evicted_before, evicter->evicted_category()->size());
+    page_cache.flush(std::move(txn));
+}
+
+class test_accelerator_t : public alt::page_accelerator_t {
+public:
+    explicit test_accelerator_t(size_t _size) : size(_size) { }
+    size_t memory_usage() const { return size; }
+private:
+    size_t size;
+};
+
+// Creates a block in `mock` and returns its id.
+block_id_t create_flushed_block(mock_ser_t *mock) {
+    dummy_cache_balancer_t balancer(GIGABYTE);
+    test_cache_t page_cache(mock->ser.get(), &balancer, mock->throttler.get());
+    auto txn = make_scoped<test_txn_t>(&page_cache);
+    block_id_t block_id;
+    {
+        current_test_acq_t acq(txn.get(), alt_create_t::create);
+        block_id = acq.block_id();
+        test_acq_t page_acq;
+        page_acq.init(acq.current_page_for_write(), &page_cache);
+        page_acq.get_buf_write();
+    }
+    page_cache.flush(std::move(txn));
+    return block_id;
+}
+
+TPTEST(PageTest, AcceleratorCountsUntilPageIsModified, 4) {
+    mock_ser_t mock;
+    const block_id_t block_id = create_flushed_block(&mock);
+
+    dummy_cache_balancer_t balancer(GIGABYTE);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    alt::evicter_t *evicter = &page_cache.evicter();
+    auto txn = make_scoped<test_txn_t>(&page_cache);
+    {
+        current_test_acq_t acq(txn.get(), block_id, access_t::read);
+        page_t *page = acq.current_page_for_read();
+        test_acq_t page_acq;
+        page_acq.init(page, &page_cache);
+        page_acq.buf_ready_signal()->wait();
+        const uint64_t size_before = evicter->in_memory_size();
+        page->set_accelerator(make_scoped<test_accelerator_t>(1000), &page_cache);
+        ASSERT_EQ(1000u, evicter->accelerator_usage());
+        ASSERT_EQ(size_before + 1000, evicter->in_memory_size());
+    }
+    {
+        current_test_acq_t acq(txn.get(), block_id, access_t::write);
+        test_acq_t page_acq;
+        page_acq.init(acq.current_page_for_write(), &page_cache);
+        page_acq.get_buf_write();
+        ASSERT_EQ(0u, evicter->accelerator_usage());
+    }
+    page_cache.flush(std::move(txn));
+}
+
+TPTEST(PageTest, AcceleratorIsEvictedWithItsPage, 4) {
+    mock_ser_t mock;
+    const block_id_t block_id = create_flushed_block(&mock);
+
+    // The accelerator alone is over the memory limit, so the page gets evicted as
+    // soon as nobody holds it.
+    const uint64_t memory_limit = 8 * DEFAULT_BTREE_BLOCK_SIZE;
+    dummy_cache_balancer_t balancer(memory_limit);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    alt::evicter_t *evicter = &page_cache.evicter();
+    auto txn = make_scoped<test_txn_t>(&page_cache);
+    {
+        current_test_acq_t acq(txn.get(), block_id, access_t::read);
+        page_t *page = acq.current_page_for_read();
+        test_acq_t page_acq;
+        page_acq.init(page, &page_cache);
+        page_acq.buf_ready_signal()->wait();
+        page->set_accelerator(make_scoped<test_accelerator_t>(2 * memory_limit),
+                              &page_cache);
+        ASSERT_GT(evicter->in_memory_size(), memory_limit);
+    }
+    ASSERT_EQ(0u, evicter->accelerator_usage());
+    ASSERT_LE(evicter->in_memory_size(), memory_limit);
+    page_cache.flush(std::move(txn));
+}
+
+// Lets the tests wait for the manifest warm-up of a page cache, and act like it.
+class manifest_warm_up_tester_t {
+public:
+    static void wait_for_warm_up(page_cache_t *cache) {
+        cache->manifest_warm_up_done_.wait();
+    }
+
+    static bool has_current_page(page_cache_t *cache, block_id_t block_id) {
+        return cache->current_pages_.count(block_id) > 0;
+    }
+
+    static void set_warm_up_active(page_cache_t *cache, bool active) {
+        cache->manifest_warm_up_active_ = active;
+    }
+
+    // Hands the cache a block that the warm-up has read.
+    static void add_warm_up_buf(page_cache_t *cache, block_id_t block_id, buf_ptr_t buf,
+                                const counted_t<standard_block_token_t> &token) {
+        cache->add_warm_up_buf(block_id, std::move(buf), token);
+    }
+};
+
+// Sets every byte of the block to `value`, and flushes it.  Creates a new block if
+// `block_id` is `NULL_BLOCK_ID`.  Returns the block's id.
+block_id_t fill_block(test_cache_t *cache, block_id_t block_id, char value) {
+    auto txn = make_scoped<test_txn_t>(cache);
+    {
+        scoped_ptr_t<current_test_acq_t> acq;
+        if (block_id == NULL_BLOCK_ID) {
+            acq = make_scoped<current_test_acq_t>(txn.get(), alt_create_t::create);
+        } else {
+            acq = make_scoped<current_test_acq_t>(txn.get(), block_id, access_t::write);
+        }
+        block_id = acq->block_id();
+        test_acq_t page_acq;
+        page_acq.init(acq->current_page_for_write(), cache);
+        memset(page_acq.get_buf_write(), value, cache->max_block_size().value());
+    }
+    cache->flush(std::move(txn));
+    return block_id;
+}
+
+void delete_block(test_cache_t *cache, block_id_t block_id) {
+    auto txn = make_scoped<test_txn_t>(cache);
+    {
+        current_test_acq_t acq(txn.get(), block_id, access_t::write);
+        acq.write_acq_signal()->wait();
+        acq.mark_deleted();
+    }
+    cache->flush(std::move(txn));
+}
+
+char read_block_value(test_cache_t *cache, block_id_t block_id) {
+    current_test_acq_t acq(cache, block_id, read_access_t::read);
+    test_acq_t page_acq;
+    page_acq.init(acq.current_page_for_read(), cache);
+    page_acq.buf_ready_signal()->wait();
+    return static_cast<const char *>(page_acq.get_buf_read())[0];
+}
+
+TPTEST(PageTest, ManifestWarmUpSkipsStaleBlockIds, 4) {
+    mock_ser_t mock;
+    temp_directory_t dir;
+    const std::string manifest_path = dir.path().path() + "/manifest";
+
+    std::vector<block_id_t> block_ids;
+    block_id_t deleted_block_id;
+    {
+        dummy_cache_balancer_t balancer(GIGABYTE);
+        test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+        for (char value = 'a'; value < 'e'; ++value) {
+            block_ids.push_back(fill_block(&page_cache, NULL_BLOCK_ID, value));
+        }
+        deleted_block_id = fill_block(&page_cache, NULL_BLOCK_ID, 'x');
+        delete_block(&page_cache, deleted_block_id);
+    }
+
+    // Besides the blocks, the manifest lists one that has been deleted since it was
+    // written, and ones that don't exist.
+    const block_id_t missing_block_id = mock.ser->end_block_id() + 10;
+    std::vector<block_id_t> manifest = block_ids;
+    manifest.push_back(deleted_block_id);
+    manifest.push_back(missing_block_id);
+    manifest.push_back(FIRST_AUX_BLOCK_ID);
+    ASSERT_EQ(0, write_cache_manifest(manifest_path, manifest));
+
+    dummy_cache_balancer_t balancer(GIGABYTE);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get(),
+                            make_optional(manifest_path));
+    manifest_warm_up_tester_t::wait_for_warm_up(&page_cache);
+    for (block_id_t block_id : block_ids) {
+        ASSERT_TRUE(manifest_warm_up_tester_t::has_current_page(&page_cache, block_id));
+    }
+    ASSERT_FALSE(manifest_warm_up_tester_t::has_current_page(&page_cache,
+                                                             deleted_block_id));
+    ASSERT_FALSE(manifest_warm_up_tester_t::has_current_page(&page_cache,
+                                                             missing_block_id));
+    ASSERT_FALSE(manifest_warm_up_tester_t::has_current_page(&page_cache,
+                                                             FIRST_AUX_BLOCK_ID));
+    for (size_t i = 0; i < block_ids.size(); ++i) {
+        ASSERT_EQ(static_cast<char>('a' + i), read_block_value(&page_cache, block_ids[i]));
+    }
+}
+
+TPTEST(PageTest, ManifestWarmUpKeepsBlocksTouchedMeanwhile, 4) {
+    mock_ser_t mock;
+    temp_directory_t dir;
+    const std::string manifest_path = dir.path().path() + "/manifest";
+
+    block_id_t block_id;
+    {
+        dummy_cache_balancer_t balancer(GIGABYTE);
+        test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+        block_id = fill_block(&page_cache, NULL_BLOCK_ID, 'a');
+    }
+
+    // What the warm-up reads if it looks up the block before it gets rewritten.
+    counted_t<standard_block_token_t> stale_token = mock.ser->index_read(block_id);
+    buf_ptr_t stale_buf;
+    {
+        scoped_ptr_t<file_account_t> account(mock.ser->make_io_account(1));
+        stale_buf = mock.ser->block_read(stale_token, account.get());
+    }
+
+    // Without a memory limit, the rewritten page gets evicted right away, so only its
+    // current_page_t tells that the block has changed.
+    dummy_cache_balancer_t balancer(0);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get(),
+                            make_optional(manifest_path));
+    // There is no manifest yet, so the cache's own warm-up finishes right away, and we
+    // play its part.
+    manifest_warm_up_tester_t::wait_for_warm_up(&page_cache);
+    manifest_warm_up_tester_t::set_warm_up_active(&page_cache, true);
+    fill_block(&page_cache, block_id, 'b');
+    manifest_warm_up_tester_t::add_warm_up_buf(&page_cache, block_id,
+                                               std::move(stale_buf), stale_token);
+    manifest_warm_up_tester_t::set_warm_up_active(&page_cache, false);
+    ASSERT_EQ('b', read_block_value(&page_cache, block_id));
+}
+
 class bigger_test_t {
 public:
     explicit bigger_test_t(uint64_t _memory_limit)
@@ -57,4 +57,24 @@ TEST(PerfmonTest, StddevComputation) {
     }
 }
 
+TEST(PerfmonTest, HistogramBuckets) {
+    histogram_t h;
+    h.add(0.5);
+    h.add(1.0);
+    h.add(1.5);
+    h.add(2.0);
+    h.add(3.0);
+    h.add(1e30);
+
+    EXPECT_EQ(2, h.counts[0]);
+    EXPECT_EQ(2, h.counts[1]);
+    EXPECT_EQ(1, h.counts[2]);
+    EXPECT_EQ(1, h.counts[histogram_t::NUM_BUCKETS - 1]);
+
+    histogram_t other;
+    other.add(4.0);
+    h.merge(other);
+    EXPECT_EQ(2, h.counts[2]);
+}
+
 }  // namespace unittest
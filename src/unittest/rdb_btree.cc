@@ -1,5 +1,7 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include <functional>
+#include <set>
+#include <string>
 
 #include "arch/io/disk.hpp"
 #include "arch/runtime/coroutines.hpp"
@@ -7,9 +9,11 @@
 #include "btree/operations.hpp"
 #include "btree/reql_specific.hpp"
 #include "buffer_cache/cache_balancer.hpp"
+#include "concurrency/pmap.hpp"
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/vector_stream.hpp"
 #include "containers/uuid.hpp"
+#include "perfmon/perfmon.hpp"
 #include "rapidjson/document.h"
 #include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/datum_json.hpp"
@@ -29,7 +33,12 @@
 
 namespace unittest {
 
-void insert_rows(int start, int finish, store_t *store) {
+std::string make_row(int i) {
+    return strprintf("{\"id\" : %d, \"sid\" : %d}", i, i * i);
+}
+
+void insert_rows(int start, int finish, store_t *store,
+                 const std::function<std::string(int)> &row_of = &make_row) {
     ql::configured_limits_t limits;
 
     guarantee(start <= finish);
@@ -48,7 +57,7 @@ void insert_rows(int start, int finish, store_t *store) {
                 superblock->get_sindex_block_id(),
                 access_t::write);
 
-            std::string data = strprintf("{\"id\" : %d, \"sid\" : %d}", i, i * i);
+            std::string data = row_of(i);
             point_write_response_t response;
 
             store_key_t pk(ql::datum_t(static_cast<double>(i)).print_primary());
@@ -88,7 +97,9 @@ void insert_rows_and_pulse_when_done(int start, int finish,
     pulse_when_done->pulse();
 }
 
-sindex_name_t create_sindex(store_t *store) {
+sindex_name_t create_sindex(
+        store_t *store,
+        const std::set<std::string> &include = std::set<std::string>()) {
     std::string name = uuid_to_str(generate_uuid());
     ql::sym_t one(1);
     ql::minidriver_t r(ql::backtrace_id_t::empty());
@@ -97,7 +108,8 @@ sindex_name_t create_sindex(store_t *store) {
         ql::map_wire_func_t(mapping, make_vector(one)),
         reql_version_t::LATEST,
         sindex_multi_bool_t::SINGLE,
-        sindex_geo_bool_t::REGULAR);
+        sindex_geo_bool_t::REGULAR,
+        include);
 
     cond_t non_interruptor;
     store->sindex_create(name, config, &non_interruptor);
@@ -111,10 +123,12 @@ void spawn_writes(store_t *store, cond_t *background_inserts_done) {
                 store, background_inserts_done));
 }
 
-ql::grouped_t<ql::stream_t> read_row_via_sindex(
+ql::result_t read_via_sindex(
         store_t *store,
         const sindex_name_t &sindex_name,
-        int sindex_value) {
+        int sindex_value,
+        const std::vector<ql::transform_variant_t> &transforms,
+        const optional<ql::terminal_variant_t> &terminal) {
     cond_t dummy_interruptor;
     read_token_t token;
     store->new_read_token(&token);
@@ -163,8 +177,8 @@ ql::grouped_t<ql::stream_t> read_row_via_sindex(
         sindex_sb.get(),
         &dummy_env, // env_t
         ql::batchspec_t::default_for(ql::batch_type_t::NORMAL),
-        std::vector<ql::transform_variant_t>(),
-        optional<ql::terminal_variant_t>(),
+        transforms,
+        terminal,
         key_range_t::universe(),
         sorting_t::ASCENDING,
         require_sindexes_t::NO,
@@ -172,8 +186,18 @@ ql::grouped_t<ql::stream_t> read_row_via_sindex(
         &res,
         release_superblock_t::RELEASE);
 
+    return res.result;
+}
+
+ql::grouped_t<ql::stream_t> read_row_via_sindex(
+        store_t *store,
+        const sindex_name_t &sindex_name,
+        int sindex_value) {
+    ql::result_t result = read_via_sindex(
+        store, sindex_name, sindex_value,
+        std::vector<ql::transform_variant_t>(), optional<ql::terminal_variant_t>());
     ql::grouped_t<ql::stream_t> *groups =
-        boost::get<ql::grouped_t<ql::stream_t> >(&res.result);
+        boost::get<ql::grouped_t<ql::stream_t> >(&result);
     guarantee(groups != nullptr);
     return *groups;
 }
@@ -271,7 +295,8 @@ TPTEST(RDBBtree, SindexPostConstruct) {
             &io_backender,
             base_path_t("."),
             generate_uuid(),
-            update_sindexes_t::UPDATE);
+            update_sindexes_t::UPDATE,
+            r_nullopt);
 
     cond_t dummy_interruptor;
 
@@ -286,6 +311,126 @@ TPTEST(RDBBtree, SindexPostConstruct) {
     check_keys_are_present(&store, sindex_name);
 }
 
+// The number of keys of the index `sindex_name` that reads answered from the
+// included fields, without loading the rows.
+int64_t keys_covered(store_t *store, const sindex_name_t &sindex_name) {
+    perfmon_counter_t *counter = &store->get_sindex_slice(
+        store->get_sindexes().at(sindex_name).id)->stats.pm_total_keys_covered;
+    void *data = counter->begin_stats();
+    pmap(get_num_threads(), [&](int thread) {
+        on_thread_t thread_switcher((threadnum_t(thread)));
+        counter->visit_stats(data);
+    });
+    return static_cast<int64_t>(counter->end_stats(data).as_num());
+}
+
+// Reads the row `i` via `sindex_name` with a `pluck("sid")` and with a `count()`,
+// and checks the results.  If `covered`, the index entry has to answer both reads;
+// otherwise the row has to be loaded for them.
+void check_covered_reads(store_t *store, const sindex_name_t &sindex_name, int i,
+                         bool covered) {
+    const int64_t covered_before = keys_covered(store, sindex_name);
+    ql::sym_t x(1);
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+    std::vector<ql::transform_variant_t> pluck{
+        ql::map_wire_func_t(r.var(x).pluck("sid").root_term(), make_vector(x))};
+    ql::result_t result = read_via_sindex(
+        store, sindex_name, i * i, pluck, optional<ql::terminal_variant_t>());
+    ql::grouped_t<ql::stream_t> *groups =
+        boost::get<ql::grouped_t<ql::stream_t> >(&result);
+    ASSERT_TRUE(groups != nullptr);
+    ASSERT_EQ(1, groups->size());
+    ql::stream_t *stream = &groups->begin()->second;
+    ASSERT_EQ(1ul, stream->substreams.size());
+    ql::raw_stream_t *raw_stream = &stream->substreams.begin()->second.stream;
+    ASSERT_EQ(1ul, raw_stream->size());
+    ql::datum_object_builder_t expected;
+    expected.overwrite("sid", ql::datum_t(static_cast<double>(i * i)));
+    ASSERT_EQ(std::move(expected).to_datum(), raw_stream->front().data);
+
+    result = read_via_sindex(
+        store, sindex_name, i * i, std::vector<ql::transform_variant_t>(),
+        make_optional(ql::terminal_variant_t(ql::count_wire_func_t())));
+    ql::grouped_t<uint64_t> *counts = boost::get<ql::grouped_t<uint64_t> >(&result);
+    ASSERT_TRUE(counts != nullptr);
+    ASSERT_EQ(1, counts->size());
+    ASSERT_EQ(1u, counts->begin()->second);
+
+    ASSERT_EQ(covered_before + (covered ? 2 : 0), keys_covered(store, sindex_name))
+        << "row " << i;
+}
+
+TPTEST(RDBBtree, CoveringSindex) {
+    recreate_temporary_directory(base_path_t("."));
+    temp_file_t temp_file;
+
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    dummy_cache_balancer_t balancer(GIGABYTE);
+
+    filepath_file_opener_t file_opener(temp_file.name(), &io_backender);
+    log_serializer_t::create(
+        &file_opener,
+        log_serializer_t::static_config_t());
+
+    log_serializer_t serializer(
+        log_serializer_t::dynamic_config_t(),
+        &file_opener,
+        &get_global_perfmon_collection());
+
+    store_t store(
+            region_t::universe(),
+            &serializer,
+            &balancer,
+            "unit_test_store",
+            true,
+            &get_global_perfmon_collection(),
+            nullptr,
+            &io_backender,
+            base_path_t("."),
+            generate_uuid(),
+            update_sindexes_t::UPDATE,
+            r_nullopt);
+
+    // The entries of the rows that exist when the index is created come from its
+    // post construction, and the others from the writes.
+    insert_rows(0, (TOTAL_KEYS_TO_INSERT * 9) / 10, &store);
+    sindex_name_t sindex_name = create_sindex(&store, std::set<std::string>{"sid"});
+    cond_t background_inserts_done;
+    spawn_writes(&store, &background_inserts_done);
+    background_inserts_done.wait();
+
+    // Queries that need the whole row still get it, from the row.
+    check_keys_are_present(&store, sindex_name);
+    ASSERT_EQ(0, keys_covered(&store, sindex_name));
+
+    // A `pluck()` of the included field and a `count()` are answered from the
+    // entries.
+    for (int i = 0; i < TOTAL_KEYS_TO_INSERT; ++i) {
+        check_covered_reads(&store, sindex_name, i, true);
+    }
+
+    // The rows that miss one of the included fields get entries without them, and
+    // the same queries load these rows.  The index is created before the rows that
+    // have all of the fields are written.
+    sindex_name_t tagged_name =
+        create_sindex(&store, std::set<std::string>{"sid", "tag"});
+    check_keys_are_present(&store, tagged_name);
+    const int tagged_end = TOTAL_KEYS_TO_INSERT + 10;
+    insert_rows(TOTAL_KEYS_TO_INSERT, tagged_end, &store, [](int i) {
+        return strprintf("{\"id\" : %d, \"sid\" : %d, \"tag\" : %d}", i, i * i, i);
+    });
+    for (int i = 0; i < tagged_end; ++i) {
+        check_covered_reads(&store, tagged_name, i, i >= TOTAL_KEYS_TO_INSERT);
+    }
+
+    // Other fields than the included ones aren't covered.
+    ql::sym_t x(1);
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+    ql::map_wire_func_t pluck(r.var(x).pluck("sid").root_term(), make_vector(x));
+    EXPECT_TRUE(pluck.only_gets_fields(std::set<std::string>{"sid"}));
+    EXPECT_FALSE(pluck.only_gets_fields(std::set<std::string>{"id"}));
+}
+
 TPTEST(RDBBtree, SindexEraseRange) {
     recreate_temporary_directory(base_path_t("."));
     temp_file_t temp_file;
@@ -314,7 +459,8 @@ TPTEST(RDBBtree, SindexEraseRange) {
             &io_backender,
             base_path_t("."),
             generate_uuid(),
-            update_sindexes_t::UPDATE);
+            update_sindexes_t::UPDATE,
+            r_nullopt);
 
     cond_t dummy_interruptor;
 
@@ -401,7 +547,8 @@ TPTEST(RDBBtree, SindexInterruptionViaDrop) {
             &io_backender,
             base_path_t("."),
             generate_uuid(),
-            update_sindexes_t::UPDATE);
+            update_sindexes_t::UPDATE,
+            r_nullopt);
 
     cond_t dummy_interruptor;
 
@@ -444,7 +591,8 @@ TPTEST(RDBBtree, SindexInterruptionViaStoreDelete) {
             &io_backender,
             base_path_t("."),
             generate_uuid(),
-            update_sindexes_t::UPDATE));
+            update_sindexes_t::UPDATE,
+            r_nullopt));
 
     insert_rows(0, (TOTAL_KEYS_TO_INSERT * 9) / 10, store.get());
 
@@ -16,6 +16,7 @@
 #include "rdb_protocol/datum_stream/vector.hpp"
 #include "rdb_protocol/minidriver.hpp"
 #include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/pseudo_time.hpp"
 #include "rdb_protocol/store.hpp"
 #include "rpc/directory/read_manager.hpp"
 #include "rpc/semilattice/semilattice_manager.hpp"
@@ -87,7 +88,8 @@ void run_with_namespace_interface(
                     make_scoped<store_t>(region_t::universe(), serializers[i].get(),
                         &balancer, temp_files[i]->name().permanent_path(), do_create,
                         &get_global_perfmon_collection(), &ctx, &io_backender,
-                        base_path_t("."), generate_uuid(), update_sindexes_t::UPDATE));
+                        base_path_t("."), generate_uuid(), update_sindexes_t::UPDATE,
+                        r_nullopt));
         }
 
         std::vector<scoped_ptr_t<store_view_t> > stores;
@@ -881,6 +883,15 @@ TEST(RDBProtocol, OvershardedMissingAttr) {
     run_in_thread_pool_with_namespace_interface(&run_sindex_missing_attr_test, true);
 }
 
+class dummy_artificial_t : public ql::changefeed::artificial_t {
+public:
+    explicit dummy_artificial_t(lifetime_t<name_resolver_t const &> name_resolver_)
+        : artificial_t(generate_uuid(), name_resolver_) { }
+    /* This gets a notification when the last changefeed disconnects, but we don't
+    care about that. */
+    void maybe_remove() { }
+};
+
 TPTEST(RDBProtocol, ArtificialChangefeeds) {
     using ql::changefeed::artificial_t;
     using ql::changefeed::keyspec_t;
@@ -898,14 +909,6 @@ TPTEST(RDBProtocol, ArtificialChangefeeds) {
         nullptr,
         make_lifetime(artificial_reql_cluster_interface));
 
-    class dummy_artificial_t : public artificial_t {
-    public:
-        explicit dummy_artificial_t(lifetime_t<name_resolver_t const &> name_resolver_)
-            : artificial_t(generate_uuid(), name_resolver_) { }
-        /* This gets a notification when the last changefeed disconnects, but we don't
-        care about that. */
-        void maybe_remove() { }
-    };
     dummy_artificial_t artificial_cfeed(make_lifetime(name_resolver));
 
     struct cfeed_bundle_t {
@@ -1010,4 +1013,135 @@ TPTEST(RDBProtocol, ArtificialChangefeeds) {
     }
 }
 
+// Subscribes to every change of `artificial_cfeed`, with `transform` applied to it.
+counted_t<ql::datum_stream_t> subscribe_transformed(
+        ql::env_t *env,
+        ql::changefeed::artificial_t *artificial_cfeed,
+        const ql::transform_variant_t &transform) {
+    ql::backtrace_id_t bt = ql::backtrace_id_t::empty();
+    return artificial_cfeed->subscribe(
+        env,
+        ql::changefeed::streamspec_t(
+            make_counted<ql::vector_datum_stream_t>(
+                bt, std::vector<ql::datum_t>(), r_nullopt),
+            "test",
+            false,
+            false,
+            false,
+            ql::configured_limits_t(),
+            ql::datum_t::boolean(false),
+            ql::changefeed::keyspec_t::range_t{
+                std::vector<ql::transform_variant_t>{transform},
+                optional<std::string>(),
+                sorting_t::UNORDERED,
+                ql::datumspec_t(ql::datum_range_t::universe()),
+                r_nullopt}),
+        "id",
+        std::vector<ql::datum_t>(),
+        bt);
+}
+
+ql::datum_t next_new_val(ql::env_t *env, const counted_t<ql::datum_stream_t> &stream) {
+    ql::batchspec_t bs(ql::batchspec_t::all()
+                       .with_new_batch_type(ql::batch_type_t::NORMAL)
+                       .with_max_dur(1000));
+    std::vector<ql::datum_t> changes = stream->next_batch(env, bs);
+    guarantee(changes.size() == 1);
+    return changes[0].get_field("new_val");
+}
+
+TPTEST(RDBProtocol, ArtificialChangefeedsShareTransforms) {
+    extproc_pool_t extproc_pool(2);
+    dummy_semilattice_controller_t<auth_semilattice_metadata_t> auth_manager;
+    rdb_context_t rdb_context(&extproc_pool, nullptr, auth_manager.get_view());
+    artificial_reql_cluster_interface_t artificial_reql_cluster_interface(
+        auth_manager.get_view(),
+        &rdb_context);
+    dummy_semilattice_controller_t<cluster_semilattice_metadata_t> cluster_manager;
+    name_resolver_t name_resolver(
+        cluster_manager.get_view(),
+        nullptr,
+        make_lifetime(artificial_reql_cluster_interface));
+    dummy_artificial_t artificial_cfeed(make_lifetime(name_resolver));
+
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+    ql::global_optargs_t small_array_limit;
+    small_array_limit.add_optarg(r.expr(ql::datum_t(1000.0)).root_term(), "array_limit");
+    ql::datum_t time = ql::pseudo::make_time(1000000000, "+00:00");
+    ql::datum_t later_time = ql::pseudo::make_time(1000000001, "+00:00");
+    auth::user_context_t user_context(auth::permissions_t(
+        tribool::True, tribool::False, tribool::False, tribool::False));
+    cond_t interruptor;
+    auto make_env = [&](const ql::global_optargs_t &optargs, const ql::datum_t &t) {
+        return make_scoped<ql::env_t>(
+            &rdb_context, ql::return_empty_normal_batches_t::YES, &interruptor,
+            optargs, user_context, t, nullptr);
+    };
+    scoped_ptr_t<ql::env_t> env = make_env(ql::global_optargs_t(), time);
+    scoped_ptr_t<ql::env_t> same_env = make_env(ql::global_optargs_t(), time);
+    scoped_ptr_t<ql::env_t> later_env = make_env(ql::global_optargs_t(), later_time);
+    scoped_ptr_t<ql::env_t> small_limit_env = make_env(small_array_limit, time);
+
+    // Every transform puts a newly built string in its result, so two subscriptions
+    // share a transform result if and only if they got the same string buffer.
+    ql::sym_t x(1);
+    ql::map_wire_func_t to_string(
+        r.array(r.var(x).coerce_to("string")).root_term(), make_vector(x));
+    ql::map_wire_func_t to_string_and_one(
+        r.array(r.var(x).coerce_to("string"), 1.0).root_term(), make_vector(x));
+    ql::map_wire_func_t to_string_and_now(
+        r.array(r.var(x).coerce_to("string"), r.now()).root_term(), make_vector(x));
+
+    counted_t<ql::datum_stream_t> base =
+        subscribe_transformed(env.get(), &artificial_cfeed, to_string);
+    counted_t<ql::datum_stream_t> same =
+        subscribe_transformed(same_env.get(), &artificial_cfeed, to_string);
+    counted_t<ql::datum_stream_t> later =
+        subscribe_transformed(later_env.get(), &artificial_cfeed, to_string);
+    counted_t<ql::datum_stream_t> small_limit =
+        subscribe_transformed(small_limit_env.get(), &artificial_cfeed, to_string);
+    counted_t<ql::datum_stream_t> other_transform =
+        subscribe_transformed(env.get(), &artificial_cfeed, to_string_and_one);
+    counted_t<ql::datum_stream_t> now =
+        subscribe_transformed(env.get(), &artificial_cfeed, to_string_and_now);
+    counted_t<ql::datum_stream_t> same_now =
+        subscribe_transformed(same_env.get(), &artificial_cfeed, to_string_and_now);
+    counted_t<ql::datum_stream_t> later_now =
+        subscribe_transformed(later_env.get(), &artificial_cfeed, to_string_and_now);
+
+    artificial_cfeed.send_all(ql::changefeed::msg_t(ql::changefeed::msg_t::change_t{
+        index_vals_t(),
+        index_vals_t(),
+        store_key_t(ql::datum_t(1.0).print_primary()),
+        ql::datum_t(-1.0),
+        ql::datum_t(1.0)}));
+
+    // The values are all kept alive, so that no buffer can be reused.
+    std::vector<ql::datum_t> vals{
+        next_new_val(env.get(), base),
+        next_new_val(same_env.get(), same),
+        next_new_val(later_env.get(), later),
+        next_new_val(small_limit_env.get(), small_limit),
+        next_new_val(env.get(), other_transform),
+        next_new_val(env.get(), now),
+        next_new_val(same_env.get(), same_now),
+        next_new_val(later_env.get(), later_now)};
+    std::vector<const char *> buffers;
+    for (const ql::datum_t &val : vals) {
+        ASSERT_EQ("1", val.get(0).as_str().to_std());
+        buffers.push_back(val.get(0).as_str().data());
+    }
+
+    // The time only matters to the transforms that call `r.now()`.
+    EXPECT_EQ(buffers[0], buffers[1]);
+    EXPECT_EQ(buffers[0], buffers[2]);
+    EXPECT_NE(buffers[0], buffers[3]);
+    EXPECT_NE(buffers[0], buffers[4]);
+    EXPECT_NE(buffers[0], buffers[5]);
+    EXPECT_EQ(buffers[5], buffers[6]);
+    EXPECT_NE(buffers[5], buffers[7]);
+    EXPECT_EQ(time, vals[5].get(1));
+    EXPECT_EQ(later_time, vals[7].get(1));
+}
+
 }   /* namespace unittest */
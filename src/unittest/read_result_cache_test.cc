@@ -0,0 +1,228 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/read_result_cache.hpp"
+
+#include "arch/io/disk.hpp"
+#include "buffer_cache/cache_balancer.hpp"
+#include "config/args.hpp"
+#include "rdb_protocol/context.hpp"
+#include "rdb_protocol/func.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/store.hpp"
+#include "serializer/log/log_serializer.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+serializable_env_t make_serializable_env(bool result_cache) {
+    ql::global_optargs_t optargs;
+    if (result_cache) {
+        ql::minidriver_t r(ql::backtrace_id_t::empty());
+        optargs.add_optarg(r.boolean(true).root_term(), "result_cache");
+    }
+    return serializable_env_t{
+        optargs,
+        auth::user_context_t(auth::permissions_t(
+            tribool::False, tribool::False, tribool::False, tribool::False)),
+        ql::datum_t()};
+}
+
+read_t make_range_read(bool result_cache,
+                       const key_range_t &range,
+                       std::vector<ql::transform_variant_t> transforms,
+                       optional<ql::terminal_variant_t> terminal
+                           = optional<ql::terminal_variant_t>()) {
+    return read_t(
+        rget_read_t(
+            optional<changefeed_stamp_t>(),
+            region_t(range),
+            r_nullopt,
+            r_nullopt,
+            make_serializable_env(result_cache),
+            "test",
+            ql::batchspec_t::default_for(ql::batch_type_t::NORMAL),
+            std::move(transforms),
+            std::move(terminal),
+            optional<sindex_rangespec_t>(),
+            sorting_t::UNORDERED),
+        profile_bool_t::DONT_PROFILE,
+        read_mode_t::SINGLE);
+}
+
+read_response_t make_sum_response(double sum) {
+    rget_read_response_t rget_response;
+    ql::grouped_t<double> grouped;
+    grouped[ql::datum_t()] = sum;
+    rget_response.result = grouped;
+    return read_response_t(rget_response);
+}
+
+double response_sum(read_response_t *response) {
+    rget_read_response_t *rget_response =
+        boost::get<rget_read_response_t>(&response->response);
+    guarantee(rget_response != nullptr);
+    ql::grouped_t<double> *grouped =
+        boost::get<ql::grouped_t<double> >(&rget_response->result);
+    guarantee(grouped != nullptr && grouped->size() == 1);
+    return grouped->begin()->second;
+}
+
+key_range_t make_range(const char *left, const char *right) {
+    return key_range_t(key_range_t::closed, store_key_t(left),
+                       key_range_t::open, store_key_t(right));
+}
+
+TPTEST(ReadResultCache, Keys) {
+    cond_t interruptor;
+    EXPECT_FALSE(read_result_cache_t::make_key(
+        make_range_read(false, make_range("a", "m"), {}), &interruptor).has_value());
+
+    optional<std::string> key = read_result_cache_t::make_key(
+        make_range_read(true, make_range("a", "m"), {}), &interruptor);
+    ASSERT_TRUE(key.has_value());
+    // The same read has the same key, even though it started at another time.
+    EXPECT_EQ(*key, *read_result_cache_t::make_key(
+        make_range_read(true, make_range("a", "m"), {}), &interruptor));
+    EXPECT_NE(*key, *read_result_cache_t::make_key(
+        make_range_read(true, make_range("a", "n"), {}), &interruptor));
+
+    // A function that reads a table can return something else every time.
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+    ql::sym_t x(1);
+    std::vector<ql::transform_variant_t> transforms;
+    transforms.push_back(ql::map_wire_func_t(
+        r.expr(ql::datum_t(1.0)).root_term(), make_vector(x)));
+    EXPECT_TRUE(read_result_cache_t::make_key(
+        make_range_read(true, make_range("a", "m"), transforms),
+        &interruptor).has_value());
+    transforms.clear();
+    transforms.push_back(ql::map_wire_func_t(
+        r.db("test").table("other").count().root_term(), make_vector(x)));
+    EXPECT_FALSE(read_result_cache_t::make_key(
+        make_range_read(true, make_range("a", "m"), transforms),
+        &interruptor).has_value());
+}
+
+TPTEST(ReadResultCache, Invalidation) {
+    perfmon_collection_t stats;
+    read_result_cache_t cache(&stats, MEGABYTE);
+    cond_t interruptor;
+
+    read_t left_read = make_range_read(true, make_range("a", "m"), {});
+    read_t right_read = make_range_read(true, make_range("m", "z"), {});
+    std::string left_key = *read_result_cache_t::make_key(left_read, &interruptor);
+    std::string right_key = *read_result_cache_t::make_key(right_read, &interruptor);
+
+    read_response_t response;
+    EXPECT_FALSE(cache.lookup(left_key, &response));
+    cache.insert(left_key, left_read, cache.generation(), make_sum_response(1));
+    cache.insert(right_key, right_read, cache.generation(), make_sum_response(2));
+    ASSERT_TRUE(cache.lookup(left_key, &response));
+    EXPECT_EQ(1, response_sum(&response));
+
+    // A change to a row in the left range only drops its result, and no result is
+    // used during the change.
+    {
+        read_result_cache_t::change_t change(&cache);
+        EXPECT_FALSE(cache.lookup(right_key, &response));
+        cache.invalidate(store_key_t("c"));
+    }
+    EXPECT_FALSE(cache.lookup(left_key, &response));
+    read_response_t right_response;
+    ASSERT_TRUE(cache.lookup(right_key, &right_response));
+    EXPECT_EQ(2, response_sum(&right_response));
+
+    // A read that started before a change doesn't store its result.
+    uint64_t generation = cache.generation();
+    {
+        read_result_cache_t::change_t change(&cache);
+    }
+    cache.insert(left_key, left_read, generation, make_sum_response(3));
+    EXPECT_FALSE(cache.lookup(left_key, &response));
+
+    cache.clear();
+    EXPECT_FALSE(cache.lookup(right_key, &response));
+}
+
+// Counts the rows of `store`, with a read whose result gets cached.
+uint64_t count_rows(store_t *store) {
+    read_t read = make_range_read(
+        true, key_range_t::universe(), {},
+        make_optional(ql::terminal_variant_t(ql::count_wire_func_t())));
+#ifndef NDEBUG
+    metainfo_checker_t metainfo_checker(store->get_region(),
+        [](const region_t &, const binary_blob_t &) { });
+#endif
+    read_token_t token;
+    store->new_read_token(&token);
+    read_response_t response;
+    cond_t interruptor;
+    store->read(DEBUG_ONLY(metainfo_checker, ) read, &response, &token, &interruptor);
+
+    rget_read_response_t *rget_response =
+        boost::get<rget_read_response_t>(&response.response);
+    guarantee(rget_response != nullptr);
+    ql::grouped_t<uint64_t> *counts =
+        boost::get<ql::grouped_t<uint64_t> >(&rget_response->result);
+    guarantee(counts != nullptr);
+    uint64_t count = 0;
+    for (const auto &pair : *counts) {
+        count += pair.second;
+    }
+    return count;
+}
+
+TPTEST(ReadResultCache, BulkLoadClearsResults) {
+    recreate_temporary_directory(base_path_t("."));
+    temp_file_t temp_file;
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    dummy_cache_balancer_t balancer(GIGABYTE);
+    filepath_file_opener_t file_opener(temp_file.name(), &io_backender);
+    log_serializer_t::create(&file_opener, log_serializer_t::static_config_t());
+    log_serializer_t serializer(log_serializer_t::dynamic_config_t(),
+                                &file_opener,
+                                &get_global_perfmon_collection());
+    rdb_context_t ctx;
+    store_t store(region_t::universe(), &serializer, &balancer, "unit_test_store",
+                  true, &get_global_perfmon_collection(), &ctx, &io_backender,
+                  base_path_t("."), generate_uuid(), update_sindexes_t::UPDATE,
+                  r_nullopt);
+
+    // The count of the empty table gets cached.
+    ASSERT_EQ(0u, count_rows(&store));
+    ASSERT_EQ(0u, count_rows(&store));
+
+    // An insert into the empty table that is big enough to be bulk loaded.
+    const uint64_t num_rows = 2 * BTREE_BULK_LOAD_MIN_BATCH_SIZE;
+    std::vector<ql::datum_t> rows;
+    for (uint64_t i = 0; i < num_rows; ++i) {
+        ql::datum_object_builder_t row;
+        row.overwrite("id", ql::datum_t(static_cast<double>(i)));
+        rows.push_back(std::move(row).to_datum());
+    }
+    write_t write(
+        batched_insert_t(std::move(rows), "id", r_nullopt,
+                         conflict_behavior_t::ERROR, r_nullopt,
+                         ql::configured_limits_t(), make_serializable_env(false),
+                         return_changes_t::NO),
+        profile_bool_t::DONT_PROFILE,
+        ql::configured_limits_t());
+#ifndef NDEBUG
+    metainfo_checker_t metainfo_checker(store.get_region(),
+        [](const region_t &, const binary_blob_t &) { });
+#endif
+    write_token_t token;
+    store.new_write_token(&token);
+    write_response_t response;
+    cond_t interruptor;
+    const state_timestamp_t timestamp = state_timestamp_t::zero().next();
+    store.write(DEBUG_ONLY(metainfo_checker, )
+                region_map_t<binary_blob_t>(store.get_region(), binary_blob_t(timestamp)),
+                write, &response, write_durability_t::SOFT, timestamp,
+                order_token_t::ignore, &token, &interruptor);
+
+    EXPECT_EQ(num_rows, count_rows(&store));
+}
+
+}  // namespace unittest
@@ -49,11 +49,8 @@ public:
         public:
             explicit writer_t(int _data) : data(_data) { }
             virtual ~writer_t() { }
-            void write(write_stream_t *stream) {
-                write_message_t wm;
-                serialize<cluster_version_t::CLUSTER>(&wm, data);
-                int res = send_write_message(stream, &wm);
-                if (res) { throw fake_archive_exc_t(); }
+            void write(write_message_t *wm) {
+                serialize<cluster_version_t::CLUSTER>(wm, data);
             }
 #ifdef ENABLE_MESSAGE_PROFILER
             const char *message_profiler_tag() const {
@@ -403,13 +400,12 @@ public:
             public cluster_send_message_write_callback_t {
         public:
             virtual ~dump_spectrum_writer_t() { }
-            void write(write_stream_t *stream) {
+            void write(write_message_t *wm) {
                 char spectrum[CHAR_MAX - CHAR_MIN + 1];
                 for (int i = CHAR_MIN; i <= CHAR_MAX; i++) {
                     spectrum[i - CHAR_MIN] = i;
                 }
-                int64_t res = stream->write(spectrum, CHAR_MAX - CHAR_MIN + 1);
-                if (res != CHAR_MAX - CHAR_MIN + 1) { throw fake_archive_exc_t(); }
+                wm->append(spectrum, CHAR_MAX - CHAR_MIN + 1);
             }
 #ifdef ENABLE_MESSAGE_PROFILER
             const char *message_profiler_tag() const {
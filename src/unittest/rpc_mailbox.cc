@@ -177,4 +177,55 @@ TPTEST_MULTITHREAD(RPCMailboxTest, TypedMailbox, 3) {
     }
 }
 
+/* `TypedMailboxWriteCallback` sends to a typed mailbox with a callback that reuses
+the serialization of the part of the message that doesn't change. */
+TPTEST_MULTITHREAD(RPCMailboxTest, TypedMailboxWriteCallback, 3) {
+    connectivity_cluster_t c;
+    mailbox_manager_t m(&c, 'M');
+    test_cluster_run_t r(&c);
+
+    std::vector<std::pair<std::string, int> > inbox;
+    mailbox_t<std::string, int> mbox(&m,
+        [&](signal_t *, const std::string &str, int i) {
+            inbox.push_back(std::make_pair(str, i));
+        });
+
+    class writer_t : public mailbox_write_callback_t {
+    public:
+        writer_t(write_message_t *_prefix, int _i) : prefix(_prefix), i(_i) { }
+        void write(cluster_version_t, write_message_t *wm) {
+            intrusive_list_t<write_buffer_t> *buffers = prefix->unsafe_expose_buffers();
+            for (write_buffer_t *b = buffers->head(); b != nullptr;
+                 b = buffers->next(b)) {
+                wm->append(b->data, b->size);
+            }
+            serialize<cluster_version_t::CLUSTER>(wm, i);
+        }
+#ifdef ENABLE_MESSAGE_PROFILER
+        const char *message_profiler_tag() const {
+            return "unittest";
+        }
+#endif
+    private:
+        write_message_t *prefix;
+        int i;
+    };
+
+    write_message_t prefix;
+    serialize<cluster_version_t::CLUSTER>(&prefix, std::string("foo"));
+    for (int i = 0; i < 3; ++i) {
+        writer_t writer(&prefix, i);
+        send_write(&m, mbox.get_address(), &writer);
+    }
+
+    let_stuff_happen();
+
+    ASSERT_EQ(3u, inbox.size());
+    std::sort(inbox.begin(), inbox.end());
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ("foo", inbox[i].first);
+        EXPECT_EQ(i, inbox[i].second);
+    }
+}
+
 }   /* namespace unittest */
@@ -0,0 +1,149 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/serialized_predicate.hpp"
+
+#include "containers/archive/vector_stream.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/func.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
+#include "rdb_protocol/wire_func.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+typedef ql::serialized_predicate_t::result_t result_t;
+
+// `{b: 2}`
+ql::datum_t b_object() {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("b", ql::datum_t(2.0));
+    return std::move(builder).to_datum();
+}
+
+std::vector<ql::datum_t> predicate_rows() {
+    ql::datum_t o = b_object();
+    std::vector<ql::datum_t> rows;
+    ql::datum_object_builder_t row1;
+    row1.overwrite("id", ql::datum_t(1.0));
+    row1.overwrite("a", ql::datum_t(5.0));
+    row1.overwrite("s", ql::datum_t("x"));
+    row1.overwrite("o", o);
+    rows.push_back(std::move(row1).to_datum());
+    ql::datum_object_builder_t row2;
+    row2.overwrite("id", ql::datum_t(2.0));
+    row2.overwrite("a", ql::datum_t(1.0));
+    row2.overwrite("s", ql::datum_t("y"));
+    rows.push_back(std::move(row2).to_datum());
+    ql::datum_object_builder_t row3;
+    row3.overwrite("id", ql::datum_t(3.0));
+    row3.overwrite("o", ql::datum_t(std::vector<ql::datum_t>{o},
+                                    ql::configured_limits_t::unlimited));
+    rows.push_back(std::move(row3).to_datum());
+    ql::datum_object_builder_t row4;
+    row4.overwrite("id", ql::datum_t(4.0));
+    row4.overwrite("a", ql::datum_t::null());
+    rows.push_back(std::move(row4).to_datum());
+    return rows;
+}
+
+std::vector<char> serialize_row(const ql::datum_t &row) {
+    write_message_t wm;
+    ql::serialization_result_t res =
+        ql::datum_serialize(&wm, row, ql::check_datum_serialization_errors_t::YES);
+    guarantee(!ql::bad(res));
+    vector_stream_t stream;
+    int write_res = send_write_message(&stream, &wm);
+    guarantee(write_res == 0);
+    return stream.vector();
+}
+
+// Tests `filter` on `predicate_rows()`, and checks that the predicate agrees with the
+// function wherever it decides.
+std::vector<result_t> test_filter(const ql::filter_wire_func_t &filter) {
+    scoped_ptr_t<ql::serialized_predicate_t> predicate =
+        ql::serialized_predicate_t::compile(filter);
+    guarantee(predicate.has());
+    cond_t interruptor;
+    ql::env_t env(&interruptor,
+                  ql::return_empty_normal_batches_t::NO,
+                  reql_version_t::LATEST);
+    counted_t<const ql::func_t> f = filter.filter_func.compile_wire_func();
+
+    std::vector<result_t> results;
+    for (const auto &row : predicate_rows()) {
+        std::vector<char> data = serialize_row(row);
+        result_t res = predicate->test(data.data(), data.size());
+        if (res != result_t::UNKNOWN) {
+            EXPECT_EQ(res == result_t::PASS,
+                      f->filter_call(&env, row, counted_t<const ql::func_t>()))
+                << row.print();
+        }
+        results.push_back(res);
+    }
+    return results;
+}
+
+ql::filter_wire_func_t make_filter(ql::minidriver_t::reql_t body, ql::sym_t x) {
+    return ql::filter_wire_func_t(ql::wire_func_t(body.root_term(), make_vector(x)),
+                                  r_nullopt);
+}
+
+TPTEST(SerializedPredicate, Comparisons) {
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+    ql::sym_t x(1);
+    const result_t PASS = result_t::PASS;
+    const result_t FAIL = result_t::FAIL;
+    const result_t UNKNOWN = result_t::UNKNOWN;
+
+    // Missing fields, and `null`, fail.
+    EXPECT_EQ(std::vector<result_t>({PASS, FAIL, FAIL, FAIL}),
+              test_filter(make_filter(r.var(x)["a"] > 3.0, x)));
+    EXPECT_EQ(std::vector<result_t>({PASS, FAIL, FAIL, FAIL}),
+              test_filter(make_filter(r.expr(3.0) < r.var(x)["a"], x)));
+    EXPECT_EQ(std::vector<result_t>({FAIL, PASS, FAIL, FAIL}),
+              test_filter(make_filter(
+                  !(r.var(x)["a"] == 5.0)
+                      && r.var(x)["s"].call(Term::NE, std::string("x")), x)));
+    EXPECT_EQ(std::vector<result_t>({PASS, PASS, FAIL, FAIL}),
+              test_filter(make_filter(
+                  r.var(x)["a"].call(Term::GE, 5.0)
+                      .call(Term::OR, r.var(x)["s"] == std::string("y")), x)));
+
+    // `row("o")("b")` plucks from the array of the third row, so only the function
+    // knows what it is.
+    EXPECT_EQ(std::vector<result_t>({PASS, FAIL, UNKNOWN, FAIL}),
+              test_filter(make_filter(r.var(x)["o"].bracket(std::string("b")) == 2.0,
+                                      x)));
+}
+
+TPTEST(SerializedPredicate, Object) {
+    // `filter({a: 5, o: {b: 2}})`
+    ql::datum_object_builder_t builder;
+    builder.overwrite("a", ql::datum_t(5.0));
+    builder.overwrite("o", b_object());
+    ql::filter_wire_func_t filter(
+        ql::new_constant_func(std::move(builder).to_datum(),
+                              ql::backtrace_id_t::empty()),
+        r_nullopt);
+    EXPECT_EQ(std::vector<result_t>({result_t::PASS, result_t::FAIL,
+                                     result_t::FAIL, result_t::FAIL}),
+              test_filter(filter));
+}
+
+TPTEST(SerializedPredicate, NotCompiled) {
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+    ql::sym_t x(1);
+    EXPECT_FALSE(ql::serialized_predicate_t::compile(
+        make_filter(r.var(x)["a"] + 1.0 > 3.0, x)).has());
+    EXPECT_FALSE(ql::serialized_predicate_t::compile(
+        make_filter(r.var(x)["a"] > r.var(x)["b"], x)).has());
+    // The default could be something other than `false`.
+    EXPECT_FALSE(ql::serialized_predicate_t::compile(
+        ql::filter_wire_func_t(
+            ql::wire_func_t((r.var(x)["a"] > 3.0).root_term(), make_vector(x)),
+            make_optional(ql::wire_func_t(r.boolean(true).root_term(),
+                                          std::vector<ql::sym_t>())))).has());
+}
+
+}  // namespace unittest
@@ -0,0 +1,54 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <atomic>
+#include <set>
+#include <vector>
+
+#include "arch/io/network.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "arch/timing.hpp"
+#include "concurrency/cond_var.hpp"
+#include "containers/scoped.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+void ignore_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &) { }
+
+TPTEST(TcpListenerTest, ShardedListenerFailsOnTakenPort, 3) {
+    std::set<ip_address_t> addresses({ip_address_t("127.0.0.1")});
+    sharded_tcp_listener_t listener(addresses, ANY_PORT, get_num_threads(),
+                                    &ignore_conn);
+
+    // The listeners are bound with `SO_REUSEPORT`, but a second sharded listener
+    // must not get to share their port.
+    ASSERT_THROW(make_scoped<sharded_tcp_listener_t>(addresses, listener.get_port(),
+                                                     get_num_threads(), &ignore_conn),
+                 address_in_use_exc_t);
+    ASSERT_THROW(make_scoped<tcp_listener_t>(addresses, listener.get_port(),
+                                             &ignore_conn),
+                 address_in_use_exc_t);
+}
+
+TPTEST(TcpListenerTest, ShardedListenerAcceptsConnections, 3) {
+    std::set<ip_address_t> addresses({ip_address_t("127.0.0.1")});
+    std::atomic<int> accepted(0);
+    sharded_tcp_listener_t listener(addresses, ANY_PORT, get_num_threads(),
+        [&](const scoped_ptr_t<tcp_conn_descriptor_t> &) {
+            ++accepted;
+        });
+
+    const int num_conns = 20;
+    std::vector<scoped_ptr_t<tcp_conn_t> > conns;
+    cond_t interruptor;
+    for (int i = 0; i < num_conns; ++i) {
+        conns.push_back(make_scoped<tcp_conn_t>(
+            ip_address_t("127.0.0.1"), listener.get_port(), &interruptor));
+    }
+    while (accepted.load() < num_conns) {
+        nap(10);
+    }
+    ASSERT_EQ(num_conns, accepted.load());
+}
+
+}  // namespace unittest